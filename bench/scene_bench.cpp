@@ -0,0 +1,2275 @@
+#include <max/max.h>
+#include <bimg/decode.h>
+#include <bx/commandline.h>
+#include <bx/file.h>
+#include <bx/os.h>
+#include <bx/timer.h>
+
+#include "world.h"
+#include "bvh.h"
+#include "components.h"
+#include "jobs.h"
+#include "mapped_file.h"
+#include "scene_format.h"
+#include "string_pool.h"
+#include "texture_cook.h"
+#include "texture_manager.h"
+#include "transform.h"
+#include "transform_kernel.h"
+#include "virtual_texture.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if BX_PLATFORM_WINDOWS
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif // WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#	include <psapi.h>
+#else
+#	include <sys/resource.h>
+#endif // BX_PLATFORM_WINDOWS
+
+// Headless scene load/save benchmark. Runs on the Noop renderer, generates a synthetic
+// scene and reports timings of the scene pipeline:
+//
+//   max-demo-bench [--entities N] [--meshes N] [--vertices N] [--textures N]
+//                  [--iterations N] [--threads N] [--deltas N] [--out path] [--test]
+//
+// Each line is a measurement with p50 and p99 in milliseconds and throughput in MB/s where
+// the measured bytes are known, followed by peak RSS once done. Checks print "ok" or
+// "FAILED", any failure makes the exit code non-zero. Numbers depend on the machine and
+// build, record them with the command line used when comparing changes.
+//
+// With --test only the checks run, on a small scene unless sizes are given, and the exit
+// code reports whether all of them passed. Registered with CTest.
+
+/// Benchmark settings, see command line options above.
+///
+struct BenchSettings
+{
+	uint32_t m_numEntities   = 10000;
+	uint32_t m_numMeshes     = 100;
+	uint32_t m_numVertices   = 4096;
+	uint32_t m_numTextures   = 0;
+	uint32_t m_numIterations = 10;
+	uint32_t m_numThreads    = 0;
+	uint32_t m_numDeltas     = 100;
+	const char* m_filepath   = "bench/scene.bin";
+	bool m_test              = false;
+};
+
+/// Timings of one measurement in milliseconds.
+///
+struct BenchSamples
+{
+	void add(int64_t _begin, int64_t _end)
+	{
+		m_ms.push_back(double(_end - _begin) * 1000.0 / double(bx::getHPFrequency()));
+	}
+
+	double percentile(double _p)
+	{
+		std::sort(m_ms.begin(), m_ms.end());
+		const size_t idx = size_t(_p * double(m_ms.size() - 1) + 0.5);
+		return m_ms[bx::min(idx, m_ms.size() - 1)];
+	}
+
+	std::vector<double> m_ms;
+};
+
+static uint32_t s_rng = 0x9e3779b9;
+
+static uint32_t rand32()
+{
+	// xorshift32, deterministic across runs and platforms.
+	s_rng ^= s_rng << 13;
+	s_rng ^= s_rng >> 17;
+	s_rng ^= s_rng << 5;
+	return s_rng;
+}
+
+static float randFloat(float _min, float _max)
+{
+	return _min + (_max - _min) * float(rand32() & 0xffffff) / float(0xffffff);
+}
+
+static uint64_t getPeakRss()
+{
+#if BX_PLATFORM_WINDOWS
+	PROCESS_MEMORY_COUNTERS pmc;
+	GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc));
+	return uint64_t(pmc.PeakWorkingSetSize);
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#	if BX_PLATFORM_OSX
+	return uint64_t(usage.ru_maxrss);
+#	else
+	return uint64_t(usage.ru_maxrss) * 1024;
+#	endif // BX_PLATFORM_OSX
+#endif // BX_PLATFORM_WINDOWS
+}
+
+static uint64_t getFileSize(const bx::FilePath& _filepath)
+{
+	bx::FileInfo info;
+	return bx::stat(info, _filepath) ? info.size : 0;
+}
+
+static void report(const char* _name, BenchSamples& _samples, uint64_t _bytes)
+{
+	const double p50 = _samples.percentile(0.5);
+	const double p99 = _samples.percentile(0.99);
+
+	printf("%-28s p50 %10.3f ms   p99 %10.3f ms", _name, p50, p99);
+	if (0 != _bytes)
+	{
+		printf("   %10.1f MB/s", double(_bytes) / (1024.0 * 1024.0) / (p50 / 1000.0));
+	}
+	printf("\n");
+}
+
+/// Let the renderer consume destroyed resources and release referenced memory.
+static void flushFrames()
+{
+	max::frame();
+	max::frame();
+}
+
+static max::MeshHandle createBenchMesh(uint32_t _numVertices)
+{
+	// Same layout as meshes coming from the Maya bridge.
+	max::VertexLayout layout;
+	layout.begin()
+		.add(max::Attrib::Position, 3, max::AttribType::Float)
+		.add(max::Attrib::Normal, 3, max::AttribType::Float)
+		.add(max::Attrib::TexCoord0, 2, max::AttribType::Float)
+		.end();
+
+	// Noisy grid, close enough to real geometry for the codecs.
+	const uint32_t size = bx::max<uint32_t>(uint32_t(bx::sqrt(float(_numVertices))), 2);
+	const uint32_t numVertices = size * size;
+	const uint32_t numIndices = (size - 1) * (size - 1) * 6;
+
+	const max::Memory* vertices = max::alloc(layout.getSize(numVertices));
+	float* vertex = (float*)vertices->data;
+	for (uint32_t yy = 0; yy < size; ++yy)
+	{
+		for (uint32_t xx = 0; xx < size; ++xx)
+		{
+			*vertex++ = float(xx);
+			*vertex++ = randFloat(-0.1f, 0.1f);
+			*vertex++ = float(yy);
+			*vertex++ = randFloat(0.45f, 0.55f);
+			*vertex++ = 1.0f;
+			*vertex++ = randFloat(0.45f, 0.55f);
+			*vertex++ = float(xx) / float(size - 1);
+			*vertex++ = float(yy) / float(size - 1);
+		}
+	}
+
+	const max::Memory* indices = max::alloc(numIndices * sizeof(uint32_t));
+	uint32_t* index = (uint32_t*)indices->data;
+	for (uint32_t yy = 0; yy < size - 1; ++yy)
+	{
+		for (uint32_t xx = 0; xx < size - 1; ++xx)
+		{
+			const uint32_t base = yy * size + xx;
+			*index++ = base;
+			*index++ = base + size;
+			*index++ = base + 1;
+			*index++ = base + 1;
+			*index++ = base + size;
+			*index++ = base + size + 1;
+		}
+	}
+
+	return max::createMesh(vertices, indices, layout);
+}
+
+/// Write square uncompressed 32-bit TGA, pixels are BGRA.
+static bool writeTga(const char* _filepath, uint32_t _size, const uint32_t* _pixels)
+{
+	uint8_t header[18] = {};
+	header[2] = 2;
+	header[12] = uint8_t(_size);
+	header[13] = uint8_t(_size >> 8);
+	header[14] = uint8_t(_size);
+	header[15] = uint8_t(_size >> 8);
+	header[16] = 32;
+	header[17] = 8;
+
+	bx::Error err;
+	bx::FileWriter writer;
+	if (!bx::open(&writer, _filepath, false, &err))
+	{
+		return false;
+	}
+
+	bx::write(&writer, header, sizeof(header), &err);
+	bx::write(&writer, _pixels, int32_t(_size * _size * sizeof(uint32_t)), &err);
+	bx::close(&writer);
+
+	return err.isOk();
+}
+
+static bool writeBenchTexture(const char* _filepath, uint32_t _size)
+{
+	std::vector<uint32_t> pixels(_size * _size);
+	for (uint32_t& pixel : pixels)
+	{
+		pixel = rand32() | 0xff000000;
+	}
+
+	return writeTga(_filepath, _size, pixels.data() );
+}
+
+static bool writeSolidTga(const char* _filepath, uint32_t _size, uint8_t _r, uint8_t _g, uint8_t _b)
+{
+	const std::vector<uint32_t> pixels(_size * _size, uint32_t(_b) | uint32_t(_g) << 8 | uint32_t(_r) << 16 | 0xff000000);
+	return writeTga(_filepath, _size, pixels.data() );
+}
+
+/// Read texture, converted to RGBA8 unless format is Count.
+static bimg::ImageContainer* readTexture(const char* _filepath, bimg::TextureFormat::Enum _format)
+{
+	MappedFile file;
+	if (!file.open(_filepath) )
+	{
+		return NULL;
+	}
+
+	bimg::ImageContainer* image = bimg::imageParse(max::getAllocator(), file.m_data, uint32_t(file.m_size), _format);
+	file.close();
+	return image;
+}
+
+static TransformComponent randomTransform()
+{
+	return {
+		{ randFloat(-500.0f, 500.0f), randFloat(-10.0f, 10.0f), randFloat(-500.0f, 500.0f) },
+		{ 0.0f, 0.0f, 0.0f, 1.0f },
+		{ 1.0f, 1.0f, 1.0f }
+	};
+}
+
+/// Move entity to random transform, keeping its world matrix slot.
+static void randomizeTransform(TransformComponent& _tc)
+{
+	const TransformComponent transform = randomTransform();
+	_tc.m_position = transform.m_position;
+	_tc.m_rotation = transform.m_rotation;
+	_tc.m_scale = transform.m_scale;
+}
+
+static void createBenchEntity(World& _world, const char* _name, max::MeshHandle _mesh, const char* _texture)
+{
+	max::EntityHandle entity = max::createEntity();
+
+	max::addComponent<TransformComponent>(entity, max::createComponent<TransformComponent>(randomTransform()));
+
+	_world.acquireMesh(_mesh);
+	max::addComponent<RenderComponent>(entity, max::createComponent<RenderComponent>({ _mesh, true, MeshBounds() }));
+
+	MaterialComponent::Texture emptyTexture;
+	emptyTexture.m_filepath = "";
+	emptyTexture.m_texture = MAX_INVALID_HANDLE;
+
+	MaterialComponent mc = {
+		emptyTexture, { 1.0f, 1.0f, 1.0f },
+		emptyTexture, { 1.0f, 1.0f, 1.0f },
+		emptyTexture, 1.0f,
+		emptyTexture, 1.0f,
+		emptyTexture
+	};
+
+	if (NULL != _texture)
+	{
+		mc.m_diffuse.m_filepath = stringIntern(_texture);
+		mc.m_diffuse.m_texture = _world.m_textureManager.load(mc.m_diffuse.m_filepath);
+	}
+
+	max::addComponent<MaterialComponent>(entity, max::createComponent<MaterialComponent>(mc));
+
+	_world.m_entities[_name].m_handle = entity;
+}
+
+static void generateWorld(World& _world, const BenchSettings& _settings)
+{
+	bx::FilePath filepath(_settings.m_filepath);
+	bx::makeAll(filepath.getPath());
+	bx::strCopy(_world.m_filepath, sizeof(_world.m_filepath), _settings.m_filepath);
+
+	std::vector<max::MeshHandle> meshes(_settings.m_numMeshes);
+	for (max::MeshHandle& mesh : meshes)
+	{
+		mesh = createBenchMesh(_settings.m_numVertices);
+	}
+
+	std::vector<std::string> textures(_settings.m_numTextures);
+	for (uint32_t ii = 0; ii < _settings.m_numTextures; ++ii)
+	{
+		char path[bx::kMaxFilePath];
+		const bx::StringView dir = filepath.getPath();
+		bx::snprintf(path, sizeof(path), "%.*s/texture_%u.tga", dir.getLength(), dir.getPtr(), ii);
+		writeBenchTexture(path, 256);
+		textures[ii] = path;
+	}
+
+	for (uint32_t ii = 0; ii < _settings.m_numEntities; ++ii)
+	{
+		char name[64];
+		bx::snprintf(name, sizeof(name), "entity_%u", ii);
+
+		createBenchEntity(_world
+			, name
+			, meshes[ii % meshes.size()]
+			, textures.empty() ? NULL : textures[ii % textures.size()].c_str()
+			);
+	}
+
+	// Meshes are owned by referencing entities, drop those nothing references.
+	for (max::MeshHandle mesh : meshes)
+	{
+		if (_world.m_meshRefs.end() == _world.m_meshRefs.find(mesh.idx))
+		{
+			max::destroy(mesh);
+		}
+	}
+}
+
+static void benchSaveLoad(World& _world, const BenchSettings& _settings)
+{
+	const bx::FilePath filepath(_settings.m_filepath);
+
+	BenchSamples save;
+	BenchSamples load;
+	for (uint32_t ii = 0; ii < _settings.m_numIterations; ++ii)
+	{
+		int64_t begin = bx::getHPCounter();
+		_world.serializeFull();
+		save.add(begin, bx::getHPCounter());
+
+		_world.unload();
+		flushFrames();
+
+		begin = bx::getHPCounter();
+		_world.deserialize();
+		load.add(begin, bx::getHPCounter());
+	}
+
+	const uint64_t size = getFileSize(filepath);
+	printf("scene %s, %.2f MB\n", _settings.m_filepath, double(size) / (1024.0 * 1024.0));
+	report("serialize", save, size);
+	report("deserialize", load, size);
+}
+
+static bool benchDedup(World& _world, const BenchSettings& _settings)
+{
+	// Same world saved with every mesh stored per entity, and with identical meshes stored once.
+	const bx::FilePath filepath(_settings.m_filepath);
+	const uint32_t numEntities = uint32_t(_world.m_entities.size());
+
+	bool ok = true;
+	uint64_t size[2] = {};
+	BenchSamples load[2];
+	for (uint32_t dedup = 0; dedup < 2; ++dedup)
+	{
+		_world.m_dedupMeshes = 0 != dedup;
+		ok &= _world.serializeFull();
+		size[dedup] = getFileSize(filepath);
+
+		for (uint32_t ii = 0; ii < _settings.m_numIterations && ok; ++ii)
+		{
+			_world.unload();
+			flushFrames();
+
+			const int64_t begin = bx::getHPCounter();
+			ok &= _world.deserialize();
+			load[dedup].add(begin, bx::getHPCounter());
+
+			ok &= numEntities == _world.m_entities.size();
+		}
+	}
+
+	_world.m_dedupMeshes = TG_CONFIG_SCENE_DEDUP;
+	ok &= _world.serializeFull();
+
+	report("deserialize without dedup", load[0], size[0]);
+	report("deserialize with dedup", load[1], size[1]);
+	printf("%-28s %.2f MB -> %.2f MB (%.1fx smaller), %.1fx faster load, %s\n"
+		, ""
+		, double(size[0]) / (1024.0 * 1024.0)
+		, double(size[1]) / (1024.0 * 1024.0)
+		, double(size[0]) / double(bx::max<uint64_t>(size[1], 1) )
+		, load[0].percentile(0.5) / bx::max(load[1].percentile(0.5), 0.001)
+		, ok ? "ok" : "FAILED"
+		);
+
+	return ok;
+}
+
+/// Write world in the stream layout scenes had before the scene container: entity count, then
+/// per entity a fixed size name, component flags, inline geometry and fixed size texture paths.
+static bool writeLegacyScene(World& _world, const bx::FilePath& _filepath)
+{
+	bx::Error err;
+	bx::FileWriter writer;
+	if (!bx::open(&writer, _filepath, false, &err))
+	{
+		return false;
+	}
+
+	const uint32_t numEntities = uint32_t(_world.m_entities.size());
+	bx::write(&writer, &numEntities, sizeof(uint32_t), &err);
+
+	char str[kSceneMaxPath];
+	for (auto it = _world.m_entities.begin(); it != _world.m_entities.end(); ++it)
+	{
+		bx::memSet(str, 0, sizeof(str));
+		bx::strCopy(str, sizeof(str), it->first.c_str());
+		bx::write(&writer, str, kSceneMaxPath, &err);
+
+		const TransformComponent* tc = max::getComponent<TransformComponent>(it->second.m_handle);
+		const bool hasTransform = NULL != tc;
+		bx::write(&writer, &hasTransform, sizeof(bool), &err);
+		if (hasTransform)
+		{
+			bx::write(&writer, &tc->m_position, sizeof(bx::Vec3), &err);
+			bx::write(&writer, &tc->m_rotation, sizeof(bx::Quaternion), &err);
+			bx::write(&writer, &tc->m_scale, sizeof(bx::Vec3), &err);
+		}
+
+		const RenderComponent* rc = max::getComponent<RenderComponent>(it->second.m_handle);
+		const bool hasRender = NULL != rc;
+		bx::write(&writer, &hasRender, sizeof(bool), &err);
+		if (hasRender)
+		{
+			max::MeshQuery* query = max::queryMesh(rc->m_mesh);
+			const max::MeshQuery::Data& data = query->m_data[0];
+			const max::VertexLayout layout = max::getLayout(rc->m_mesh);
+
+			const uint32_t num = 1;
+			bx::write(&writer, &num, sizeof(uint32_t), &err);
+			bx::write(&writer, &layout.m_hash, sizeof(uint32_t), &err);
+			bx::write(&writer, &layout.m_stride, sizeof(uint16_t), &err);
+			bx::write(&writer, layout.m_offset, sizeof(uint16_t) * max::Attrib::Count, &err);
+			bx::write(&writer, layout.m_attributes, sizeof(uint16_t) * max::Attrib::Count, &err);
+
+			const uint32_t verticesSize = layout.getSize(data.m_numVertices);
+			bx::write(&writer, &verticesSize, sizeof(uint32_t), &err);
+			bx::write(&writer, data.m_vertices, int32_t(verticesSize), &err);
+
+			const uint32_t indicesSize = data.m_numIndices * sizeof(uint32_t);
+			bx::write(&writer, &indicesSize, sizeof(uint32_t), &err);
+			bx::write(&writer, data.m_indices, int32_t(indicesSize), &err);
+		}
+
+		const MaterialComponent* mc = max::getComponent<MaterialComponent>(it->second.m_handle);
+		const bool hasMaterial = NULL != mc;
+		bx::write(&writer, &hasMaterial, sizeof(bool), &err);
+		if (hasMaterial)
+		{
+			const char* paths[] = { mc->m_diffuse.m_filepath, mc->m_normal.m_filepath, mc->m_roughness.m_filepath, mc->m_metallic.m_filepath };
+			for (const char* path : paths)
+			{
+				const bool hasTexture = 0 != bx::strLen(path);
+				bx::write(&writer, &hasTexture, sizeof(bool), &err);
+				if (hasTexture)
+				{
+					bx::memSet(str, 0, sizeof(str));
+					bx::strCopy(str, sizeof(str), path);
+					bx::write(&writer, str, kSceneMaxPath, &err);
+				}
+			}
+
+			bx::write(&writer, mc->m_diffuseFactor, sizeof(float) * 3, &err);
+			bx::write(&writer, mc->m_normalFactor, sizeof(float) * 3, &err);
+			bx::write(&writer, &mc->m_roughnessFactor, sizeof(float), &err);
+			bx::write(&writer, &mc->m_metallicFactor, sizeof(float), &err);
+		}
+	}
+
+	bx::close(&writer);
+	return err.isOk();
+}
+
+/// Load legacy scene like World::deserialize did before the scene container, a read per field
+/// and a copy of every vertex and index blob.
+static bool loadLegacyScene(World& _world, const bx::FilePath& _filepath)
+{
+	bx::Error err;
+	bx::FileReader reader;
+	if (!bx::open(&reader, _filepath, &err))
+	{
+		return false;
+	}
+
+	uint32_t numEntities = 0;
+	bx::read(&reader, &numEntities, sizeof(uint32_t), &err);
+
+	char str[kSceneMaxPath];
+	for (uint32_t ii = 0; ii < numEntities && err.isOk(); ++ii)
+	{
+		bx::read(&reader, str, kSceneMaxPath, &err);
+		str[kSceneMaxPath - 1] = '\0';
+
+		max::EntityHandle entity = max::createEntity();
+		_world.m_entities[str].m_handle = entity;
+
+		bool hasTransform = false;
+		bx::read(&reader, &hasTransform, sizeof(bool), &err);
+		if (hasTransform)
+		{
+			float data[10];
+			bx::read(&reader, data, sizeof(data), &err);
+			max::addComponent<TransformComponent>(entity, max::createComponent<TransformComponent>({
+				{ data[0], data[1], data[2] },
+				{ data[3], data[4], data[5], data[6] },
+				{ data[7], data[8], data[9] }
+			}));
+		}
+
+		bool hasRender = false;
+		bx::read(&reader, &hasRender, sizeof(bool), &err);
+		if (hasRender)
+		{
+			uint32_t num = 0;
+			bx::read(&reader, &num, sizeof(uint32_t), &err);
+
+			max::VertexLayout layout;
+			bx::read(&reader, &layout.m_hash, sizeof(uint32_t), &err);
+			bx::read(&reader, &layout.m_stride, sizeof(uint16_t), &err);
+			bx::read(&reader, layout.m_offset, sizeof(uint16_t) * max::Attrib::Count, &err);
+			bx::read(&reader, layout.m_attributes, sizeof(uint16_t) * max::Attrib::Count, &err);
+
+			uint32_t verticesSize = 0;
+			bx::read(&reader, &verticesSize, sizeof(uint32_t), &err);
+			const max::Memory* vertices = max::alloc(verticesSize);
+			bx::read(&reader, vertices->data, int32_t(verticesSize), &err);
+
+			uint32_t indicesSize = 0;
+			bx::read(&reader, &indicesSize, sizeof(uint32_t), &err);
+			const max::Memory* indices = max::alloc(indicesSize);
+			bx::read(&reader, indices->data, int32_t(indicesSize), &err);
+
+			const max::MeshHandle mesh = max::createMesh(vertices, indices, layout);
+			_world.acquireMesh(mesh);
+			max::addComponent<RenderComponent>(entity, max::createComponent<RenderComponent>({ mesh, false, _world.getMeshBounds(mesh) }));
+		}
+
+		bool hasMaterial = false;
+		bx::read(&reader, &hasMaterial, sizeof(bool), &err);
+		if (hasMaterial)
+		{
+			MaterialComponent mc;
+			MaterialComponent::Texture* textures[] = { &mc.m_diffuse, &mc.m_normal, &mc.m_roughness, &mc.m_metallic };
+			for (MaterialComponent::Texture* texture : textures)
+			{
+				texture->m_texture = MAX_INVALID_HANDLE;
+				texture->m_filepath = "";
+
+				bool hasTexture = false;
+				bx::read(&reader, &hasTexture, sizeof(bool), &err);
+				if (hasTexture)
+				{
+					bx::read(&reader, str, kSceneMaxPath, &err);
+					str[kSceneMaxPath - 1] = '\0';
+					texture->m_filepath = stringIntern(str);
+				}
+			}
+			_world.loadMaterial(entity, mc);
+
+			bx::read(&reader, mc.m_diffuseFactor, sizeof(float) * 3, &err);
+			bx::read(&reader, mc.m_normalFactor, sizeof(float) * 3, &err);
+			bx::read(&reader, &mc.m_roughnessFactor, sizeof(float), &err);
+			bx::read(&reader, &mc.m_metallicFactor, sizeof(float), &err);
+			max::addComponent<MaterialComponent>(entity, max::createComponent<MaterialComponent>(mc));
+		}
+	}
+
+	bx::close(&reader);
+	return err.isOk();
+}
+
+static bool benchLegacy(World& _world, const BenchSettings& _settings)
+{
+	// Same world in the legacy stream layout, loaded by the legacy reader, converted, and loaded as container.
+	char path[bx::kMaxFilePath];
+	bx::snprintf(path, sizeof(path), "%s.legacy", _settings.m_filepath);
+	const bx::FilePath legacy(path);
+	const bx::FilePath converted = sceneConvertedPath(legacy);
+
+	_world.serializeFull();
+
+	bool ok = writeLegacyScene(_world, legacy);
+	const uint32_t numEntities = uint32_t(_world.m_entities.size());
+
+	BenchSamples legacyLoad;
+	BenchSamples convert;
+	BenchSamples load;
+	for (uint32_t ii = 0; ii < _settings.m_numIterations && ok; ++ii)
+	{
+		_world.unload();
+		flushFrames();
+
+		int64_t begin = bx::getHPCounter();
+		ok &= loadLegacyScene(_world, legacy);
+		legacyLoad.add(begin, bx::getHPCounter());
+
+		ok &= numEntities == _world.m_entities.size();
+
+		_world.unload();
+		flushFrames();
+
+		begin = bx::getHPCounter();
+		ok &= sceneConvertLegacy(legacy, converted);
+		convert.add(begin, bx::getHPCounter());
+
+		begin = bx::getHPCounter();
+		ok &= _world.deserialize();
+		load.add(begin, bx::getHPCounter());
+
+		ok &= numEntities == _world.m_entities.size();
+	}
+
+	const uint64_t legacySize = getFileSize(legacy);
+	const uint64_t size = getFileSize(bx::FilePath(_settings.m_filepath));
+
+	report("deserialize legacy stream", legacyLoad, legacySize);
+	report("convert legacy", convert, legacySize);
+	report("deserialize container", load, size);
+	printf("%-28s %.2f MB legacy, %.2f MB container, %.1fx faster load, %s\n"
+		, ""
+		, double(legacySize) / (1024.0 * 1024.0)
+		, double(size) / (1024.0 * 1024.0)
+		, legacyLoad.percentile(0.5) / bx::max(load.percentile(0.5), 0.001)
+		, ok ? "ok" : "FAILED"
+		);
+
+	bx::remove(legacy);
+	bx::remove(converted);
+
+	return ok;
+}
+
+static void benchCompression(World& _world, const BenchSettings& _settings)
+{
+	const bx::FilePath filepath(_settings.m_filepath);
+
+	const uint32_t modes[] = { SceneCompression::None, SceneCompression::Lossless, SceneCompression::All };
+	const char* names[] = { "raw", "lossless", "quantized" };
+
+	for (uint32_t mode = 0; mode < BX_COUNTOF(modes); ++mode)
+	{
+		_world.m_compression = modes[mode];
+		_world.serializeFull();
+
+		// Decode throughput of geometry alone, in decoded bytes.
+		SceneFile* scene = SceneFile::open(filepath);
+		if (NULL == scene)
+		{
+			continue;
+		}
+
+		const SceneHeader* header = scene->getHeader();
+		const SceneMesh* meshes = scene->getMeshes();
+		const uint64_t geometrySize = header->m_sections[SceneSection::Geometry].m_size;
+		const uint8_t* geometry = scene->m_file.m_data + header->m_sections[SceneSection::Geometry].m_offset;
+
+		BenchSamples decode;
+		uint64_t decodedSize = 0;
+		for (uint32_t ii = 0; ii < _settings.m_numIterations; ++ii)
+		{
+			decodedSize = 0;
+
+			const int64_t begin = bx::getHPCounter();
+			for (uint32_t jj = 0; jj < header->m_numMeshes; ++jj)
+			{
+				void* vertices;
+				void* indices;
+				sceneDecodeMesh(meshes[jj], geometry, vertices, indices);
+
+				if (NULL != vertices)
+				{
+					bx::free(max::getAllocator(), vertices);
+				}
+				if (NULL != indices)
+				{
+					bx::free(max::getAllocator(), indices);
+				}
+
+				decodedSize += meshes[jj].m_verticesSize + meshes[jj].m_indicesSize;
+			}
+			decode.add(begin, bx::getHPCounter());
+		}
+
+		scene->release();
+
+		BenchSamples load;
+		for (uint32_t ii = 0; ii < _settings.m_numIterations; ++ii)
+		{
+			_world.unload();
+			flushFrames();
+
+			const int64_t begin = bx::getHPCounter();
+			_world.deserialize();
+			load.add(begin, bx::getHPCounter());
+		}
+
+		char name[64];
+		printf("%s: %.2f MB on disk, %.2f MB geometry\n", names[mode]
+			, double(getFileSize(filepath)) / (1024.0 * 1024.0)
+			, double(geometrySize) / (1024.0 * 1024.0)
+			);
+		bx::snprintf(name, sizeof(name), "decode %s", names[mode]);
+		report(name, decode, decodedSize);
+		bx::snprintf(name, sizeof(name), "deserialize %s", names[mode]);
+		report(name, load, getFileSize(filepath));
+	}
+
+	_world.m_compression = TG_CONFIG_SCENE_COMPRESSION;
+	_world.serializeFull();
+}
+
+static void benchVerify(const BenchSettings& _settings)
+{
+	const bx::FilePath filepath(_settings.m_filepath);
+
+	BenchSamples open;
+	BenchSamples verify;
+	for (uint32_t ii = 0; ii < _settings.m_numIterations; ++ii)
+	{
+		int64_t begin = bx::getHPCounter();
+		SceneFile* scene = SceneFile::open(filepath);
+		open.add(begin, bx::getHPCounter());
+
+		if (NULL == scene)
+		{
+			return;
+		}
+
+		begin = bx::getHPCounter();
+		if (!scene->verify())
+		{
+			printf("verify FAILED\n");
+		}
+		verify.add(begin, bx::getHPCounter());
+
+		scene->release();
+	}
+
+	const uint64_t size = getFileSize(filepath);
+	report("open", open, size);
+	report("verify", verify, size);
+}
+
+static void benchThreads(World& _world, const BenchSettings& _settings)
+{
+	const bx::FilePath filepath(_settings.m_filepath);
+	const uint32_t maxThreads = jobsGetNumThreads();
+
+	for (uint32_t numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+	{
+		jobsDestroy();
+		jobsCreate(numThreads);
+
+		BenchSamples load;
+		for (uint32_t ii = 0; ii < _settings.m_numIterations; ++ii)
+		{
+			_world.unload();
+			flushFrames();
+
+			const int64_t begin = bx::getHPCounter();
+			_world.deserialize();
+			load.add(begin, bx::getHPCounter());
+		}
+
+		char name[64];
+		bx::snprintf(name, sizeof(name), "deserialize %u threads", numThreads);
+		report(name, load, getFileSize(filepath));
+	}
+
+	jobsDestroy();
+	jobsCreate(maxThreads);
+}
+
+static void benchAsync(World& _world, const BenchSettings& _settings)
+{
+	BenchSamples sync;
+	BenchSamples firstFrame;
+	BenchSamples complete;
+	uint32_t numFrames = 0;
+
+	for (uint32_t ii = 0; ii < _settings.m_numIterations; ++ii)
+	{
+		_world.unload();
+		flushFrames();
+
+		// Blocking load, first frame follows once everything is resident.
+		int64_t begin = bx::getHPCounter();
+		_world.deserialize();
+		max::frame();
+		sync.add(begin, bx::getHPCounter());
+
+		_world.unload();
+		flushFrames();
+
+		begin = bx::getHPCounter();
+		_world.loadAsync(_settings.m_filepath);
+
+		numFrames = 0;
+		uint32_t loaded;
+		uint32_t total;
+		do
+		{
+			_world.update();
+			max::frame();
+
+			if (0 == numFrames++)
+			{
+				firstFrame.add(begin, bx::getHPCounter());
+			}
+		}
+		while (_world.getLoadProgress(loaded, total));
+
+		complete.add(begin, bx::getHPCounter());
+	}
+
+	report("first frame, load", sync, 0);
+	report("first frame, loadAsync", firstFrame, 0);
+	printf("%-28s %u frames\n", "loadAsync complete", numFrames);
+	report("loadAsync complete", complete, 0);
+}
+
+static bool testTextureCache(const BenchSettings& _settings)
+{
+	// Released textures stay cached within budget, least recently released are evicted first.
+	const bx::StringView dir = bx::FilePath(_settings.m_filepath).getPath();
+	bx::makeAll(dir);
+
+	constexpr uint32_t kNumTextures = 4;
+	std::string paths[kNumTextures];
+	bool result = true;
+
+	for (uint32_t ii = 0; ii < kNumTextures; ++ii)
+	{
+		char path[bx::kMaxFilePath];
+		bx::snprintf(path, sizeof(path), "%.*s/cache_test_%u.tga", dir.getLength(), dir.getPtr(), ii);
+		result &= writeBenchTexture(path, 64);
+		paths[ii] = path;
+	}
+
+	TextureManager tm;
+
+	max::TextureHandle handles[kNumTextures];
+	for (uint32_t ii = 0; ii < kNumTextures; ++ii)
+	{
+		handles[ii] = tm.load(paths[ii].c_str() );
+		result &= isValid(handles[ii]);
+	}
+
+	auto isLoaded = [&](uint32_t _ii)
+	{
+		return PathTable<TextureRef>::kInvalid != tm.m_textures.find(paths[_ii].c_str() );
+	};
+
+	auto isCached = [&](uint32_t _ii)
+	{
+		const uint32_t idx = tm.m_textures.find(paths[_ii].c_str() );
+		return PathTable<TextureRef>::kInvalid != idx && tm.m_textures[idx].m_cached;
+	};
+
+	// Room for two textures of the same size.
+	const uint32_t idx = tm.m_textures.find(paths[0].c_str() );
+	const uint64_t size = PathTable<TextureRef>::kInvalid != idx ? tm.m_textures[idx].m_size : 0;
+	tm.m_cacheBudget = size * 2;
+	result &= 0 != size;
+
+	tm.unload(paths[0].c_str() );
+	tm.unload(paths[1].c_str() );
+	result &= isCached(0) && isCached(1);
+	result &= 0 == tm.getCacheStats().m_numEvictions;
+
+	// Over budget, texture released first goes first.
+	tm.unload(paths[2].c_str() );
+	result &= !isLoaded(0) && isCached(1) && isCached(2);
+
+	tm.unload(paths[3].c_str() );
+	result &= !isLoaded(1) && isCached(2) && isCached(3);
+
+	const TextureCacheStats& stats = tm.getCacheStats();
+	result &= 2 == stats.m_numEvictions;
+	result &= 2 == stats.m_num;
+	result &= stats.m_size <= tm.m_cacheBudget;
+
+	// Reloading a cached texture returns it without I/O, an evicted one is loaded again.
+	const uint32_t numMisses = stats.m_numMisses;
+	result &= handles[2].idx == tm.load(paths[2].c_str() ).idx;
+	result &= !isCached(2) && 1 == stats.m_numHits && numMisses == stats.m_numMisses;
+
+	result &= isValid(tm.load(paths[0].c_str() ) );
+	result &= numMisses + 1 == stats.m_numMisses;
+
+	// Textures in use aren't evicted, trimming drops everything released.
+	tm.trimCache(0);
+	result &= isLoaded(0) && isLoaded(2) && !isLoaded(3);
+
+	tm.unload(paths[0].c_str() );
+	tm.unload(paths[2].c_str() );
+	tm.trimCache(0);
+	result &= 0 == stats.m_num && 0 == stats.m_size;
+
+	for (uint32_t ii = 0; ii < kNumTextures; ++ii)
+	{
+		result &= !isLoaded(ii);
+		bx::remove(paths[ii].c_str() );
+	}
+
+	flushFrames();
+
+	printf("%-28s %s\n", "texture cache eviction", result ? "ok" : "FAILED");
+	return result;
+}
+
+static bool testTextureReload(const BenchSettings& _settings)
+{
+#if TG_CONFIG_TEXTURE_HOT_RELOAD
+	const bx::StringView dir = bx::FilePath(_settings.m_filepath).getPath();
+	bx::makeAll(dir);
+
+	char path[bx::kMaxFilePath];
+	bx::snprintf(path, sizeof(path), "%.*s/reload_test.tga", dir.getLength(), dir.getPtr() );
+
+	bool result = writeBenchTexture(path, 64);
+
+	TextureManager tm;
+	const max::TextureHandle handle = tm.load(path);
+	result &= isValid(handle);
+
+	// Rewritten with the same size, the texture is updated in place by a later `update`.
+	const uint32_t numReloads = tm.getNumReloads();
+	result &= writeBenchTexture(path, 64);
+
+	std::vector<TextureUpload> uploaded;
+	for (uint32_t ii = 0; ii < 200 && numReloads == tm.getNumReloads(); ++ii)
+	{
+		tm.update(uploaded);
+		tm.wait();
+		bx::sleep(5);
+	}
+
+	result &= numReloads < tm.getNumReloads();
+	result &= handle.idx == tm.load(path).idx;
+
+	tm.unload(path);
+	tm.unload(path);
+	tm.trimCache(0);
+	bx::remove(path);
+
+	flushFrames();
+
+	printf("%-28s %s\n", "texture hot reload", result ? "ok" : "FAILED");
+	return result;
+#else
+	BX_UNUSED(_settings);
+	printf("%-28s %s\n", "texture hot reload", "skipped");
+	return true;
+#endif // TG_CONFIG_TEXTURE_HOT_RELOAD
+}
+
+/// TextureManager lookups before `PathTable`, string keys built on every call.
+struct StringKeyTextures
+{
+	void load(const char* _filePath)
+	{
+		++m_textures[_filePath].m_refCount;
+	}
+
+	void unload(const char* _filePath)
+	{
+		auto it = m_textures.find(_filePath);
+		if (it != m_textures.end()
+		&&  0 == --it->second.m_refCount)
+		{
+			m_textures.erase(it);
+		}
+	}
+
+	std::unordered_map<std::string, TextureRef> m_textures;
+};
+
+/// Open addressing lookups as used by TextureManager.
+struct PathTableTextures
+{
+	void load(const char* _filePath)
+	{
+		++m_textures[m_textures.insert(_filePath, pathHash(_filePath) )].m_refCount;
+	}
+
+	void unload(const char* _filePath)
+	{
+		const uint32_t idx = m_textures.find(_filePath, pathHash(_filePath) );
+		if (PathTable<TextureRef>::kInvalid != idx
+		&&  0 == --m_textures[idx].m_refCount)
+		{
+			m_textures.remove(idx);
+		}
+	}
+
+	PathTable<TextureRef> m_textures;
+};
+
+template<typename Ty>
+static void benchLookup(const char* _name, Ty& _textures, const std::vector<const char*>& _paths, uint32_t _numCalls, uint32_t _numIterations)
+{
+	const uint32_t mask = uint32_t(_paths.size() - 1);
+
+	// Every path stays referenced, calls only look up and count references.
+	for (const char* path : _paths)
+	{
+		_textures.load(path);
+	}
+
+	BenchSamples samples;
+	for (uint32_t ii = 0; ii < _numIterations; ++ii)
+	{
+		const int64_t begin = bx::getHPCounter();
+		for (uint32_t jj = 0; jj < _numCalls; ++jj)
+		{
+			const char* path = _paths[(jj * 7) & mask];
+			_textures.load(path);
+			_textures.unload(path);
+		}
+		samples.add(begin, bx::getHPCounter());
+	}
+
+	for (const char* path : _paths)
+	{
+		_textures.unload(path);
+	}
+
+	report(_name, samples, 0);
+}
+
+static void benchTextureLookup(World& _world, const BenchSettings& _settings)
+{
+	constexpr uint32_t kNumPaths = 256;
+	constexpr uint32_t kNumCalls = 1000000;
+
+	// Paths are interned like material texture paths, files don't need to exist.
+	std::vector<const char*> paths(kNumPaths);
+	for (uint32_t ii = 0; ii < kNumPaths; ++ii)
+	{
+		char path[bx::kMaxFilePath];
+		bx::snprintf(path, sizeof(path), "textures/materials/lookup_%u_basecolor.png", ii);
+		paths[ii] = stringIntern(path);
+	}
+
+	StringKeyTextures stringKey;
+	benchLookup("tex lookup unordered_map", stringKey, paths, kNumCalls, _settings.m_numIterations);
+
+	PathTableTextures pathTable;
+	benchLookup("tex lookup PathTable", pathTable, paths, kNumCalls, _settings.m_numIterations);
+
+	benchLookup("tex lookup TextureManager", _world.m_textureManager, paths, kNumCalls, _settings.m_numIterations);
+}
+
+static bool testTextureCook(const BenchSettings& _settings)
+{
+	const bx::StringView dir = bx::FilePath(_settings.m_filepath).getPath();
+	bx::makeAll(dir);
+
+	char path[bx::kMaxFilePath];
+	bx::snprintf(path, sizeof(path), "%.*s/cook_test.tga", dir.getLength(), dir.getPtr() );
+
+	bool result = writeBenchTexture(path, 64);
+
+	// Packed surfaces are cooked with or without encoder. Index hits while sources are
+	// unchanged, a changed source stamp misses until cooked again.
+	const char* surface = textureSurfacePath(stringIntern(path), "");
+
+	bx::FilePath cooked;
+	bx::FilePath found;
+	result &= textureCook(surface, TextureUsage::Linear, cooked);
+	result &= textureCookFind(surface, TextureUsage::Linear, found);
+	result &= 0 == bx::strCmp(found, cooked);
+
+	result &= writeBenchTexture(path, 32);
+	result &= !textureCookFind(surface, TextureUsage::Linear, found);
+
+	const bx::FilePath stale = cooked;
+	result &= textureCook(surface, TextureUsage::Linear, cooked);
+	result &= textureCookFind(surface, TextureUsage::Linear, found);
+	result &= 0 == bx::strCmp(found, cooked);
+
+	bx::FileInfo info;
+	result &= 0 != bx::strCmp(stale, cooked) && !bx::stat(info, stale);
+
+	bimg::ImageContainer* surfaceImage = readTexture(cooked.getCPtr(), bimg::TextureFormat::Count);
+	result &= NULL != surfaceImage && 32 == surfaceImage->m_width;
+
+	if (NULL != surfaceImage)
+	{
+		bimg::imageFree(surfaceImage);
+	}
+
+#if TG_CONFIG_TEXTURE_COOK
+	// Normal maps keep two channels in BC5 where supported, color goes to BC1.
+	const max::Caps* caps = max::getCaps();
+	if (0 != (caps->formats[max::TextureFormat::BC5] & MAX_CAPS_FORMAT_TEXTURE_2D)
+	&&  0 != (caps->formats[max::TextureFormat::BC1] & MAX_CAPS_FORMAT_TEXTURE_2D) )
+	{
+		const bimg::TextureFormat::Enum expected[] = { bimg::TextureFormat::BC1, bimg::TextureFormat::BC5 };
+		const TextureUsage::Enum usages[] = { TextureUsage::Color, TextureUsage::Normal };
+
+		for (uint32_t ii = 0; ii < BX_COUNTOF(usages); ++ii)
+		{
+			result &= textureCook(path, usages[ii], cooked);
+
+			bimg::ImageContainer* image = readTexture(cooked.getCPtr(), bimg::TextureFormat::Count);
+			result &= NULL != image && expected[ii] == image->m_format && 1 < image->m_numMips;
+
+			if (NULL != image)
+			{
+				bimg::imageFree(image);
+			}
+		}
+	}
+#endif // TG_CONFIG_TEXTURE_COOK
+
+	bx::remove(path);
+
+	// Black and white average to mid gray in linear space, sRGB 188, linear data to 128.
+	const uint8_t bw[16] =
+	{
+		  0,   0,   0, 255,  255, 255, 255, 255,
+		255, 255, 255, 255,    0,   0,   0, 255,
+	};
+
+	uint8_t texel[4];
+	textureDownsample(bw, 2, 2, texel, TextureUsage::Color);
+	result &= 187 <= texel[0] && texel[0] <= 189 && 255 == texel[3];
+
+	textureDownsample(bw, 2, 2, texel, TextureUsage::Linear);
+	result &= 127 <= texel[0] && texel[0] <= 128 && 255 == texel[3];
+
+	// Normals tilted opposite ways average to straight up once renormalized.
+	const uint8_t normals[16] =
+	{
+		204, 128, 230, 255,   51, 128, 230, 255,
+		 51, 128, 230, 255,  204, 128, 230, 255,
+	};
+
+	textureDownsample(normals, 2, 2, texel, TextureUsage::Normal);
+	result &= 127 <= texel[0] && texel[0] <= 129 && 254 <= texel[2];
+
+	printf("%-28s %s\n", "texture cook", result ? "ok" : "FAILED");
+	return result;
+}
+
+static bool testTexturePack(const BenchSettings& _settings)
+{
+	const bx::StringView dir = bx::FilePath(_settings.m_filepath).getPath();
+	bx::makeAll(dir);
+
+	char roughness[bx::kMaxFilePath];
+	char metallic[bx::kMaxFilePath];
+	char missing[bx::kMaxFilePath];
+	bx::snprintf(roughness, sizeof(roughness), "%.*s/pack_roughness.tga", dir.getLength(), dir.getPtr() );
+	bx::snprintf(metallic, sizeof(metallic), "%.*s/pack_metallic.tga", dir.getLength(), dir.getPtr() );
+	bx::snprintf(missing, sizeof(missing), "%.*s/pack_missing.tga", dir.getLength(), dir.getPtr() );
+	bx::remove(missing);
+
+	// Maps are read from red, other channels must not leak into the packed texture.
+	bool result = writeSolidTga(roughness, 16, 40, 90, 10);
+	result &= writeSolidTga(metallic, 16, 200, 10, 90);
+
+	// Missing maps are white, an empty path and a path naming no file alike.
+	const struct { const char* m_roughness; const char* m_metallic; uint8_t m_g; uint8_t m_b; } cases[] =
+	{
+		{ roughness, metallic, 40,  200 },
+		{ roughness, "",       40,  255 },
+		{ missing,   metallic, 255, 200 },
+	};
+
+	for (uint32_t ii = 0; ii < BX_COUNTOF(cases); ++ii)
+	{
+		const char* surface = textureSurfacePath(stringIntern(cases[ii].m_roughness), stringIntern(cases[ii].m_metallic) );
+
+		bx::FilePath cooked;
+		const bool cookResult = textureCook(surface, TextureUsage::Linear, cooked);
+
+		bimg::ImageContainer* image = cookResult ? readTexture(cooked.getCPtr(), bimg::TextureFormat::RGBA8) : NULL;
+		if (NULL == image)
+		{
+			result = false;
+			continue;
+		}
+
+		// BC1 keeps 5 and 6 bits per channel.
+		const uint8_t* texel = (const uint8_t*)image->m_data;
+		result &= 16 == image->m_width
+			&& 247 <= texel[0]
+			&& bx::abs(int32_t(texel[1]) - int32_t(cases[ii].m_g) ) <= 8
+			&& bx::abs(int32_t(texel[2]) - int32_t(cases[ii].m_b) ) <= 8
+			;
+
+		bimg::imageFree(image);
+	}
+
+	// Nothing to pack without any map.
+	bx::FilePath cooked;
+	result &= !textureCook(textureSurfacePath(stringIntern(missing), ""), TextureUsage::Linear, cooked);
+
+	bx::remove(roughness);
+	bx::remove(metallic);
+
+	printf("%-28s %s\n", "texture pack", result ? "ok" : "FAILED");
+	return result;
+}
+
+/// Write feedback pass pixel, see fs_vt_feedback.
+static void encodeFeedback(uint8_t _rgba[4], uint8_t _mip, uint32_t _x, uint32_t _y)
+{
+	_rgba[0] = uint8_t(_x);
+	_rgba[1] = uint8_t(_y);
+	_rgba[2] = uint8_t(_x >> 8 | (_y >> 8) << 4);
+	_rgba[3] = _mip + 1;
+}
+
+static void benchVirtualTexture(const BenchSettings& _settings)
+{
+	constexpr uint32_t kNumFrames = 100;
+	constexpr uint32_t kWidth = 1920 / TG_CONFIG_VT_FEEDBACK_DIVISOR;
+	constexpr uint32_t kHeight = 1080 / TG_CONFIG_VT_FEEDBACK_DIVISOR;
+
+	VirtualTextureDesc desc;
+	desc.m_size = 16384;
+	desc.m_pageSize = TG_CONFIG_VT_PAGE_SIZE;
+	desc.m_border = TG_CONFIG_VT_PAGE_BORDER;
+	desc.m_numMips = uint8_t(bx::uint32_cnttz(desc.m_size / desc.m_pageSize) + 1);
+
+	std::vector<uint8_t> feedback(kWidth * kHeight * 4);
+	std::vector<uint32_t> pages;
+
+	BenchSamples samples;
+	uint32_t numLoads = 0;
+
+	for (uint32_t ii = 0; ii < _settings.m_numIterations; ++ii)
+	{
+		VirtualTextureCache cache;
+		cache.create(desc, TG_CONFIG_VT_ATLAS_PAGES);
+
+		for (uint32_t frame = 0; frame < kNumFrames; ++frame)
+		{
+			// Ground plane seen from a camera moving forward, far rows need coarser mips.
+			const float forward = float(frame) * 0.002f;
+			for (uint32_t yy = 0; yy < kHeight; ++yy)
+			{
+				const float depth = 1.0f + float(kHeight - 1 - yy) / float(kHeight) * 31.0f;
+				const uint8_t mip = uint8_t(bx::min<uint32_t>(uint32_t(bx::log2(depth) ), desc.m_numMips - 1) );
+				const uint32_t num = desc.getNumPages(mip);
+
+				for (uint32_t xx = 0; xx < kWidth; ++xx)
+				{
+					const float uu = bx::fract(0.5f + (float(xx) / float(kWidth) - 0.5f) * depth * 0.02f);
+					const float vv = bx::fract(forward + depth * 0.02f);
+					encodeFeedback(&feedback[(yy * kWidth + xx) * 4], mip, uint32_t(uu * num), uint32_t(vv * num) );
+				}
+			}
+
+			const int64_t begin = bx::getHPCounter();
+
+			// Pages load instantly, measures resolve and page table updates only.
+			pages.clear();
+			cache.resolve(feedback.data(), kWidth * kHeight, TG_CONFIG_VT_MAX_REQUESTS, pages);
+			for (uint32_t page : pages)
+			{
+				VirtualPageSlot slot;
+				cache.map(page, slot);
+			}
+
+			for (uint8_t mip = 0; mip < desc.m_numMips; ++mip)
+			{
+				uint32_t rowBegin, rowEnd;
+				cache.getDirtyRows(mip, rowBegin, rowEnd);
+			}
+
+			samples.add(begin, bx::getHPCounter() );
+			numLoads += uint32_t(pages.size() );
+		}
+	}
+
+	report("vt resolve", samples, 0);
+	printf("%-28s %.1f pages per frame\n", "vt loads", double(numLoads) / double(kNumFrames * _settings.m_numIterations) );
+}
+
+/// Expected page table entry, see `VirtualTextureCache`.
+static uint32_t vtEntry(uint16_t _x, uint16_t _y, uint8_t _mip)
+{
+	return uint32_t(_x) | uint32_t(_y) << 8 | uint32_t(_mip) << 16 | UINT32_C(0xff) << 24;
+}
+
+static bool testVirtualTexture()
+{
+	// 8x8 pages in 4 mips and a 2x2 atlas, a single feedback pixel per resolve.
+	VirtualTextureDesc desc;
+	desc.m_size = 1024;
+	desc.m_pageSize = 128;
+	desc.m_border = TG_CONFIG_VT_PAGE_BORDER;
+	desc.m_numMips = 4;
+
+	VirtualTextureCache cache;
+	cache.create(desc, 2);
+
+	std::vector<uint32_t> pages;
+	bool result = true;
+
+	// Resolve one request, expecting exactly one page and mapping it.
+	auto step = [&](uint8_t _mip, uint32_t _x, uint32_t _y, uint32_t _expected, VirtualPageSlot _expectedSlot)
+	{
+		uint8_t feedback[4];
+		encodeFeedback(feedback, _mip, _x, _y);
+
+		uint32_t page;
+		bool ok = vtFeedbackDecode(feedback, page) && vtPageId(_mip, _x, _y) == page;
+
+		pages.clear();
+		ok &= 1 == cache.resolve(feedback, 1, 16, pages);
+		ok &= 1 == pages.size() && _expected == pages[0];
+
+		VirtualPageSlot slot;
+		ok &= !pages.empty() && cache.map(pages[0], slot);
+		ok &= _expectedSlot.m_x == slot.m_x && _expectedSlot.m_y == slot.m_y;
+		return ok;
+	};
+
+	auto entryAt = [&](uint8_t _mip, uint32_t _x, uint32_t _y)
+	{
+		return cache.getPageTable(_mip)[_y * desc.getNumPages(_mip) + _x];
+	};
+
+	// Last mip comes first and maps every entry.
+	result &= step(0, 3, 5, vtPageId(3, 0, 0), { 0, 0 });
+	for (uint8_t mip = 0; mip < desc.m_numMips; ++mip)
+	{
+		const uint32_t num = desc.getNumPages(mip);
+		for (uint32_t ii = 0; ii < num * num; ++ii)
+		{
+			result &= vtEntry(0, 0, 3) == cache.getPageTable(mip)[ii];
+		}
+	}
+
+	// Pages load coarse to fine, entries point to the finest resident ancestor.
+	result &= step(0, 3, 5, vtPageId(2, 0, 1), { 1, 0 });
+	result &= step(0, 3, 5, vtPageId(1, 1, 2), { 0, 1 });
+	result &= step(0, 3, 5, vtPageId(0, 3, 5), { 1, 1 });
+	result &= 4 == cache.getNumResident();
+
+	result &= vtEntry(1, 1, 0) == entryAt(0, 3, 5);
+	result &= vtEntry(0, 1, 1) == entryAt(0, 2, 5);
+	result &= vtEntry(1, 0, 2) == entryAt(0, 0, 4);
+	result &= vtEntry(0, 1, 1) == entryAt(1, 1, 2);
+	result &= vtEntry(0, 0, 3) == entryAt(0, 0, 0);
+	result &= vtEntry(0, 0, 3) == entryAt(2, 1, 1);
+
+	// Using the mip 1 page only leaves the mip 0 page least recently used.
+	{
+		uint8_t feedback[4];
+		encodeFeedback(feedback, 1, 1, 2);
+
+		pages.clear();
+		result &= 0 == cache.resolve(feedback, 1, 16, pages);
+	}
+
+	// Full atlas evicts it, its entries fall back to the mip 1 page.
+	result &= step(0, 7, 0, vtPageId(2, 1, 0), { 1, 1 });
+	result &= !cache.isResident(vtPageId(0, 3, 5) );
+	result &= cache.isResident(vtPageId(1, 1, 2) );
+	result &= cache.isResident(vtPageId(3, 0, 0) );
+	result &= 4 == cache.getNumResident();
+
+	result &= vtEntry(0, 1, 1) == entryAt(0, 3, 5);
+	result &= vtEntry(1, 1, 2) == entryAt(0, 7, 0);
+	result &= vtEntry(1, 1, 2) == entryAt(1, 3, 1);
+	result &= vtEntry(1, 1, 2) == entryAt(2, 1, 0);
+	result &= vtEntry(0, 1, 1) == entryAt(0, 3, 4);
+
+	printf("%-28s %s\n", "vt page table", result ? "ok" : "FAILED");
+	return result;
+}
+
+/// World matrix reads of one render pass.
+struct TransformPass
+{
+	bool m_cached; //!< Read matrices cached by `transformUpdate` instead of computing them.
+	float m_sum;   //!< Keeps reads from being optimized out.
+};
+
+static void transformPass(TransformPass& _pass)
+{
+	const RenderList& list = transformGetRenderList();
+	const max::EntityHandle* renderables = list.m_entities;
+
+	for (uint32_t ii = 0; ii < list.m_num; ++ii)
+	{
+		if (_pass.m_cached)
+		{
+			_pass.m_sum += transformGetWorld(renderables[ii])[12];
+		}
+		else
+		{
+			const TransformComponent* tc = max::getComponent<TransformComponent>(renderables[ii]);
+
+			float mtx[16];
+			bx::mtxSRT(mtx,
+				tc->m_scale.x, tc->m_scale.y, tc->m_scale.z,
+				tc->m_rotation.x, tc->m_rotation.y, tc->m_rotation.z, tc->m_rotation.w,
+				tc->m_position.x, tc->m_position.y, tc->m_position.z);
+
+			_pass.m_sum += mtx[12];
+		}
+	}
+}
+
+static void benchTransforms(const BenchSettings& _settings)
+{
+	constexpr uint32_t kNumPasses = 2; // Shadow map and GBuffer, cubemap passes only run on probe bakes.
+	const uint32_t counts[] = { 10000, 100000 };
+
+	for (uint32_t count : counts)
+	{
+		std::vector<max::EntityHandle> entities(count);
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			entities[ii] = max::createEntity();
+			max::addComponent<TransformComponent>(entities[ii], max::createComponent<TransformComponent>(randomTransform()));
+			max::addComponent<RenderComponent>(entities[ii], max::createComponent<RenderComponent>({ MAX_INVALID_HANDLE, true, MeshBounds() }));
+		}
+
+		TransformPass pass = { false, 0.0f };
+		transformUpdate();
+
+		// Before, every pass computes every matrix.
+		BenchSamples computed;
+		for (uint32_t ii = 0; ii < _settings.m_numIterations; ++ii)
+		{
+			const int64_t begin = bx::getHPCounter();
+			for (uint32_t jj = 0; jj < kNumPasses; ++jj)
+			{
+				transformPass(pass);
+			}
+			computed.add(begin, bx::getHPCounter() );
+		}
+
+		// After, matrices are computed once and only if their transform changed.
+		pass.m_cached = true;
+
+		BenchSamples cached;
+		BenchSamples moving;
+		for (uint32_t ii = 0; ii < _settings.m_numIterations * 2; ++ii)
+		{
+			// Every other frame a tenth of the entities move.
+			const bool move = 0 != (ii & 1);
+			if (move)
+			{
+				for (uint32_t jj = 0; jj < count / 10; ++jj)
+				{
+					TransformComponent* tc = max::getComponent<TransformComponent>(entities[rand32() % count]);
+					tc->m_position.y += 1.0f;
+				}
+			}
+
+			const int64_t begin = bx::getHPCounter();
+			transformUpdate();
+			for (uint32_t jj = 0; jj < kNumPasses; ++jj)
+			{
+				transformPass(pass);
+			}
+			(move ? moving : cached).add(begin, bx::getHPCounter() );
+		}
+
+		char name[64];
+		bx::snprintf(name, sizeof(name), "xform mtxSRT %uk", count / 1000);
+		report(name, computed, 0);
+		bx::snprintf(name, sizeof(name), "xform cached %uk", count / 1000);
+		report(name, cached, 0);
+		bx::snprintf(name, sizeof(name), "xform cached 10%% moved %uk", count / 1000);
+		report(name, moving, 0);
+
+		if (0.0f == pass.m_sum)
+		{
+			printf("\n");
+		}
+
+		for (max::EntityHandle entity : entities)
+		{
+			max::destroy(entity);
+		}
+
+		// Frees slots of destroyed entities.
+		transformUpdate();
+	}
+}
+
+static bool benchRenderList(const BenchSettings& _settings)
+{
+	// Every renderable must be submitted, at any count.
+	const uint32_t counts[] = { 1000, 10000, 100000, 1000000 };
+
+	bool result = true;
+	for (uint32_t count : counts)
+	{
+		std::vector<max::EntityHandle> entities(count);
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			entities[ii] = max::createEntity();
+			max::addComponent<TransformComponent>(entities[ii], max::createComponent<TransformComponent>(randomTransform()));
+			max::addComponent<RenderComponent>(entities[ii], max::createComponent<RenderComponent>({ MAX_INVALID_HANDLE, true, MeshBounds() }));
+		}
+
+		BenchSamples samples;
+		for (uint32_t ii = 0; ii < _settings.m_numIterations; ++ii)
+		{
+			const int64_t begin = bx::getHPCounter();
+			transformUpdate();
+			samples.add(begin, bx::getHPCounter() );
+		}
+
+		const RenderList& list = transformGetRenderList();
+		const max::EntityHandle* renderables = list.m_entities;
+		const uint32_t num = list.m_num;
+
+		// Each entity exactly once.
+		std::unordered_map<uint32_t, uint32_t> submitted;
+		for (max::EntityHandle entity : entities)
+		{
+			submitted.insert({ entity.idx, 0 });
+		}
+
+		bool ok = num == count;
+		for (uint32_t ii = 0; ii < num && ok; ++ii)
+		{
+			auto it = submitted.find(renderables[ii].idx);
+			ok = it != submitted.end()
+				&& 0 == it->second++
+				&& NULL != transformGetWorld(renderables[ii])
+				;
+		}
+
+		char name[64];
+		bx::snprintf(name, sizeof(name), "render list %uk", count / 1000);
+		report(name, samples, 0);
+		printf("%-28s %u of %u submitted, %s\n", "", num, count, ok ? "ok" : "FAILED");
+
+		result &= ok;
+
+		for (max::EntityHandle entity : entities)
+		{
+			max::destroy(entity);
+		}
+
+		transformUpdate();
+	}
+
+	return result;
+}
+
+/// Per renderable CPU work of a pass, components and world matrix of entities drawn.
+static float submitPass(const RenderList& _list, const uint8_t* _visible)
+{
+	float sum = 0.0f;
+	for (uint32_t ii = 0; ii < _list.m_num; ++ii)
+	{
+		if (NULL != _visible && 0 == _visible[ii])
+		{
+			continue;
+		}
+
+		const RenderComponent* rc = max::getComponent<RenderComponent>(_list.m_entities[ii]);
+		const MaterialComponent* mc = max::getComponent<MaterialComponent>(_list.m_entities[ii]);
+		sum += transformGetWorld(_list.m_entities[ii])[12] + float(rc->m_castShadows) + float(NULL != mc);
+	}
+
+	return sum;
+}
+
+static bool benchCulling(const BenchSettings& _settings)
+{
+	constexpr uint32_t kCount = 100000;
+
+	// Unit spheres spread around camera, like a large open level.
+	MeshBounds bounds;
+	bounds.m_min[0] = bounds.m_min[1] = bounds.m_min[2] = -1.0f;
+	bounds.m_max[0] = bounds.m_max[1] = bounds.m_max[2] =  1.0f;
+	bounds.m_radius = 1.0f;
+
+	std::vector<max::EntityHandle> entities(kCount);
+	for (uint32_t ii = 0; ii < kCount; ++ii)
+	{
+		TransformComponent tc = randomTransform();
+		tc.m_position.x *= 2.0f;
+		tc.m_position.z *= 2.0f;
+
+		entities[ii] = max::createEntity();
+		max::addComponent<TransformComponent>(entities[ii], max::createComponent<TransformComponent>(tc));
+		max::addComponent<RenderComponent>(entities[ii], max::createComponent<RenderComponent>({ MAX_INVALID_HANDLE, true, bounds }));
+	}
+
+	transformUpdate();
+	const RenderList& list = transformGetRenderList();
+
+	// Render list only has spheres without TG_CONFIG_BVH, computed here like `transformUpdate` does.
+	std::vector<float> sphereData[4];
+	for (uint32_t jj = 0; jj < 4; ++jj)
+	{
+		sphereData[jj].resize(list.m_num);
+	}
+
+	for (uint32_t ii = 0; ii < list.m_num; ++ii)
+	{
+		const TransformComponent* tc = max::getComponent<TransformComponent>(list.m_entities[ii]);
+		const RenderComponent* rc = max::getComponent<RenderComponent>(list.m_entities[ii]);
+		const float maxScale = bx::max(bx::abs(tc->m_scale.x), bx::abs(tc->m_scale.y), bx::abs(tc->m_scale.z) );
+
+		float sphere[4];
+		cullingTransformBounds(rc->m_bounds, transformGetWorld(list.m_entities[ii]), maxScale, sphere);
+		for (uint32_t jj = 0; jj < 4; ++jj)
+		{
+			sphereData[jj][ii] = sphere[jj];
+		}
+	}
+
+	const float* spheres[4] = { sphereData[0].data(), sphereData[1].data(), sphereData[2].data(), sphereData[3].data() };
+
+	const bool homogeneousDepth = max::getCaps()->homogeneousDepth;
+
+	float view[16];
+	bx::mtxLookAt(view, { 0.0f, 10.0f, 0.0f }, { 100.0f, 0.0f, 100.0f });
+
+	constexpr float kNear = 0.1f;
+	constexpr float kFar = 500.0f;
+
+	float proj[16];
+	bx::mtxProj(proj, 60.0f, 16.0f / 9.0f, kNear, kFar, homogeneousDepth);
+
+	float viewProj[16];
+	bx::mtxMul(viewProj, view, proj);
+
+	Frustum frustum;
+	cullingFrustum(frustum, viewProj, homogeneousDepth);
+
+	std::vector<uint8_t> visible(list.m_num);
+
+	BenchSamples all;
+	BenchSamples culled;
+	uint32_t numVisible = 0;
+	float sum = 0.0f;
+
+	for (uint32_t ii = 0; ii < _settings.m_numIterations; ++ii)
+	{
+		int64_t begin = bx::getHPCounter();
+		sum += submitPass(list, NULL);
+		all.add(begin, bx::getHPCounter() );
+
+		begin = bx::getHPCounter();
+		numVisible = cullingSpheres(frustum, spheres, list.m_num, visible.data() );
+		sum += submitPass(list, visible.data() );
+		culled.add(begin, bx::getHPCounter() );
+	}
+
+	// Spheres with center in clip volume must be visible, culled spheres must be behind a plane.
+	bool ok = true;
+	for (uint32_t ii = 0; ii < list.m_num && ok; ++ii)
+	{
+		const float pos[3] = { spheres[0][ii], spheres[1][ii], spheres[2][ii] };
+		const float radius = spheres[3][ii];
+
+		float clip[4];
+		for (uint32_t jj = 0; jj < 4; ++jj)
+		{
+			clip[jj] = pos[0] * viewProj[jj] + pos[1] * viewProj[4 + jj] + pos[2] * viewProj[8 + jj] + viewProj[12 + jj];
+		}
+
+		// Clip depth rounds badly near far plane, depth is tested in view space.
+		const float depth = pos[0] * view[2] + pos[1] * view[6] + pos[2] * view[10] + view[14];
+		const bool inside = bx::abs(clip[0]) <= clip[3] * 0.999f
+			&& bx::abs(clip[1]) <= clip[3] * 0.999f
+			&& kNear * 1.001f <= depth
+			&& depth <= kFar * 0.999f
+			;
+
+		bool outside = false;
+		for (uint32_t jj = 0; jj < Frustum::Count; ++jj)
+		{
+			const float* plane = frustum.m_planes[jj];
+			outside |= (plane[0] * pos[0] + plane[1] * pos[1]) + (plane[2] * pos[2] + plane[3]) < -radius;
+		}
+
+		ok = (0 != visible[ii]) != outside
+			&& !(inside && 0 == visible[ii])
+			;
+	}
+
+	report("cull none, submit all", all, 0);
+	report("cull spheres, submit visible", culled, 0);
+	printf("%-28s %u submitted, %u culled of %u, %.3f ms saved, %s\n"
+		, ""
+		, numVisible
+		, list.m_num - numVisible
+		, list.m_num
+		, all.percentile(0.5) - culled.percentile(0.5)
+		, ok ? "ok" : "FAILED"
+		);
+
+	if (0.0f == sum)
+	{
+		printf("\n");
+	}
+
+	for (max::EntityHandle entity : entities)
+	{
+		max::destroy(entity);
+	}
+
+	transformUpdate();
+
+	return ok;
+}
+
+static void randomBox(BoundingBox& _box, float _extent)
+{
+	const float size = randFloat(0.25f, 2.0f);
+	for (uint32_t ii = 0; ii < 3; ++ii)
+	{
+		const float center = randFloat(-_extent, _extent);
+		_box.m_min[ii] = center - size;
+		_box.m_max[ii] = center + size;
+	}
+}
+
+static bool benchBvh(const BenchSettings& _settings)
+{
+	// Same density at every count, world grows with number of objects.
+	const uint32_t counts[] = { 1000, 10000, 100000, 1000000 };
+
+	bool result = true;
+	for (uint32_t count : counts)
+	{
+		const float extent = 100.0f * bx::pow(float(count) / 1000.0f, 1.0f / 3.0f);
+
+		std::vector<BoundingBox> boxes(count);
+		for (BoundingBox& box : boxes)
+		{
+			randomBox(box, extent);
+		}
+
+		Bvh bvh;
+		std::vector<uint32_t> proxies(count);
+
+		int64_t begin = bx::getHPCounter();
+		for (uint32_t ii = 0; ii < count; ++ii)
+		{
+			proxies[ii] = bvh.insert(boxes[ii], ii);
+		}
+		BenchSamples build;
+		build.add(begin, bx::getHPCounter() );
+
+		// Tenth of objects move a little each frame, most stay inside their fat box.
+		BenchSamples refit;
+		uint32_t numReinserted = 0;
+		for (uint32_t ii = 0; ii < _settings.m_numIterations; ++ii)
+		{
+			begin = bx::getHPCounter();
+			for (uint32_t jj = ii % 10; jj < count; jj += 10)
+			{
+				BoundingBox& box = boxes[jj];
+				for (uint32_t kk = 0; kk < 3; ++kk)
+				{
+					const float delta = randFloat(-0.1f, 0.1f);
+					box.m_min[kk] += delta;
+					box.m_max[kk] += delta;
+				}
+
+				numReinserted += bvh.move(proxies[jj], box);
+			}
+			refit.add(begin, bx::getHPCounter() );
+		}
+
+		float view[16];
+		bx::mtxLookAt(view, { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.2f, 1.0f });
+
+		float proj[16];
+		bx::mtxProj(proj, 60.0f, 16.0f / 9.0f, 0.1f, extent, max::getCaps()->homogeneousDepth);
+
+		float viewProj[16];
+		bx::mtxMul(viewProj, view, proj);
+
+		Frustum frustum;
+		cullingFrustum(frustum, viewProj, max::getCaps()->homogeneousDepth);
+
+		const BoundingBox region = { { -10.0f, -10.0f, -10.0f }, { 10.0f, 10.0f, 10.0f } };
+
+		constexpr uint32_t kNumRays = 64;
+		const float dir[3] = { 1.0f, 0.01f, -0.02f };
+		const float invDir[3] = { 1.0f / dir[0], 1.0f / dir[1], 1.0f / dir[2] };
+
+		// Rays across the world, like picking or a bake tracing against the scene.
+		float origins[kNumRays][3];
+		for (uint32_t ii = 0; ii < kNumRays; ++ii)
+		{
+			origins[ii][0] = -extent;
+			origins[ii][1] = randFloat(-extent, extent);
+			origins[ii][2] = randFloat(-extent, extent);
+		}
+
+		BenchSamples frustumTree, frustumLinear, boxTree, boxLinear, rayTree, rayLinear;
+		std::vector<uint32_t> tree, linear;
+		std::vector<BvhHit> hits;
+		bool ok = true;
+
+		for (uint32_t ii = 0; ii < _settings.m_numIterations; ++ii)
+		{
+			tree.clear();
+			begin = bx::getHPCounter();
+			bvh.queryFrustum(frustum, tree);
+			frustumTree.add(begin, bx::getHPCounter() );
+
+			linear.clear();
+			begin = bx::getHPCounter();
+			for (uint32_t jj = 0; jj < count; ++jj)
+			{
+				if (cullingBox(frustum, boxes[jj]) )
+				{
+					linear.push_back(jj);
+				}
+			}
+			frustumLinear.add(begin, bx::getHPCounter() );
+
+			std::sort(tree.begin(), tree.end() );
+			ok &= tree == linear;
+
+			tree.clear();
+			begin = bx::getHPCounter();
+			bvh.queryBox(region, tree);
+			boxTree.add(begin, bx::getHPCounter() );
+
+			linear.clear();
+			begin = bx::getHPCounter();
+			for (uint32_t jj = 0; jj < count; ++jj)
+			{
+				if (cullingOverlap(boxes[jj], region) )
+				{
+					linear.push_back(jj);
+				}
+			}
+			boxLinear.add(begin, bx::getHPCounter() );
+
+			std::sort(tree.begin(), tree.end() );
+			ok &= tree == linear;
+
+			uint32_t numHits = 0;
+			begin = bx::getHPCounter();
+			for (uint32_t jj = 0; jj < kNumRays; ++jj)
+			{
+				hits.clear();
+				numHits += bvh.queryRay(origins[jj], dir, 2.0f * extent, hits);
+			}
+			rayTree.add(begin, bx::getHPCounter() );
+
+			uint32_t numLinear = 0;
+			begin = bx::getHPCounter();
+			for (uint32_t jj = 0; jj < kNumRays; ++jj)
+			{
+				for (uint32_t kk = 0; kk < count; ++kk)
+				{
+					float distance;
+					numLinear += cullingRay(origins[jj], invDir, 2.0f * extent, boxes[kk], distance);
+				}
+			}
+			rayLinear.add(begin, bx::getHPCounter() );
+
+			ok &= numHits == numLinear;
+		}
+
+		char name[64];
+		bx::snprintf(name, sizeof(name), "bvh %uk build", count / 1000);
+		report(name, build, 0);
+		bx::snprintf(name, sizeof(name), "bvh %uk refit 10%%", count / 1000);
+		report(name, refit, 0);
+		bx::snprintf(name, sizeof(name), "bvh %uk frustum", count / 1000);
+		report(name, frustumTree, 0);
+		bx::snprintf(name, sizeof(name), "linear %uk frustum", count / 1000);
+		report(name, frustumLinear, 0);
+		bx::snprintf(name, sizeof(name), "bvh %uk box", count / 1000);
+		report(name, boxTree, 0);
+		bx::snprintf(name, sizeof(name), "linear %uk box", count / 1000);
+		report(name, boxLinear, 0);
+		bx::snprintf(name, sizeof(name), "bvh %uk %u rays", count / 1000, kNumRays);
+		report(name, rayTree, 0);
+		bx::snprintf(name, sizeof(name), "linear %uk %u rays", count / 1000, kNumRays);
+		report(name, rayLinear, 0);
+		printf("%-28s %u levels, %.1f MB, %u reinserted, %s\n"
+			, ""
+			, bvh.getHeight()
+			, double(bvh.getMemorySize() ) / (1024.0 * 1024.0)
+			, numReinserted
+			, ok ? "ok" : "FAILED"
+			);
+
+		result &= ok;
+	}
+
+	return result;
+}
+
+static bool benchTransformKernel(const BenchSettings& _settings)
+{
+	constexpr uint32_t kCount = 100000;
+
+	std::vector<float> trs[10];
+	for (uint32_t ii = 0; ii < BX_COUNTOF(trs); ++ii)
+	{
+		trs[ii].resize(kCount);
+	}
+
+	for (uint32_t ii = 0; ii < kCount; ++ii)
+	{
+		const bx::Quaternion rot = bx::normalize(bx::Quaternion{ randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f) });
+		const float values[] =
+		{
+			randFloat(-1000.0f, 1000.0f), randFloat(-1000.0f, 1000.0f), randFloat(-1000.0f, 1000.0f),
+			rot.x, rot.y, rot.z, rot.w,
+			randFloat(0.1f, 10.0f), randFloat(0.1f, 10.0f), randFloat(0.1f, 10.0f),
+		};
+
+		for (uint32_t jj = 0; jj < BX_COUNTOF(trs); ++jj)
+		{
+			trs[jj][ii] = values[jj];
+		}
+	}
+
+	const TransformSoA soa =
+	{
+		{ trs[0].data(), trs[1].data(), trs[2].data() },
+		{ trs[3].data(), trs[4].data(), trs[5].data(), trs[6].data() },
+		{ trs[7].data(), trs[8].data(), trs[9].data() },
+	};
+
+	// Shuffled indices, like slots dirtied by moving entities.
+	std::vector<uint32_t> indices(kCount);
+	for (uint32_t ii = 0; ii < kCount; ++ii)
+	{
+		indices[ii] = ii;
+	}
+
+	for (uint32_t ii = kCount - 1; ii > 0; --ii)
+	{
+		bx::swap(indices[ii], indices[rand32() % (ii + 1)]);
+	}
+
+	std::vector<float> expected(kCount * 16);
+	for (uint32_t ii = 0; ii < kCount; ++ii)
+	{
+		bx::mtxSRT(&expected[ii * 16],
+			trs[7][ii], trs[8][ii], trs[9][ii],
+			trs[3][ii], trs[4][ii], trs[5][ii], trs[6][ii],
+			trs[0][ii], trs[1][ii], trs[2][ii]);
+	}
+
+	const TransformKernel::Enum selected = transformGetKernel();
+	std::vector<float> matrices(kCount * 16);
+
+	bool result = true;
+	for (uint32_t kernel = 0; kernel < TransformKernel::Count; ++kernel)
+	{
+		if (!transformSetKernel(TransformKernel::Enum(kernel) ) )
+		{
+			continue;
+		}
+
+		// Odd count covers remainder of batches.
+		bx::memSet(matrices.data(), 0, matrices.size() * sizeof(float) );
+		transformBatch(soa, indices.data(), kCount - 3, matrices.data() );
+		transformBatch(soa, &indices[kCount - 3], 3, matrices.data() );
+
+		// Reordered operations round differently, error is relative to magnitude.
+		bool ok = true;
+		for (uint32_t ii = 0; ii < kCount * 16 && ok; ++ii)
+		{
+			ok = bx::abs(matrices[ii] - expected[ii]) <= 1e-5f * bx::max(1.0f, bx::abs(expected[ii]) );
+		}
+
+		BenchSamples samples;
+		for (uint32_t ii = 0; ii < _settings.m_numIterations; ++ii)
+		{
+			const int64_t begin = bx::getHPCounter();
+			transformBatch(soa, indices.data(), kCount, matrices.data() );
+			samples.add(begin, bx::getHPCounter() );
+		}
+
+		char name[64];
+		bx::snprintf(name, sizeof(name), "xform kernel %s%s", transformGetKernelName(TransformKernel::Enum(kernel) ), selected == kernel ? " *" : "");
+
+		const double p50 = samples.percentile(0.5);
+		report(name, samples, 0);
+		printf("%-28s %.1f M matrices/s, %s\n", "", double(kCount) / (p50 * 1000.0), ok ? "matches mtxSRT" : "FAILED");
+
+		result &= ok;
+	}
+
+	transformSetKernel(selected);
+
+	return result;
+}
+
+static bool benchDelta(World& _world, const BenchSettings& _settings)
+{
+	// Round trip through incremental saves, every save moves a few entities and every
+	// tenth also adds and removes one.
+	_world.serializeFull();
+
+	std::unordered_map<std::string, bx::Vec3> expected;
+	for (auto it = _world.m_entities.begin(); it != _world.m_entities.end(); ++it)
+	{
+		expected.insert({ it->first, max::getComponent<TransformComponent>(it->second.m_handle)->m_position });
+	}
+
+	max::MeshHandle mesh = createBenchMesh(64);
+	_world.acquireMesh(mesh);
+
+	BenchSamples save;
+	uint32_t numCompactions = 0;
+
+	for (uint32_t ii = 0; ii < _settings.m_numDeltas; ++ii)
+	{
+		for (uint32_t jj = 0; jj < 4; ++jj)
+		{
+			auto it = _world.m_entities.begin();
+			std::advance(it, rand32() % _world.m_entities.size());
+
+			TransformComponent* tc = max::getComponent<TransformComponent>(it->second.m_handle);
+			randomizeTransform(*tc);
+			expected.insert_or_assign(it->first, tc->m_position);
+
+			_world.markDirty(it->first, SceneEntity::Transform);
+		}
+
+		if (0 == ii % 10)
+		{
+			char name[64];
+			bx::snprintf(name, sizeof(name), "delta_%u", ii);
+			createBenchEntity(_world, name, mesh, NULL);
+			expected.insert_or_assign(name, max::getComponent<TransformComponent>(_world.m_entities[name].m_handle)->m_position);
+			_world.markDirty(name, SceneEntity::Transform | SceneEntity::Render | SceneEntity::Material);
+
+			auto it = _world.m_entities.begin();
+			std::advance(it, rand32() % _world.m_entities.size());
+			const std::string removed = it->first;
+			if (removed != name)
+			{
+				_world.destroyEntity(it->second.m_handle);
+				_world.m_entities.erase(it);
+				_world.markRemoved(removed);
+				expected.erase(removed);
+			}
+		}
+
+		const uint64_t deltaSize = _world.m_deltaSize;
+
+		const int64_t begin = bx::getHPCounter();
+		_world.serialize();
+		save.add(begin, bx::getHPCounter());
+
+		numCompactions += _world.m_deltaSize < deltaSize ? 1 : 0;
+	}
+
+	_world.releaseMesh(mesh);
+
+	report("incremental save", save, 0);
+	printf("%-28s %.1f KB after %u saves, %u compactions\n", "delta log", double(_world.m_deltaSize) / 1024.0, _settings.m_numDeltas, numCompactions);
+
+	_world.unload();
+	flushFrames();
+	_world.deserialize();
+
+	bool result = _world.m_entities.size() == expected.size();
+	for (auto it = expected.begin(); it != expected.end() && result; ++it)
+	{
+		auto entity = _world.m_entities.find(it->first);
+		result = entity != _world.m_entities.end();
+
+		if (result)
+		{
+			const bx::Vec3& position = max::getComponent<TransformComponent>(entity->second.m_handle)->m_position;
+			result = position.x == it->second.x
+				&& position.y == it->second.y
+				&& position.z == it->second.z
+				;
+		}
+	}
+
+	printf("%-28s %s\n", "delta round trip", result ? "ok" : "FAILED");
+	return result;
+}
+
+static bool testDeltaDeleted(World& _world)
+{
+	// Changes appended to a log deleted behind the world's back must still reach disk.
+	_world.serializeFull();
+
+	auto first = _world.m_entities.begin();
+	auto second = std::next(first);
+
+	TransformComponent* tc = max::getComponent<TransformComponent>(first->second.m_handle);
+	randomizeTransform(*tc);
+	const bx::Vec3 firstPosition = tc->m_position;
+	_world.markDirty(first->first, SceneEntity::Transform);
+	bool result = _world.serialize() && 0 != _world.m_deltaSize;
+
+	bx::remove(sceneDeltaPath(bx::FilePath(_world.m_filepath) ) );
+
+	tc = max::getComponent<TransformComponent>(second->second.m_handle);
+	randomizeTransform(*tc);
+	const bx::Vec3 secondPosition = tc->m_position;
+	_world.markDirty(second->first, SceneEntity::Transform);
+	result &= _world.serialize();
+
+	const std::string firstName = first->first;
+	const std::string secondName = second->first;
+
+	_world.unload();
+	flushFrames();
+	result &= _world.deserialize();
+
+	auto isAt = [&](const std::string& _name, const bx::Vec3& _position)
+	{
+		auto entity = _world.m_entities.find(_name);
+		if (entity == _world.m_entities.end())
+		{
+			return false;
+		}
+
+		const bx::Vec3& position = max::getComponent<TransformComponent>(entity->second.m_handle)->m_position;
+		return position.x == _position.x && position.y == _position.y && position.z == _position.z;
+	};
+
+	result &= isAt(firstName, firstPosition) && isAt(secondName, secondPosition);
+
+	printf("%-28s %s\n", "delta log deleted", result ? "ok" : "FAILED");
+	return result;
+}
+
+static uint32_t getOption(const bx::CommandLine& _cmdLine, const char* _name, uint32_t _default)
+{
+	const char* value = _cmdLine.findOption(_name);
+	return NULL != value ? uint32_t(atoi(value)) : _default;
+}
+
+int main(int _argc, const char* _argv[])
+{
+	bx::CommandLine cmdLine(_argc, _argv);
+
+	BenchSettings settings;
+	settings.m_numEntities   = getOption(cmdLine, "entities", settings.m_numEntities);
+	settings.m_numMeshes     = bx::max<uint32_t>(getOption(cmdLine, "meshes", settings.m_numMeshes), 1);
+	settings.m_numVertices   = getOption(cmdLine, "vertices", settings.m_numVertices);
+	settings.m_numTextures   = getOption(cmdLine, "textures", settings.m_numTextures);
+	settings.m_numIterations = bx::max<uint32_t>(getOption(cmdLine, "iterations", settings.m_numIterations), 1);
+	settings.m_numThreads    = getOption(cmdLine, "threads", settings.m_numThreads);
+	settings.m_numDeltas     = getOption(cmdLine, "deltas", settings.m_numDeltas);
+	settings.m_filepath      = cmdLine.findOption("out", settings.m_filepath);
+	settings.m_test          = cmdLine.hasArg("test");
+
+	if (settings.m_test)
+	{
+		settings.m_numEntities   = getOption(cmdLine, "entities", 1000);
+		settings.m_numMeshes     = bx::max<uint32_t>(getOption(cmdLine, "meshes", 10), 1);
+		settings.m_numVertices   = getOption(cmdLine, "vertices", 256);
+		settings.m_numIterations = bx::max<uint32_t>(getOption(cmdLine, "iterations", 1), 1);
+	}
+
+	max::Init init;
+	init.rendererType = max::RendererType::Noop;
+	init.physicsType = max::PhysicsType::Count;
+	init.resolution.width = 1;
+	init.resolution.height = 1;
+	if (!max::init(init))
+	{
+		printf("Failed to initialize max.\n");
+		return EXIT_FAILURE;
+	}
+
+	jobsCreate(settings.m_numThreads);
+	transformCreate();
+
+	printf("%u entities, %u meshes of %u vertices, %u textures, %u job threads\n"
+		, settings.m_numEntities
+		, settings.m_numMeshes
+		, settings.m_numVertices
+		, settings.m_numTextures
+		, jobsGetNumThreads()
+		);
+
+	bool result = benchTransformKernel(settings);
+	result &= benchRenderList(settings);
+	result &= benchCulling(settings);
+	result &= benchBvh(settings);
+
+	if (!settings.m_test)
+	{
+		benchTransforms(settings);
+	}
+
+	{
+		World world;
+		generateWorld(world, settings);
+
+		if (!settings.m_test)
+		{
+			benchSaveLoad(world, settings);
+		}
+
+		result &= benchDedup(world, settings);
+		result &= benchLegacy(world, settings);
+
+		if (!settings.m_test)
+		{
+			benchCompression(world, settings);
+			benchVerify(settings);
+			benchThreads(world, settings);
+			benchAsync(world, settings);
+
+			benchTextureLookup(world, settings);
+			benchVirtualTexture(settings);
+		}
+
+		result &= benchDelta(world, settings);
+		result &= testDeltaDeleted(world);
+		result &= testTextureCache(settings);
+		result &= testTextureReload(settings);
+		result &= testTextureCook(settings);
+		result &= testTexturePack(settings);
+		result &= testVirtualTexture();
+
+		world.unload();
+		world.m_textureManager.trimCache(0);
+		flushFrames();
+	}
+
+	printf("%-28s %.1f MB\n", "peak rss", double(getPeakRss()) / (1024.0 * 1024.0));
+
+	transformDestroy();
+	jobsDestroy();
+	max::shutdown();
+
+	return result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,496 @@
+#include "bvh.h"
+
+#include <bx/math.h>
+
+#include <algorithm>
+
+static BoundingBox merge(const BoundingBox& _a, const BoundingBox& _b)
+{
+	return
+	{
+		{ bx::min(_a.m_min[0], _b.m_min[0]), bx::min(_a.m_min[1], _b.m_min[1]), bx::min(_a.m_min[2], _b.m_min[2]) },
+		{ bx::max(_a.m_max[0], _b.m_max[0]), bx::max(_a.m_max[1], _b.m_max[1]), bx::max(_a.m_max[2], _b.m_max[2]) },
+	};
+}
+
+static bool contains(const BoundingBox& _outer, const BoundingBox& _inner)
+{
+	return _outer.m_min[0] <= _inner.m_min[0] && _inner.m_max[0] <= _outer.m_max[0]
+		&& _outer.m_min[1] <= _inner.m_min[1] && _inner.m_max[1] <= _outer.m_max[1]
+		&& _outer.m_min[2] <= _inner.m_min[2] && _inner.m_max[2] <= _outer.m_max[2]
+		;
+}
+
+/// Half surface area, cost of a node is proportional to chance of a query visiting it.
+static float getArea(const BoundingBox& _box)
+{
+	const float dx = _box.m_max[0] - _box.m_min[0];
+	const float dy = _box.m_max[1] - _box.m_min[1];
+	const float dz = _box.m_max[2] - _box.m_min[2];
+	return dx * dy + dy * dz + dz * dx;
+}
+
+static BoundingBox fatten(const BoundingBox& _box)
+{
+	BoundingBox result;
+	for (uint32_t ii = 0; ii < 3; ++ii)
+	{
+		const float margin = (_box.m_max[ii] - _box.m_min[ii]) * TG_CONFIG_BVH_MARGIN;
+		result.m_min[ii] = _box.m_min[ii] - margin;
+		result.m_max[ii] = _box.m_max[ii] + margin;
+	}
+
+	return result;
+}
+
+Bvh::Bvh()
+	: m_root(kInvalid)
+	, m_free(kInvalid)
+	, m_num(0)
+{
+}
+
+uint32_t Bvh::insert(const BoundingBox& _box, uint32_t _user)
+{
+	const uint32_t leaf = allocNode();
+
+	Node& node = m_nodes[leaf];
+	node.m_box = fatten(_box);
+	node.m_exact = _box;
+	node.m_user = _user;
+	node.m_height = 0;
+
+	insertLeaf(leaf);
+	++m_num;
+
+	return leaf;
+}
+
+void Bvh::remove(uint32_t _proxy)
+{
+	BX_ASSERT(_proxy < m_nodes.size() && m_nodes[_proxy].isLeaf() && 0 == m_nodes[_proxy].m_height, "Invalid proxy %d.", _proxy)
+
+	removeLeaf(_proxy);
+	freeNode(_proxy);
+	--m_num;
+}
+
+bool Bvh::move(uint32_t _proxy, const BoundingBox& _box)
+{
+	Node& node = m_nodes[_proxy];
+	node.m_exact = _box;
+
+	if (contains(node.m_box, _box) )
+	{
+		return false;
+	}
+
+	removeLeaf(_proxy);
+	m_nodes[_proxy].m_box = fatten(_box);
+	insertLeaf(_proxy);
+
+	return true;
+}
+
+void Bvh::clear()
+{
+	m_nodes.clear();
+	m_root = kInvalid;
+	m_free = kInvalid;
+	m_num = 0;
+}
+
+uint32_t Bvh::queryFrustum(const Frustum& _frustum, std::vector<uint32_t>& _outUser) const
+{
+	const size_t first = _outUser.size();
+	if (kInvalid == m_root)
+	{
+		return 0;
+	}
+
+	// Node in low bits, planes still to test in high bits.
+	constexpr uint32_t kAllPlanes = (1 << Frustum::Count) - 1;
+	m_frustumStack.clear();
+	m_frustumStack.push_back(uint64_t(kAllPlanes) << 32 | m_root);
+
+	while (!m_frustumStack.empty() )
+	{
+		const uint32_t idx = uint32_t(m_frustumStack.back() );
+		uint32_t planes = uint32_t(m_frustumStack.back() >> 32);
+		m_frustumStack.pop_back();
+
+		const Node& node = m_nodes[idx];
+
+		if (node.isLeaf() )
+		{
+			// Exact box is tested like a linear scan would.
+			if (cullingBox(_frustum, node.m_exact) )
+			{
+				_outUser.push_back(node.m_user);
+			}
+
+			continue;
+		}
+
+		const BoundingBox& box = node.m_box;
+		const float center[3] = { (box.m_min[0] + box.m_max[0]) * 0.5f, (box.m_min[1] + box.m_max[1]) * 0.5f, (box.m_min[2] + box.m_max[2]) * 0.5f };
+		const float extent[3] = { (box.m_max[0] - box.m_min[0]) * 0.5f, (box.m_max[1] - box.m_min[1]) * 0.5f, (box.m_max[2] - box.m_min[2]) * 0.5f };
+
+		bool outside = false;
+		for (uint32_t ii = 0; ii < Frustum::Count && !outside; ++ii)
+		{
+			if (0 == (planes & (1 << ii) ) )
+			{
+				continue;
+			}
+
+			const float* plane = _frustum.m_planes[ii];
+			const float dist = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+			const float radius = bx::abs(plane[0]) * extent[0] + bx::abs(plane[1]) * extent[1] + bx::abs(plane[2]) * extent[2];
+
+			outside = dist + radius < 0.0f;
+
+			// Children of a box fully inside a plane are too.
+			if (dist - radius > 0.0f)
+			{
+				planes &= ~(1 << ii);
+			}
+		}
+
+		if (outside)
+		{
+			continue;
+		}
+
+		if (0 == planes)
+		{
+			collect(idx, _outUser);
+			continue;
+		}
+
+		m_frustumStack.push_back(uint64_t(planes) << 32 | node.m_child[0]);
+		m_frustumStack.push_back(uint64_t(planes) << 32 | node.m_child[1]);
+	}
+
+	return uint32_t(_outUser.size() - first);
+}
+
+uint32_t Bvh::queryBox(const BoundingBox& _box, std::vector<uint32_t>& _outUser) const
+{
+	const size_t first = _outUser.size();
+	if (kInvalid == m_root)
+	{
+		return 0;
+	}
+
+	m_stack.clear();
+	m_stack.push_back(m_root);
+
+	while (!m_stack.empty() )
+	{
+		const Node& node = m_nodes[m_stack.back()];
+		m_stack.pop_back();
+
+		if (node.isLeaf() )
+		{
+			if (cullingOverlap(node.m_exact, _box) )
+			{
+				_outUser.push_back(node.m_user);
+			}
+		}
+		else if (cullingOverlap(node.m_box, _box) )
+		{
+			m_stack.push_back(node.m_child[0]);
+			m_stack.push_back(node.m_child[1]);
+		}
+	}
+
+	return uint32_t(_outUser.size() - first);
+}
+
+uint32_t Bvh::queryRay(const float _origin[3], const float _dir[3], float _maxDistance, std::vector<BvhHit>& _outHits) const
+{
+	const size_t first = _outHits.size();
+	if (kInvalid == m_root)
+	{
+		return 0;
+	}
+
+	const float invDir[3] = { 1.0f / _dir[0], 1.0f / _dir[1], 1.0f / _dir[2] };
+
+	m_stack.clear();
+	m_stack.push_back(m_root);
+
+	while (!m_stack.empty() )
+	{
+		const Node& node = m_nodes[m_stack.back()];
+		m_stack.pop_back();
+
+		float distance;
+		if (node.isLeaf() )
+		{
+			if (cullingRay(_origin, invDir, _maxDistance, node.m_exact, distance) )
+			{
+				_outHits.push_back({ node.m_user, distance });
+			}
+		}
+		else if (cullingRay(_origin, invDir, _maxDistance, node.m_box, distance) )
+		{
+			m_stack.push_back(node.m_child[0]);
+			m_stack.push_back(node.m_child[1]);
+		}
+	}
+
+	std::sort(_outHits.begin() + first, _outHits.end(), [](const BvhHit& _a, const BvhHit& _b)
+	{
+		return _a.m_distance < _b.m_distance;
+	});
+
+	return uint32_t(_outHits.size() - first);
+}
+
+uint32_t Bvh::getNum() const
+{
+	return m_num;
+}
+
+uint32_t Bvh::getHeight() const
+{
+	return kInvalid == m_root ? 0 : uint32_t(m_nodes[m_root].m_height + 1);
+}
+
+uint64_t Bvh::getMemorySize() const
+{
+	return uint64_t(m_nodes.capacity() ) * sizeof(Node)
+		+ uint64_t(m_stack.capacity() ) * sizeof(uint32_t)
+		+ uint64_t(m_frustumStack.capacity() ) * sizeof(uint64_t)
+		;
+}
+
+uint32_t Bvh::allocNode()
+{
+	uint32_t idx;
+	if (kInvalid != m_free)
+	{
+		idx = m_free;
+		m_free = m_nodes[idx].m_parent;
+	}
+	else
+	{
+		idx = uint32_t(m_nodes.size() );
+		m_nodes.push_back(Node() );
+	}
+
+	Node& node = m_nodes[idx];
+	node.m_parent = kInvalid;
+	node.m_child[0] = kInvalid;
+	node.m_child[1] = kInvalid;
+	node.m_user = kInvalid;
+	node.m_height = 0;
+
+	return idx;
+}
+
+void Bvh::freeNode(uint32_t _node)
+{
+	m_nodes[_node].m_parent = m_free;
+	m_nodes[_node].m_height = -1;
+	m_free = _node;
+}
+
+void Bvh::insertLeaf(uint32_t _leaf)
+{
+	if (kInvalid == m_root)
+	{
+		m_root = _leaf;
+		m_nodes[_leaf].m_parent = kInvalid;
+		return;
+	}
+
+	const BoundingBox box = m_nodes[_leaf].m_box;
+
+	// Descend to sibling that grows total area least.
+	uint32_t idx = m_root;
+	while (!m_nodes[idx].isLeaf() )
+	{
+		const Node& node = m_nodes[idx];
+
+		const float area = getArea(node.m_box);
+		const float combinedArea = getArea(merge(node.m_box, box) );
+
+		// Cost of new parent of this node and leaf, growth of this node passes on to ancestors.
+		const float cost = 2.0f * combinedArea;
+		const float inheritance = 2.0f * (combinedArea - area);
+
+		float childCost[2];
+		for (uint32_t ii = 0; ii < 2; ++ii)
+		{
+			const Node& child = m_nodes[node.m_child[ii]];
+			const float merged = getArea(merge(child.m_box, box) );
+			childCost[ii] = child.isLeaf()
+				? merged + inheritance
+				: merged - getArea(child.m_box) + inheritance
+				;
+		}
+
+		if (cost < childCost[0]
+		&&  cost < childCost[1])
+		{
+			break;
+		}
+
+		idx = childCost[0] < childCost[1] ? node.m_child[0] : node.m_child[1];
+	}
+
+	const uint32_t sibling = idx;
+	const uint32_t oldParent = m_nodes[sibling].m_parent;
+	const uint32_t parent = allocNode();
+
+	Node& newParent = m_nodes[parent];
+	newParent.m_parent = oldParent;
+	newParent.m_box = merge(box, m_nodes[sibling].m_box);
+	newParent.m_height = m_nodes[sibling].m_height + 1;
+	newParent.m_child[0] = sibling;
+	newParent.m_child[1] = _leaf;
+
+	if (kInvalid != oldParent)
+	{
+		Node& node = m_nodes[oldParent];
+		node.m_child[node.m_child[0] == sibling ? 0 : 1] = parent;
+	}
+	else
+	{
+		m_root = parent;
+	}
+
+	m_nodes[sibling].m_parent = parent;
+	m_nodes[_leaf].m_parent = parent;
+
+	refit(m_nodes[_leaf].m_parent);
+}
+
+void Bvh::removeLeaf(uint32_t _leaf)
+{
+	if (_leaf == m_root)
+	{
+		m_root = kInvalid;
+		return;
+	}
+
+	const uint32_t parent = m_nodes[_leaf].m_parent;
+	const uint32_t grandParent = m_nodes[parent].m_parent;
+	const uint32_t sibling = m_nodes[parent].m_child[0] == _leaf
+		? m_nodes[parent].m_child[1]
+		: m_nodes[parent].m_child[0]
+		;
+
+	// Sibling takes place of parent.
+	m_nodes[sibling].m_parent = grandParent;
+	freeNode(parent);
+
+	if (kInvalid != grandParent)
+	{
+		Node& node = m_nodes[grandParent];
+		node.m_child[node.m_child[0] == parent ? 0 : 1] = sibling;
+		refit(grandParent);
+	}
+	else
+	{
+		m_root = sibling;
+	}
+}
+
+void Bvh::refit(uint32_t _node)
+{
+	for (uint32_t idx = _node; kInvalid != idx;)
+	{
+		idx = balance(idx);
+
+		Node& node = m_nodes[idx];
+		const Node& child0 = m_nodes[node.m_child[0]];
+		const Node& child1 = m_nodes[node.m_child[1]];
+
+		node.m_height = 1 + bx::max(child0.m_height, child1.m_height);
+		node.m_box = merge(child0.m_box, child1.m_box);
+
+		idx = node.m_parent;
+	}
+}
+
+uint32_t Bvh::balance(uint32_t _node)
+{
+	Node& aa = m_nodes[_node];
+	if (aa.isLeaf()
+	||  2 > aa.m_height)
+	{
+		return _node;
+	}
+
+	// Rotate taller child up, A becomes its child and takes its shorter child.
+	const int32_t diff = m_nodes[aa.m_child[1]].m_height - m_nodes[aa.m_child[0]].m_height;
+	if (-1 <= diff && diff <= 1)
+	{
+		return _node;
+	}
+
+	const uint32_t up = diff > 1 ? 1 : 0;
+	const uint32_t iB = aa.m_child[1 - up];
+	const uint32_t iC = aa.m_child[up];
+	Node& cc = m_nodes[iC];
+	const uint32_t iF = cc.m_child[0];
+	const uint32_t iG = cc.m_child[1];
+
+	cc.m_child[0] = _node;
+	cc.m_parent = aa.m_parent;
+	aa.m_parent = iC;
+
+	if (kInvalid != cc.m_parent)
+	{
+		Node& parent = m_nodes[cc.m_parent];
+		parent.m_child[parent.m_child[0] == _node ? 0 : 1] = iC;
+	}
+	else
+	{
+		m_root = iC;
+	}
+
+	// Taller grandchild stays with C, shorter one replaces C under A.
+	const bool fTaller = m_nodes[iF].m_height > m_nodes[iG].m_height;
+	const uint32_t iKeep = fTaller ? iF : iG;
+	const uint32_t iMove = fTaller ? iG : iF;
+
+	cc.m_child[1] = iKeep;
+	aa.m_child[up] = iMove;
+	m_nodes[iMove].m_parent = _node;
+
+	const Node& bb = m_nodes[iB];
+	aa.m_box = merge(bb.m_box, m_nodes[iMove].m_box);
+	aa.m_height = 1 + bx::max(bb.m_height, m_nodes[iMove].m_height);
+
+	cc.m_box = merge(aa.m_box, m_nodes[iKeep].m_box);
+	cc.m_height = 1 + bx::max(aa.m_height, m_nodes[iKeep].m_height);
+
+	return iC;
+}
+
+void Bvh::collect(uint32_t _node, std::vector<uint32_t>& _outUser) const
+{
+	m_stack.clear();
+	m_stack.push_back(_node);
+
+	while (!m_stack.empty() )
+	{
+		const Node& node = m_nodes[m_stack.back()];
+		m_stack.pop_back();
+
+		if (node.isLeaf() )
+		{
+			_outUser.push_back(node.m_user);
+		}
+		else
+		{
+			m_stack.push_back(node.m_child[0]);
+			m_stack.push_back(node.m_child[1]);
+		}
+	}
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include "culling.h"
+
+#include <vector>
+
+#ifndef TG_CONFIG_BVH
+#	define TG_CONFIG_BVH 1 //!< Cull renderables through a BVH over their world bounds instead of testing each.
+#endif // TG_CONFIG_BVH
+
+#ifndef TG_CONFIG_BVH_MARGIN
+#	define TG_CONFIG_BVH_MARGIN 0.1f //!< Fraction of leaf box size added on each side, moves within it don't change the tree.
+#endif // TG_CONFIG_BVH_MARGIN
+
+/// Leaf hit by a ray, see `Bvh::queryRay`.
+///
+struct BvhHit
+{
+	uint32_t m_user;  //!< User data of leaf.
+	float m_distance; //!< Distance box is entered at, in units of ray direction length.
+};
+
+/// Dynamic bounding volume hierarchy of boxes. Leaves are inserted where they grow the tree
+/// least and subtrees are rotated to keep it balanced. Leaves hold a fat box, enlarged by
+/// TG_CONFIG_BVH_MARGIN, so moving a leaf only reinserts it once it leaves its fat box.
+/// Queries test the exact box of leaves.
+///
+/// Nodes are pooled, a tree of N leaves never holds more than 2N - 1 nodes.
+///
+struct Bvh
+{
+	static constexpr uint32_t kInvalid = UINT32_MAX;
+
+	Bvh();
+
+	/// Add leaf.
+	///
+	/// @param[in] _box Box of leaf.
+	/// @param[in] _user Data returned by queries.
+	///
+	/// @returns Proxy of leaf, valid until it is removed.
+	///
+	uint32_t insert(const BoundingBox& _box, uint32_t _user);
+
+	void remove(uint32_t _proxy);
+
+	/// Update box of leaf.
+	///
+	/// @returns True if leaf left its fat box and was reinserted.
+	///
+	bool move(uint32_t _proxy, const BoundingBox& _box);
+
+	/// Remove all leaves, keeps memory.
+	///
+	void clear();
+
+	/// Get leaves whose box is inside or intersects frustum. Subtrees fully inside the
+	/// frustum are added without testing their leaves.
+	///
+	/// @param[out] _outUser User data of leaves is appended.
+	///
+	/// @returns Number of leaves appended.
+	///
+	uint32_t queryFrustum(const Frustum& _frustum, std::vector<uint32_t>& _outUser) const;
+
+	/// Get leaves whose box overlaps box.
+	///
+	/// @param[out] _outUser User data of leaves is appended.
+	///
+	/// @returns Number of leaves appended.
+	///
+	uint32_t queryBox(const BoundingBox& _box, std::vector<uint32_t>& _outUser) const;
+
+	/// Get leaves whose box is hit by ray, nearest first.
+	///
+	/// @param[in] _origin Ray origin.
+	/// @param[in] _dir Ray direction.
+	/// @param[in] _maxDistance Max distance along ray, in units of direction length.
+	/// @param[out] _outHits Hits are appended.
+	///
+	/// @returns Number of hits appended.
+	///
+	uint32_t queryRay(const float _origin[3], const float _dir[3], float _maxDistance, std::vector<BvhHit>& _outHits) const;
+
+	/// Get number of leaves.
+	///
+	uint32_t getNum() const;
+
+	/// Get number of levels, 0 if empty.
+	///
+	uint32_t getHeight() const;
+
+	/// Get bytes allocated by tree.
+	///
+	uint64_t getMemorySize() const;
+
+private:
+	struct Node
+	{
+		bool isLeaf() const
+		{
+			return kInvalid == m_child[0];
+		}
+
+		BoundingBox m_box;   //!< Fat box of leaf, union of children.
+		BoundingBox m_exact; //!< Box of leaf.
+		uint32_t m_parent;   //!< Next free node if free.
+		uint32_t m_child[2]; //!< Invalid if leaf.
+		uint32_t m_user;
+		int32_t m_height;    //!< 0 for leaves, -1 if free.
+	};
+
+	uint32_t allocNode();
+
+	void freeNode(uint32_t _node);
+
+	void insertLeaf(uint32_t _leaf);
+
+	void removeLeaf(uint32_t _leaf);
+
+	/// Fix boxes and heights from node to root, balancing on the way.
+	void refit(uint32_t _node);
+
+	/// Rotate taller grandchild up if children differ by more than one level.
+	///
+	/// @returns Node now at position of node.
+	///
+	uint32_t balance(uint32_t _node);
+
+	/// Append user data of all leaves of subtree.
+	void collect(uint32_t _node, std::vector<uint32_t>& _outUser) const;
+
+	std::vector<Node> m_nodes;
+	uint32_t m_root;
+	uint32_t m_free; //!< First free node, linked through m_parent.
+	uint32_t m_num;
+
+	mutable std::vector<uint32_t> m_stack;        //!< Scratch of queries.
+	mutable std::vector<uint64_t> m_frustumStack; //!< Scratch of `queryFrustum`, node and planes left to test.
+};
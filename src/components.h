@@ -4,11 +4,14 @@
 #include <bx/math.h>
 #include <bx/timer.h>
 
+#include "culling.h"
+
 struct TransformComponent
 {
 	bx::Vec3 m_position;
 	bx::Quaternion m_rotation;
 	bx::Vec3 m_scale;
+	uint32_t m_worldIdx = UINT32_MAX; //!< Slot of cached world matrix, see `transformGetWorld`.
 };
 
 struct MaterialComponent
@@ -16,7 +19,7 @@ struct MaterialComponent
 	struct Texture
 	{
 		max::TextureHandle m_texture; //!< Handle to texture.
-		char m_filepath[1024];	      //!< Path to texture.
+		const char* m_filepath;       //!< Interned path to texture, see `stringIntern`. Empty if none.
 	};
 
 	Texture m_diffuse;	      //!< Diffuse map.
@@ -30,12 +33,20 @@ struct MaterialComponent
 
 	Texture m_metallic;       //!< Metallic map.
 	float m_metallicFactor;   //!< Metallic factor.
+
+	Texture m_surface;        //!< Occlusion (r), roughness (g) and metallic (b) packed from maps above, see TG_CONFIG_SURFACE_TEXTURE. Roughness and metallic textures aren't loaded then.
+};
+
+struct VirtualTextureComponent
+{
+	const char* m_filepath; //!< Interned path to virtual texture, see `virtualTextureCook`. Replaces diffuse map, sampled with first texture coordinates.
 };
 
 struct RenderComponent
 {
 	max::MeshHandle m_mesh;  //!< Handle to mesh.
 	bool m_castShadows;		 //!< Should cast shadows.
+	MeshBounds m_bounds;     //!< Local bounds of mesh, unknown bounds are never culled.
 };
 
 struct CameraComponent
@@ -0,0 +1,266 @@
+#include "culling.h"
+
+#include <bx/math.h>
+#include <bx/uint32_t.h>
+
+#if BX_CPU_X86
+#	include <emmintrin.h>
+#endif // BX_CPU_X86
+
+bool cullingComputeBounds(max::MeshHandle _mesh, MeshBounds& _outBounds)
+{
+	const max::MeshQuery* query = max::queryMesh(_mesh);
+	const max::VertexLayout layout = max::getLayout(_mesh);
+
+	float min[3] = {  FLT_MAX,  FLT_MAX,  FLT_MAX };
+	float max[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	for (uint32_t ii = 0; ii < query->m_num; ++ii)
+	{
+		const max::MeshQuery::Data& data = query->m_data[ii];
+		for (uint32_t jj = 0; jj < data.m_numVertices; ++jj)
+		{
+			float pos[4];
+			max::vertexUnpack(pos, max::Attrib::Position, layout, data.m_vertices, jj);
+
+			for (uint32_t kk = 0; kk < 3; ++kk)
+			{
+				min[kk] = bx::min(min[kk], pos[kk]);
+				max[kk] = bx::max(max[kk], pos[kk]);
+			}
+		}
+	}
+
+	if (min[0] > max[0])
+	{
+		return false;
+	}
+
+	// Sphere around box center, tighter than the box's circumsphere.
+	const float center[3] = { (min[0] + max[0]) * 0.5f, (min[1] + max[1]) * 0.5f, (min[2] + max[2]) * 0.5f };
+
+	float radiusSq = 0.0f;
+	for (uint32_t ii = 0; ii < query->m_num; ++ii)
+	{
+		const max::MeshQuery::Data& data = query->m_data[ii];
+		for (uint32_t jj = 0; jj < data.m_numVertices; ++jj)
+		{
+			float pos[4];
+			max::vertexUnpack(pos, max::Attrib::Position, layout, data.m_vertices, jj);
+
+			const float dx = pos[0] - center[0];
+			const float dy = pos[1] - center[1];
+			const float dz = pos[2] - center[2];
+			radiusSq = bx::max(radiusSq, dx * dx + dy * dy + dz * dz);
+		}
+	}
+
+	bx::memCopy(_outBounds.m_min, min, sizeof(min) );
+	bx::memCopy(_outBounds.m_max, max, sizeof(max) );
+	bx::memCopy(_outBounds.m_center, center, sizeof(center) );
+	_outBounds.m_radius = bx::sqrt(radiusSq);
+
+	return true;
+}
+
+void cullingTransformBounds(const MeshBounds& _bounds, const float* _world, float _maxScale, float _outSphere[4])
+{
+	const float* center = _bounds.m_center;
+	_outSphere[0] = center[0] * _world[0] + center[1] * _world[4] + center[2] * _world[ 8] + _world[12];
+	_outSphere[1] = center[0] * _world[1] + center[1] * _world[5] + center[2] * _world[ 9] + _world[13];
+	_outSphere[2] = center[0] * _world[2] + center[1] * _world[6] + center[2] * _world[10] + _world[14];
+
+	// Unknown bounds stay infinite.
+	_outSphere[3] = FLT_MAX == _bounds.m_radius
+		? FLT_MAX
+		: _bounds.m_radius * _maxScale
+		;
+}
+
+void cullingTransformBox(const MeshBounds& _bounds, const float* _world, BoundingBox& _outBox)
+{
+	const float center[3] =
+	{
+		(_bounds.m_min[0] + _bounds.m_max[0]) * 0.5f,
+		(_bounds.m_min[1] + _bounds.m_max[1]) * 0.5f,
+		(_bounds.m_min[2] + _bounds.m_max[2]) * 0.5f,
+	};
+	const float extent[3] =
+	{
+		(_bounds.m_max[0] - _bounds.m_min[0]) * 0.5f,
+		(_bounds.m_max[1] - _bounds.m_min[1]) * 0.5f,
+		(_bounds.m_max[2] - _bounds.m_min[2]) * 0.5f,
+	};
+
+	// Center is transformed, extents grow by absolute values of the matrix.
+	for (uint32_t ii = 0; ii < 3; ++ii)
+	{
+		const float cc = center[0] * _world[ii] + center[1] * _world[4 + ii] + center[2] * _world[8 + ii] + _world[12 + ii];
+		const float ee = extent[0] * bx::abs(_world[ii]) + extent[1] * bx::abs(_world[4 + ii]) + extent[2] * bx::abs(_world[8 + ii]);
+
+		_outBox.m_min[ii] = cc - ee;
+		_outBox.m_max[ii] = cc + ee;
+	}
+}
+
+void cullingFrustum(Frustum& _outFrustum, const float* _viewProj, bool _homogeneousDepth)
+{
+	// Row vectors, clip coordinate i is dot of position and column i.
+	float col[4][4];
+	for (uint32_t ii = 0; ii < 4; ++ii)
+	{
+		col[ii][0] = _viewProj[ii];
+		col[ii][1] = _viewProj[ii + 4];
+		col[ii][2] = _viewProj[ii + 8];
+		col[ii][3] = _viewProj[ii + 12];
+	}
+
+	for (uint32_t ii = 0; ii < 4; ++ii)
+	{
+		_outFrustum.m_planes[Frustum::Left  ][ii] = col[3][ii] + col[0][ii];
+		_outFrustum.m_planes[Frustum::Right ][ii] = col[3][ii] - col[0][ii];
+		_outFrustum.m_planes[Frustum::Bottom][ii] = col[3][ii] + col[1][ii];
+		_outFrustum.m_planes[Frustum::Top   ][ii] = col[3][ii] - col[1][ii];
+		_outFrustum.m_planes[Frustum::Near  ][ii] = _homogeneousDepth ? col[3][ii] + col[2][ii] : col[2][ii];
+		_outFrustum.m_planes[Frustum::Far   ][ii] = col[3][ii] - col[2][ii];
+	}
+
+	// Distances of spheres are compared against their radius.
+	for (uint32_t ii = 0; ii < Frustum::Count; ++ii)
+	{
+		float* plane = _outFrustum.m_planes[ii];
+		const float invLength = 1.0f / bx::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+		plane[0] *= invLength;
+		plane[1] *= invLength;
+		plane[2] *= invLength;
+		plane[3] *= invLength;
+	}
+}
+
+bool cullingBox(const Frustum& _frustum, const BoundingBox& _box)
+{
+	const float center[3] =
+	{
+		(_box.m_min[0] + _box.m_max[0]) * 0.5f,
+		(_box.m_min[1] + _box.m_max[1]) * 0.5f,
+		(_box.m_min[2] + _box.m_max[2]) * 0.5f,
+	};
+	const float extent[3] =
+	{
+		(_box.m_max[0] - _box.m_min[0]) * 0.5f,
+		(_box.m_max[1] - _box.m_min[1]) * 0.5f,
+		(_box.m_max[2] - _box.m_min[2]) * 0.5f,
+	};
+
+	for (uint32_t ii = 0; ii < Frustum::Count; ++ii)
+	{
+		// Box is outside if its corner furthest along the normal is.
+		const float* plane = _frustum.m_planes[ii];
+		const float dist = plane[0] * center[0] + plane[1] * center[1] + plane[2] * center[2] + plane[3];
+		const float radius = bx::abs(plane[0]) * extent[0] + bx::abs(plane[1]) * extent[1] + bx::abs(plane[2]) * extent[2];
+		if (dist + radius < 0.0f)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool cullingOverlap(const BoundingBox& _a, const BoundingBox& _b)
+{
+	return _a.m_min[0] <= _b.m_max[0] && _b.m_min[0] <= _a.m_max[0]
+		&& _a.m_min[1] <= _b.m_max[1] && _b.m_min[1] <= _a.m_max[1]
+		&& _a.m_min[2] <= _b.m_max[2] && _b.m_min[2] <= _a.m_max[2]
+		;
+}
+
+bool cullingRay(const float _origin[3], const float _invDir[3], float _maxDistance, const BoundingBox& _box, float& _outDistance)
+{
+	// Slabs, infinite reciprocals of axis aligned rays give infinite distances.
+	float tmin = 0.0f;
+	float tmax = _maxDistance;
+
+	for (uint32_t ii = 0; ii < 3; ++ii)
+	{
+		float t0 = (_box.m_min[ii] - _origin[ii]) * _invDir[ii];
+		float t1 = (_box.m_max[ii] - _origin[ii]) * _invDir[ii];
+		if (t0 > t1)
+		{
+			bx::swap(t0, t1);
+		}
+
+		// Written so NaN of a ray in the plane of a slab keeps the previous bound.
+		tmin = t0 > tmin ? t0 : tmin;
+		tmax = t1 < tmax ? t1 : tmax;
+	}
+
+	_outDistance = tmin;
+	return tmin <= tmax;
+}
+
+static bool isVisible(const Frustum& _frustum, float _x, float _y, float _z, float _radius)
+{
+	for (uint32_t ii = 0; ii < Frustum::Count; ++ii)
+	{
+		const float* plane = _frustum.m_planes[ii];
+		// Same order of operations as SSE2 path.
+		if ( (plane[0] * _x + plane[1] * _y) + (plane[2] * _z + plane[3]) < -_radius)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+uint32_t cullingSpheres(const Frustum& _frustum, const float* const _sphere[4], uint32_t _num, uint8_t* _outVisible)
+{
+	uint32_t numVisible = 0;
+	uint32_t ii = 0;
+
+#if BX_CPU_X86
+	__m128 planes[Frustum::Count][4];
+	for (uint32_t jj = 0; jj < Frustum::Count; ++jj)
+	{
+		for (uint32_t kk = 0; kk < 4; ++kk)
+		{
+			planes[jj][kk] = _mm_set1_ps(_frustum.m_planes[jj][kk]);
+		}
+	}
+
+	for (; ii + 4 <= _num; ii += 4)
+	{
+		const __m128 xx = _mm_loadu_ps(&_sphere[0][ii]);
+		const __m128 yy = _mm_loadu_ps(&_sphere[1][ii]);
+		const __m128 zz = _mm_loadu_ps(&_sphere[2][ii]);
+		const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&_sphere[3][ii]) );
+
+		// Lanes stay set while sphere is not behind any plane.
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1) );
+		for (uint32_t jj = 0; jj < Frustum::Count; ++jj)
+		{
+			const __m128 dist = _mm_add_ps(
+				  _mm_add_ps(_mm_mul_ps(planes[jj][0], xx), _mm_mul_ps(planes[jj][1], yy) )
+				, _mm_add_ps(_mm_mul_ps(planes[jj][2], zz), planes[jj][3])
+				);
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(dist, negRadius) );
+		}
+
+		const int32_t mask = _mm_movemask_ps(inside);
+		_outVisible[ii + 0] = uint8_t( (mask >> 0) & 1);
+		_outVisible[ii + 1] = uint8_t( (mask >> 1) & 1);
+		_outVisible[ii + 2] = uint8_t( (mask >> 2) & 1);
+		_outVisible[ii + 3] = uint8_t( (mask >> 3) & 1);
+		numVisible += bx::uint32_cntbits(uint32_t(mask) );
+	}
+#endif // BX_CPU_X86
+
+	for (; ii < _num; ++ii)
+	{
+		_outVisible[ii] = isVisible(_frustum, _sphere[0][ii], _sphere[1][ii], _sphere[2][ii], _sphere[3][ii]);
+		numVisible += _outVisible[ii];
+	}
+
+	return numVisible;
+}
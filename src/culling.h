@@ -0,0 +1,101 @@
+#pragma once
+
+#include <max/max.h>
+
+#include <float.h>
+
+#ifndef TG_CONFIG_FRUSTUM_CULLING
+#	define TG_CONFIG_FRUSTUM_CULLING 1 //!< Skip renderables outside the frustum of each view.
+#endif // TG_CONFIG_FRUSTUM_CULLING
+
+/// Local bounds of a mesh, see `cullingComputeBounds`.
+///
+struct MeshBounds
+{
+	float m_min[3]    = {  0.0f,  0.0f,  0.0f }; //!< Local AABB.
+	float m_max[3]    = {  0.0f,  0.0f,  0.0f };
+	float m_center[3] = {  0.0f,  0.0f,  0.0f }; //!< Local bounding sphere.
+	float m_radius    = FLT_MAX;                 //!< FLT_MAX if unknown, never culled.
+};
+
+/// Axis aligned box.
+///
+struct BoundingBox
+{
+	float m_min[3];
+	float m_max[3];
+};
+
+/// View frustum, planes point inside.
+///
+struct Frustum
+{
+	enum Plane
+	{
+		Left,
+		Right,
+		Bottom,
+		Top,
+		Near,
+		Far,
+
+		Count
+	};
+
+	float m_planes[Count][4]; //!< Normalized normal and distance.
+};
+
+/// Compute local bounds of mesh from vertex positions of its groups, call once when mesh is
+/// created.
+///
+/// @returns False if mesh has no vertices, bounds are left unknown.
+///
+bool cullingComputeBounds(max::MeshHandle _mesh, MeshBounds& _outBounds);
+
+/// Get world bounding sphere of bounds transformed by scale, rotation and translation.
+///
+/// @param[out] _outSphere Center x, y, z and radius.
+///
+void cullingTransformBounds(const MeshBounds& _bounds, const float* _world, float _maxScale, float _outSphere[4]);
+
+/// Get world box of bounds transformed by world matrix, encloses the transformed local box.
+///
+void cullingTransformBox(const MeshBounds& _bounds, const float* _world, BoundingBox& _outBox);
+
+/// Get frustum of view projection.
+///
+/// @param[in] _viewProj View matrix multiplied by projection matrix.
+/// @param[in] _homogeneousDepth Clip depth is -1 to 1 instead of 0 to 1, see `max::Caps`.
+///
+void cullingFrustum(Frustum& _outFrustum, const float* _viewProj, bool _homogeneousDepth);
+
+/// Test box against frustum.
+///
+/// @returns True if box is inside or intersects frustum.
+///
+bool cullingBox(const Frustum& _frustum, const BoundingBox& _box);
+
+/// Test if boxes overlap, touching boxes overlap.
+///
+bool cullingOverlap(const BoundingBox& _a, const BoundingBox& _b);
+
+/// Intersect ray with box.
+///
+/// @param[in] _origin Ray origin.
+/// @param[in] _invDir Reciprocal of ray direction per axis.
+/// @param[in] _maxDistance Max distance along ray, in units of direction length.
+/// @param[out] _outDistance Distance box is entered at, 0 if origin is inside.
+///
+/// @returns True if ray hits box within max distance.
+///
+bool cullingRay(const float _origin[3], const float _invDir[3], float _maxDistance, const BoundingBox& _box, float& _outDistance);
+
+/// Test spheres against frustum, 4 at a time with SSE2 where available.
+///
+/// @param[in] _sphere Center x, y, z and radius, one array each.
+/// @param[in] _num Number of spheres.
+/// @param[out] _outVisible 1 per sphere inside or intersecting frustum, 0 otherwise.
+///
+/// @returns Number of visible spheres.
+///
+uint32_t cullingSpheres(const Frustum& _frustum, const float* const _sphere[4], uint32_t _num, uint8_t* _outVisible);
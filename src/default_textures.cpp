@@ -0,0 +1,61 @@
+#include "default_textures.h"
+
+/// Single texel RGBA8 per default texture, referenced by the renderer without a copy.
+static const uint8_t s_texels[DefaultTexture::Count][4] =
+{
+	{ 255, 255, 255, 255 }, // White
+	{ 128, 128, 255, 255 }, // Normal
+};
+
+static max::TextureHandle s_textures[DefaultTexture::Count];
+static uint32_t s_refCount = 0;
+
+void defaultTexturesAcquire()
+{
+	if (0 != s_refCount++)
+	{
+		return;
+	}
+
+	for (uint32_t ii = 0; ii < DefaultTexture::Count; ++ii)
+	{
+		s_textures[ii] = max::createTexture2D(1, 1, false, 1, max::TextureFormat::RGBA8, 0
+			, max::makeRef(s_texels[ii], sizeof(s_texels[ii]) )
+			);
+	}
+}
+
+void defaultTexturesRelease()
+{
+	BX_ASSERT(0 != s_refCount, "Default textures released more often than acquired.")
+
+	if (0 != --s_refCount)
+	{
+		return;
+	}
+
+	for (uint32_t ii = 0; ii < DefaultTexture::Count; ++ii)
+	{
+		max::destroy(s_textures[ii]);
+		s_textures[ii] = MAX_INVALID_HANDLE;
+	}
+}
+
+max::TextureHandle defaultTextureGet(DefaultTexture::Enum _texture)
+{
+	BX_ASSERT(0 != s_refCount, "Default textures are not acquired.")
+	return s_textures[_texture];
+}
+
+bool isDefaultTexture(max::TextureHandle _texture)
+{
+	for (uint32_t ii = 0; ii < DefaultTexture::Count && 0 != s_refCount; ++ii)
+	{
+		if (s_textures[ii].idx == _texture.idx)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
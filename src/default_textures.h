@@ -0,0 +1,34 @@
+#pragma once
+
+#include <max/max.h>
+
+/// Textures standing in for missing material maps.
+///
+struct DefaultTexture
+{
+	enum Enum
+	{
+		White,  //!< Diffuse and surface maps, material factors are used as is.
+		Normal, //!< Flat tangent space normal.
+
+		Count
+	};
+};
+
+/// Take reference to default textures, first reference creates them from constant texels.
+/// Call on the main thread only, like all other default texture functions.
+///
+void defaultTexturesAcquire();
+
+/// Release reference to default textures, last reference destroys them.
+///
+void defaultTexturesRelease();
+
+/// Get default texture, shared by all users. Valid while a reference is held, must not be
+/// destroyed.
+///
+max::TextureHandle defaultTextureGet(DefaultTexture::Enum _texture);
+
+/// Check if texture is one of the default textures.
+///
+bool isDefaultTexture(max::TextureHandle _texture);
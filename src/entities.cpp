@@ -1,5 +1,8 @@
 #include "entities.h"
 #include "components.h"
+#include "string_pool.h"
+#include "texture_manager.h"
+#include "virtual_texture_file.h"
 
 #include <bx/readerwriter.h>
 #include <bx/file.h>
@@ -9,32 +12,36 @@ void createCube(std::unordered_map<std::string, EntityHandle>& _entities, const
 {
 	RenderComponent rc;
 	rc.m_mesh = _cube;
+	cullingComputeBounds(_cube, rc.m_bounds);
 
 	MaterialComponent mc;
-	bx::strCopy(mc.m_diffuse.m_filepath, 1024, "");
+	mc.m_diffuse.m_filepath = "";
 	mc.m_diffuse.m_texture = MAX_INVALID_HANDLE;
 
 	mc.m_diffuseFactor[0] = _color.x;
 	mc.m_diffuseFactor[1] = _color.y;
 	mc.m_diffuseFactor[2] = _color.z;
 
-	bx::strCopy(mc.m_normal.m_filepath, 1024, "");
+	mc.m_normal.m_filepath = "";
 	mc.m_normal.m_texture = MAX_INVALID_HANDLE;
 
 	mc.m_normalFactor[0] = 1.0f;
 	mc.m_normalFactor[1] = 1.0f;
 	mc.m_normalFactor[2] = 1.0f;
 
-	bx::strCopy(mc.m_metallic.m_filepath, 1024, "");
+	mc.m_metallic.m_filepath = "";
 	mc.m_metallic.m_texture = MAX_INVALID_HANDLE;
 
 	mc.m_metallicFactor = 1.0f;
 
-	bx::strCopy(mc.m_roughness.m_filepath, 1024, "");
+	mc.m_roughness.m_filepath = "";
 	mc.m_roughness.m_texture = MAX_INVALID_HANDLE;
 
 	mc.m_roughnessFactor = 1.0f;
 
+	mc.m_surface.m_filepath = "";
+	mc.m_surface.m_texture = MAX_INVALID_HANDLE;
+
 	_entities[_name].m_handle = max::createEntity();
 	max::addComponent<TransformComponent>(_entities[_name].m_handle,
 		max::createComponent<TransformComponent>(_transform)
@@ -50,7 +57,8 @@ void createCube(std::unordered_map<std::string, EntityHandle>& _entities, const
 void Entities::load()
 {
 	// Resources
-	max::MeshHandle cube = max::loadMesh("meshes/cube.bin", true); // THIS DOESNT HAVE TANGENTS
+	m_cube = max::loadMesh("meshes/cube.bin", true); // THIS DOESNT HAVE TANGENTS
+	const max::MeshHandle cube = m_cube;
 
 	// Player (Maya)
 	m_entities["MayaPlayer"].m_handle = max::createEntity();
@@ -72,6 +80,20 @@ void Entities::load()
 		cube,
 		{1.0f, 1.0f, 1.0f});
 
+#if TG_CONFIG_VIRTUAL_TEXTURE
+	// Floor is too large for one texture, stone repeats over a 4096^2 virtual texture.
+	bx::FilePath floorPath;
+	if (virtualTextureCook("textures/fieldstone-rgba.dds", 8, floorPath) )
+	{
+		VirtualTextureComponent vc;
+		vc.m_filepath = stringIntern(floorPath.getCPtr() );
+
+		max::addComponent<VirtualTextureComponent>(m_entities["Floor"].m_handle,
+			max::createComponent<VirtualTextureComponent>(vc)
+		);
+	}
+#endif // TG_CONFIG_VIRTUAL_TEXTURE
+
 	createCube(m_entities,
 		"Right",
 		{ {0.0f, 5.0f, -5.5f}, {0.0f, 0.0f, 0.0f, 1.0f}, {5.0f, 4.75f, 0.5f} },
@@ -97,7 +119,7 @@ void Entities::load()
 		{ 1.0f, 1.0f, 1.0f });
 }
 
-void Entities::unload()
+void Entities::unload(TextureManager& _textureManager)
 {
 	if (m_entities.size() <= 0)
 	{
@@ -110,34 +132,26 @@ void Entities::unload()
 		{
 			if (RenderComponent* rc = max::getComponent<RenderComponent>(it->second.m_handle))
 			{
-				max::destroy(rc->m_mesh);
+				// Cube mesh is shared, destroyed once below.
 				rc->m_mesh = MAX_INVALID_HANDLE;
 			}
-			if (MaterialComponent* rc = max::getComponent<MaterialComponent>(it->second.m_handle))
+			if (MaterialComponent* mc = max::getComponent<MaterialComponent>(it->second.m_handle))
 			{
-				if (isValid(rc->m_diffuse.m_texture))
-				{
-					max::destroy(rc->m_diffuse.m_texture);
-					rc->m_diffuse.m_texture = MAX_INVALID_HANDLE;
-				}
-
-				if (isValid(rc->m_normal.m_texture))
-				{
-					max::destroy(rc->m_normal.m_texture);
-					rc->m_normal.m_texture = MAX_INVALID_HANDLE;
-				}
-
-				if (isValid(rc->m_roughness.m_texture))
-				{
-					max::destroy(rc->m_roughness.m_texture);
-					rc->m_roughness.m_texture = MAX_INVALID_HANDLE;
-				}
-
-				if (isValid(rc->m_metallic.m_texture))
-				{
-					max::destroy(rc->m_metallic.m_texture);
-					rc->m_metallic.m_texture = MAX_INVALID_HANDLE;
-				}
+				// Textures may be shared with the world, the manager destroys them with their last reference.
+				_textureManager.unload(mc->m_diffuse.m_filepath);
+				mc->m_diffuse.m_texture = MAX_INVALID_HANDLE;
+
+				_textureManager.unload(mc->m_normal.m_filepath);
+				mc->m_normal.m_texture = MAX_INVALID_HANDLE;
+
+				_textureManager.unload(mc->m_roughness.m_filepath);
+				mc->m_roughness.m_texture = MAX_INVALID_HANDLE;
+
+				_textureManager.unload(mc->m_metallic.m_filepath);
+				mc->m_metallic.m_texture = MAX_INVALID_HANDLE;
+
+				_textureManager.unload(mc->m_surface.m_filepath);
+				mc->m_surface.m_texture = MAX_INVALID_HANDLE;
 			}
 			max::destroy(it->second.m_handle);
 			it->second.m_handle = MAX_INVALID_HANDLE;
@@ -145,6 +159,9 @@ void Entities::unload()
 	}
 
 	m_entities.clear();
+
+	max::destroy(m_cube);
+	m_cube = MAX_INVALID_HANDLE;
 }
 
 void Entities::update()
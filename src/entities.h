@@ -5,14 +5,23 @@
 #include "maya_bridge.h"
 #include "handles.h"
 
+struct TextureManager;
+
 struct Entities
 {
 	Entities()
+		: m_cube(MAX_INVALID_HANDLE)
 	{}
 
 	void load();
-	void unload();
+
+	/// Destroy entities, material textures are released through the texture manager that
+	/// loaded them.
+	///
+	void unload(TextureManager& _textureManager);
+
 	void update();
 	
 	std::unordered_map<std::string, EntityHandle> m_entities;
+	max::MeshHandle m_cube; //!< Mesh shared by all entities.
 };
\ No newline at end of file
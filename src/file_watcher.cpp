@@ -0,0 +1,175 @@
+#include "file_watcher.h"
+
+#include <bx/filepath.h>
+
+#if BX_PLATFORM_LINUX
+#	include <sys/inotify.h>
+#	include <unistd.h>
+#endif // BX_PLATFORM_LINUX
+
+FileWatcher::FileWatcher()
+	: m_fd(-1)
+{
+#if BX_PLATFORM_LINUX
+	m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (0 > m_fd)
+	{
+		BX_TRACE("Failed to initialize inotify, files are not watched.")
+		m_fd = -1;
+	}
+#endif // BX_PLATFORM_LINUX
+}
+
+FileWatcher::~FileWatcher()
+{
+#if BX_PLATFORM_LINUX
+	if (0 <= m_fd)
+	{
+		// Closing the instance removes all its watches.
+		close(m_fd);
+	}
+#endif // BX_PLATFORM_LINUX
+}
+
+bool FileWatcher::add(const char* _filePath)
+{
+	if (!isSupported())
+	{
+		return false;
+	}
+
+	const bx::FilePath filePath(_filePath);
+
+	auto file = m_files.find(filePath.getCPtr());
+	if (file != m_files.end())
+	{
+		++file->second.m_refCount;
+		return true;
+	}
+
+	const bx::StringView path = filePath.getPath();
+	std::string dirPath(path.getPtr(), path.getLength());
+
+	auto dir = m_dirs.find(dirPath);
+	if (dir == m_dirs.end())
+	{
+#if BX_PLATFORM_LINUX
+		// Close after write and rename over cover both in place and atomic saves.
+		const int32_t wd = inotify_add_watch(m_fd
+			, dirPath.empty() ? "." : dirPath.c_str()
+			, IN_CLOSE_WRITE | IN_MOVED_TO
+			);
+		if (0 > wd)
+		{
+			BX_TRACE("Failed to watch directory of, %s", _filePath)
+			return false;
+		}
+
+		dir = m_dirs.insert({ dirPath, { wd, 0 } }).first;
+		m_wds[wd] = dirPath;
+#endif // BX_PLATFORM_LINUX
+	}
+
+	++dir->second.m_refCount;
+	m_files.insert({ filePath.getCPtr(), { _filePath, 1 } });
+
+	return true;
+}
+
+void FileWatcher::remove(const char* _filePath)
+{
+	const bx::FilePath filePath(_filePath);
+
+	auto file = m_files.find(filePath.getCPtr());
+	if (file == m_files.end()
+	||  0 != --file->second.m_refCount)
+	{
+		return;
+	}
+
+	m_files.erase(file);
+
+	const bx::StringView path = filePath.getPath();
+	auto dir = m_dirs.find(std::string(path.getPtr(), path.getLength()));
+	if (dir == m_dirs.end()
+	||  0 != --dir->second.m_refCount)
+	{
+		return;
+	}
+
+#if BX_PLATFORM_LINUX
+	inotify_rm_watch(m_fd, dir->second.m_wd);
+#endif // BX_PLATFORM_LINUX
+
+	m_wds.erase(dir->second.m_wd);
+	m_dirs.erase(dir);
+}
+
+uint32_t FileWatcher::poll(std::vector<const char*>& _outChanged)
+{
+	uint32_t num = 0;
+
+#if BX_PLATFORM_LINUX
+	if (!isSupported())
+	{
+		return 0;
+	}
+
+	const size_t first = _outChanged.size();
+
+	alignas(struct inotify_event) char buffer[4096];
+	for (;;)
+	{
+		// Non-blocking, fails with EAGAIN once all events are read.
+		const ssize_t size = read(m_fd, buffer, sizeof(buffer));
+		if (0 >= size)
+		{
+			break;
+		}
+
+		for (ssize_t offset = 0; offset < size;)
+		{
+			const struct inotify_event* event = (const struct inotify_event*)&buffer[offset];
+			offset += sizeof(struct inotify_event) + event->len;
+
+			auto dir = m_wds.find(event->wd);
+			if (0 == event->len
+			||  dir == m_wds.end())
+			{
+				continue;
+			}
+
+			const bx::FilePath filePath((dir->second + event->name).c_str());
+
+			auto file = m_files.find(filePath.getCPtr());
+			if (file == m_files.end())
+			{
+				continue;
+			}
+
+			// Saves often write a file more than once.
+			bool reported = false;
+			for (size_t ii = first; ii < _outChanged.size() && !reported; ++ii)
+			{
+				reported = _outChanged[ii] == file->second.m_filePath;
+			}
+
+			if (!reported)
+			{
+				_outChanged.push_back(file->second.m_filePath);
+				++num;
+			}
+		}
+	}
+#else
+	// Not implemented, no changes are ever reported.
+	BX_UNUSED(_outChanged);
+#endif // BX_PLATFORM_LINUX
+
+	return num;
+}
+
+bool FileWatcher::isSupported() const
+{
+	return 0 <= m_fd;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <bx/bx.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Watch files for changes, inotify on Linux. Directories are watched rather than files so
+/// editors saving by renaming a temporary file over the original are seen as well.
+///
+/// Linux only, there is no implementation for other platforms yet. There `add` fails,
+/// `poll` never reports changes and `isSupported` is false.
+///
+struct FileWatcher
+{
+	FileWatcher();
+	~FileWatcher();
+
+	/// Start watching file, files are reference counted.
+	///
+	/// @param[in] _filePath Interned path to file, see `stringIntern`. Reported as is by `poll`.
+	///
+	/// @returns True if file is watched.
+	///
+	bool add(const char* _filePath);
+
+	/// Stop watching file once removed as often as added.
+	///
+	void remove(const char* _filePath);
+
+	/// Get files written or replaced since last call, doesn't block.
+	///
+	/// @param[out] _outChanged Paths passed to `add` of changed files are appended, once each.
+	///
+	/// @returns Number of changed files.
+	///
+	uint32_t poll(std::vector<const char*>& _outChanged);
+
+	/// Get whether files can be watched on this platform.
+	///
+	bool isSupported() const;
+
+private:
+	struct File
+	{
+		const char* m_filePath; //!< Path passed to `add`.
+		uint32_t m_refCount;
+	};
+
+	struct Dir
+	{
+		int32_t m_wd;           //!< Native watch descriptor.
+		uint32_t m_refCount;    //!< Watched files in directory.
+	};
+
+	int32_t m_fd; //!< Native handle, -1 if not supported.
+	std::unordered_map<std::string, File> m_files;   //!< Normalized path to file.
+	std::unordered_map<std::string, Dir> m_dirs;     //!< Normalized path to directory, with trailing slash.
+	std::unordered_map<int32_t, std::string> m_wds;  //!< Watch descriptor to directory.
+};
@@ -0,0 +1,138 @@
+#include "jobs.h"
+
+#include <max/max.h>
+#include <bx/thread.h>
+#include <bx/mutex.h>
+#include <bx/semaphore.h>
+
+#include <deque>
+#include <thread>
+
+constexpr uint32_t kMaxJobThreads = 32;
+
+struct Job
+{
+	JobFn m_fn;
+	void* m_userData;
+};
+
+struct JobSystem
+{
+	void create(uint32_t _numThreads)
+	{
+		if (0 == _numThreads)
+		{
+			const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+			_numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		m_numThreads = bx::min(_numThreads, kMaxJobThreads);
+		m_exit = false;
+
+		for (uint32_t ii = 0; ii < m_numThreads; ++ii)
+		{
+			m_threads[ii].init(threadFunc, this, 0, "Job");
+		}
+	}
+
+	void destroy()
+	{
+		{
+			bx::MutexScope lock(m_mutex);
+			m_exit = true;
+		}
+
+		m_work.post(m_numThreads);
+
+		for (uint32_t ii = 0; ii < m_numThreads; ++ii)
+		{
+			m_threads[ii].shutdown();
+		}
+
+		m_numThreads = 0;
+	}
+
+	void push(JobFn _fn, void* _userData)
+	{
+		{
+			bx::MutexScope lock(m_mutex);
+			m_jobs.push_back({ _fn, _userData });
+		}
+
+		m_work.post();
+	}
+
+	static int32_t threadFunc(bx::Thread* _self, void* _userData)
+	{
+		BX_UNUSED(_self);
+
+		JobSystem* system = (JobSystem*)_userData;
+
+		for (;;)
+		{
+			system->m_work.wait();
+
+			Job job;
+			{
+				bx::MutexScope lock(system->m_mutex);
+
+				// Drain queue before exiting.
+				if (system->m_jobs.empty())
+				{
+					if (system->m_exit)
+					{
+						break;
+					}
+
+					continue;
+				}
+
+				job = system->m_jobs.front();
+				system->m_jobs.pop_front();
+			}
+
+			job.m_fn(job.m_userData);
+		}
+
+		return 0;
+	}
+
+	bx::Thread m_threads[kMaxJobThreads];
+	uint32_t m_numThreads;
+
+	bx::Mutex m_mutex;
+	bx::Semaphore m_work;
+	std::deque<Job> m_jobs;
+	bool m_exit;
+};
+
+static JobSystem* s_ctx = NULL;
+
+void jobsCreate(uint32_t _numThreads)
+{
+	s_ctx = BX_NEW(max::getAllocator(), JobSystem);
+	s_ctx->create(_numThreads);
+}
+
+void jobsDestroy()
+{
+	s_ctx->destroy();
+	bx::deleteObject<JobSystem>(max::getAllocator(), s_ctx);
+	s_ctx = NULL;
+}
+
+void jobsPush(JobFn _fn, void* _userData)
+{
+	if (NULL == s_ctx)
+	{
+		_fn(_userData);
+		return;
+	}
+
+	s_ctx->push(_fn, _userData);
+}
+
+uint32_t jobsGetNumThreads()
+{
+	return NULL != s_ctx ? s_ctx->m_numThreads : 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <bx/uint32_t.h>
+
+/// Job entry point, called on a worker thread.
+///
+typedef void (*JobFn)(void* _userData);
+
+/// Create job system worker threads.
+///
+/// @param[in] _numThreads Number of worker threads, 0 to use one less than the number of hardware threads.
+///
+void jobsCreate(uint32_t _numThreads = 0);
+
+/// Destroy job system, waits for queued jobs to finish.
+///
+void jobsDestroy();
+
+/// Queue job. Runs immediately on calling thread if job system has no worker threads.
+///
+void jobsPush(JobFn _fn, void* _userData);
+
+/// Get number of worker threads.
+///
+uint32_t jobsGetNumThreads();
@@ -8,6 +8,8 @@
 #include "components.h"
 #include "render.h"
 #include "camera.h"
+#include "jobs.h"
+#include "transform.h"
 
 #ifndef TG_CONFIG_WITH_IMGUI
 #	define TG_CONFIG_WITH_IMGUI 1
@@ -181,13 +183,17 @@ struct TwilightGuardian : public max::AppI
 		init.resolution.reset  = m_engine.m_reset;
 		init.callback = &m_callback;
 		max::init(init);
+
+		// Create job system, used by scene loading.
+		jobsCreate();
 		
-		// Load scenes.
-		m_world.load("scenes/scene.bin");
+		// Load scenes, world streams in over the first frames.
+		m_world.loadAsync("scenes/scene.bin");
 		m_entities.load();
 
 		// Create systems.
 		cameraCreate(&m_cameraSettings);
+		transformCreate();
 		renderCreate(&m_renderSettings);
 		inputCreate(&m_inputSettings, &m_engine.m_mouseState);
 
@@ -207,12 +213,17 @@ struct TwilightGuardian : public max::AppI
 
 		// Destroy systems.
 		renderDestroy();
+		transformDestroy();
 		cameraDestroy();
 		inputDestroy();
 
 		// Unload scenes.
 		m_world.unload();
-		m_entities.unload();
+		m_entities.unload(m_world.m_textureManager);
+		m_world.m_textureManager.trimCache(0);
+
+		// Destroy job system.
+		jobsDestroy();
 
 		// Shutdown engine.
 		max::shutdown();
@@ -236,7 +247,34 @@ struct TwilightGuardian : public max::AppI
 			{
 				if (ImGui::CollapsingHeader("Scene"))
 				{
+					uint32_t loaded, total;
+					if (m_world.getLoadProgress(loaded, total))
+					{
+						ImGui::ProgressBar(total > 0 ? float(loaded) / float(total) : 1.0f);
+					}
 
+					ImGui::SliderFloat("Load budget (ms)", &m_world.m_loadBudgetMs, 0.5f, 33.0f);
+
+					const TextureManager& tm = m_world.m_textureManager;
+					ImGui::Text("Textures: %.1f MB resident, %.1f MB requested"
+						, double(tm.getResidentSize() ) / (1024.0 * 1024.0)
+						, double(tm.getRequestedSize() ) / (1024.0 * 1024.0)
+						);
+
+					const TextureCacheStats& cache = tm.getCacheStats();
+					ImGui::Text("Texture cache: %.1f MB, %u hits, %u misses, %u evictions"
+						, double(cache.m_size) / (1024.0 * 1024.0)
+						, cache.m_numHits
+						, cache.m_numMisses
+						, cache.m_numEvictions
+						);
+					ImGui::Text("Texture reloads: %u", tm.getNumReloads() );
+
+					int32_t budgetMb = int32_t(m_world.m_textureManager.m_budget >> 20);
+					if (ImGui::SliderInt("Texture budget (MB)", &budgetMb, 16, 4096))
+					{
+						m_world.m_textureManager.m_budget = uint64_t(budgetMb) << 20;
+					}
 				}
 
 				if (ImGui::CollapsingHeader("Camera"))
@@ -246,7 +284,38 @@ struct TwilightGuardian : public max::AppI
 
 				if (ImGui::CollapsingHeader("Render"))
 				{
-
+					const RenderStats& stats = renderGetStats();
+					ImGui::Text("GBuffer: %u draws, %.3f ms submit"
+						, stats.m_numDraws
+						, stats.m_submitMs
+						);
+					const TransformStats& transforms = transformGetStats();
+					ImGui::Text("Transforms: %u, %u updated, %.3f ms"
+						, transforms.m_num
+						, transforms.m_numUpdated
+						, transforms.m_updateMs
+						);
+					ImGui::Text("BVH: %u levels, %.1f KB"
+						, transforms.m_bvhHeight
+						, double(transforms.m_bvhBytes) / 1024.0
+						);
+					const struct { const char* m_name; const CullStats* m_stats; } views[] =
+					{
+						{ "GBuffer",  &stats.m_gbuffer  },
+						{ "Shadow",   &stats.m_shadow   },
+						{ "Feedback", &stats.m_feedback },
+						{ "Cubemaps", &stats.m_cubemap  },
+					};
+					for (uint32_t ii = 0; ii < BX_COUNTOF(views); ++ii)
+					{
+						ImGui::Text("%s: %u submitted, %u culled, %.3f ms"
+							, views[ii].m_name
+							, views[ii].m_stats->m_numVisible
+							, views[ii].m_stats->m_numCulled
+							, views[ii].m_stats->m_cullMs
+							);
+					}
+					ImGui::Text("Virtual texture pages: %u", stats.m_numVirtualPages);
 				}
 
 #ifdef TG_CONFIG_WITH_MAYA
@@ -255,15 +324,17 @@ struct TwilightGuardian : public max::AppI
 				{
 					if (s_connectToMaya && m_mayaBridge == NULL)
 					{
-						// Unload current world and begin syncing with Maya.
+						// Unload current world, Maya sends its whole scene on connect and the bridge
+						// can't update meshes of entities that already exist.
 						m_world.unload();
 
+						// Begin syncing with Maya.
 						m_mayaBridge = BX_NEW(max::getAllocator(), MayaBridge);
 						BX_ASSERT(m_mayaBridge->begin(), "Failed to begin maya bridge, not enough memory.")
 					}
 					else if (m_mayaBridge != NULL)
 					{
-						// Save current world and end syncing with Maya. 
+						// Save changes to current world and end syncing with Maya. 
 						m_world.serialize();
 
 						BX_ASSERT(m_mayaBridge->end(), "Failed to end maya bridge.")
@@ -273,7 +344,7 @@ struct TwilightGuardian : public max::AppI
 						m_world.unload();
 
 						// Load serialized scene from disk.
-						m_world.deserialize();
+						m_world.loadAsync(m_world.m_filepath);
 					}
 				}
 #endif // TG_CONFIG_WITH_MAYA
@@ -315,10 +386,12 @@ struct TwilightGuardian : public max::AppI
 
 			// Update scene.
 			m_world.update();
+			m_world.streamTextures(m_renderSettings.m_activeCameraIdx, float(m_engine.m_height) );
 			m_entities.update();  
 
 			// Update systems.
 			cameraUpdate();
+			transformUpdate();
 			renderUpdate();
 			inputUpdate();
 
@@ -0,0 +1,144 @@
+#include "mapped_file.h"
+
+#include <bx/platform.h>
+
+#if BX_PLATFORM_WINDOWS
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif // WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif // BX_PLATFORM_WINDOWS
+
+bool MappedFile::open(const bx::FilePath& _filepath)
+{
+	close();
+
+#if BX_PLATFORM_WINDOWS
+	HANDLE file = CreateFileA(_filepath.getCPtr()
+		, GENERIC_READ
+		, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE
+		, NULL
+		, OPEN_EXISTING
+		, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN
+		, NULL
+		);
+	if (INVALID_HANDLE_VALUE == file)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || 0 == size.QuadPart)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (NULL == mapping)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (NULL == data)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	m_handle  = file;
+	m_mapping = mapping;
+	m_data    = (const uint8_t*)data;
+	m_size    = uint64_t(size.QuadPart);
+#else
+	int fd = ::open(_filepath.getCPtr(), O_RDONLY);
+	if (0 > fd)
+	{
+		return false;
+	}
+
+	struct stat st;
+	if (0 != fstat(fd, &st) || 0 == st.st_size)
+	{
+		::close(fd);
+		return false;
+	}
+
+	void* data = mmap(NULL, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd); // Mapping keeps its own reference to the file.
+
+	if (MAP_FAILED == data)
+	{
+		return false;
+	}
+
+	madvise(data, size_t(st.st_size), MADV_WILLNEED);
+
+	m_data = (const uint8_t*)data;
+	m_size = uint64_t(st.st_size);
+#endif // BX_PLATFORM_WINDOWS
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (NULL == m_data)
+	{
+		return;
+	}
+
+#if BX_PLATFORM_WINDOWS
+	UnmapViewOfFile(m_data);
+	CloseHandle((HANDLE)m_mapping);
+	CloseHandle((HANDLE)m_handle);
+#else
+	munmap((void*)m_data, size_t(m_size));
+#endif // BX_PLATFORM_WINDOWS
+
+	m_handle  = NULL;
+	m_mapping = NULL;
+	m_data    = NULL;
+	m_size    = 0;
+}
+
+bool fileGetStamp(const bx::FilePath& _filepath, FileStamp& _outStamp)
+{
+#if BX_PLATFORM_WINDOWS
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesExA(_filepath.getCPtr(), GetFileExInfoStandard, &data)
+	||  0 != (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) )
+	{
+		return false;
+	}
+
+	_outStamp.m_size  = uint64_t(data.nFileSizeHigh) << 32 | data.nFileSizeLow;
+	_outStamp.m_mtime = uint64_t(data.ftLastWriteTime.dwHighDateTime) << 32 | data.ftLastWriteTime.dwLowDateTime;
+#else
+	struct stat st;
+	if (0 != stat(_filepath.getCPtr(), &st)
+	||  !S_ISREG(st.st_mode) )
+	{
+		return false;
+	}
+
+#	if BX_PLATFORM_OSX || BX_PLATFORM_IOS
+	const struct timespec& mtime = st.st_mtimespec;
+#	else
+	const struct timespec& mtime = st.st_mtim;
+#	endif // BX_PLATFORM_OSX || BX_PLATFORM_IOS
+
+	_outStamp.m_size  = uint64_t(st.st_size);
+	_outStamp.m_mtime = uint64_t(mtime.tv_sec) * 1000000000 + uint64_t(mtime.tv_nsec);
+#endif // BX_PLATFORM_WINDOWS
+
+	return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <bx/filepath.h>
+
+/// Read-only memory mapped file.
+///
+struct MappedFile
+{
+	MappedFile()
+		: m_data(NULL)
+		, m_size(0)
+		, m_handle(NULL)
+		, m_mapping(NULL)
+	{}
+
+	/// Map entire file into memory.
+	///
+	/// @param[in] _filepath Path to file.
+	///
+	/// @returns True if file was mapped.
+	///
+	bool open(const bx::FilePath& _filepath);
+
+	/// Unmap file.
+	///
+	void close();
+
+	bool isOpen() const
+	{
+		return NULL != m_data;
+	}
+
+	const uint8_t* m_data; //!< Mapped file contents.
+	uint64_t m_size;       //!< Size of mapped file in bytes.
+
+private:
+	void* m_handle;  //!< Native file handle.
+	void* m_mapping; //!< Native mapping handle.
+};
+
+/// Size and last write time of a file, changes when file is written or replaced.
+///
+struct FileStamp
+{
+	uint64_t m_size;  //!< Size of file in bytes.
+	uint64_t m_mtime; //!< Last write time, native units.
+};
+
+/// Get size and last write time of file without opening it.
+///
+/// @returns True if file exists.
+///
+bool fileGetStamp(const bx::FilePath& _filepath, FileStamp& _outStamp);
@@ -5,6 +5,8 @@
 #include "world.h"
 #include "entities.h"
 #include "components.h"
+#include "string_pool.h"
+#include "texture_cook.h"
 
 bool MayaBridge::begin()
 {
@@ -72,15 +74,12 @@ void MayaBridge::read(World* _world, Entities* _entities)
 			{
 				if (meshEvent.m_numVertices == 0 && meshEvent.m_numIndices == 0)
 				{
-					// Destroy entity.
-					if (RenderComponent* drc = max::getComponent<RenderComponent>(entity))
-					{
-						max::destroy(drc->m_mesh);
-					}
-					max::destroy(entity);
+					// Destroy entity, releasing its textures as well.
+					_world->destroyEntity(entity);
 					entity = MAX_INVALID_HANDLE;
 
 					_world->m_entities.erase(meshEvent.m_name);
+					_world->markRemoved(meshEvent.m_name);
 				}
 				else
 				{
@@ -117,22 +116,28 @@ void MayaBridge::read(World* _world, Entities* _entities)
 
 				RenderComponent rc = {
 					max::createMesh(vertices, indices, layout), true, // @todo Add way to choose cast shadow in maya.
+					MeshBounds(),
 				};
+				_world->acquireMesh(rc.m_mesh);
+				rc.m_bounds = _world->getMeshBounds(rc.m_mesh);
 				max::addComponent<RenderComponent>(entity, max::createComponent<RenderComponent>(rc));
 
 				// Material.
 				MaterialComponent::Texture emptyTexture;
-				bx::strCopy(emptyTexture.m_filepath, 1024, "");
+				emptyTexture.m_filepath = "";
 				emptyTexture.m_texture = MAX_INVALID_HANDLE;
 
 				MaterialComponent mc = {
 					emptyTexture, { 1.0f, 1.0f, 1.0f }, // Diffuse
 					emptyTexture, { 1.0f, 1.0f, 1.0f }, // Normal
 					emptyTexture, 1.0f,                 // Roughness
-					emptyTexture, 1.0f                  // Metallic
+					emptyTexture, 1.0f,                 // Metallic
+					emptyTexture                        // Surface
 					// @todo Will it always be this? Even when importing meshes?
 				};
 				max::addComponent<MaterialComponent>(entity, max::createComponent<MaterialComponent>(mc));
+
+				_world->markDirty(meshEvent.m_name, SceneEntity::Transform | SceneEntity::Render | SceneEntity::Material);
 			}
 		}
 
@@ -165,6 +170,8 @@ void MayaBridge::read(World* _world, Entities* _entities)
 							transformEvent.m_scale[1],
 							transformEvent.m_scale[2]
 						};
+
+						_world->markDirty(transformEvent.m_name, SceneEntity::Transform);
 					}
 				}
 			}
@@ -183,20 +190,19 @@ void MayaBridge::read(World* _world, Entities* _entities)
 					MaterialComponent* mc = max::getComponent<MaterialComponent>(entity);
 					if (mc != NULL)
 					{
+						_world->markDirty(materialEvent.m_name, SceneEntity::Material);
+
 						// Color
 						if (bx::strCmp(mc->m_diffuse.m_filepath, materialEvent.m_diffusePath) != bx::kExitSuccess)
 						{
-							// Set new paths.
-							bx::strCopy(mc->m_diffuse.m_filepath, 1024, materialEvent.m_diffusePath);
+							// Release current texture, other materials may share it.
+							_world->unloadTexture(entity, mc->m_diffuse);
 
-							// Destroy current textures if they exist.
-							if (isValid(mc->m_diffuse.m_texture))
-							{
-								max::destroy(mc->m_diffuse.m_texture);
-							}
+							// Set new paths.
+							mc->m_diffuse.m_filepath = stringIntern(materialEvent.m_diffusePath);
 
 							// Load new textures with new paths.
-							mc->m_diffuse.m_texture = _world->m_textureManager.load(mc->m_diffuse.m_filepath);
+							_world->loadTexture(entity, mc->m_diffuse, TextureUsage::Color, false);
 						}
 						else
 						{
@@ -208,50 +214,59 @@ void MayaBridge::read(World* _world, Entities* _entities)
 						// Normal
 						if (bx::strCmp(mc->m_normal.m_filepath, materialEvent.m_normalPath) != bx::kExitSuccess)
 						{
-							// Set new paths.
-							bx::strCopy(mc->m_normal.m_filepath, 1024, materialEvent.m_normalPath);
+							// Release current texture, other materials may share it.
+							_world->unloadTexture(entity, mc->m_normal);
 
-							// Destroy current textures if they exist.
-							if (isValid(mc->m_normal.m_texture))
-							{
-								max::destroy(mc->m_normal.m_texture);
-							}
+							// Set new paths.
+							mc->m_normal.m_filepath = stringIntern(materialEvent.m_normalPath);
 
 							// Load new textures with new paths.
-							mc->m_normal.m_texture = _world->m_textureManager.load(mc->m_normal.m_filepath);
+							_world->loadTexture(entity, mc->m_normal, TextureUsage::Normal, false);
 						}
 
+#if TG_CONFIG_SURFACE_TEXTURE
+						// Roughness and metallic, packed into surface texture.
+						if (bx::strCmp(mc->m_roughness.m_filepath, materialEvent.m_roughnessPath) != bx::kExitSuccess
+						||  bx::strCmp(mc->m_metallic.m_filepath, materialEvent.m_metallicPath) != bx::kExitSuccess)
+						{
+							// Set new paths.
+							mc->m_roughness.m_filepath = stringIntern(materialEvent.m_roughnessPath);
+							mc->m_metallic.m_filepath = stringIntern(materialEvent.m_metallicPath);
+
+							// Release current surface, other materials may share it.
+							_world->unloadTexture(entity, mc->m_surface);
+
+							// Load new surface with new paths.
+							mc->m_surface.m_filepath = textureSurfacePath(mc->m_roughness.m_filepath, mc->m_metallic.m_filepath);
+							_world->loadTexture(entity, mc->m_surface, TextureUsage::Linear, false);
+						}
+#else
 						// Roughness
 						if (bx::strCmp(mc->m_roughness.m_filepath, materialEvent.m_roughnessPath) != bx::kExitSuccess)
 						{
-							// Set new paths.
-							bx::strCopy(mc->m_roughness.m_filepath, 1024, materialEvent.m_roughnessPath);
+							// Release current texture, other materials may share it.
+							_world->unloadTexture(entity, mc->m_roughness);
 
-							// Destroy current textures if they exist.
-							if (isValid(mc->m_roughness.m_texture))
-							{
-								max::destroy(mc->m_roughness.m_texture);
-							}
+							// Set new paths.
+							mc->m_roughness.m_filepath = stringIntern(materialEvent.m_roughnessPath);
 
 							// Load new textures with new paths.
-							mc->m_roughness.m_texture = _world->m_textureManager.load(mc->m_roughness.m_filepath);
+							_world->loadTexture(entity, mc->m_roughness, TextureUsage::Linear, false);
 						}
 
 						// Metallic
 						if (bx::strCmp(mc->m_metallic.m_filepath, materialEvent.m_metallicPath) != bx::kExitSuccess)
 						{
-							// Set new paths.
-							bx::strCopy(mc->m_metallic.m_filepath, 1024, materialEvent.m_metallicPath);
+							// Release current texture, other materials may share it.
+							_world->unloadTexture(entity, mc->m_metallic);
 
-							// Destroy current textures if they exist.
-							if (isValid(mc->m_metallic.m_texture))
-							{
-								max::destroy(mc->m_metallic.m_texture);
-							}
+							// Set new paths.
+							mc->m_metallic.m_filepath = stringIntern(materialEvent.m_metallicPath);
 
 							// Load new textures with new paths.
-							mc->m_metallic.m_texture = _world->m_textureManager.load(mc->m_metallic.m_filepath);
+							_world->loadTexture(entity, mc->m_metallic, TextureUsage::Linear, false);
 						}
+#endif // TG_CONFIG_SURFACE_TEXTURE
 					}
 				}
 			}
@@ -0,0 +1,356 @@
+#include "mesh_codec.h"
+
+#include <bx/math.h>
+
+constexpr uint32_t kLzMinMatch   = 4;
+constexpr uint32_t kLzMaxOffset  = UINT16_MAX;
+constexpr uint32_t kLzHashBits   = 14;
+constexpr uint32_t kLzHashSize   = 1 << kLzHashBits;
+constexpr uint32_t kLzLengthMask = 15;
+
+static uint32_t lzRead32(const uint8_t* _ptr)
+{
+	uint32_t value;
+	bx::memCopy(&value, _ptr, sizeof(uint32_t));
+	return value;
+}
+
+static uint32_t lzHash(uint32_t _value)
+{
+	return (_value * 2654435761u) >> (32 - kLzHashBits);
+}
+
+static bool lzWriteLength(uint8_t*& _dst, const uint8_t* _dstEnd, uint32_t _length)
+{
+	for (;;)
+	{
+		if (_dst >= _dstEnd)
+		{
+			return false;
+		}
+
+		if (_length < 255)
+		{
+			*_dst++ = uint8_t(_length);
+			return true;
+		}
+
+		*_dst++ = 255;
+		_length -= 255;
+	}
+}
+
+static bool lzWriteSequence(uint8_t*& _dst, const uint8_t* _dstEnd, const uint8_t* _literals, uint32_t _numLiterals, uint32_t _offset, uint32_t _matchLength)
+{
+	if (_dst >= _dstEnd)
+	{
+		return false;
+	}
+
+	const uint32_t matchCode = 0 != _offset ? _matchLength - kLzMinMatch : 0;
+
+	uint8_t* token = _dst++;
+	*token = uint8_t(bx::min(_numLiterals, kLzLengthMask) << 4 | bx::min(matchCode, kLzLengthMask));
+
+	if (_numLiterals >= kLzLengthMask
+	&&  !lzWriteLength(_dst, _dstEnd, _numLiterals - kLzLengthMask))
+	{
+		return false;
+	}
+
+	if (_numLiterals > uint32_t(_dstEnd - _dst))
+	{
+		return false;
+	}
+
+	bx::memCopy(_dst, _literals, _numLiterals);
+	_dst += _numLiterals;
+
+	// Last sequence has literals only.
+	if (0 == _offset)
+	{
+		return true;
+	}
+
+	if (2 > _dstEnd - _dst)
+	{
+		return false;
+	}
+
+	*_dst++ = uint8_t(_offset);
+	*_dst++ = uint8_t(_offset >> 8);
+
+	if (matchCode >= kLzLengthMask
+	&&  !lzWriteLength(_dst, _dstEnd, matchCode - kLzLengthMask))
+	{
+		return false;
+	}
+
+	return true;
+}
+
+uint32_t lzCompressBound(uint32_t _size)
+{
+	return _size + _size / 255 + 16;
+}
+
+uint32_t lzCompress(const void* _src, uint32_t _srcSize, void* _dst, uint32_t _dstCapacity)
+{
+	const uint8_t* src = (const uint8_t*)_src;
+	uint8_t* dst = (uint8_t*)_dst;
+	const uint8_t* dstEnd = dst + _dstCapacity;
+
+	uint32_t* table = (uint32_t*)bx::alloc(max::getAllocator(), kLzHashSize * sizeof(uint32_t));
+	bx::memSet(table, 0xff, kLzHashSize * sizeof(uint32_t));
+
+	bool ok = true;
+	uint32_t anchor = 0;
+	uint32_t pos = 0;
+
+	while (ok && pos + kLzMinMatch <= _srcSize)
+	{
+		const uint32_t sequence = lzRead32(&src[pos]);
+		const uint32_t hash = lzHash(sequence);
+		const uint32_t candidate = table[hash];
+		table[hash] = pos;
+
+		if (UINT32_MAX != candidate
+		&&  pos - candidate <= kLzMaxOffset
+		&&  lzRead32(&src[candidate]) == sequence)
+		{
+			uint32_t length = kLzMinMatch;
+			while (pos + length < _srcSize
+			&&     src[candidate + length] == src[pos + length])
+			{
+				++length;
+			}
+
+			ok = lzWriteSequence(dst, dstEnd, &src[anchor], pos - anchor, pos - candidate, length);
+
+			pos += length;
+			anchor = pos;
+		}
+		else
+		{
+			++pos;
+		}
+	}
+
+	ok = ok && lzWriteSequence(dst, dstEnd, &src[anchor], _srcSize - anchor, 0, 0);
+
+	bx::free(max::getAllocator(), table);
+
+	return ok ? uint32_t(dst - (uint8_t*)_dst) : 0;
+}
+
+static bool lzReadLength(const uint8_t*& _src, const uint8_t* _srcEnd, uint32_t& _length)
+{
+	uint8_t value;
+	do
+	{
+		if (_src >= _srcEnd)
+		{
+			return false;
+		}
+
+		value = *_src++;
+		_length += value;
+	}
+	while (255 == value);
+
+	return true;
+}
+
+bool lzDecompress(const void* _src, uint32_t _srcSize, void* _dst, uint32_t _dstSize)
+{
+	const uint8_t* src = (const uint8_t*)_src;
+	const uint8_t* srcEnd = src + _srcSize;
+	uint8_t* dst = (uint8_t*)_dst;
+	uint8_t* dstEnd = dst + _dstSize;
+
+	while (src < srcEnd)
+	{
+		const uint8_t token = *src++;
+
+		// Literals.
+		uint32_t numLiterals = token >> 4;
+		if (kLzLengthMask == numLiterals
+		&&  !lzReadLength(src, srcEnd, numLiterals))
+		{
+			return false;
+		}
+
+		if (numLiterals > uint32_t(srcEnd - src)
+		||  numLiterals > uint32_t(dstEnd - dst))
+		{
+			return false;
+		}
+
+		bx::memCopy(dst, src, numLiterals);
+		src += numLiterals;
+		dst += numLiterals;
+
+		if (src == srcEnd)
+		{
+			break;
+		}
+
+		// Match.
+		if (2 > srcEnd - src)
+		{
+			return false;
+		}
+
+		const uint32_t offset = uint32_t(src[0]) | uint32_t(src[1]) << 8;
+		src += 2;
+
+		uint32_t length = token & kLzLengthMask;
+		if (kLzLengthMask == length
+		&&  !lzReadLength(src, srcEnd, length))
+		{
+			return false;
+		}
+		length += kLzMinMatch;
+
+		if (0 == offset
+		||  offset > uint32_t(dst - (uint8_t*)_dst)
+		||  length > uint32_t(dstEnd - dst))
+		{
+			return false;
+		}
+
+		const uint8_t* match = dst - offset;
+		if (offset >= length)
+		{
+			bx::memCopy(dst, match, length);
+			dst += length;
+		}
+		else
+		{
+			// Overlapping match repeats last offset bytes.
+			for (uint32_t ii = 0; ii < length; ++ii)
+			{
+				*dst++ = *match++;
+			}
+		}
+	}
+
+	return dst == dstEnd;
+}
+
+void meshFilterEncode(const void* _src, uint32_t _size, uint32_t _stride, void* _dst)
+{
+	const uint8_t* src = (const uint8_t*)_src;
+	uint8_t* dst = (uint8_t*)_dst;
+	const uint32_t num = _size / _stride;
+
+	for (uint32_t plane = 0; plane < _stride; ++plane)
+	{
+		uint8_t prev = 0;
+		for (uint32_t ii = 0; ii < num; ++ii)
+		{
+			const uint8_t value = src[ii * _stride + plane];
+			dst[plane * num + ii] = uint8_t(value - prev);
+			prev = value;
+		}
+	}
+}
+
+void meshFilterDecode(const void* _src, uint32_t _size, uint32_t _stride, void* _dst)
+{
+	const uint8_t* src = (const uint8_t*)_src;
+	uint8_t* dst = (uint8_t*)_dst;
+	const uint32_t num = _size / _stride;
+
+	for (uint32_t plane = 0; plane < _stride; ++plane)
+	{
+		uint8_t prev = 0;
+		for (uint32_t ii = 0; ii < num; ++ii)
+		{
+			prev = uint8_t(prev + src[plane * num + ii]);
+			dst[ii * _stride + plane] = prev;
+		}
+	}
+}
+
+bool meshQuantizeLayout(const max::VertexLayout& _layout, max::VertexLayout& _outLayout)
+{
+	bool changed = false;
+
+	_outLayout.begin();
+
+	for (uint32_t ii = 0; ii < max::Attrib::Count; ++ii)
+	{
+		const max::Attrib::Enum attrib = max::Attrib::Enum(ii);
+		if (!_layout.has(attrib))
+		{
+			continue;
+		}
+
+		uint8_t num;
+		max::AttribType::Enum type;
+		bool normalized;
+		bool asInt;
+		_layout.decode(attrib, num, type, normalized, asInt);
+
+		const bool packed = false
+			|| max::Attrib::Normal == attrib
+			|| max::Attrib::Tangent == attrib
+			|| max::Attrib::Bitangent == attrib
+			;
+
+		if (packed && max::AttribType::Float == type)
+		{
+			// 4 components keep attribute 4 byte aligned.
+			_outLayout.add(attrib, 4, max::AttribType::Uint8, true, false);
+			changed = true;
+		}
+		else
+		{
+			_outLayout.add(attrib, num, type, normalized, asInt);
+		}
+	}
+
+	_outLayout.end();
+
+	return changed;
+}
+
+void meshQuantizeVertices(const max::VertexLayout& _dstLayout, void* _dst, const max::VertexLayout& _srcLayout, const void* _src, uint32_t _num)
+{
+	max::vertexConvert(_dstLayout, _dst, _srcLayout, _src, _num);
+
+	const max::Attrib::Enum packed[] = { max::Attrib::Normal, max::Attrib::Tangent, max::Attrib::Bitangent };
+	for (max::Attrib::Enum attrib : packed)
+	{
+		uint8_t num;
+		max::AttribType::Enum type;
+		bool normalized;
+		bool asInt;
+
+		if (!_dstLayout.has(attrib))
+		{
+			continue;
+		}
+
+		_dstLayout.decode(attrib, num, type, normalized, asInt);
+		if (max::AttribType::Uint8 != type || !normalized)
+		{
+			continue;
+		}
+
+		// Convert truncates, rewrite with [-1, 1] mapped to nearest of 0-255.
+		uint8_t* dst = (uint8_t*)_dst + _dstLayout.getOffset(attrib);
+		for (uint32_t ii = 0; ii < _num; ++ii, dst += _dstLayout.m_stride)
+		{
+			float value[4];
+			max::vertexUnpack(value, attrib, _srcLayout, _src, ii);
+
+			for (uint32_t jj = 0; jj < num; ++jj)
+			{
+				const float unorm = bx::clamp(value[jj] * 0.5f + 0.5f, 0.0f, 1.0f);
+				dst[jj] = uint8_t(unorm * 255.0f + 0.5f);
+			}
+		}
+	}
+}
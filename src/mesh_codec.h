@@ -0,0 +1,43 @@
+#pragma once
+
+#include <max/max.h>
+
+/// Worst case size of `lzCompress` output for input of _size bytes.
+///
+uint32_t lzCompressBound(uint32_t _size);
+
+/// Compress with a byte oriented LZ77 codec (LZ4 block style sequences, 64KB window).
+///
+/// @returns Compressed size, 0 if output doesn't fit into _dstCapacity.
+///
+uint32_t lzCompress(const void* _src, uint32_t _srcSize, void* _dst, uint32_t _dstCapacity);
+
+/// Decompress `lzCompress` output. Input is bounds checked, safe to call on untrusted data.
+///
+/// @returns True if exactly _dstSize bytes were decoded.
+///
+bool lzDecompress(const void* _src, uint32_t _srcSize, void* _dst, uint32_t _dstSize);
+
+/// Transpose elements of _stride bytes into byte planes and delta encode each plane. Makes
+/// vertex and index streams considerably more compressible.
+///
+/// @param[in] _size Size of _src in bytes, multiple of _stride.
+///
+void meshFilterEncode(const void* _src, uint32_t _size, uint32_t _stride, void* _dst);
+
+/// Inverse of `meshFilterEncode`.
+///
+void meshFilterDecode(const void* _src, uint32_t _size, uint32_t _stride, void* _dst);
+
+/// Get layout with normals, tangents and bitangents stored as normalized 8-bit values. Those
+/// attributes are packed into [0, 1] and unpacked in shaders, positions and texture
+/// coordinates are left at full precision.
+///
+/// @returns True if quantized layout differs from _layout.
+///
+bool meshQuantizeLayout(const max::VertexLayout& _layout, max::VertexLayout& _outLayout);
+
+/// Convert _num vertices to layout from `meshQuantizeLayout`. Like `max::vertexConvert`, but
+/// packed attributes are rounded to the nearest 8-bit value instead of truncated.
+///
+void meshQuantizeVertices(const max::VertexLayout& _dstLayout, void* _dst, const max::VertexLayout& _srcLayout, const void* _src, uint32_t _num);
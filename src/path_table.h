@@ -0,0 +1,246 @@
+#pragma once
+
+#include "string_pool.h"
+
+#include <bx/bx.h>
+#include <bx/string.h>
+
+#include <vector>
+
+/// Get 64-bit FNV-1a hash of path.
+///
+inline uint64_t pathHash(const char* _path)
+{
+	uint64_t hash = UINT64_C(0xcbf29ce484222325);
+	for (const char* ch = _path; '\0' != *ch; ++ch)
+	{
+		hash ^= uint8_t(*ch);
+		hash *= UINT64_C(0x100000001b3);
+	}
+
+	return hash;
+}
+
+/// Values by path in an open addressing hash table. Slots hold index and upper hash bits of
+/// entries and are probed linearly, lookups don't allocate and only compare paths on a full
+/// 64-bit hash match. Paths are interned on insert, see `stringIntern`, interned lookups
+/// compare pointers only.
+///
+/// Entries are indexed and keep their index until removed, values may move on insert.
+///
+template<typename Ty>
+struct PathTable
+{
+	static constexpr uint32_t kInvalid = UINT32_MAX;
+
+	PathTable()
+		: m_num(0)
+	{}
+
+	/// @returns Index of entry, kInvalid if none.
+	///
+	uint32_t find(const char* _path, uint64_t _hash) const
+	{
+		if (m_slots.empty())
+		{
+			return kInvalid;
+		}
+
+		const uint32_t mask = uint32_t(m_slots.size() - 1);
+		const uint32_t tag = uint32_t(_hash >> 32);
+
+		for (uint32_t ii = uint32_t(_hash) & mask;; ii = (ii + 1) & mask)
+		{
+			const Slot& slot = m_slots[ii];
+			if (kInvalid == slot.m_idx)
+			{
+				return kInvalid;
+			}
+
+			const Entry& entry = m_entries[slot.m_idx];
+			if (tag == slot.m_tag
+			&&  _hash == entry.m_hash
+			&&  (_path == entry.m_path || 0 == bx::strCmp(_path, entry.m_path) ) )
+			{
+				return slot.m_idx;
+			}
+		}
+	}
+
+	uint32_t find(const char* _path) const
+	{
+		return find(_path, pathHash(_path) );
+	}
+
+	/// Find entry, adding one with default value if none.
+	///
+	/// @returns Index of entry.
+	///
+	uint32_t insert(const char* _path, uint64_t _hash)
+	{
+		uint32_t idx = find(_path, _hash);
+		if (kInvalid != idx)
+		{
+			return idx;
+		}
+
+		// At most half full, probes stay short.
+		if (2 * (m_num + 1) > m_slots.size() )
+		{
+			grow();
+		}
+
+		if (m_free.empty())
+		{
+			idx = uint32_t(m_entries.size() );
+			m_entries.emplace_back();
+		}
+		else
+		{
+			idx = m_free.back();
+			m_free.pop_back();
+		}
+
+		Entry& entry = m_entries[idx];
+		entry.m_hash = _hash;
+		entry.m_path = stringIntern(_path);
+
+		const uint32_t mask = uint32_t(m_slots.size() - 1);
+		uint32_t ii = uint32_t(_hash) & mask;
+		while (kInvalid != m_slots[ii].m_idx)
+		{
+			ii = (ii + 1) & mask;
+		}
+
+		m_slots[ii] = { uint32_t(_hash >> 32), idx };
+		++m_num;
+
+		return idx;
+	}
+
+	uint32_t insert(const char* _path)
+	{
+		return insert(_path, pathHash(_path) );
+	}
+
+	/// Remove entry, its index is reused by later inserts.
+	///
+	void remove(uint32_t _idx)
+	{
+		Entry& entry = m_entries[_idx];
+		BX_ASSERT(NULL != entry.m_path, "Entry %u is not used.", _idx)
+
+		const uint32_t mask = uint32_t(m_slots.size() - 1);
+		uint32_t hole = uint32_t(entry.m_hash) & mask;
+		while (_idx != m_slots[hole].m_idx)
+		{
+			hole = (hole + 1) & mask;
+		}
+
+		// Shift following entries back instead of leaving a tombstone, entries stay at or
+		// after their home slot.
+		for (uint32_t ii = (hole + 1) & mask; kInvalid != m_slots[ii].m_idx; ii = (ii + 1) & mask)
+		{
+			const uint32_t home = uint32_t(m_entries[m_slots[ii].m_idx].m_hash) & mask;
+			if ( ( (ii - home) & mask) >= ( (ii - hole) & mask) )
+			{
+				m_slots[hole] = m_slots[ii];
+				hole = ii;
+			}
+		}
+
+		m_slots[hole].m_idx = kInvalid;
+
+		entry.m_path = NULL;
+		entry.m_value = Ty();
+		m_free.push_back(_idx);
+		--m_num;
+	}
+
+	void clear()
+	{
+		m_slots.clear();
+		m_entries.clear();
+		m_free.clear();
+		m_num = 0;
+	}
+
+	Ty& operator[](uint32_t _idx)
+	{
+		return m_entries[_idx].m_value;
+	}
+
+	const Ty& operator[](uint32_t _idx) const
+	{
+		return m_entries[_idx].m_value;
+	}
+
+	/// @returns Interned path of entry, NULL if index is not used.
+	///
+	const char* getPath(uint32_t _idx) const
+	{
+		return m_entries[_idx].m_path;
+	}
+
+	/// Get number of entries.
+	///
+	uint32_t getNum() const
+	{
+		return m_num;
+	}
+
+	/// Get end of entry indices, iterate up to it skipping indices without a path.
+	///
+	uint32_t getEnd() const
+	{
+		return uint32_t(m_entries.size() );
+	}
+
+private:
+	void grow()
+	{
+		const uint32_t num = bx::max<uint32_t>(16, uint32_t(m_slots.size() ) * 2);
+		m_slots.assign(num, { 0, kInvalid });
+
+		const uint32_t mask = num - 1;
+		for (uint32_t idx = 0, end = uint32_t(m_entries.size() ); idx < end; ++idx)
+		{
+			const Entry& entry = m_entries[idx];
+			if (NULL == entry.m_path)
+			{
+				continue;
+			}
+
+			uint32_t ii = uint32_t(entry.m_hash) & mask;
+			while (kInvalid != m_slots[ii].m_idx)
+			{
+				ii = (ii + 1) & mask;
+			}
+
+			m_slots[ii] = { uint32_t(entry.m_hash >> 32), idx };
+		}
+	}
+
+	struct Slot
+	{
+		uint32_t m_tag; //!< Upper 32 bits of entry hash.
+		uint32_t m_idx; //!< Index of entry, kInvalid if slot is empty.
+	};
+
+	struct Entry
+	{
+		Entry()
+			: m_hash(0)
+			, m_path(NULL)
+		{}
+
+		uint64_t m_hash;
+		const char* m_path; //!< Interned, NULL if entry is free.
+		Ty m_value;
+	};
+
+	std::vector<Slot> m_slots;     //!< Power of two sized.
+	std::vector<Entry> m_entries;
+	std::vector<uint32_t> m_free;  //!< Free entry indices.
+	uint32_t m_num;
+};
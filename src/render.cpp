@@ -2,10 +2,19 @@
 
 #include <max/max.h>
 #include <bimg/bimg.h>
+#include <bx/cpu.h>
 #include <bx/file.h>
 #include <bx/readerwriter.h>
+#include <bx/mutex.h>
+#include <bx/semaphore.h>
 
+#include "bvh.h"
 #include "components.h"
+#include "default_textures.h"
+#include "jobs.h"
+#include "texture_cook.h"
+#include "transform.h"
+#include "virtual_texture_file.h"
 
 #include <map> // @todo
 
@@ -254,6 +263,7 @@ struct Samplers
 		s_materialNormal = max::createUniform("s_materialNormal", max::UniformType::Sampler);
 		s_materialRoughness = max::createUniform("s_materialRoughness", max::UniformType::Sampler);
 		s_materialMetallic = max::createUniform("s_materialMetallic", max::UniformType::Sampler);
+		s_materialSurface = max::createUniform("s_materialSurface", max::UniformType::Sampler);
 		s_cubeDiffuse = max::createUniform("s_cubeDiffuse", max::UniformType::Sampler);
 		s_cubeNormal = max::createUniform("s_cubeNormal", max::UniformType::Sampler);
 		s_cubePosition = max::createUniform("s_cubePosition", max::UniformType::Sampler);
@@ -276,6 +286,7 @@ struct Samplers
 		max::destroy(s_materialNormal);
 		max::destroy(s_materialRoughness);
 		max::destroy(s_materialMetallic);
+		max::destroy(s_materialSurface);
 		max::destroy(s_cubeDiffuse);
 		max::destroy(s_cubeNormal);
 		max::destroy(s_cubePosition);
@@ -297,6 +308,7 @@ struct Samplers
 	max::UniformHandle s_materialNormal;
 	max::UniformHandle s_materialRoughness;
 	max::UniformHandle s_materialMetallic;
+	max::UniformHandle s_materialSurface;
 	max::UniformHandle s_cubeDiffuse;
 	max::UniformHandle s_cubeNormal;
 	max::UniformHandle s_cubePosition;
@@ -313,29 +325,6 @@ struct Samplers
 	max::UniformHandle s_gbufferDepth;
 };
 
-/// Create default texture with given color.
-/// 
-static max::TextureHandle createDefaultTexture(const uint8_t _r, const uint8_t _g, const uint8_t _b, const uint8_t _a)
-{
-	const uint32_t dim = 8;
-	const uint32_t textureSize = dim * dim * 4;
-	uint8_t* data = new uint8_t[textureSize];
-	for (uint32_t i = 0; i < textureSize; i += 4)
-	{
-		data[i + 0] = _r;
-		data[i + 1] = _g;
-		data[i + 2] = _b;
-		data[i + 3] = _a;
-	}
-	const max::Memory* mem = max::copy(data, textureSize);
-	max::TextureHandle texture = max::createTexture2D(
-		dim, dim, false, 1, max::TextureFormat::RGBA8, 0, mem
-	);
-	delete[] data;
-
-	return texture;
-}
-
 /// Global material.
 /// 
 struct Material
@@ -345,14 +334,12 @@ struct Material
 		m_samplers = _samplers;
 		m_uniforms = _uniforms;
 
-		m_whiteTexture = createDefaultTexture(255, 255, 255, 255);
-		m_normalTexture = createDefaultTexture(128, 128, 255, 255);
+		defaultTexturesAcquire();
 	}
 
 	void destroy()
 	{
-		max::destroy(m_normalTexture);
-		max::destroy(m_whiteTexture);
+		defaultTexturesRelease();
 	}
 
 	void submitPerDraw()
@@ -367,10 +354,13 @@ struct Material
 		m_uniforms->m_texNormalFactor[1] = m_factorNormal[1];
 		m_uniforms->m_texNormalFactor[2] = m_factorNormal[2];
 
+#if TG_CONFIG_SURFACE_TEXTURE
+		max::setTexture(2, m_samplers->s_materialSurface, m_texSurface);
+#else
 		max::setTexture(2, m_samplers->s_materialRoughness, m_texRoughness);
-		m_uniforms->m_texRoughnessFactor = m_factorRoughness;
-
 		max::setTexture(3, m_samplers->s_materialMetallic, m_texMetallic);
+#endif // TG_CONFIG_SURFACE_TEXTURE
+		m_uniforms->m_texRoughnessFactor = m_factorRoughness;
 		m_uniforms->m_texMetallicFactor = m_factorMetallic;
 	}
 
@@ -382,7 +372,7 @@ struct Material
 		}
 		else
 		{
-			m_texDiffuse = m_whiteTexture;
+			m_texDiffuse = defaultTextureGet(DefaultTexture::White);
 		}
 
 		m_factorDiffuse[0] = _r;
@@ -399,7 +389,7 @@ struct Material
 		}
 		else
 		{
-			m_texNormal = m_normalTexture;
+			m_texNormal = defaultTextureGet(DefaultTexture::Normal);
 		}
 
 		m_factorNormal[0] = _r;
@@ -416,7 +406,7 @@ struct Material
 		}
 		else
 		{
-			m_texRoughness = m_whiteTexture;
+			m_texRoughness = defaultTextureGet(DefaultTexture::White);
 		}
 
 		m_factorRoughness = _r;
@@ -430,12 +420,28 @@ struct Material
 		}
 		else
 		{
-			m_texMetallic = m_whiteTexture;
+			m_texMetallic = defaultTextureGet(DefaultTexture::White);
 		}
 
 		m_factorMetallic = _r;
 	}
 
+	/// @param[in] _texture Occlusion (r), roughness (g) and metallic (b), see TG_CONFIG_SURFACE_TEXTURE.
+	void setSurface(max::TextureHandle _texture, float _roughness, float _metallic)
+	{
+		if (isValid(_texture))
+		{
+			m_texSurface = _texture;
+		}
+		else
+		{
+			m_texSurface = defaultTextureGet(DefaultTexture::White);
+		}
+
+		m_factorRoughness = _roughness;
+		m_factorMetallic = _metallic;
+	}
+
 	Samplers* m_samplers;
 	Uniforms* m_uniforms;
 
@@ -443,15 +449,12 @@ struct Material
 	max::TextureHandle m_texNormal;
 	max::TextureHandle m_texRoughness;
 	max::TextureHandle m_texMetallic;
+	max::TextureHandle m_texSurface;
 
 	float m_factorDiffuse[4];
 	float m_factorNormal[4];
 	float m_factorRoughness;
 	float m_factorMetallic;
-
-private:
-	max::TextureHandle m_whiteTexture;
-	max::TextureHandle m_normalTexture;
 };
 
 /// Probe volume.
@@ -518,6 +521,8 @@ struct Probes
 	Probe* m_probes; //!< Probes.
 };
 
+struct VirtualTexturing;
+
 /// Common data used across render techniques.
 /// 
 struct CommonResources
@@ -532,7 +537,10 @@ struct CommonResources
 	Samplers* m_samplers;
 	Material* m_material;
 	Probes* m_probes;
+	RenderStats* m_stats;
+	VirtualTexturing* m_virtual;
 
+	uint32_t m_frame; //!< Frame number returned by last `max::frame`.
 	bool m_firstFrame;
 };
 
@@ -557,67 +565,502 @@ struct RenderData
 {
 	max::ViewId m_view;
 	max::ProgramHandle m_program;
+	max::ProgramHandle m_programVirtual; //!< Program of entities with a VirtualTextureComponent, invalid to use m_program.
 
 	CommonResources* m_common;
 
 	bool m_material; 
+	bool m_virtualOnly; //!< Only entities using m_programVirtual write color, others write depth.
+
+	Frustum m_frustum; //!< Renderables outside are not submitted, see `setFrustum`.
+
+	uint32_t m_numDraws; //!< Draws submitted, updated by `submit`.
+	CullStats m_cull;    //!< Culling of last `submit`.
+
+	std::vector<max::EntityHandle> m_entities; //!< Scratch of `submit`, renderables to draw.
+	std::vector<uint8_t> m_visible;            //!< Scratch of `submit`.
 };
 
-constexpr uint32_t kMaxRenderables = 1000;
+/// Set view frustum renderables are culled against.
+///
+static void setFrustum(RenderData* _renderData, const float* _view, const float* _proj)
+{
+	float viewProj[16];
+	bx::mtxMul(viewProj, _view, _proj);
+	cullingFrustum(_renderData->m_frustum, viewProj, max::getCaps()->homogeneousDepth);
+}
+
+static void submit(RenderData* _renderData);
+
+/// Sparse virtual texture of entities with a VirtualTextureComponent, one virtual texture at a
+/// time. A low resolution feedback pass writes the page each pixel needs and is read back, pages
+/// missing from the page cache atlas are read from the tiled file on worker threads. Until a page
+/// arrives the page table points its texels to the finest resident ancestor.
+///
+struct VirtualTexturing
+{
+	/// Page read on a worker thread.
+	struct PageLoad
+	{
+		VirtualTexturing* m_vt;
+		uint32_t m_page;
+		uint8_t* m_data; //!< Page texels including border.
+	};
+
+	void create(CommonResources* _common, max::ViewId _viewFeedback, max::ViewId _viewReadback)
+	{
+		m_common = _common;
+		m_viewFeedback = _viewFeedback;
+		m_viewReadback = _viewReadback;
+
+		m_programGBuffer = MAX_INVALID_HANDLE;
+		m_programFeedback = MAX_INVALID_HANDLE;
+
+#if TG_CONFIG_VIRTUAL_TEXTURE
+#	if TG_CONFIG_SURFACE_TEXTURE
+		m_programGBuffer = max::loadProgram("vs_gbuffer", "fs_gbuffer_vt_surface");
+#	else
+		m_programGBuffer = max::loadProgram("vs_gbuffer", "fs_gbuffer_vt");
+#	endif // TG_CONFIG_SURFACE_TEXTURE
+		m_programFeedback = max::loadProgram("vs_gbuffer", "fs_vt_feedback");
+#endif // TG_CONFIG_VIRTUAL_TEXTURE
+
+		u_vtParams = max::createUniform("u_vtParams", max::UniformType::Vec4, 2);
+		s_vtAtlas = max::createUniform("s_vtAtlas", max::UniformType::Sampler);
+		s_vtPageTable = max::createUniform("s_vtPageTable", max::UniformType::Sampler);
+
+		m_atlas = MAX_INVALID_HANDLE;
+		m_pageTable = MAX_INVALID_HANDLE;
+		m_readback = MAX_INVALID_HANDLE;
+		m_framebuffer.idx = max::kInvalidHandle;
+
+		m_filepath = NULL;
+		m_width = 0;
+		m_height = 0;
+		m_readFrame = 0;
+		m_numLoads = 0;
+		m_recreate = true;
+	}
+
+	void destroy()
+	{
+		close();
+		destroyFramebuffer();
+
+		max::destroy(s_vtPageTable);
+		max::destroy(s_vtAtlas);
+		max::destroy(u_vtParams);
+
+		if (isValid(m_programFeedback))
+		{
+			max::destroy(m_programFeedback);
+			max::destroy(m_programGBuffer);
+		}
+	}
+
+	/// Virtual texture is open and its shaders are built.
+	bool isEnabled() const
+	{
+		return m_file.isOpen();
+	}
+
+	void submitPerDraw()
+	{
+		// Atlas replaces diffuse map, page table uses a free stage.
+		max::setTexture(0, s_vtAtlas, m_atlas);
+		max::setTexture(4, s_vtPageTable, m_pageTable);
+		max::setUniform(u_vtParams, m_params, 2);
+	}
+
+	void render()
+	{
+		if (!isValid(m_programFeedback))
+		{
+			return;
+		}
+
+		open(findFilePath() );
+		if (!isEnabled() )
+		{
+			return;
+		}
+
+		upload();
+
+		// Feedback buffer is written by pending read, resize once it completes.
+		m_recreate = m_recreate || m_common->m_firstFrame;
+		if (m_recreate && 0 == m_readFrame)
+		{
+			destroyFramebuffer();
+			createFramebuffer();
+			m_recreate = false;
+		}
+
+		if (0 != m_readFrame
+		&&  m_common->m_frame >= m_readFrame)
+		{
+			resolve();
+		}
+
+		max::setViewFrameBuffer(m_viewFeedback, m_framebuffer);
+		max::setViewRect(m_viewFeedback, 0, 0, m_width, m_height);
+		max::setViewClear(m_viewFeedback, MAX_CLEAR_COLOR | MAX_CLEAR_DEPTH, 0x00000000, 1.0f, 0);
+		max::setViewTransform(m_viewFeedback, m_common->m_view, m_common->m_proj);
+
+		m_renderData.m_view = m_viewFeedback;
+		m_renderData.m_program = m_programFeedback;
+		m_renderData.m_programVirtual = m_programFeedback;
+		m_renderData.m_common = m_common;
+		m_renderData.m_material = false;
+		m_renderData.m_virtualOnly = true;
+		setFrustum(&m_renderData, m_common->m_view, m_common->m_proj);
+		submit(&m_renderData);
+		m_common->m_stats->m_feedback = m_renderData.m_cull;
+
+		if (0 == m_readFrame)
+		{
+			max::blit(m_viewReadback, m_readback, 0, 0, max::getTexture(m_framebuffer) );
+			m_readFrame = max::readTexture(m_readback, m_feedback.data() );
+		}
+
+		m_common->m_stats->m_numVirtualPages = m_cache.getNumResident();
+	}
+
+	max::ProgramHandle m_programGBuffer; //!< Invalid if shaders are not built.
+
+private:
+	/// Get virtual texture of first entity using one.
+	static const char* findFilePath()
+	{
+		const char* filePath = NULL;
+
+		max::System<VirtualTextureComponent> virtuals;
+		virtuals.each(1, [](max::EntityHandle _entity, void* _userData)
+		{
+			*(const char**)_userData = max::getComponent<VirtualTextureComponent>(_entity)->m_filepath;
+		}, &filePath);
+
+		return filePath;
+	}
+
+	void open(const char* _filePath)
+	{
+		if (_filePath == m_filepath)
+		{
+			return;
+		}
+
+		close();
+
+		// Failed files are not retried until the path changes.
+		m_filepath = _filePath;
+		if (NULL == _filePath
+		||  !m_file.open(_filePath) )
+		{
+			return;
+		}
+
+		const VirtualTextureDesc& desc = m_file.m_desc;
+		m_cache.create(desc, TG_CONFIG_VT_ATLAS_PAGES);
+
+		const uint16_t slotSize = desc.m_pageSize + 2 * desc.m_border;
+		const uint16_t atlasSize = TG_CONFIG_VT_ATLAS_PAGES * slotSize;
+		m_atlas = max::createTexture2D(atlasSize, atlasSize, false, 1, max::TextureFormat::RGBA8, MAX_SAMPLER_UVW_CLAMP);
+
+		const uint16_t numPages = uint16_t(desc.getNumPages(0) );
+		m_pageTable = max::createTexture2D(numPages, numPages, true, 1, max::TextureFormat::RGBA8, MAX_SAMPLER_POINT | MAX_SAMPLER_UVW_CLAMP);
+
+		for (uint8_t mip = 0; mip < desc.m_numMips; ++mip)
+		{
+			const uint16_t num = uint16_t(desc.getNumPages(mip) );
+			max::updateTexture2D(m_pageTable, 0, mip, 0, 0, num, num, max::copy(m_cache.getPageTable(mip), num * num * 4) );
+		}
+
+		m_params[0] = float(desc.m_size);
+		m_params[1] = float(desc.m_numMips);
+		m_params[2] = float(desc.m_pageSize);
+		m_params[3] = float(desc.m_border);
+		m_params[4] = float(atlasSize);
+		m_params[5] = float(slotSize);
+		m_params[6] = -bx::log2(float(TG_CONFIG_VT_FEEDBACK_DIVISOR) ); // Feedback derivatives are divisor times larger.
+		m_params[7] = 0.0f;
+	}
+
+	void close()
+	{
+		// Pages are read from the mapped file.
+		while (0 != bx::atomicFetchAndAdd<int32_t>(&m_numLoads, 0) )
+		{
+			m_loadDone.wait();
+		}
+
+		for (PageLoad* load : m_loaded)
+		{
+			bx::free(max::getAllocator(), load->m_data);
+			bx::deleteObject(max::getAllocator(), load);
+		}
+		m_loaded.clear();
+
+		if (isValid(m_atlas) )
+		{
+			max::destroy(m_atlas);
+			max::destroy(m_pageTable);
+			m_atlas = MAX_INVALID_HANDLE;
+			m_pageTable = MAX_INVALID_HANDLE;
+		}
+
+		m_cache.destroy();
+		m_file.close();
+		m_filepath = NULL;
+	}
+
+	/// Start loading pages requested by read back feedback.
+	void resolve()
+	{
+		m_requests.clear();
+		m_cache.resolve(m_feedback.data(), m_width * m_height, TG_CONFIG_VT_MAX_REQUESTS, m_requests);
+
+		for (uint32_t page : m_requests)
+		{
+			PageLoad* load = BX_NEW(max::getAllocator(), PageLoad);
+			load->m_vt = this;
+			load->m_page = page;
+			load->m_data = NULL;
+
+			bx::atomicFetchAndAdd<int32_t>(&m_numLoads, 1);
+			jobsPush(loadPage, load);
+		}
+
+		m_readFrame = 0;
+	}
+
+	/// Copy loaded pages into atlas and changed rows into page table.
+	void upload()
+	{
+		std::vector<PageLoad*> loaded;
+		{
+			bx::MutexScope lock(m_mutex);
+			loaded.swap(m_loaded);
+		}
+
+		const VirtualTextureDesc& desc = m_file.m_desc;
+		const uint16_t slotSize = desc.m_pageSize + 2 * desc.m_border;
+
+		for (PageLoad* load : loaded)
+		{
+			VirtualPageSlot slot;
+			if (m_cache.map(load->m_page, slot) )
+			{
+				// Atlas copy owns page memory.
+				max::updateTexture2D(m_atlas, 0, 0, slot.m_x * slotSize, slot.m_y * slotSize, slotSize, slotSize
+					, max::makeRef(load->m_data, m_file.getPageBytes(), freePage)
+					);
+			}
+			else
+			{
+				bx::free(max::getAllocator(), load->m_data);
+			}
+
+			bx::deleteObject(max::getAllocator(), load);
+		}
+
+		for (uint8_t mip = 0; mip < desc.m_numMips; ++mip)
+		{
+			uint32_t begin, end;
+			if (m_cache.getDirtyRows(mip, begin, end) )
+			{
+				const uint32_t num = desc.getNumPages(mip);
+				max::updateTexture2D(m_pageTable, 0, mip, 0, uint16_t(begin), uint16_t(num), uint16_t(end - begin)
+					, max::copy(m_cache.getPageTable(mip) + begin * num, (end - begin) * num * 4)
+					);
+			}
+		}
+	}
+
+	void createFramebuffer()
+	{
+		const RenderSettings::Rect rect = getScaledResolution(m_common);
+		m_width = bx::max<uint16_t>(rect.m_width / TG_CONFIG_VT_FEEDBACK_DIVISOR, 1);
+		m_height = bx::max<uint16_t>(rect.m_height / TG_CONFIG_VT_FEEDBACK_DIVISOR, 1);
+
+		max::TextureHandle fbtextures[] =
+		{
+			max::createTexture2D(m_width, m_height, false, 1, max::TextureFormat::RGBA8, MAX_TEXTURE_RT),
+			max::createTexture2D(m_width, m_height, false, 1, max::TextureFormat::D32F, MAX_TEXTURE_RT)
+		};
+		m_framebuffer = max::createFrameBuffer(BX_COUNTOF(fbtextures), fbtextures, true);
+
+		m_readback = max::createTexture2D(m_width, m_height, false, 1, max::TextureFormat::RGBA8, MAX_TEXTURE_BLIT_DST | MAX_TEXTURE_READ_BACK);
+		m_feedback.resize(m_width * m_height * 4);
+	}
+
+	void destroyFramebuffer()
+	{
+		if (isValid(m_framebuffer) )
+		{
+			max::destroy(m_framebuffer); // Textures are destroyed with it.
+			max::destroy(m_readback);
+			m_framebuffer.idx = max::kInvalidHandle;
+			m_readback = MAX_INVALID_HANDLE;
+		}
+	}
+
+	static void loadPage(void* _userData)
+	{
+		PageLoad* load = (PageLoad*)_userData;
+		VirtualTexturing* vt = load->m_vt;
+
+		// Touching the mapped page reads it from disk.
+		const uint32_t size = vt->m_file.getPageBytes();
+		load->m_data = (uint8_t*)bx::alloc(max::getAllocator(), size);
+		bx::memCopy(load->m_data, vt->m_file.getPage(load->m_page), size);
+
+		{
+			bx::MutexScope lock(vt->m_mutex);
+			vt->m_loaded.push_back(load);
+		}
+
+		bx::atomicFetchAndSub<int32_t>(&vt->m_numLoads, 1);
+		vt->m_loadDone.post();
+	}
+
+	static void freePage(void* _ptr, void* _userData)
+	{
+		BX_UNUSED(_userData);
+		bx::free(max::getAllocator(), _ptr);
+	}
+
+	CommonResources* m_common;
+	max::ViewId m_viewFeedback;
+	max::ViewId m_viewReadback;
+
+	RenderData m_renderData;
+
+	max::ProgramHandle m_programFeedback; //!< Invalid if shaders are not built.
+	max::UniformHandle u_vtParams;
+	max::UniformHandle s_vtAtlas;
+	max::UniformHandle s_vtPageTable;
+
+	max::TextureHandle m_atlas;           //!< Page cache, TG_CONFIG_VT_ATLAS_PAGES slots per side.
+	max::TextureHandle m_pageTable;       //!< Mip per virtual texture mip, texel per page, see `VirtualTextureCache`.
+	max::TextureHandle m_readback;        //!< Feedback copy read by CPU.
+	max::FrameBufferHandle m_framebuffer; //!< Feedback pass, TG_CONFIG_VT_FEEDBACK_DIVISOR times smaller than GBuffer.
+
+	float m_params[8]; //!< Size, mips, page size, border, atlas size, slot size, feedback lod bias.
+
+	const char* m_filepath; //!< Interned path of open virtual texture, NULL if none.
+	VirtualTextureFile m_file;
+	VirtualTextureCache m_cache;
+
+	uint16_t m_width;                //!< Feedback pass width.
+	uint16_t m_height;               //!< Feedback pass height.
+	std::vector<uint8_t> m_feedback; //!< Read back feedback pixels.
+	std::vector<uint32_t> m_requests;
+	uint32_t m_readFrame;            //!< Frame feedback read completes, 0 if none pending.
+	bool m_recreate;                 //!< Feedback pass is resized once no read is pending.
+
+	bx::Mutex m_mutex;
+	bx::Semaphore m_loadDone;
+	std::vector<PageLoad*> m_loaded; //!< Pages read by workers, guarded by m_mutex.
+	int32_t m_numLoads;              //!< Pages being read by workers.
+};
 
 /// Submit scene geometry for rendering.
 ///
 static void submit(RenderData* _renderData)
 {
-	max::System<TransformComponent, RenderComponent> renderables;
-	renderables.each(kMaxRenderables, [](max::EntityHandle _entity, void* _userData)
+	// Gathered once per frame by transformUpdate, no cap on number of renderables.
+	const RenderList& list = transformGetRenderList();
+
+	const int64_t begin = bx::getHPCounter();
+
+	std::vector<max::EntityHandle>& entities = _renderData->m_entities;
+	entities.clear();
+
+#if TG_CONFIG_FRUSTUM_CULLING && TG_CONFIG_BVH
+	// Subtrees outside frustum are skipped, those inside are taken without testing leaves.
+	const uint32_t numVisible = transformQueryFrustum(_renderData->m_frustum, entities);
+#elif TG_CONFIG_FRUSTUM_CULLING
+	_renderData->m_visible.resize(list.m_num);
+	uint8_t* visible = _renderData->m_visible.data();
+
+	const uint32_t numVisible = cullingSpheres(_renderData->m_frustum, list.m_sphere, list.m_num, visible);
+	for (uint32_t jj = 0; jj < list.m_num; ++jj)
 	{
-		RenderData* data = (RenderData*)_userData;
+		if (0 != visible[jj])
+		{
+			entities.push_back(list.m_entities[jj]);
+		}
+	}
+#else
+	entities.assign(list.m_entities, list.m_entities + list.m_num);
+	const uint32_t numVisible = list.m_num;
+#endif // TG_CONFIG_FRUSTUM_CULLING && TG_CONFIG_BVH
 
-		TransformComponent* tc = max::getComponent<TransformComponent>(_entity);
-		RenderComponent* rc = max::getComponent<RenderComponent>(_entity);
+	_renderData->m_cull.m_numVisible = numVisible;
+	_renderData->m_cull.m_numCulled = list.m_num - numVisible;
+	_renderData->m_cull.m_cullMs = double(bx::getHPCounter() - begin) * 1000.0 / double(bx::getHPFrequency() );
+
+	for (const max::EntityHandle entity : entities)
+	{
+		RenderComponent* rc = max::getComponent<RenderComponent>(entity);
+
+		// Cached once per frame, shared by all passes and mesh groups.
+		const float* mtx = transformGetWorld(entity);
 
 		max::MeshQuery* query = max::queryMesh(rc->m_mesh);
 		for (uint32_t ii = 0; ii < query->m_num; ++ii)
 		{
-			float mtx[16];
-			bx::mtxSRT(mtx,
-				tc->m_scale.x, tc->m_scale.y, tc->m_scale.z,
-				tc->m_rotation.x, tc->m_rotation.y, tc->m_rotation.z, tc->m_rotation.w,
-				tc->m_position.x, tc->m_position.y, tc->m_position.z);
-
 			max::setTransform(mtx);
 
 			max::setVertexBuffer(0, query->m_vertices[ii]);
 			max::setIndexBuffer(query->m_indices[ii]);
 
-			if (data->m_material)
+			VirtualTextureComponent* vc = isValid(_renderData->m_programVirtual)
+				? max::getComponent<VirtualTextureComponent>(entity)
+				: NULL
+				;
+
+			if (_renderData->m_material)
 			{
-				MaterialComponent* mc = max::getComponent<MaterialComponent>(_entity);
+				MaterialComponent* mc = max::getComponent<MaterialComponent>(entity);
 				if (mc != NULL)
 				{
-					data->m_common->m_material->setDiffuse(mc->m_diffuse.m_texture, mc->m_diffuseFactor[0], mc->m_diffuseFactor[1], mc->m_diffuseFactor[2]);
-					data->m_common->m_material->setNormal(mc->m_normal.m_texture, mc->m_normalFactor[0], mc->m_normalFactor[1], mc->m_normalFactor[2]);
-					data->m_common->m_material->setRoughness(mc->m_roughness.m_texture, mc->m_roughnessFactor);
-					data->m_common->m_material->setMetallic(mc->m_metallic.m_texture, mc->m_metallicFactor);
+					_renderData->m_common->m_material->setDiffuse(mc->m_diffuse.m_texture, mc->m_diffuseFactor[0], mc->m_diffuseFactor[1], mc->m_diffuseFactor[2]);
+					_renderData->m_common->m_material->setNormal(mc->m_normal.m_texture, mc->m_normalFactor[0], mc->m_normalFactor[1], mc->m_normalFactor[2]);
+#if TG_CONFIG_SURFACE_TEXTURE
+					_renderData->m_common->m_material->setSurface(mc->m_surface.m_texture, mc->m_roughnessFactor, mc->m_metallicFactor);
+#else
+					_renderData->m_common->m_material->setRoughness(mc->m_roughness.m_texture, mc->m_roughnessFactor);
+					_renderData->m_common->m_material->setMetallic(mc->m_metallic.m_texture, mc->m_metallicFactor);
+#endif // TG_CONFIG_SURFACE_TEXTURE
 				}
 
-				data->m_common->m_material->submitPerDraw();
-				data->m_common->m_uniforms->submitPerDraw();
+				_renderData->m_common->m_material->submitPerDraw();
+				_renderData->m_common->m_uniforms->submitPerDraw();
+			}
+
+			max::ProgramHandle program = _renderData->m_program;
+			if (NULL != vc)
+			{
+				_renderData->m_common->m_virtual->submitPerDraw();
+				program = _renderData->m_programVirtual;
 			}
 
+			const bool writeColor = NULL != vc || !_renderData->m_virtualOnly;
+
 			max::setState(0
-				| MAX_STATE_WRITE_RGB
-				| MAX_STATE_WRITE_A
+				| (writeColor ? MAX_STATE_WRITE_RGB | MAX_STATE_WRITE_A : 0)
 				| MAX_STATE_WRITE_Z
 				| MAX_STATE_DEPTH_TEST_LESS
 				| MAX_STATE_MSAA
 			);
 
-			max::submit(data->m_view, data->m_program);
-		}
+			max::submit(_renderData->m_view, program);
 
-	}, _renderData);
+			++_renderData->m_numDraws;
+		}
+	}
 }
 
 /// Deferred GBuffer.
@@ -640,7 +1083,11 @@ struct GBuffer
 		m_common = _common;
 
 		//
+#if TG_CONFIG_SURFACE_TEXTURE
+		m_program = max::loadProgram("vs_gbuffer", "fs_gbuffer_surface");
+#else
 		m_program = max::loadProgram("vs_gbuffer", "fs_gbuffer");
+#endif // TG_CONFIG_SURFACE_TEXTURE
 
 		// Don't create framebuffer until first render call.
 		m_framebuffer.idx = max::kInvalidHandle;
@@ -670,9 +1117,25 @@ struct GBuffer
 
 		m_renderData.m_view = m_view;
 		m_renderData.m_program = m_program;
+		m_renderData.m_programVirtual = MAX_INVALID_HANDLE;
 		m_renderData.m_common = m_common;
 		m_renderData.m_material = true;
+		m_renderData.m_virtualOnly = false;
+
+		if (m_common->m_virtual->isEnabled() )
+		{
+			m_renderData.m_programVirtual = m_common->m_virtual->m_programGBuffer;
+		}
+		m_renderData.m_numDraws = 0;
+		setFrustum(&m_renderData, m_common->m_view, m_common->m_proj);
+
+		const int64_t begin = bx::getHPCounter();
 		submit(&m_renderData);
+
+		RenderStats* stats = m_common->m_stats;
+		stats->m_submitMs = double(bx::getHPCounter() - begin) * 1000.0 / double(bx::getHPFrequency());
+		stats->m_numDraws = m_renderData.m_numDraws;
+		stats->m_gbuffer = m_renderData.m_cull;
 	}
 
 	void createFramebuffer()
@@ -1099,9 +1562,14 @@ struct SM
 
 		m_renderData.m_view = m_view;
 		m_renderData.m_program = m_program;
+		m_renderData.m_programVirtual = MAX_INVALID_HANDLE;
 		m_renderData.m_common = m_common;
 		m_renderData.m_material = false;
+		m_renderData.m_virtualOnly = false;
+		setFrustum(&m_renderData, view, proj);
 		submit(&m_renderData);
+
+		m_common->m_stats->m_shadow = m_renderData.m_cull;
 	}
 
 	void createFramebuffer(uint32_t _width, uint32_t _height)
@@ -1175,7 +1643,11 @@ struct GI
 		m_positionAtlas = max::createTexture2D(atlasWidth, atlasHeight, false, 1, max::TextureFormat::RG11B10F, MAX_TEXTURE_BLIT_DST);
 		m_depthAtlas = max::createTexture2D(atlasWidth, atlasHeight, false, 1, max::TextureFormat::R32F, MAX_TEXTURE_BLIT_DST);
 
+#if TG_CONFIG_SURFACE_TEXTURE
+		m_programCubemap = max::loadProgram("vs_gbuffer", "fs_gbuffer_cubemap_surface");
+#else
 		m_programCubemap = max::loadProgram("vs_gbuffer", "fs_gbuffer_cubemap");
+#endif // TG_CONFIG_SURFACE_TEXTURE
 
 		m_programOctahedral = max::loadProgram("vs_screen", "fs_octahedral");
 	}
@@ -1268,6 +1740,8 @@ struct GI
 		}
 		else
 		{
+			bx::memSet(&m_common->m_stats->m_cubemap, 0, sizeof(CullStats) );
+
 			for (uint32_t ii = 0; ii < m_common->m_probes->m_num; ++ii)
 			{
 				// Create gbuffer cubemap rendertarget.
@@ -1305,10 +1779,18 @@ struct GI
 
 					m_renderData.m_view = m_viewIdOffline;
 					m_renderData.m_program = m_programCubemap;
+					m_renderData.m_programVirtual = MAX_INVALID_HANDLE;
 					m_renderData.m_common = m_common;
 					m_renderData.m_material = true;
+					m_renderData.m_virtualOnly = false;
+					setFrustum(&m_renderData, view, proj);
 					submit(&m_renderData);
 
+					CullStats& cubemap = m_common->m_stats->m_cubemap;
+					cubemap.m_numVisible += m_renderData.m_cull.m_numVisible;
+					cubemap.m_numCulled += m_renderData.m_cull.m_numCulled;
+					cubemap.m_cullMs += m_renderData.m_cull.m_cullMs;
+
 					++m_viewIdOffline;
 				}
 
@@ -1644,12 +2126,17 @@ struct RenderSystem
 		m_material.create(&m_samplers, &m_uniforms);
 		m_probes.create({ -4.5f, 0.5f, -4.5f }, 3, 3, 3, 4.5f);
 
+		bx::memSet(&m_stats, 0, sizeof(m_stats) );
+
 		// Set common resources.
 		m_common.m_settings   = _settings;
 		m_common.m_uniforms   = &m_uniforms;
 		m_common.m_samplers   = &m_samplers;
 		m_common.m_material   = &m_material;
 		m_common.m_probes     = &m_probes;
+		m_common.m_stats      = &m_stats;
+		m_common.m_virtual    = &m_virtual;
+		m_common.m_frame      = 0;
 		m_common.m_firstFrame = true;
 
 		// Create all render techniques.
@@ -1674,11 +2161,16 @@ struct RenderSystem
 
 		m_forward.create(&m_common, 7);
 		max::setViewName(7, "Forward");
+
+		m_virtual.create(&m_common, 8, 9);
+		max::setViewName(8, "Virtual Texture Feedback");
+		max::setViewName(9, "Virtual Texture Readback");
 	}
 
 	void destroy()
 	{
 		// Destroy all render techniques.
+		m_virtual.destroy();
 		m_forward.destroy();
 		m_sky.destroy();
 		m_combine.destroy();
@@ -1739,6 +2231,7 @@ struct RenderSystem
 		m_uniforms.submitPerFrame();
 
 		// Render all render techniques.
+		m_virtual.render();
 		m_sm.render(&m_sky); // @todo Do we want sky as input here? Its using previous frame sky values since sm renders first.
 		m_gbuffer.render();
 		m_gi.render(); // @todo This also relies on uniforms.lightDir which is caluclated in sky. So this is also using previous frame sky values.
@@ -1748,7 +2241,7 @@ struct RenderSystem
 		m_forward.render(&m_gbuffer, &m_gi);
 
 		// Swap buffers.
-		max::frame();
+		m_common.m_frame = max::frame();
 
 		// End frame.
 		m_common.m_firstFrame = false;
@@ -1761,6 +2254,7 @@ struct RenderSystem
 	}
 
 	CommonResources m_common;
+	RenderStats m_stats;
 
 	Uniforms m_uniforms;
 	Samplers m_samplers;
@@ -1774,6 +2268,7 @@ struct RenderSystem
 	Combine m_combine;
 	Sky m_sky;
 	Forward m_forward;
+	VirtualTexturing m_virtual;
 };
 
 static RenderSystem* s_ctx = NULL;
@@ -1799,4 +2294,9 @@ void renderUpdate()
 void renderReset()
 {
 	s_ctx->reset();
+}
+
+const RenderStats& renderGetStats()
+{
+	return s_ctx->m_stats;
 }
\ No newline at end of file
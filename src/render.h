@@ -44,6 +44,29 @@ struct RenderSettings
 	bool m_debugbufferB;
 };
 
+/// Renderables culled by a view, see TG_CONFIG_FRUSTUM_CULLING.
+///
+struct CullStats
+{
+	uint32_t m_numVisible; //!< Renderables inside view frustum, submitted.
+	uint32_t m_numCulled;  //!< Renderables outside view frustum, skipped.
+	double m_cullMs;       //!< CPU time spent culling.
+};
+
+/// Render statistics of last frame.
+///
+struct RenderStats
+{
+	uint32_t m_numDraws;        //!< Draws submitted to GBuffer.
+	uint32_t m_numVirtualPages; //!< Virtual texture pages resident in page cache.
+	double m_submitMs;          //!< CPU time spent submitting GBuffer draws.
+
+	CullStats m_gbuffer;  //!< Camera view.
+	CullStats m_shadow;   //!< Shadow map view.
+	CullStats m_feedback; //!< Virtual texture feedback view.
+	CullStats m_cubemap;  //!< Summed over all cubemap faces of last probe bake.
+};
+
 /// Create render system context.
 /// 
 /// @param[in] _settings Render settings.
@@ -62,3 +85,7 @@ void renderUpdate();
 /// 
 void renderReset();
 
+/// Get render statistics of last frame.
+///
+const RenderStats& renderGetStats();
+
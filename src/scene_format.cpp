@@ -0,0 +1,1191 @@
+#include "scene_format.h"
+#include "mesh_codec.h"
+#include "jobs.h"
+
+#include <bx/readerwriter.h>
+#include <bx/file.h>
+#include <bx/cpu.h>
+#include <bx/hash.h>
+#include <bx/timer.h>
+#include <bx/semaphore.h>
+#include <bx/platform.h>
+
+#include <time.h>
+
+#if BX_PLATFORM_WINDOWS
+#	ifndef WIN32_LEAN_AND_MEAN
+#		define WIN32_LEAN_AND_MEAN
+#	endif // WIN32_LEAN_AND_MEAN
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <stdio.h>
+#	include <unistd.h>
+#endif // BX_PLATFORM_WINDOWS
+
+static uint64_t sceneAlign(uint64_t _value)
+{
+	return (_value + kSceneAlignment - 1) & ~uint64_t(kSceneAlignment - 1);
+}
+
+/// Buffers writes in blocks of fixed size and checksums each block before it is written.
+///
+struct SceneWriter
+{
+	/// @param[in] _writer Destination, NULL to keep everything buffered until `flush`.
+	/// @param[in] _blockSize Bytes covered by each checksum.
+	///
+	SceneWriter(bx::WriterI* _writer, uint64_t _blockSize)
+		: m_writer(_writer)
+		, m_blockSize(_blockSize)
+		, m_pos(0)
+	{
+	}
+
+	void write(const void* _data, uint64_t _size)
+	{
+		const uint8_t* data = (const uint8_t*)_data;
+
+		while (0 != _size)
+		{
+			const uint64_t size = bx::min<uint64_t>(_size, m_blockSize - m_block.size());
+			m_block.insert(m_block.end(), data, data + size);
+			m_pos += size;
+			data += size;
+			_size -= size;
+
+			if (m_block.size() == m_blockSize)
+			{
+				flush();
+			}
+		}
+	}
+
+	/// Pad to kSceneAlignment relative to start of writer.
+	void pad()
+	{
+		static const uint8_t s_zero[kSceneAlignment] = {};
+		write(s_zero, sceneAlign(m_pos) - m_pos);
+	}
+
+	/// Checksum and write pending partial block.
+	void flush()
+	{
+		if (m_block.empty())
+		{
+			return;
+		}
+
+		m_checksums.push_back(sceneChecksum(m_block.data(), m_block.size()));
+
+		if (NULL != m_writer)
+		{
+			bx::write(m_writer, m_block.data(), int32_t(m_block.size()), &m_err);
+			m_block.clear();
+		}
+	}
+
+	bx::WriterI* m_writer;
+	uint64_t m_blockSize;
+	uint64_t m_pos;                   //!< Bytes written so far.
+	std::vector<uint8_t> m_block;     //!< Pending block.
+	std::vector<uint32_t> m_checksums; //!< Checksum of each flushed block.
+	bx::Error m_err;
+};
+
+static bool replaceFile(const bx::FilePath& _src, const bx::FilePath& _dst)
+{
+#if BX_PLATFORM_WINDOWS
+	return 0 != MoveFileExA(_src.getCPtr(), _dst.getCPtr(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+	// Contents must be on disk before the rename is, or a crash can leave an empty file behind the new name.
+	int fd = ::open(_src.getCPtr(), O_RDONLY);
+	if (0 <= fd)
+	{
+		fsync(fd);
+		::close(fd);
+	}
+
+	if (0 != rename(_src.getCPtr(), _dst.getCPtr()) )
+	{
+		return false;
+	}
+
+	// Rename itself is only durable once the directory entry is on disk.
+	const bx::StringView dir = _dst.getPath();
+	char path[bx::kMaxFilePath];
+	bx::strCopy(path, sizeof(path), dir.isEmpty() ? bx::StringView(".") : dir);
+
+	fd = ::open(path, O_RDONLY);
+	if (0 <= fd)
+	{
+		fsync(fd);
+		::close(fd);
+	}
+
+	return true;
+#endif // BX_PLATFORM_WINDOWS
+}
+
+static uint32_t rotl32(uint32_t _value, uint32_t _shift)
+{
+	return (_value << _shift) | (_value >> (32 - _shift));
+}
+
+static uint32_t read32(const uint8_t* _ptr)
+{
+	uint32_t value;
+	bx::memCopy(&value, _ptr, sizeof(uint32_t));
+	return value;
+}
+
+uint32_t sceneChecksum(const void* _data, uint64_t _size, uint32_t _seed)
+{
+	// xxHash32.
+	constexpr uint32_t kPrime1 = 2654435761u;
+	constexpr uint32_t kPrime2 = 2246822519u;
+	constexpr uint32_t kPrime3 = 3266489917u;
+	constexpr uint32_t kPrime4 = 668265263u;
+	constexpr uint32_t kPrime5 = 374761393u;
+
+	const uint8_t* ptr = (const uint8_t*)_data;
+	const uint8_t* end = ptr + _size;
+
+	uint32_t hash;
+	if (_size >= 16)
+	{
+		uint32_t v0 = _seed + kPrime1 + kPrime2;
+		uint32_t v1 = _seed + kPrime2;
+		uint32_t v2 = _seed;
+		uint32_t v3 = _seed - kPrime1;
+
+		const uint8_t* limit = end - 16;
+		do
+		{
+			v0 = rotl32(v0 + read32(ptr +  0) * kPrime2, 13) * kPrime1;
+			v1 = rotl32(v1 + read32(ptr +  4) * kPrime2, 13) * kPrime1;
+			v2 = rotl32(v2 + read32(ptr +  8) * kPrime2, 13) * kPrime1;
+			v3 = rotl32(v3 + read32(ptr + 12) * kPrime2, 13) * kPrime1;
+			ptr += 16;
+		}
+		while (ptr <= limit);
+
+		hash = rotl32(v0, 1) + rotl32(v1, 7) + rotl32(v2, 12) + rotl32(v3, 18);
+	}
+	else
+	{
+		hash = _seed + kPrime5;
+	}
+
+	hash += uint32_t(_size);
+
+	for (; ptr + 4 <= end; ptr += 4)
+	{
+		hash = rotl32(hash + read32(ptr) * kPrime3, 17) * kPrime4;
+	}
+
+	for (; ptr < end; ++ptr)
+	{
+		hash = rotl32(hash + *ptr * kPrime5, 11) * kPrime1;
+	}
+
+	hash ^= hash >> 15;
+	hash *= kPrime2;
+	hash ^= hash >> 13;
+	hash *= kPrime3;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+uint32_t SceneMeshTable::add(const SceneMesh& _mesh, const SceneGeometry& _geometry)
+{
+	if (!m_dedup)
+	{
+		m_meshes.push_back(_mesh);
+		m_geometry.push_back(_geometry);
+		return (uint32_t)m_meshes.size() - 1;
+	}
+
+	bx::HashMurmur2A hash;
+	hash.begin();
+	hash.add(_mesh.m_layoutHash);
+	hash.add(_geometry.m_vertices, int32_t(_geometry.m_verticesSize));
+	hash.add(_geometry.m_indices, int32_t(_geometry.m_indicesSize));
+	const uint32_t key = hash.end();
+
+	// Compare contents on hash match, collisions must not merge different meshes.
+	auto range = m_lookup.equal_range(key);
+	for (auto it = range.first; it != range.second; ++it)
+	{
+		const SceneMesh& mesh = m_meshes[it->second];
+		const SceneGeometry& geometry = m_geometry[it->second];
+
+		if (mesh.m_layoutHash == _mesh.m_layoutHash
+		&&  geometry.m_verticesSize == _geometry.m_verticesSize
+		&&  geometry.m_indicesSize == _geometry.m_indicesSize
+		&&  0 == bx::memCmp(geometry.m_vertices, _geometry.m_vertices, _geometry.m_verticesSize)
+		&&  0 == bx::memCmp(geometry.m_indices, _geometry.m_indices, _geometry.m_indicesSize) )
+		{
+			return it->second;
+		}
+	}
+
+	const uint32_t index = (uint32_t)m_meshes.size();
+	m_meshes.push_back(_mesh);
+	m_geometry.push_back(_geometry);
+	m_lookup.insert({ key, index });
+
+	return index;
+}
+
+SceneStringTable::SceneStringTable()
+{
+	// Offset 0 is reserved for the empty string.
+	m_data.push_back('\0');
+}
+
+uint32_t SceneStringTable::add(const char* _str)
+{
+	if (NULL == _str || '\0' == _str[0])
+	{
+		return 0;
+	}
+
+	auto it = m_lookup.find(_str);
+	if (it != m_lookup.end())
+	{
+		return it->second;
+	}
+
+	const uint32_t offset = (uint32_t)m_data.size();
+	m_data.insert(m_data.end(), _str, _str + bx::strLen(_str) + 1);
+	m_lookup.insert({ _str, offset });
+
+	return offset;
+}
+
+/// Geometry of a mesh as stored in the file.
+///
+struct SceneEncodedGeometry
+{
+	std::vector<uint8_t> m_vertices; //!< Empty if raw vertices are stored.
+	std::vector<uint8_t> m_indices;  //!< Empty if raw indices are stored.
+};
+
+static bool compressStream(const void* _data, uint32_t _size, uint32_t _stride, std::vector<uint8_t>& _out)
+{
+	std::vector<uint8_t> filtered(_size);
+	meshFilterEncode(_data, _size, _stride, filtered.data());
+
+	_out.resize(lzCompressBound(_size));
+	const uint32_t size = lzCompress(filtered.data(), _size, _out.data(), uint32_t(_out.size()));
+
+	// Not worth decoding if it doesn't get smaller.
+	if (0 == size || size >= _size)
+	{
+		_out.clear();
+		return false;
+	}
+
+	_out.resize(size);
+	return true;
+}
+
+static void encodeMesh(SceneMesh& _mesh, const SceneGeometry& _geometry, uint32_t _compression, SceneEncodedGeometry& _out)
+{
+	_mesh.m_flags = 0;
+
+	// Vertices.
+	const void* vertices = _geometry.m_vertices;
+	uint32_t verticesSize = _geometry.m_verticesSize;
+	std::vector<uint8_t> quantized;
+
+	if (0 != (_compression & SceneCompression::Quantize) && 0 != _mesh.m_stride)
+	{
+		max::VertexLayout layout;
+		layout.m_hash = _mesh.m_layoutHash;
+		layout.m_stride = _mesh.m_stride;
+		bx::memCopy(layout.m_offset, _mesh.m_offset, sizeof(uint16_t) * max::Attrib::Count);
+		bx::memCopy(layout.m_attributes, _mesh.m_attributes, sizeof(uint16_t) * max::Attrib::Count);
+
+		max::VertexLayout quantizedLayout;
+		if (meshQuantizeLayout(layout, quantizedLayout))
+		{
+			const uint32_t numVertices = verticesSize / layout.m_stride;
+			quantized.resize(quantizedLayout.getSize(numVertices));
+			meshQuantizeVertices(quantizedLayout, quantized.data(), layout, vertices, numVertices);
+
+			_mesh.m_layoutHash = quantizedLayout.m_hash;
+			_mesh.m_stride = quantizedLayout.m_stride;
+			bx::memCopy(_mesh.m_offset, quantizedLayout.m_offset, sizeof(uint16_t) * max::Attrib::Count);
+			bx::memCopy(_mesh.m_attributes, quantizedLayout.m_attributes, sizeof(uint16_t) * max::Attrib::Count);
+
+			vertices = quantized.data();
+			verticesSize = uint32_t(quantized.size());
+		}
+	}
+
+	_mesh.m_verticesSize = verticesSize;
+	_mesh.m_verticesStoredSize = verticesSize;
+
+	if (0 != (_compression & SceneCompression::Lz)
+	&&  0 != _mesh.m_stride
+	&&  compressStream(vertices, verticesSize, _mesh.m_stride, _out.m_vertices))
+	{
+		_mesh.m_flags |= SceneMesh::VerticesLz;
+		_mesh.m_verticesStoredSize = uint32_t(_out.m_vertices.size());
+	}
+	else if (!quantized.empty())
+	{
+		_out.m_vertices.swap(quantized);
+	}
+
+	// Indices.
+	const uint32_t numIndices = _geometry.m_indicesSize / sizeof(uint32_t);
+	const void* indices = _geometry.m_indices;
+	uint32_t indexSize = sizeof(uint32_t);
+	std::vector<uint8_t> indices16;
+
+	if (0 != (_compression & SceneCompression::Index16)
+	&&  0 != _mesh.m_stride
+	&&  verticesSize / _mesh.m_stride <= UINT16_MAX + 1)
+	{
+		indices16.resize(numIndices * sizeof(uint16_t));
+
+		const uint32_t* src = (const uint32_t*)_geometry.m_indices;
+		uint16_t* dst = (uint16_t*)indices16.data();
+		for (uint32_t ii = 0; ii < numIndices; ++ii)
+		{
+			dst[ii] = uint16_t(src[ii]);
+		}
+
+		_mesh.m_flags |= SceneMesh::Index16;
+		indices = indices16.data();
+		indexSize = sizeof(uint16_t);
+	}
+
+	_mesh.m_indicesSize = numIndices * sizeof(uint32_t);
+	_mesh.m_indicesStoredSize = numIndices * indexSize;
+
+	if (0 != (_compression & SceneCompression::Lz)
+	&&  compressStream(indices, _mesh.m_indicesStoredSize, indexSize, _out.m_indices))
+	{
+		_mesh.m_flags |= SceneMesh::IndicesLz;
+		_mesh.m_indicesStoredSize = uint32_t(_out.m_indices.size());
+	}
+	else if (!indices16.empty())
+	{
+		_out.m_indices.swap(indices16);
+	}
+}
+
+static uint64_t encodeGeometry(SceneMeshTable& _meshes, uint32_t _compression, std::vector<SceneEncodedGeometry>& _outEncoded)
+{
+	const uint32_t numMeshes = (uint32_t)_meshes.m_meshes.size();
+	_outEncoded.resize(numMeshes);
+
+	uint64_t size = 0;
+	for (uint32_t ii = 0; ii < numMeshes; ++ii)
+	{
+		SceneMesh& mesh = _meshes.m_meshes[ii];
+		encodeMesh(mesh, _meshes.m_geometry[ii], _compression, _outEncoded[ii]);
+
+		mesh.m_verticesOffset = size;
+		size = sceneAlign(size + mesh.m_verticesStoredSize);
+
+		mesh.m_indicesOffset = size;
+		size = sceneAlign(size + mesh.m_indicesStoredSize);
+	}
+
+	return size;
+}
+
+static void writeGeometry(SceneWriter& _writer, const SceneMeshTable& _meshes, const std::vector<SceneEncodedGeometry>& _encoded)
+{
+	for (uint32_t ii = 0; ii < _meshes.m_meshes.size(); ++ii)
+	{
+		const SceneMesh& mesh = _meshes.m_meshes[ii];
+		const SceneGeometry& geo = _meshes.m_geometry[ii];
+		const SceneEncodedGeometry& enc = _encoded[ii];
+
+		_writer.write(enc.m_vertices.empty() ? geo.m_vertices : enc.m_vertices.data(), mesh.m_verticesStoredSize);
+		_writer.pad();
+
+		_writer.write(enc.m_indices.empty() ? geo.m_indices : enc.m_indices.data(), mesh.m_indicesStoredSize);
+		_writer.pad();
+	}
+}
+
+uint64_t sceneCreateUid()
+{
+	// Wall clock keeps ids unique across runs, counter within a run.
+	return uint64_t(time(NULL)) << 32 ^ uint64_t(bx::getHPCounter());
+}
+
+bool sceneWrite(const bx::FilePath& _filepath, const SceneEntity* _entities, uint32_t _num, SceneMeshTable& _meshes, const SceneStringTable& _strings, uint64_t _uid, uint32_t _compression)
+{
+	const uint32_t numMeshes = (uint32_t)_meshes.m_meshes.size();
+
+	// Encode and lay out geometry blobs.
+	std::vector<SceneEncodedGeometry> encoded;
+	const uint64_t geometrySize = encodeGeometry(_meshes, _compression, encoded);
+
+	SceneHeader header;
+	bx::memSet(&header, 0, sizeof(SceneHeader));
+	header.m_magic = TG_SCENE_MAGIC;
+	header.m_version = kSceneVersion;
+	header.m_numEntities = _num;
+	header.m_numMeshes = numMeshes;
+	header.m_uid = _uid;
+
+	SceneSectionDesc& entities = header.m_sections[SceneSection::Entities];
+	entities.m_offset = sceneAlign(sizeof(SceneHeader));
+	entities.m_size = uint64_t(_num) * sizeof(SceneEntity);
+
+	SceneSectionDesc& meshes = header.m_sections[SceneSection::Meshes];
+	meshes.m_offset = sceneAlign(entities.m_offset + entities.m_size);
+	meshes.m_size = uint64_t(numMeshes) * sizeof(SceneMesh);
+
+	SceneSectionDesc& strings = header.m_sections[SceneSection::Strings];
+	strings.m_offset = sceneAlign(meshes.m_offset + meshes.m_size);
+	strings.m_size = uint64_t(_strings.m_data.size());
+
+	SceneSectionDesc& geometry = header.m_sections[SceneSection::Geometry];
+	geometry.m_offset = sceneAlign(strings.m_offset + strings.m_size);
+	geometry.m_size = geometrySize;
+
+	// Everything after the header is covered by block checksums stored at the end of the file.
+	const uint64_t checksumBegin = entities.m_offset;
+	const uint64_t checksumEnd = sceneAlign(geometry.m_offset + geometry.m_size);
+	const uint64_t numBlocks = (checksumEnd - checksumBegin + kSceneChecksumBlock - 1) / kSceneChecksumBlock;
+
+	header.m_checksumBlockSize = kSceneChecksumBlock;
+	header.m_checksums.m_offset = checksumEnd;
+	header.m_checksums.m_size = numBlocks * sizeof(uint32_t);
+	header.m_checksum = sceneChecksum(&header, sizeof(SceneHeader));
+
+	// Write to a temporary file and swap it in once complete, a crash never leaves a partial scene behind.
+	char tempPath[bx::kMaxFilePath];
+	bx::snprintf(tempPath, sizeof(tempPath), "%s.tmp", _filepath.getCPtr());
+	const bx::FilePath temp(tempPath);
+
+	bx::Error err;
+	bx::FileWriter writer;
+
+	bx::makeAll(_filepath.getPath());
+
+	if (!bx::open(&writer, temp, false, &err))
+	{
+		BX_TRACE("Failed to open file at path %s", temp.getCPtr())
+		return false;
+	}
+
+	static const uint8_t s_zero[kSceneAlignment] = {};
+	bx::write(&writer, &header, sizeof(SceneHeader), &err);
+	bx::write(&writer, s_zero, int32_t(entities.m_offset - sizeof(SceneHeader)), &err);
+
+	SceneWriter sw(&writer, kSceneChecksumBlock);
+
+	sw.write(_entities, entities.m_size);
+	sw.pad();
+
+	sw.write(_meshes.m_meshes.data(), meshes.m_size);
+	sw.pad();
+
+	sw.write(_strings.m_data.data(), strings.m_size);
+	sw.pad();
+
+	writeGeometry(sw, _meshes, encoded);
+	sw.flush();
+
+	BX_ASSERT(sw.m_checksums.size() == numBlocks, "Checksum block count mismatch.")
+	bx::write(&writer, sw.m_checksums.data(), int32_t(header.m_checksums.m_size), &err);
+
+	bx::close(&writer);
+
+	if (!err.isOk() || !sw.m_err.isOk())
+	{
+		BX_TRACE("Failed to write scene to path %s", temp.getCPtr())
+		bx::remove(temp);
+		return false;
+	}
+
+	if (!replaceFile(temp, _filepath))
+	{
+		BX_TRACE("Failed to replace scene at path %s", _filepath.getCPtr())
+		bx::remove(temp);
+		return false;
+	}
+
+	// Log written against the previous scene no longer applies.
+	bx::remove(sceneDeltaPath(_filepath));
+
+	return true;
+}
+
+bx::FilePath sceneDeltaPath(const bx::FilePath& _filepath)
+{
+	char path[bx::kMaxFilePath];
+	bx::snprintf(path, sizeof(path), "%s.delta", _filepath.getCPtr());
+
+	return bx::FilePath(path);
+}
+
+bool sceneAppendDelta(const bx::FilePath& _filepath, uint64_t _baseUid, uint64_t& _size, const SceneEntity* _entities, uint32_t _num, const uint32_t* _removed, uint32_t _numRemoved, SceneMeshTable& _meshes, const SceneStringTable& _strings, uint32_t _compression)
+{
+	const uint32_t numMeshes = (uint32_t)_meshes.m_meshes.size();
+
+	std::vector<SceneEncodedGeometry> encoded;
+	const uint64_t geometrySize = encodeGeometry(_meshes, _compression, encoded);
+
+	SceneDeltaBlock block;
+	bx::memSet(&block, 0, sizeof(SceneDeltaBlock));
+	block.m_magic = TG_SCENE_DELTA_MAGIC;
+	block.m_numEntities = _num;
+	block.m_numMeshes = numMeshes;
+	block.m_numRemoved = _numRemoved;
+
+	SceneSectionDesc& entities = block.m_sections[SceneSection::Entities];
+	entities.m_offset = sceneAlign(sizeof(SceneDeltaBlock));
+	entities.m_size = uint64_t(_num) * sizeof(SceneEntity);
+
+	SceneSectionDesc& meshes = block.m_sections[SceneSection::Meshes];
+	meshes.m_offset = sceneAlign(entities.m_offset + entities.m_size);
+	meshes.m_size = uint64_t(numMeshes) * sizeof(SceneMesh);
+
+	SceneSectionDesc& strings = block.m_sections[SceneSection::Strings];
+	strings.m_offset = sceneAlign(meshes.m_offset + meshes.m_size);
+	strings.m_size = uint64_t(_strings.m_data.size());
+
+	SceneSectionDesc& removed = block.m_removed;
+	removed.m_offset = sceneAlign(strings.m_offset + strings.m_size);
+	removed.m_size = uint64_t(_numRemoved) * sizeof(uint32_t);
+
+	SceneSectionDesc& geometry = block.m_sections[SceneSection::Geometry];
+	geometry.m_offset = sceneAlign(removed.m_offset + removed.m_size);
+	geometry.m_size = geometrySize;
+
+	block.m_size = sceneAlign(geometry.m_offset + geometry.m_size);
+
+	// Block is small, payload is buffered so its checksum can go into the block header.
+	SceneWriter sw(NULL, UINT64_MAX);
+
+	sw.write(_entities, entities.m_size);
+	sw.pad();
+
+	sw.write(_meshes.m_meshes.data(), meshes.m_size);
+	sw.pad();
+
+	sw.write(_strings.m_data.data(), strings.m_size);
+	sw.pad();
+
+	sw.write(_removed, removed.m_size);
+	sw.pad();
+
+	writeGeometry(sw, _meshes, encoded);
+	sw.flush();
+
+	block.m_checksum = sceneChecksum(&block, sizeof(SceneDeltaBlock), 0 != sw.m_checksums.size() ? sw.m_checksums[0] : 0);
+
+	// Write.
+	static const uint8_t s_zero[kSceneAlignment] = {};
+
+	bx::Error err;
+	bx::FileWriter writer;
+
+	// A log that no longer exists is started over, appending would write a block without header.
+	bx::FileInfo info;
+	const bool append = 0 != _size && bx::stat(info, _filepath);
+	if (!append)
+	{
+		bx::remove(_filepath);
+	}
+
+	if (!bx::open(&writer, _filepath, append, &err))
+	{
+		BX_TRACE("Failed to open file at path %s", _filepath.getCPtr())
+		return false;
+	}
+
+	if (!append)
+	{
+		SceneDeltaHeader header;
+		header.m_magic = TG_SCENE_DELTA_MAGIC;
+		header.m_version = kSceneDeltaVersion;
+		header.m_baseUid = _baseUid;
+
+		bx::write(&writer, &header, sizeof(SceneDeltaHeader), &err);
+		bx::write(&writer, s_zero, int32_t(sceneAlign(sizeof(SceneDeltaHeader)) - sizeof(SceneDeltaHeader)), &err);
+	}
+
+	bx::write(&writer, &block, sizeof(SceneDeltaBlock), &err);
+	bx::write(&writer, s_zero, int32_t(entities.m_offset - sizeof(SceneDeltaBlock)), &err);
+	bx::write(&writer, sw.m_block.data(), int32_t(sw.m_block.size()), &err);
+
+	bx::close(&writer);
+
+	if (!err.isOk())
+	{
+		BX_TRACE("Failed to append delta to path %s", _filepath.getCPtr())
+		return false;
+	}
+
+	_size = (append ? _size : sceneAlign(sizeof(SceneDeltaHeader))) + block.m_size;
+	return true;
+}
+
+static void* decodeStream(const uint8_t* _src, uint32_t _storedSize, uint32_t _size, uint32_t _stride)
+{
+	void* filtered = bx::alloc(max::getAllocator(), _size);
+	if (!lzDecompress(_src, _storedSize, filtered, _size))
+	{
+		bx::free(max::getAllocator(), filtered);
+		return NULL;
+	}
+
+	void* decoded = bx::alloc(max::getAllocator(), _size);
+	meshFilterDecode(filtered, _size, _stride, decoded);
+	bx::free(max::getAllocator(), filtered);
+
+	return decoded;
+}
+
+bool sceneDecodeMesh(const SceneMesh& _mesh, const uint8_t* _geometry, void*& _outVertices, void*& _outIndices)
+{
+	_outVertices = NULL;
+	_outIndices = NULL;
+
+	if (0 != _mesh.m_indicesSize % sizeof(uint32_t))
+	{
+		return false;
+	}
+
+	bool result = true;
+
+	// Vertices.
+	if (0 != (_mesh.m_flags & SceneMesh::VerticesLz))
+	{
+		result = 0 != _mesh.m_stride
+			&& 0 == _mesh.m_verticesSize % _mesh.m_stride
+			&& NULL != (_outVertices = decodeStream(_geometry + _mesh.m_verticesOffset, _mesh.m_verticesStoredSize, _mesh.m_verticesSize, _mesh.m_stride))
+			;
+	}
+	else
+	{
+		result = _mesh.m_verticesStoredSize == _mesh.m_verticesSize;
+	}
+
+	// Indices.
+	const uint32_t numIndices = _mesh.m_indicesSize / sizeof(uint32_t);
+	const uint32_t indexSize = 0 != (_mesh.m_flags & SceneMesh::Index16) ? sizeof(uint16_t) : sizeof(uint32_t);
+	const uint8_t* indices = _geometry + _mesh.m_indicesOffset;
+
+	void* decoded = NULL;
+	if (result && 0 != (_mesh.m_flags & SceneMesh::IndicesLz))
+	{
+		decoded = decodeStream(indices, _mesh.m_indicesStoredSize, numIndices * indexSize, indexSize);
+		result = NULL != decoded;
+		indices = (const uint8_t*)decoded;
+	}
+	else if (result)
+	{
+		result = _mesh.m_indicesStoredSize == numIndices * indexSize;
+	}
+
+	if (result && 0 != (_mesh.m_flags & SceneMesh::Index16))
+	{
+		const uint16_t* src = (const uint16_t*)indices;
+		uint32_t* dst = (uint32_t*)bx::alloc(max::getAllocator(), _mesh.m_indicesSize);
+		for (uint32_t ii = 0; ii < numIndices; ++ii)
+		{
+			dst[ii] = src[ii];
+		}
+
+		_outIndices = dst;
+
+		if (NULL != decoded)
+		{
+			bx::free(max::getAllocator(), decoded);
+		}
+	}
+	else
+	{
+		_outIndices = decoded;
+	}
+
+	if (!result && NULL != _outVertices)
+	{
+		bx::free(max::getAllocator(), _outVertices);
+		_outVertices = NULL;
+	}
+
+	return result;
+}
+
+/// Get whether legacy stream holds at least size more bytes.
+static bool hasBytes(bx::FileReader& _reader, int64_t _fileSize, uint64_t _size)
+{
+	return _size <= uint64_t(_fileSize - bx::seek(&_reader) );
+}
+
+bool sceneConvertLegacy(const bx::FilePath& _src, const bx::FilePath& _dst)
+{
+	bx::Error err;
+	bx::FileReader reader;
+
+	if (!bx::open(&reader, _src, &err))
+	{
+		BX_TRACE("Failed to open file at path %s", _src.getCPtr())
+		return false;
+	}
+
+	const int64_t fileSize = bx::getSize(&reader);
+
+	uint32_t numEntities = 0;
+	bx::read(&reader, &numEntities, sizeof(uint32_t), &err);
+
+	if (TG_SCENE_MAGIC == numEntities || 0 == numEntities)
+	{
+		bx::close(&reader);
+		return false;
+	}
+
+	// Every entity holds at least its name and three component flags.
+	constexpr uint64_t kMinEntitySize = kSceneMaxPath + 3 * sizeof(bool);
+	if (!hasBytes(reader, fileSize, numEntities * kMinEntitySize) )
+	{
+		BX_TRACE("Legacy scene at path %s is corrupt, %u entities exceed file size", _src.getCPtr(), numEntities)
+		bx::close(&reader);
+		return false;
+	}
+
+	std::vector<SceneEntity> entities(numEntities);
+	std::vector<SceneGeometry> geometry(numEntities);
+	bx::memSet(entities.data(), 0, entities.size() * sizeof(SceneEntity));
+	bx::memSet(geometry.data(), 0, geometry.size() * sizeof(SceneGeometry));
+
+	SceneMeshTable meshes;
+	SceneStringTable strings;
+
+	char str[kSceneMaxPath];
+	bool valid = true;
+
+	for (uint32_t ii = 0; ii < numEntities && err.isOk() && valid; ++ii)
+	{
+		SceneEntity& entity = entities[ii];
+
+		bx::read(&reader, str, kSceneMaxPath, &err);
+		str[kSceneMaxPath - 1] = '\0';
+		entity.m_name = strings.add(str);
+
+		// Transform Component
+		bool hasTransformComponent = false;
+		bx::read(&reader, &hasTransformComponent, sizeof(bool), &err);
+		if (hasTransformComponent)
+		{
+			entity.m_flags |= SceneEntity::Transform;
+			bx::read(&reader, entity.m_position, sizeof(float) * 3, &err);
+			bx::read(&reader, entity.m_rotation, sizeof(float) * 4, &err);
+			bx::read(&reader, entity.m_scale, sizeof(float) * 3, &err);
+		}
+
+		// Render Component
+		bool hasRenderComponent = false;
+		bx::read(&reader, &hasRenderComponent, sizeof(bool), &err);
+		if (hasRenderComponent)
+		{
+			entity.m_flags |= SceneEntity::Render;
+
+			uint32_t num = 0;
+			bx::read(&reader, &num, sizeof(uint32_t), &err);
+
+			SceneMesh mesh;
+			bx::memSet(&mesh, 0, sizeof(SceneMesh));
+			bx::read(&reader, &mesh.m_layoutHash, sizeof(uint32_t), &err);
+			bx::read(&reader, &mesh.m_stride, sizeof(uint16_t), &err);
+			bx::read(&reader, mesh.m_offset, sizeof(uint16_t) * max::Attrib::Count, &err);
+			bx::read(&reader, mesh.m_attributes, sizeof(uint16_t) * max::Attrib::Count, &err);
+
+			SceneGeometry& geo = geometry[ii];
+
+			bx::read(&reader, &geo.m_verticesSize, sizeof(uint32_t), &err);
+			if (!hasBytes(reader, fileSize, geo.m_verticesSize) )
+			{
+				valid = false;
+				break;
+			}
+
+			void* vertices = bx::alloc(max::getAllocator(), geo.m_verticesSize);
+			bx::read(&reader, vertices, geo.m_verticesSize, &err);
+			geo.m_vertices = vertices;
+
+			bx::read(&reader, &geo.m_indicesSize, sizeof(uint32_t), &err);
+			if (!hasBytes(reader, fileSize, geo.m_indicesSize) )
+			{
+				valid = false;
+				break;
+			}
+
+			void* indices = bx::alloc(max::getAllocator(), geo.m_indicesSize);
+			bx::read(&reader, indices, geo.m_indicesSize, &err);
+			geo.m_indices = indices;
+
+			entity.m_mesh = meshes.add(mesh, geo);
+		}
+
+		// Material Component
+		bool hasMaterialComponent = false;
+		bx::read(&reader, &hasMaterialComponent, sizeof(bool), &err);
+		if (hasMaterialComponent)
+		{
+			entity.m_flags |= SceneEntity::Material;
+
+			SceneMaterial& material = entity.m_material;
+			uint32_t* paths[] = { &material.m_diffuse, &material.m_normal, &material.m_roughness, &material.m_metallic };
+			for (uint32_t jj = 0; jj < BX_COUNTOF(paths); ++jj)
+			{
+				bool hasTexture = false;
+				bx::read(&reader, &hasTexture, sizeof(bool), &err);
+				if (hasTexture)
+				{
+					bx::read(&reader, str, kSceneMaxPath, &err);
+					str[kSceneMaxPath - 1] = '\0';
+					*paths[jj] = strings.add(str);
+				}
+			}
+
+			bx::read(&reader, material.m_diffuseFactor, sizeof(float) * 3, &err);
+			bx::read(&reader, material.m_normalFactor, sizeof(float) * 3, &err);
+			bx::read(&reader, &material.m_roughnessFactor, sizeof(float), &err);
+			bx::read(&reader, &material.m_metallicFactor, sizeof(float), &err);
+		}
+	}
+
+	bx::close(&reader);
+
+	bool result = err.isOk() && valid;
+	if (result)
+	{
+		result = sceneWrite(_dst, entities.data(), numEntities, meshes, strings, sceneCreateUid());
+	}
+	else
+	{
+		BX_TRACE("Failed to read legacy scene at path %s", _src.getCPtr())
+	}
+
+	for (uint32_t ii = 0; ii < numEntities; ++ii)
+	{
+		if (NULL != geometry[ii].m_vertices)
+		{
+			bx::free(max::getAllocator(), (void*)geometry[ii].m_vertices);
+		}
+		if (NULL != geometry[ii].m_indices)
+		{
+			bx::free(max::getAllocator(), (void*)geometry[ii].m_indices);
+		}
+	}
+
+	if (result)
+	{
+		BX_TRACE("Converted legacy scene %s to %s", _src.getCPtr(), _dst.getCPtr())
+	}
+
+	return result;
+}
+
+bx::FilePath sceneConvertedPath(const bx::FilePath& _filepath)
+{
+	char path[bx::kMaxFilePath];
+	bx::snprintf(path, sizeof(path), "%s.converted", _filepath.getCPtr());
+
+	return bx::FilePath(path);
+}
+
+SceneFile* SceneFile::open(const bx::FilePath& _filepath)
+{
+	SceneFile* scene = BX_NEW(max::getAllocator(), SceneFile);
+	scene->m_refCount = 1;
+
+	if (!scene->m_file.open(_filepath))
+	{
+		bx::deleteObject(max::getAllocator(), scene);
+		return NULL;
+	}
+
+	// Validate header and section bounds.
+	const uint64_t fileSize = scene->m_file.m_size;
+	const SceneHeader* header = scene->getHeader();
+
+	bool valid = fileSize >= sizeof(SceneHeader)
+		&& TG_SCENE_MAGIC == header->m_magic
+		&& kSceneVersion == header->m_version
+		;
+
+	if (valid)
+	{
+		SceneHeader copy = *header;
+		copy.m_checksum = 0;
+		valid = header->m_checksum == sceneChecksum(&copy, sizeof(SceneHeader));
+	}
+
+	for (uint32_t ii = 0; ii < SceneSection::Count + 1 && valid; ++ii)
+	{
+		const SceneSectionDesc& section = ii < SceneSection::Count ? header->m_sections[ii] : header->m_checksums;
+		valid = section.m_offset <= fileSize
+			&& section.m_size <= fileSize - section.m_offset
+			&& 0 == (section.m_offset & (kSceneAlignment - 1))
+			;
+	}
+
+	valid = valid
+		&& header->m_sections[SceneSection::Entities].m_size == uint64_t(header->m_numEntities) * sizeof(SceneEntity)
+		&& header->m_sections[SceneSection::Meshes].m_size == uint64_t(header->m_numMeshes) * sizeof(SceneMesh)
+		&& header->m_sections[SceneSection::Strings].m_size > 0
+		&& header->m_checksumBlockSize > 0
+		&& header->m_checksums.m_offset >= header->m_sections[SceneSection::Entities].m_offset
+		;
+
+	if (valid)
+	{
+		const uint64_t covered = header->m_checksums.m_offset - header->m_sections[SceneSection::Entities].m_offset;
+		const uint64_t numBlocks = (covered + header->m_checksumBlockSize - 1) / header->m_checksumBlockSize;
+		valid = header->m_checksums.m_size == numBlocks * sizeof(uint32_t);
+	}
+
+	// String table must be terminated so lookups can never run past it.
+	if (valid)
+	{
+		const SceneSectionDesc& strings = header->m_sections[SceneSection::Strings];
+		valid = '\0' == scene->m_file.m_data[strings.m_offset + strings.m_size - 1];
+	}
+
+	if (!valid)
+	{
+		if (fileSize >= sizeof(uint32_t) && TG_SCENE_MAGIC == header->m_magic)
+		{
+			BX_TRACE("Scene at path %s is corrupt or has unsupported version %d", _filepath.getCPtr(), header->m_version)
+		}
+
+		scene->m_file.close();
+		bx::deleteObject(max::getAllocator(), scene);
+		return NULL;
+	}
+
+	return scene;
+}
+
+/// Range of checksum blocks verified by one job.
+///
+struct SceneVerifyJob
+{
+	SceneFile* m_scene;
+	uint32_t m_begin;
+	uint32_t m_end;
+	bool m_valid;
+	int32_t* m_pending;
+	bx::Semaphore* m_done;
+};
+
+static void verifyBlocks(void* _userData)
+{
+	SceneVerifyJob* job = (SceneVerifyJob*)_userData;
+
+	const SceneHeader* header = job->m_scene->getHeader();
+	const uint8_t* data = job->m_scene->m_file.m_data;
+	const uint32_t* checksums = (const uint32_t*)(data + header->m_checksums.m_offset);
+
+	const uint64_t begin = header->m_sections[SceneSection::Entities].m_offset;
+	const uint64_t end = header->m_checksums.m_offset;
+
+	job->m_valid = true;
+	for (uint32_t ii = job->m_begin; ii < job->m_end && job->m_valid; ++ii)
+	{
+		const uint64_t offset = begin + uint64_t(ii) * header->m_checksumBlockSize;
+		const uint64_t size = bx::min<uint64_t>(header->m_checksumBlockSize, end - offset);
+		job->m_valid = checksums[ii] == sceneChecksum(data + offset, size);
+	}
+
+	bx::atomicFetchAndSub<int32_t>(job->m_pending, 1);
+	job->m_done->post();
+}
+
+bool SceneFile::verify()
+{
+	const SceneHeader* header = getHeader();
+	const uint32_t numBlocks = uint32_t(header->m_checksums.m_size / sizeof(uint32_t));
+
+	// Few jobs per thread keeps workers busy when blocks are paged in at different speeds.
+	const uint32_t numJobs = bx::min(numBlocks, bx::max<uint32_t>(jobsGetNumThreads() * 4, 1));
+	const uint32_t blocksPerJob = (numBlocks + numJobs - 1) / bx::max<uint32_t>(numJobs, 1);
+
+	std::vector<SceneVerifyJob> jobs(numJobs);
+	bx::Semaphore done;
+	int32_t pending = int32_t(numJobs);
+
+	for (uint32_t ii = 0; ii < numJobs; ++ii)
+	{
+		SceneVerifyJob& job = jobs[ii];
+		job.m_scene = this;
+		job.m_begin = ii * blocksPerJob;
+		job.m_end = bx::min(job.m_begin + blocksPerJob, numBlocks);
+		job.m_pending = &pending;
+		job.m_done = &done;
+	}
+
+	for (SceneVerifyJob& job : jobs)
+	{
+		jobsPush(verifyBlocks, &job);
+	}
+
+	while (0 != bx::atomicFetchAndAdd<int32_t>(&pending, 0))
+	{
+		done.wait();
+	}
+
+	for (const SceneVerifyJob& job : jobs)
+	{
+		if (!job.m_valid)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void SceneFile::addRef()
+{
+	bx::atomicFetchAndAdd<int32_t>(&m_refCount, 1);
+}
+
+void SceneFile::release()
+{
+	// Last reference may be dropped from render thread once geometry has been consumed.
+	if (1 == bx::atomicFetchAndSub<int32_t>(&m_refCount, 1))
+	{
+		m_file.close();
+		bx::deleteObject(max::getAllocator(), this);
+	}
+}
+
+static void releaseSceneGeometry(void* _ptr, void* _userData)
+{
+	BX_UNUSED(_ptr);
+
+	SceneFile* scene = (SceneFile*)_userData;
+	scene->release();
+}
+
+bool SceneFile::isGeometry(uint64_t _offset, uint32_t _size) const
+{
+	const SceneSectionDesc& geometry = getHeader()->m_sections[SceneSection::Geometry];
+	return _offset <= geometry.m_size && _size <= geometry.m_size - _offset;
+}
+
+const max::Memory* SceneFile::makeRef(uint64_t _offset, uint32_t _size)
+{
+	if (!isGeometry(_offset, _size) )
+	{
+		return NULL;
+	}
+
+	const SceneSectionDesc& geometry = getHeader()->m_sections[SceneSection::Geometry];
+
+	addRef();
+	return max::makeRef(m_file.m_data + geometry.m_offset + _offset, _size, releaseSceneGeometry, this);
+}
+
+bool SceneDeltaFile::open(const bx::FilePath& _filepath, uint64_t _baseUid)
+{
+	close();
+
+	if (!m_file.open(_filepath))
+	{
+		return false;
+	}
+
+	const SceneDeltaHeader* header = (const SceneDeltaHeader*)m_file.m_data;
+
+	const bool valid = m_file.m_size >= sizeof(SceneDeltaHeader)
+		&& TG_SCENE_DELTA_MAGIC == header->m_magic
+		&& kSceneDeltaVersion == header->m_version
+		&& _baseUid == header->m_baseUid
+		;
+
+	if (!valid)
+	{
+		BX_TRACE("Ignoring delta log %s, it doesn't belong to the scene", _filepath.getCPtr())
+		m_file.close();
+		return false;
+	}
+
+	m_pos = sceneAlign(sizeof(SceneDeltaHeader));
+	return true;
+}
+
+void SceneDeltaFile::close()
+{
+	m_file.close();
+	m_pos = 0;
+}
+
+const SceneDeltaBlock* SceneDeltaFile::next()
+{
+	if (!m_file.isOpen()
+	||  m_pos >= m_file.m_size
+	||  sizeof(SceneDeltaBlock) > m_file.m_size - m_pos)
+	{
+		return NULL;
+	}
+
+	const SceneDeltaBlock* block = (const SceneDeltaBlock*)(m_file.m_data + m_pos);
+
+	// A save interrupted half way leaves a truncated block at the end of the log.
+	bool valid = TG_SCENE_DELTA_MAGIC == block->m_magic
+		&& block->m_size <= m_file.m_size - m_pos
+		&& 0 == (block->m_size & (kSceneAlignment - 1))
+		;
+
+	for (uint32_t ii = 0; ii < SceneSection::Count + 1 && valid; ++ii)
+	{
+		const SceneSectionDesc& section = ii < SceneSection::Count ? block->m_sections[ii] : block->m_removed;
+		valid = section.m_offset <= block->m_size
+			&& section.m_size <= block->m_size - section.m_offset
+			&& 0 == (section.m_offset & (kSceneAlignment - 1))
+			;
+	}
+
+	valid = valid
+		&& block->m_sections[SceneSection::Entities].m_size == uint64_t(block->m_numEntities) * sizeof(SceneEntity)
+		&& block->m_sections[SceneSection::Meshes].m_size == uint64_t(block->m_numMeshes) * sizeof(SceneMesh)
+		&& block->m_removed.m_size == uint64_t(block->m_numRemoved) * sizeof(uint32_t)
+		&& block->m_sections[SceneSection::Strings].m_size > 0
+		;
+
+	// Blocks are small, always verified.
+	if (valid)
+	{
+		const uint64_t payload = block->m_sections[SceneSection::Entities].m_offset;
+
+		SceneDeltaBlock copy = *block;
+		copy.m_checksum = 0;
+
+		const uint32_t seed = payload < block->m_size ? sceneChecksum((const uint8_t*)block + payload, block->m_size - payload) : 0;
+		valid = block->m_checksum == sceneChecksum(&copy, sizeof(SceneDeltaBlock), seed);
+	}
+
+	if (valid)
+	{
+		const SceneSectionDesc& strings = block->m_sections[SceneSection::Strings];
+		valid = '\0' == getSection(block, strings)[strings.m_size - 1];
+	}
+
+	if (!valid)
+	{
+		return NULL;
+	}
+
+	m_pos += block->m_size;
+	return block;
+}
@@ -0,0 +1,434 @@
+#pragma once
+
+#include <max/max.h>
+#include <bx/filepath.h>
+
+#include "mapped_file.h"
+
+#include <unordered_map>
+#include <string>
+#include <vector>
+
+// Scene container layout:
+//
+//   SceneHeader
+//   SceneEntity[m_numEntities]                  (SceneSection::Entities)
+//   SceneMesh[m_numMeshes]                      (SceneSection::Meshes)
+//   Null terminated strings                     (SceneSection::Strings)
+//   Vertex and index blobs, kSceneAlignment each (SceneSection::Geometry)
+//   Checksum of every kSceneChecksumBlock bytes after the header (SceneHeader::m_checksums)
+//
+// Every section starts at a kSceneAlignment aligned file offset so the whole file can be
+// memory mapped and geometry handed straight to the renderer without an intermediate copy.
+// Meshes are stored once per unique content and referenced from entities by index. Names
+// and paths are stored once in the string table and referenced by 32-bit offset, offset 0
+// is always the empty string.
+//
+// Meshes with multiple groups store all groups in one vertex and one index blob, with
+// indices rebased to the shared vertex blob. They load as a single group drawn with one
+// submit, the entity has a single material for all of them anyway.
+//
+// Geometry blobs are optionally compressed per mesh, see `SceneCompression`. Uncompressed
+// blobs are still referenced from the mapping, compressed ones are decoded on load.
+//
+// Scenes are written to a temporary file that replaces the old one once complete. The header
+// checksum is always checked on open, block checksums only by `SceneFile::verify`.
+//
+// Incremental saves append blocks of changed entities to a delta log next to the scene,
+// see `sceneAppendDelta`. The log is bound to its base scene by `SceneHeader::m_uid` and
+// replayed on top of it when loading.
+
+#define TG_SCENE_MAGIC       BX_MAKEFOURCC('T', 'G', 'S', 'C')
+#define TG_SCENE_DELTA_MAGIC BX_MAKEFOURCC('T', 'G', 'S', 'D')
+
+constexpr uint32_t kSceneVersion      = 7;    //!< Current scene container version.
+constexpr uint32_t kSceneDeltaVersion = 3;    //!< Current delta log version.
+constexpr uint32_t kSceneAlignment = 16;   //!< Alignment of sections and geometry blobs.
+constexpr uint32_t kSceneMaxPath   = 1024; //!< Max length of names and paths in legacy scenes.
+
+constexpr uint32_t kSceneChecksumBlock = 1 << 20; //!< Bytes covered by each block checksum.
+
+/// Geometry compression applied when writing a scene.
+///
+struct SceneCompression
+{
+	enum Enum
+	{
+		None     = 0,
+		Quantize = 1 << 0, //!< Store normals, tangents and bitangents as normalized 8-bit, see `meshQuantizeLayout`.
+		Index16  = 1 << 1, //!< Store 16-bit indices for meshes with at most 65536 vertices.
+		Lz       = 1 << 2, //!< Filter and LZ compress blobs that get smaller.
+
+		Lossless = Index16 | Lz, //!< Round trips geometry bit exact.
+		All      = Quantize | Index16 | Lz
+	};
+};
+
+#ifndef TG_CONFIG_SCENE_COMPRESSION
+#	define TG_CONFIG_SCENE_COMPRESSION SceneCompression::Lossless //!< Quantize is opt-in, it's lossy.
+#endif // TG_CONFIG_SCENE_COMPRESSION
+
+#ifndef TG_CONFIG_SCENE_DEDUP
+#	define TG_CONFIG_SCENE_DEDUP 1 //!< Store meshes with identical contents once in saved scenes.
+#endif // TG_CONFIG_SCENE_DEDUP
+
+#ifndef TG_CONFIG_SCENE_VERIFY
+#	define TG_CONFIG_SCENE_VERIFY BX_CONFIG_DEBUG //!< Verify block checksums of scenes on load.
+#endif // TG_CONFIG_SCENE_VERIFY
+
+#ifndef TG_CONFIG_SCENE_VERIFY_ASYNC
+#	define TG_CONFIG_SCENE_VERIFY_ASYNC 0 //!< Also verify on asynchronous load, blocks the frame starting it.
+#endif // TG_CONFIG_SCENE_VERIFY_ASYNC
+
+/// Scene sections.
+///
+struct SceneSection
+{
+	enum Enum
+	{
+		Entities, //!< Entity table.
+		Meshes,   //!< Unique mesh table.
+		Strings,  //!< String table.
+		Geometry, //!< Vertex and index blobs.
+
+		Count
+	};
+};
+
+/// Location of a section within the scene file.
+///
+struct SceneSectionDesc
+{
+	uint64_t m_offset; //!< Offset from start of file.
+	uint64_t m_size;   //!< Size in bytes.
+};
+
+/// Scene file header.
+///
+struct SceneHeader
+{
+	uint32_t m_magic;       //!< TG_SCENE_MAGIC.
+	uint32_t m_version;     //!< kSceneVersion.
+	uint32_t m_numEntities; //!< Number of entities in entity table.
+	uint32_t m_numMeshes;   //!< Number of unique meshes in mesh table.
+	uint64_t m_uid;         //!< Unique id of this write, delta logs must match it.
+
+	uint32_t m_checksum;          //!< Checksum of header with this field zeroed.
+	uint32_t m_checksumBlockSize; //!< Bytes covered by each block checksum.
+
+	SceneSectionDesc m_sections[SceneSection::Count];
+	SceneSectionDesc m_checksums; //!< Checksum of each block from end of header up to this section.
+};
+
+/// Delta log header, followed by `SceneDeltaBlock`s.
+///
+struct SceneDeltaHeader
+{
+	uint32_t m_magic;   //!< TG_SCENE_DELTA_MAGIC.
+	uint32_t m_version; //!< kSceneDeltaVersion.
+	uint64_t m_baseUid; //!< SceneHeader::m_uid of base scene.
+};
+
+/// Changes written by one incremental save. Section offsets are relative to the start of
+/// the block. Entities only carry the components set in their flags and their mesh indexes
+/// the mesh table of the block.
+///
+struct SceneDeltaBlock
+{
+	uint32_t m_magic;       //!< TG_SCENE_DELTA_MAGIC.
+	uint32_t m_numEntities; //!< Number of added or changed entities.
+	uint32_t m_numMeshes;   //!< Number of meshes in block mesh table.
+	uint32_t m_numRemoved;  //!< Number of removed entity names.
+	uint32_t m_checksum;    //!< Checksum of block header with this field zeroed, seeded with checksum of the rest of the block.
+	uint64_t m_size;        //!< Size of block including header and padding.
+
+	SceneSectionDesc m_sections[SceneSection::Count];
+	SceneSectionDesc m_removed; //!< String offsets of removed entity names.
+};
+
+/// Serialized mesh.
+///
+struct SceneMesh
+{
+	enum Flags
+	{
+		Index16    = 1 << 0, //!< Indices are stored as 16-bit.
+		VerticesLz = 1 << 1, //!< Vertices are filtered and LZ compressed.
+		IndicesLz  = 1 << 2, //!< Indices are filtered and LZ compressed.
+	};
+
+	uint64_t m_verticesOffset;     //!< Offset of vertices from start of geometry section.
+	uint64_t m_indicesOffset;      //!< Offset of indices from start of geometry section.
+	uint32_t m_verticesSize;       //!< Size of decoded vertices in bytes.
+	uint32_t m_indicesSize;        //!< Size of decoded 32-bit indices in bytes.
+	uint32_t m_verticesStoredSize; //!< Size of vertices in file.
+	uint32_t m_indicesStoredSize;  //!< Size of indices in file.
+	uint32_t m_flags;              //!< SceneMesh::Flags.
+
+	uint32_t m_layoutHash;                         //!< max::VertexLayout::m_hash.
+	uint16_t m_stride;                             //!< max::VertexLayout::m_stride.
+	uint16_t m_offset[max::Attrib::Count];         //!< max::VertexLayout::m_offset.
+	uint16_t m_attributes[max::Attrib::Count];     //!< max::VertexLayout::m_attributes.
+};
+
+/// Serialized material.
+///
+struct SceneMaterial
+{
+	uint32_t m_diffuse;   //!< String offset of diffuse map path, 0 if none.
+	uint32_t m_normal;    //!< String offset of normal map path, 0 if none.
+	uint32_t m_roughness; //!< String offset of roughness map path, 0 if none.
+	uint32_t m_metallic;  //!< String offset of metallic map path, 0 if none.
+
+	float m_diffuseFactor[3];
+	float m_normalFactor[3];
+	float m_roughnessFactor;
+	float m_metallicFactor;
+};
+
+/// Serialized entity.
+///
+struct SceneEntity
+{
+	enum Flags
+	{
+		Transform = 1 << 0, //!< Has TransformComponent.
+		Render    = 1 << 1, //!< Has RenderComponent.
+		Material  = 1 << 2, //!< Has MaterialComponent.
+	};
+
+	uint32_t m_name; //!< String offset of entity name.
+	uint32_t m_flags;
+
+	float m_position[3];
+	float m_rotation[4];
+	float m_scale[3];
+
+	uint32_t m_mesh; //!< Index into mesh table.
+	SceneMaterial m_material;
+};
+
+/// Compute xxHash32 checksum.
+///
+uint32_t sceneChecksum(const void* _data, uint64_t _size, uint32_t _seed = 0);
+
+/// Uncompressed geometry referenced by a mesh when writing a scene.
+///
+struct SceneGeometry
+{
+	const void* m_vertices;
+	uint32_t m_verticesSize;
+	const void* m_indices;
+	uint32_t m_indicesSize;
+};
+
+/// Mesh table used when writing a scene. Meshes with identical layout, vertices and indices
+/// are only stored once.
+///
+struct SceneMeshTable
+{
+	SceneMeshTable()
+		: m_dedup(true)
+	{}
+
+	/// Add mesh to table.
+	///
+	/// @returns Index of new or existing identical mesh, always new if `m_dedup` is false.
+	///
+	uint32_t add(const SceneMesh& _mesh, const SceneGeometry& _geometry);
+
+	bool m_dedup; //!< Look up identical meshes, disabled to measure what deduplication saves.
+	std::vector<SceneMesh> m_meshes;
+	std::vector<SceneGeometry> m_geometry;
+	std::unordered_multimap<uint32_t, uint32_t> m_lookup; //!< Content hash to mesh index.
+};
+
+/// String table used when writing a scene. Equal strings are only stored once.
+///
+struct SceneStringTable
+{
+	SceneStringTable();
+
+	/// Add string to table.
+	///
+	/// @returns Offset of new or existing equal string, 0 for NULL or empty string.
+	///
+	uint32_t add(const char* _str);
+
+	std::vector<char> m_data;
+	std::unordered_map<std::string, uint32_t> m_lookup; //!< String to offset.
+};
+
+/// Write scene container to disk.
+///
+/// @param[in] _filepath Destination path, replaced if it exists.
+/// @param[in] _entities Entity records.
+/// @param[in] _num Number of entities.
+/// @param[in] _meshes Mesh table. Geometry offsets are filled in.
+/// @param[in] _strings String table referenced by entities.
+/// @param[in] _uid Unique id of this write, see `sceneCreateUid`.
+/// @param[in] _compression Geometry compression, see `SceneCompression::Enum`.
+///
+/// @returns True if scene was written. Delta log of previous scene is removed.
+///
+bool sceneWrite(const bx::FilePath& _filepath, const SceneEntity* _entities, uint32_t _num, SceneMeshTable& _meshes, const SceneStringTable& _strings, uint64_t _uid, uint32_t _compression = TG_CONFIG_SCENE_COMPRESSION);
+
+/// Create id that identifies a written scene.
+///
+uint64_t sceneCreateUid();
+
+/// Get path of delta log belonging to scene at path.
+///
+bx::FilePath sceneDeltaPath(const bx::FilePath& _filepath);
+
+/// Append block of changes to delta log.
+///
+/// @param[in] _filepath Path of delta log, see `sceneDeltaPath`.
+/// @param[in] _baseUid Uid of base scene.
+/// @param[in,out] _size Valid size of log, 0 to start a new one. Updated to include appended block.
+/// @param[in] _entities Added or changed entities.
+/// @param[in] _num Number of entities.
+/// @param[in] _removed String offsets of removed entity names.
+/// @param[in] _numRemoved Number of removed entities.
+/// @param[in] _meshes Meshes referenced by entities. Geometry offsets are filled in.
+/// @param[in] _strings String table referenced by entities and removed names.
+/// @param[in] _compression Geometry compression, see `SceneCompression::Enum`.
+///
+/// @returns True if block was appended.
+///
+bool sceneAppendDelta(const bx::FilePath& _filepath, uint64_t _baseUid, uint64_t& _size, const SceneEntity* _entities, uint32_t _num, const uint32_t* _removed, uint32_t _numRemoved, SceneMeshTable& _meshes, const SceneStringTable& _strings, uint32_t _compression = TG_CONFIG_SCENE_COMPRESSION);
+
+/// Decode mesh geometry stored with any of the `SceneMesh::Flags`.
+///
+/// @param[in] _mesh Mesh record.
+/// @param[in] _geometry Start of geometry section.
+/// @param[out] _outVertices Decoded vertices, allocated with `max::getAllocator`. NULL if stored uncompressed.
+/// @param[out] _outIndices Decoded 32-bit indices, allocated with `max::getAllocator`. NULL if stored uncompressed.
+///
+/// @returns True if geometry was decoded.
+///
+bool sceneDecodeMesh(const SceneMesh& _mesh, const uint8_t* _geometry, void*& _outVertices, void*& _outIndices);
+
+/// Convert scene written with the legacy stream layout (count + per entity fixed size records
+/// and inline geometry) to the current container. Counts and sizes read from the legacy
+/// stream are checked against the file size, corrupt files fail instead of allocating.
+///
+/// @param[in] _src Legacy scene.
+/// @param[in] _dst Destination path, see `sceneConvertedPath`.
+///
+/// @returns True if scene was converted.
+///
+bool sceneConvertLegacy(const bx::FilePath& _src, const bx::FilePath& _dst);
+
+/// Get path legacy scene at path is converted to, the legacy scene itself is left as is.
+///
+bx::FilePath sceneConvertedPath(const bx::FilePath& _filepath);
+
+/// Memory mapped scene, reference counted so it stays mapped as long as the renderer
+/// holds geometry created with `SceneFile::makeRef`.
+///
+struct SceneFile
+{
+	/// Map and validate scene at path.
+	///
+	/// @returns Scene with one reference owned by the caller, NULL if the file is not a valid scene.
+	///
+	static SceneFile* open(const bx::FilePath& _filepath);
+
+	void addRef();
+	void release();
+
+	/// Check block checksums, spread over job system worker threads. Truncation and header
+	/// corruption are already caught by `open`, this catches corrupt contents.
+	///
+	/// @returns True if every block matches its checksum.
+	///
+	bool verify();
+
+	const SceneHeader* getHeader() const
+	{
+		return (const SceneHeader*)m_file.m_data;
+	}
+
+	const SceneEntity* getEntities() const
+	{
+		return (const SceneEntity*)(m_file.m_data + getHeader()->m_sections[SceneSection::Entities].m_offset);
+	}
+
+	const SceneMesh* getMeshes() const
+	{
+		return (const SceneMesh*)(m_file.m_data + getHeader()->m_sections[SceneSection::Meshes].m_offset);
+	}
+
+	/// @returns String at offset in string table, "" if offset is out of bounds.
+	///
+	const char* getString(uint32_t _offset) const
+	{
+		const SceneSectionDesc& strings = getHeader()->m_sections[SceneSection::Strings];
+		return _offset < strings.m_size
+			? (const char*)(m_file.m_data + strings.m_offset + _offset)
+			: ""
+			;
+	}
+
+	/// Get whether range lies within geometry section, `makeRef` of such a range doesn't fail.
+	///
+	bool isGeometry(uint64_t _offset, uint32_t _size) const;
+
+	/// Reference geometry section memory without copying. Adds a reference that is dropped
+	/// once the renderer releases the memory.
+	///
+	/// @returns Memory reference, NULL if range is out of bounds.
+	///
+	const max::Memory* makeRef(uint64_t _offset, uint32_t _size);
+
+	MappedFile m_file;
+	int32_t m_refCount;
+};
+
+/// Memory mapped delta log.
+///
+struct SceneDeltaFile
+{
+	SceneDeltaFile()
+		: m_pos(0)
+	{}
+
+	/// Map delta log and check it belongs to base scene.
+	///
+	/// @returns True if log exists and matches _baseUid.
+	///
+	bool open(const bx::FilePath& _filepath, uint64_t _baseUid);
+
+	void close();
+
+	/// @returns Next block, NULL at end of log or at first truncated or corrupt block.
+	///
+	const SceneDeltaBlock* next();
+
+	/// @returns True if every block of the log was consumed by `next`.
+	///
+	bool isComplete() const
+	{
+		return m_pos == m_file.m_size;
+	}
+
+	static const uint8_t* getSection(const SceneDeltaBlock* _block, const SceneSectionDesc& _section)
+	{
+		return (const uint8_t*)_block + _section.m_offset;
+	}
+
+	/// @returns String at offset in string table of block, "" if offset is out of bounds.
+	///
+	static const char* getString(const SceneDeltaBlock* _block, uint32_t _offset)
+	{
+		const SceneSectionDesc& strings = _block->m_sections[SceneSection::Strings];
+		return _offset < strings.m_size
+			? (const char*)getSection(_block, strings) + _offset
+			: ""
+			;
+	}
+
+	MappedFile m_file;
+	uint64_t m_pos; //!< Offset of next block.
+};
@@ -0,0 +1,217 @@
+#include "scene_loader.h"
+#include "string_pool.h"
+#include "jobs.h"
+
+#include <bx/cpu.h>
+
+SceneLoader::SceneLoader()
+	: m_scene(NULL)
+	, m_chunkSize(kSceneLoadChunkSize)
+	, m_numMeshChunks(0)
+	, m_numPending(0)
+	, m_numLoaded(0)
+	, m_numTotal(0)
+{
+}
+
+void SceneLoader::begin(SceneFile* _scene, uint32_t _chunkSize)
+{
+	BX_ASSERT(!isActive(), "Scene loader is already active.")
+
+	_scene->addRef();
+	m_scene = _scene;
+	m_chunkSize = bx::max<uint32_t>(_chunkSize, 1);
+
+	const SceneHeader* header = m_scene->getHeader();
+	m_meshes.resize(header->m_numMeshes);
+	m_entities.resize(header->m_numEntities);
+
+	m_numLoaded = 0;
+	m_numTotal = header->m_numEntities;
+
+	// Meshes are queued first so entities rarely wait on the mesh they reference.
+	m_numMeshChunks = (header->m_numMeshes + m_chunkSize - 1) / m_chunkSize;
+	const uint32_t numEntityChunks = (header->m_numEntities + m_chunkSize - 1) / m_chunkSize;
+
+	m_chunks.resize(m_numMeshChunks + numEntityChunks);
+	for (uint32_t ii = 0; ii < m_chunks.size(); ++ii)
+	{
+		const bool meshes = ii < m_numMeshChunks;
+		const uint32_t first = (meshes ? ii : ii - m_numMeshChunks) * m_chunkSize;
+		const uint32_t count = meshes ? header->m_numMeshes : header->m_numEntities;
+
+		Chunk& chunk = m_chunks[ii];
+		chunk.m_loader = this;
+		chunk.m_begin = first;
+		chunk.m_end = bx::min(first + m_chunkSize, count);
+		chunk.m_meshes = meshes;
+		chunk.m_done = 0;
+	}
+
+	// Set before pushing any job, jobs may run inline.
+	m_numPending = int32_t(m_chunks.size());
+
+	for (Chunk& chunk : m_chunks)
+	{
+		jobsPush(chunk.m_meshes ? decodeMeshes : decodeEntities, &chunk);
+	}
+}
+
+void SceneLoader::end()
+{
+	if (!isActive())
+	{
+		return;
+	}
+
+	while (0 != bx::atomicFetchAndAdd<int32_t>(&m_numPending, 0))
+	{
+		m_chunkDone.wait();
+	}
+
+	// Decoded geometry not handed to the renderer, load was cancelled.
+	for (SceneLoadMesh& mesh : m_meshes)
+	{
+		if (NULL != mesh.m_vertices)
+		{
+			bx::free(max::getAllocator(), mesh.m_vertices);
+		}
+		if (NULL != mesh.m_indices)
+		{
+			bx::free(max::getAllocator(), mesh.m_indices);
+		}
+	}
+
+	m_chunks.clear();
+	m_meshes.clear();
+	m_entities.clear();
+
+	m_scene->release();
+	m_scene = NULL;
+}
+
+const SceneLoadEntity* SceneLoader::next()
+{
+	if (isDone())
+	{
+		return NULL;
+	}
+
+	Chunk& chunk = m_chunks[m_numMeshChunks + m_numLoaded / m_chunkSize];
+	if (0 == bx::atomicFetchAndAdd<int32_t>(&chunk.m_done, 0))
+	{
+		return NULL;
+	}
+
+	const SceneLoadEntity& entity = m_entities[m_numLoaded];
+	if (0 != (entity.m_flags & SceneEntity::Render)
+	&&  UINT32_MAX != entity.m_mesh)
+	{
+		Chunk& meshChunk = m_chunks[entity.m_mesh / m_chunkSize];
+		if (0 == bx::atomicFetchAndAdd<int32_t>(&meshChunk.m_done, 0))
+		{
+			return NULL;
+		}
+	}
+
+	++m_numLoaded;
+	return &entity;
+}
+
+void SceneLoader::wait()
+{
+	if (0 != bx::atomicFetchAndAdd<int32_t>(&m_numPending, 0))
+	{
+		m_chunkDone.wait();
+	}
+}
+
+void SceneLoader::decodeMeshes(void* _userData)
+{
+	Chunk* chunk = (Chunk*)_userData;
+	SceneLoader* loader = chunk->m_loader;
+
+	const SceneMesh* meshes = loader->m_scene->getMeshes();
+	const SceneSectionDesc& geometry = loader->m_scene->getHeader()->m_sections[SceneSection::Geometry];
+
+	for (uint32_t ii = chunk->m_begin; ii < chunk->m_end; ++ii)
+	{
+		const SceneMesh& sm = meshes[ii];
+		SceneLoadMesh& mesh = loader->m_meshes[ii];
+
+		mesh.m_layout.m_hash = sm.m_layoutHash;
+		mesh.m_layout.m_stride = sm.m_stride;
+		bx::memCopy(mesh.m_layout.m_offset, sm.m_offset, sizeof(uint16_t) * max::Attrib::Count);
+		bx::memCopy(mesh.m_layout.m_attributes, sm.m_attributes, sizeof(uint16_t) * max::Attrib::Count);
+
+		mesh.m_verticesOffset = sm.m_verticesOffset;
+		mesh.m_indicesOffset = sm.m_indicesOffset;
+		mesh.m_verticesSize = sm.m_verticesSize;
+		mesh.m_indicesSize = sm.m_indicesSize;
+		mesh.m_vertices = NULL;
+		mesh.m_indices = NULL;
+		mesh.m_valid = true
+			&& 0 != sm.m_verticesSize
+			&& 0 != sm.m_indicesSize
+			&& sm.m_verticesOffset <= geometry.m_size
+			&& sm.m_verticesStoredSize <= geometry.m_size - sm.m_verticesOffset
+			&& sm.m_indicesOffset <= geometry.m_size
+			&& sm.m_indicesStoredSize <= geometry.m_size - sm.m_indicesOffset
+			;
+
+		// Compressed streams are decoded here, uncompressed ones stay in the mapping.
+		mesh.m_valid = mesh.m_valid
+			&& sceneDecodeMesh(sm, loader->m_scene->m_file.m_data + geometry.m_offset, mesh.m_vertices, mesh.m_indices)
+			;
+	}
+
+	bx::atomicExchange<int32_t>(&chunk->m_done, 1);
+	bx::atomicFetchAndSub<int32_t>(&loader->m_numPending, 1);
+	loader->m_chunkDone.post();
+}
+
+static void decodeTexture(MaterialComponent::Texture& _texture, const char* _filepath)
+{
+	_texture.m_texture = MAX_INVALID_HANDLE;
+	_texture.m_filepath = stringIntern(_filepath);
+}
+
+void SceneLoader::decodeEntities(void* _userData)
+{
+	Chunk* chunk = (Chunk*)_userData;
+	SceneLoader* loader = chunk->m_loader;
+	SceneFile* scene = loader->m_scene;
+
+	const uint32_t numMeshes = scene->getHeader()->m_numMeshes;
+	const SceneEntity* entities = scene->getEntities();
+
+	for (uint32_t ii = chunk->m_begin; ii < chunk->m_end; ++ii)
+	{
+		const SceneEntity& se = entities[ii];
+		SceneLoadEntity& entity = loader->m_entities[ii];
+
+		entity.m_name = scene->getString(se.m_name);
+		entity.m_flags = se.m_flags;
+
+		bx::memCopy(entity.m_position, se.m_position, sizeof(float) * 3);
+		bx::memCopy(entity.m_rotation, se.m_rotation, sizeof(float) * 4);
+		bx::memCopy(entity.m_scale, se.m_scale, sizeof(float) * 3);
+
+		entity.m_mesh = se.m_mesh < numMeshes ? se.m_mesh : UINT32_MAX;
+
+		MaterialComponent& material = entity.m_material;
+		decodeTexture(material.m_diffuse, scene->getString(se.m_material.m_diffuse));
+		decodeTexture(material.m_normal, scene->getString(se.m_material.m_normal));
+		decodeTexture(material.m_roughness, scene->getString(se.m_material.m_roughness));
+		decodeTexture(material.m_metallic, scene->getString(se.m_material.m_metallic));
+
+		bx::memCopy(material.m_diffuseFactor, se.m_material.m_diffuseFactor, sizeof(float) * 3);
+		bx::memCopy(material.m_normalFactor, se.m_material.m_normalFactor, sizeof(float) * 3);
+		material.m_roughnessFactor = se.m_material.m_roughnessFactor;
+		material.m_metallicFactor = se.m_material.m_metallicFactor;
+	}
+
+	bx::atomicExchange<int32_t>(&chunk->m_done, 1);
+	bx::atomicFetchAndSub<int32_t>(&loader->m_numPending, 1);
+	loader->m_chunkDone.post();
+}
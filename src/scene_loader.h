@@ -0,0 +1,109 @@
+#pragma once
+
+#include <max/max.h>
+#include <bx/semaphore.h>
+
+#include "components.h"
+#include "scene_format.h"
+
+#include <vector>
+
+constexpr uint32_t kSceneLoadChunkSize = 256; //!< Entities or meshes decoded per job.
+
+/// Mesh decoded by a worker, ready to be created on the main thread.
+///
+struct SceneLoadMesh
+{
+	max::VertexLayout m_layout;
+	uint64_t m_verticesOffset; //!< Offset of vertices in geometry section.
+	uint64_t m_indicesOffset;  //!< Offset of indices in geometry section.
+	uint32_t m_verticesSize;
+	uint32_t m_indicesSize;
+	void* m_vertices;          //!< Decoded vertices, NULL if referenced from the mapped file. Owned until taken by main thread.
+	void* m_indices;           //!< Decoded indices, NULL if referenced from the mapped file. Owned until taken by main thread.
+	bool m_valid;              //!< Geometry is within the mapped file and decoded.
+};
+
+/// Entity decoded by a worker, ready to be created on the main thread.
+///
+struct SceneLoadEntity
+{
+	const char* m_name; //!< Points into mapped scene, valid until `SceneLoader::end`.
+	uint32_t m_flags;   //!< SceneEntity::Flags.
+
+	float m_position[3];
+	float m_rotation[4];
+	float m_scale[3];
+
+	uint32_t m_mesh;              //!< Index into mesh table, UINT32_MAX if out of range.
+	MaterialComponent m_material; //!< Texture paths interned, textures not loaded.
+};
+
+/// Staged scene loader. Worker jobs decode fixed size chunks of the mesh and entity tables
+/// while the main thread consumes decoded entities in file order and creates them in batches.
+///
+struct SceneLoader
+{
+	SceneLoader();
+
+	/// Start decoding scene, adds a reference to scene that is dropped in `end`.
+	///
+	void begin(SceneFile* _scene, uint32_t _chunkSize = kSceneLoadChunkSize);
+
+	/// Wait for outstanding jobs and release scene and staging memory.
+	///
+	void end();
+
+	/// Get next decoded entity in file order. Referenced mesh is decoded as well.
+	///
+	/// @returns Entity, NULL if the next chunk is still being decoded or all entities were consumed.
+	///
+	const SceneLoadEntity* next();
+
+	/// Get decoded mesh. Only valid for mesh referenced by entity returned from `next`.
+	///
+	SceneLoadMesh& getMesh(uint32_t _index)
+	{
+		return m_meshes[_index];
+	}
+
+	/// Block until another chunk has been decoded.
+	///
+	void wait();
+
+	bool isActive() const
+	{
+		return NULL != m_scene;
+	}
+
+	bool isDone() const
+	{
+		return m_numLoaded == m_numTotal;
+	}
+
+	struct Chunk
+	{
+		SceneLoader* m_loader;
+		uint32_t m_begin;
+		uint32_t m_end;
+		bool m_meshes;        //!< Chunk of mesh table, entity table otherwise.
+		int32_t m_done;
+	};
+
+	static void decodeMeshes(void* _userData);
+	static void decodeEntities(void* _userData);
+
+	SceneFile* m_scene;
+	uint32_t m_chunkSize;
+
+	std::vector<Chunk> m_chunks;           //!< Mesh chunks followed by entity chunks.
+	uint32_t m_numMeshChunks;
+	std::vector<SceneLoadMesh> m_meshes;
+	std::vector<SceneLoadEntity> m_entities;
+
+	bx::Semaphore m_chunkDone;
+	int32_t m_numPending; //!< Chunks queued or being decoded.
+
+	uint32_t m_numLoaded; //!< Entities consumed by main thread.
+	uint32_t m_numTotal;  //!< Entities in scene.
+};
@@ -0,0 +1,36 @@
+// Virtual texture, see VirtualTexturing in render.cpp.
+uniform vec4 u_vtParams[2];
+#define u_vtSize         u_vtParams[0].x
+#define u_vtNumMips      u_vtParams[0].y
+#define u_vtPageSize     u_vtParams[0].z
+#define u_vtBorder       u_vtParams[0].w
+#define u_vtAtlasSize    u_vtParams[1].x
+#define u_vtSlotSize     u_vtParams[1].y
+#define u_vtFeedbackBias u_vtParams[1].z
+
+// Virtual texture mip sampled at uv, not clamped.
+float vtMip(vec2 _uv)
+{
+	vec2 dx = dFdx(_uv * u_vtSize);
+	vec2 dy = dFdy(_uv * u_vtSize);
+	return 0.5 * log2(max(dot(dx, dx), dot(dy, dy) ) );
+}
+
+// Pages per side of virtual texture mip.
+float vtNumPages(float _mip)
+{
+	return u_vtSize / u_vtPageSize / exp2(_mip);
+}
+
+// Atlas coordinates of uv (xy), z is 0 while no page covering uv is resident.
+vec3 vtAtlasCoord(sampler2D _pageTable, vec2 _uv)
+{
+	float mip = clamp(floor(vtMip(_uv) ), 0.0, u_vtNumMips - 1.0);
+
+	// Slot (xy) and mip (z) of finest resident page, coarser than mip while pages load.
+	vec4 entry = floor(texture2DLod(_pageTable, _uv, mip) * 255.0 + 0.5);
+
+	vec2 offset = fract(_uv * vtNumPages(entry.z) ) * u_vtPageSize + u_vtBorder;
+	vec2 coord  = (entry.xy * u_vtSlotSize + offset) / u_vtAtlasSize;
+	return vec3(coord, entry.w);
+}
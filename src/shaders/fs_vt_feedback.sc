@@ -0,0 +1,17 @@
+$input v_normal, v_texcoord0, v_texcoord1, v_texcoord2, v_texcoord3
+
+#include "common/common.sh"
+#include "common/virtual_texture.sh"
+
+void main()
+{
+	// Pass is smaller than the GBuffer, bias brings mip back to the one the GBuffer samples.
+	float mip  = clamp(floor(vtMip(v_texcoord0) + u_vtFeedbackBias), 0.0, u_vtNumMips - 1.0);
+	float num  = vtNumPages(mip);
+	vec2 page  = min(floor(clamp(v_texcoord0, 0.0, 1.0) * num), num - 1.0);
+
+	// Low bits in red and green, high bits in blue, mip + 1 in alpha, see vtFeedbackDecode.
+	vec2 high = floor(page / 256.0);
+	vec2 low  = page - high * 256.0;
+	gl_FragColor = vec4(low, high.x + high.y * 16.0, mip + 1.0) / 255.0;
+}
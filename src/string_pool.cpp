@@ -0,0 +1,33 @@
+#include "string_pool.h"
+
+#include <bx/mutex.h>
+
+#include <unordered_set>
+#include <string>
+
+struct StringPool
+{
+	const char* intern(const char* _str)
+	{
+		if (NULL == _str || '\0' == _str[0])
+		{
+			return "";
+		}
+
+		bx::MutexScope lock(m_mutex);
+
+		// Set nodes are never moved, pointers to their contents stay valid.
+		auto it = m_strings.insert(_str).first;
+		return it->c_str();
+	}
+
+	bx::Mutex m_mutex;
+	std::unordered_set<std::string> m_strings;
+};
+
+static StringPool s_pool;
+
+const char* stringIntern(const char* _str)
+{
+	return s_pool.intern(_str);
+}
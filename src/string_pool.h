@@ -0,0 +1,10 @@
+#pragma once
+
+/// Intern string. Equal strings share one immutable copy that stays valid until shutdown,
+/// so components can store `const char*` instead of fixed size buffers.
+///
+/// @param[in] _str String to intern.
+///
+/// @returns Interned string, "" if _str is NULL or empty.
+///
+const char* stringIntern(const char* _str);
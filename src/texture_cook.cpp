@@ -0,0 +1,653 @@
+#include "texture_cook.h"
+#include "mapped_file.h"
+#include "scene_format.h"
+#include "string_pool.h"
+
+#include <max/max.h>
+#include <bimg/decode.h>
+#include <bx/cpu.h>
+#include <bx/file.h>
+
+#if TG_CONFIG_TEXTURE_COOK
+#	include <bimg/encode.h>
+#endif // TG_CONFIG_TEXTURE_COOK
+
+#include <string>
+#include <vector>
+
+#include <stdio.h>
+
+constexpr uint32_t kTextureCookVersion = 2;           //!< Bump when cooked output changes, invalidates cache.
+constexpr uint32_t kTextureSurfaceSeed = 0x4f524d00; //!< Keeps packed surface textures apart from single source ones.
+constexpr uint32_t kTextureIndexMagic  = BX_MAKEFOURCC('T', 'G', 'T', 'I');
+
+static const char* s_surfaceExt = ".orm";
+
+/// Cache index entry of a source texture, followed by its path. Names the cooked texture of
+/// the sources as they were when cooked, see `textureCook`.
+///
+struct TextureCookIndex
+{
+	uint32_t m_magic;
+	uint32_t m_version;     //!< kTextureCookVersion of cooked texture.
+	FileStamp m_sources[2]; //!< Stamps of sources, zero if missing.
+	uint32_t m_hashLo;      //!< Content hash of cooked texture.
+	uint32_t m_hashHi;
+	uint32_t m_pathSize;    //!< Length of path following entry.
+};
+
+/// Source files of a texture and their cache index entry.
+///
+struct CookSources
+{
+	std::string m_paths[2];   //!< Texture itself, or roughness and metallic map of packed surface.
+	FileStamp m_stamps[2];    //!< Zero if missing.
+	uint32_t m_num;           //!< Number of existing sources.
+	bool m_surface;           //!< Packed surface texture, see `textureSurfacePath`.
+	TextureUsage::Enum m_usage;
+	char m_indexPath[bx::kMaxFilePath];
+	TextureCookIndex m_index; //!< Current index entry, zero magic if there is none.
+};
+
+static bimg::TextureFormat::Enum getCookFormat(TextureUsage::Enum _usage, bool _hasAlpha)
+{
+#if TG_CONFIG_TEXTURE_COOK
+	const max::Caps* caps = max::getCaps();
+
+	// BC1 drops the precision normals need, BC5 keeps two channels at full quality.
+	max::TextureFormat::Enum bc = _hasAlpha ? max::TextureFormat::BC3 : max::TextureFormat::BC1;
+	if (TextureUsage::Normal == _usage)
+	{
+		bc = max::TextureFormat::BC5;
+	}
+
+	if (0 != (caps->formats[bc] & MAX_CAPS_FORMAT_TEXTURE_2D))
+	{
+		return bimg::TextureFormat::Enum(bc);
+	}
+
+	if (0 != (caps->formats[max::TextureFormat::ASTC4x4] & MAX_CAPS_FORMAT_TEXTURE_2D))
+	{
+		return bimg::TextureFormat::ASTC4x4;
+	}
+#else
+	BX_UNUSED(_usage, _hasAlpha);
+#endif // TG_CONFIG_TEXTURE_COOK
+
+	return bimg::TextureFormat::Count;
+}
+
+/// Copy RGBA8 image into larger one, replicating the last row and column.
+static void padRgba8(const uint8_t* _src, uint32_t _width, uint32_t _height, uint8_t* _dst, uint32_t _dstWidth, uint32_t _dstHeight)
+{
+	for (uint32_t yy = 0; yy < _dstHeight; ++yy)
+	{
+		const uint32_t* src = (const uint32_t*)_src + bx::min(yy, _height - 1) * _width;
+		uint32_t* dst = (uint32_t*)_dst + yy * _dstWidth;
+
+		for (uint32_t xx = 0; xx < _dstWidth; ++xx)
+		{
+			dst[xx] = src[bx::min(xx, _width - 1)];
+		}
+	}
+}
+
+static float srgbToLinear(float _value)
+{
+	return _value <= 0.04045f ? _value / 12.92f : bx::pow( (_value + 0.055f) / 1.055f, 2.4f);
+}
+
+static float linearToSrgb(float _value)
+{
+	return _value <= 0.0031308f ? _value * 12.92f : 1.055f * bx::pow(_value, 1.0f / 2.4f) - 0.055f;
+}
+
+static uint8_t toUnorm8(float _value)
+{
+	return uint8_t(bx::clamp(_value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+void textureDownsample(const uint8_t* _src, uint32_t _width, uint32_t _height, uint8_t* _dst, TextureUsage::Enum _usage)
+{
+	float toLinear[256];
+	for (uint32_t ii = 0; ii < BX_COUNTOF(toLinear); ++ii)
+	{
+		toLinear[ii] = TextureUsage::Color == _usage
+			? srgbToLinear(float(ii) / 255.0f)
+			: float(ii) / 255.0f
+			;
+	}
+
+	const uint32_t pitch = _width * 4;
+
+	for (uint32_t yy = 0; yy < _height / 2; ++yy)
+	{
+		for (uint32_t xx = 0; xx < _width / 2; ++xx, _dst += 4)
+		{
+			const uint8_t* row = _src + yy * 2 * pitch + xx * 8;
+			const uint8_t* texels[4] = { row, row + 4, row + pitch, row + pitch + 4 };
+
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (const uint8_t* texel : texels)
+			{
+				for (uint32_t cc = 0; cc < 3; ++cc)
+				{
+					sum[cc] += toLinear[texel[cc] ];
+				}
+
+				sum[3] += float(texel[3]) / 255.0f;
+			}
+
+			if (TextureUsage::Normal == _usage)
+			{
+				// Sum of four unorm normals, back to [-1, 1] times four.
+				const bx::Vec3 normal = { sum[0] * 2.0f - 4.0f, sum[1] * 2.0f - 4.0f, sum[2] * 2.0f - 4.0f };
+				const float len = bx::length(normal);
+				const bx::Vec3 unit = 0.0f < len ? bx::mul(normal, 1.0f / len) : bx::Vec3(0.0f, 0.0f, 1.0f);
+
+				_dst[0] = toUnorm8(unit.x * 0.5f + 0.5f);
+				_dst[1] = toUnorm8(unit.y * 0.5f + 0.5f);
+				_dst[2] = toUnorm8(unit.z * 0.5f + 0.5f);
+			}
+			else
+			{
+				for (uint32_t cc = 0; cc < 3; ++cc)
+				{
+					const float value = sum[cc] * 0.25f;
+					_dst[cc] = toUnorm8(TextureUsage::Color == _usage ? linearToSrgb(value) : value);
+				}
+			}
+
+			_dst[3] = toUnorm8(sum[3] * 0.25f);
+		}
+	}
+}
+
+/// Write RGBA8 image with full mip chain in given format, RGBA8 is written as is.
+static bool cook(const bimg::ImageContainer& _rgba, bimg::TextureFormat::Enum _format, TextureUsage::Enum _usage, const bx::FilePath& _dst)
+{
+	bx::AllocatorI* allocator = max::getAllocator();
+
+	bimg::ImageContainer* cooked = bimg::imageAlloc(allocator, _format, uint16_t(_rgba.m_width), uint16_t(_rgba.m_height), 1, 1, false, true);
+
+	const uint8_t* pixels = (const uint8_t*)_rgba.m_data;
+	std::vector<uint8_t> level(pixels, pixels + _rgba.m_width * _rgba.m_height * 4);
+	std::vector<uint8_t> padded;
+
+	uint32_t width = _rgba.m_width;
+	uint32_t height = _rgba.m_height;
+
+	bx::Error err;
+	for (uint8_t lod = 0; lod < cooked->m_numMips && err.isOk(); ++lod)
+	{
+		bimg::ImageMip mip;
+		bimg::imageGetRawData(*cooked, 0, lod, cooked->m_data, cooked->m_size, mip);
+
+		if (bimg::TextureFormat::RGBA8 == _format)
+		{
+			bx::memCopy( (void*)mip.m_data, level.data(), width * height * 4);
+		}
+		else
+		{
+#if TG_CONFIG_TEXTURE_COOK
+			// Encoder works on whole blocks.
+			const uint32_t blockWidth = (width + 3) & ~3u;
+			const uint32_t blockHeight = (height + 3) & ~3u;
+			padded.resize(blockWidth * blockHeight * 4);
+			padRgba8(level.data(), width, height, padded.data(), blockWidth, blockHeight);
+
+			bimg::imageEncodeFromRgba8(allocator, (void*)mip.m_data, padded.data(), blockWidth, blockHeight, 1, _format, bimg::Quality::Default, &err);
+#else
+			BX_ASSERT(false, "Texture encoder is not available, see TG_CONFIG_TEXTURE_COOK.")
+#endif // TG_CONFIG_TEXTURE_COOK
+		}
+
+		if (lod + 1 < cooked->m_numMips)
+		{
+			// Odd sizes repeat their last row or column.
+			const uint32_t evenWidth = (width + 1) & ~1u;
+			const uint32_t evenHeight = (height + 1) & ~1u;
+			padded.resize(evenWidth * evenHeight * 4);
+			padRgba8(level.data(), width, height, padded.data(), evenWidth, evenHeight);
+
+			width = bx::max<uint32_t>(width / 2, 1);
+			height = bx::max<uint32_t>(height / 2, 1);
+			level.resize(width * height * 4);
+			textureDownsample(padded.data(), evenWidth, evenHeight, level.data(), _usage);
+		}
+	}
+
+	// Write next to the cache entry and move into place, concurrent readers never see a partial file.
+	static int32_t s_tempId = 0;
+
+	char tempPath[bx::kMaxFilePath];
+	bx::snprintf(tempPath, sizeof(tempPath), "%s.%d.tmp", _dst.getCPtr(), bx::atomicFetchAndAdd<int32_t>(&s_tempId, 1));
+
+	bx::FileWriter writer;
+	if (err.isOk() && bx::open(&writer, tempPath, false, &err))
+	{
+		bimg::imageWriteKtx(&writer, *cooked, cooked->m_data, cooked->m_size, &err);
+		bx::close(&writer);
+	}
+
+	bimg::imageFree(cooked);
+
+	if (!err.isOk() || 0 != rename(tempPath, _dst.getCPtr()))
+	{
+		BX_TRACE("Failed to write cooked texture %s", _dst.getCPtr())
+		bx::remove(tempPath);
+		return false;
+	}
+
+	return true;
+}
+
+/// Cook single source texture, see `textureCook`.
+static bool cookSource(const MappedFile& _source, TextureUsage::Enum _usage, const bx::FilePath& _dst)
+{
+	bimg::ImageContainer* rgba = bimg::imageParse(max::getAllocator(), _source.m_data, uint32_t(_source.m_size), bimg::TextureFormat::RGBA8);
+	if (NULL == rgba)
+	{
+		return false;
+	}
+
+	const bimg::TextureFormat::Enum format = getCookFormat(_usage, rgba->m_hasAlpha);
+	const bool result = bimg::TextureFormat::Count != format
+		&& 1 == rgba->m_depth
+		&& 1 == rgba->m_numLayers
+		&& !rgba->m_cubeMap
+		&& cook(*rgba, format, _usage, _dst)
+		;
+
+	bimg::imageFree(rgba);
+	return result;
+}
+
+/// Cook occlusion, roughness and metallic texture from roughness and metallic maps, missing
+/// maps are white. See `textureSurfacePath`.
+static bool cookSurface(const MappedFile* _sources, const bx::FilePath& _dst)
+{
+	bx::AllocatorI* allocator = max::getAllocator();
+
+	bimg::ImageContainer* maps[2] = { NULL, NULL };
+	uint32_t width = 0;
+	uint32_t height = 0;
+
+	for (uint32_t ii = 0; ii < BX_COUNTOF(maps); ++ii)
+	{
+		if (_sources[ii].isOpen())
+		{
+			maps[ii] = bimg::imageParse(allocator, _sources[ii].m_data, uint32_t(_sources[ii].m_size), bimg::TextureFormat::RGBA8);
+		}
+
+		if (NULL != maps[ii])
+		{
+			width = bx::max(width, maps[ii]->m_width);
+			height = bx::max(height, maps[ii]->m_height);
+		}
+	}
+
+	bool result = false;
+
+	if (0 != width)
+	{
+		bimg::ImageContainer* surface = bimg::imageAlloc(allocator, bimg::TextureFormat::RGBA8, uint16_t(width), uint16_t(height), 1, 1, false, false);
+		uint8_t* dst = (uint8_t*)surface->m_data;
+
+		// Maps of different size are sampled nearest.
+		for (uint32_t yy = 0; yy < height; ++yy)
+		{
+			for (uint32_t xx = 0; xx < width; ++xx, dst += 4)
+			{
+				dst[0] = 255;
+				dst[3] = 255;
+
+				for (uint32_t ii = 0; ii < BX_COUNTOF(maps); ++ii)
+				{
+					const bimg::ImageContainer* map = maps[ii];
+					dst[1 + ii] = NULL != map
+						? ( (const uint8_t*)map->m_data)[( (yy * map->m_height / height) * map->m_width + xx * map->m_width / width) * 4]
+						: 255
+						;
+				}
+			}
+		}
+
+		// Without encoder packed textures stay uncompressed, still halving surface samplers.
+		bimg::TextureFormat::Enum format = getCookFormat(TextureUsage::Linear, false);
+		if (bimg::TextureFormat::Count == format)
+		{
+			format = bimg::TextureFormat::RGBA8;
+		}
+
+		result = cook(*surface, format, TextureUsage::Linear, _dst);
+		bimg::imageFree(surface);
+	}
+
+	for (uint32_t ii = 0; ii < BX_COUNTOF(maps); ++ii)
+	{
+		if (NULL != maps[ii])
+		{
+			bimg::imageFree(maps[ii]);
+		}
+	}
+
+	return result;
+}
+
+/// Split packed surface path into roughness and metallic map paths.
+static bool parseSurfacePath(const char* _filePath, std::string& _outRoughness, std::string& _outMetallic)
+{
+	const std::string path(_filePath);
+	const size_t extLen = bx::strLen(s_surfaceExt);
+
+	if (path.size() <= extLen
+	||  0 != path.compare(path.size() - extLen, extLen, s_surfaceExt) )
+	{
+		return false;
+	}
+
+	const size_t separator = path.rfind('|');
+	if (std::string::npos == separator)
+	{
+		return false;
+	}
+
+	_outRoughness = path.substr(0, separator);
+	_outMetallic = path.substr(separator + 1, path.size() - extLen - separator - 1);
+	return true;
+}
+
+const char* textureSurfacePath(const char* _roughness, const char* _metallic)
+{
+	if ('\0' == _roughness[0]
+	&&  '\0' == _metallic[0])
+	{
+		return "";
+	}
+
+	std::string path;
+	path.append(_roughness).append("|").append(_metallic).append(s_surfaceExt);
+
+	return stringIntern(path.c_str() );
+}
+
+bool textureIsSurface(const char* _filePath)
+{
+	std::string roughness;
+	std::string metallic;
+	return parseSurfacePath(_filePath, roughness, metallic);
+}
+
+uint32_t textureGetSources(const char* _filePath, const char* _outSources[2])
+{
+	std::string roughness;
+	std::string metallic;
+
+	if (!parseSurfacePath(_filePath, roughness, metallic) )
+	{
+		_outSources[0] = stringIntern(_filePath);
+		return 1;
+	}
+
+	uint32_t num = 0;
+	const std::string* paths[] = { &roughness, &metallic };
+	for (uint32_t ii = 0; ii < BX_COUNTOF(paths); ++ii)
+	{
+		if (!paths[ii]->empty() )
+		{
+			_outSources[num++] = stringIntern(paths[ii]->c_str() );
+		}
+	}
+
+	return num;
+}
+
+static void getCookedPath(uint32_t _hashLo, uint32_t _hashHi, bx::FilePath& _outFilePath)
+{
+	char cookedPath[bx::kMaxFilePath];
+	bx::snprintf(cookedPath, sizeof(cookedPath), "%s/%08x%08x.ktx", TG_CONFIG_TEXTURE_CACHE_DIR, _hashHi, _hashLo);
+	_outFilePath.set(cookedPath);
+}
+
+/// Read cache index entry of texture, entries of other paths sharing the name are ignored.
+static bool readIndex(const char* _filePath, CookSources& _sources)
+{
+	bx::memSet(&_sources.m_index, 0, sizeof(TextureCookIndex) );
+
+	MappedFile file;
+	if (!file.open(_sources.m_indexPath) )
+	{
+		return false;
+	}
+
+	const uint32_t pathSize = bx::strLen(_filePath);
+	const TextureCookIndex* index = (const TextureCookIndex*)file.m_data;
+	const bool result = sizeof(TextureCookIndex) + pathSize == file.m_size
+		&& kTextureIndexMagic == index->m_magic
+		&& pathSize == index->m_pathSize
+		&& 0 == bx::memCmp(index + 1, _filePath, pathSize)
+		;
+
+	if (result)
+	{
+		bx::memCopy(&_sources.m_index, index, sizeof(TextureCookIndex) );
+	}
+
+	file.close();
+	return result;
+}
+
+/// Write cache index entry next to it and move into place, like cooked textures.
+static bool writeIndex(const char* _filePath, const CookSources& _sources, uint32_t _hashLo, uint32_t _hashHi)
+{
+	TextureCookIndex index;
+	bx::memSet(&index, 0, sizeof(TextureCookIndex) );
+	index.m_magic = kTextureIndexMagic;
+	index.m_version = kTextureCookVersion;
+	bx::memCopy(index.m_sources, _sources.m_stamps, sizeof(index.m_sources) );
+	index.m_hashLo = _hashLo;
+	index.m_hashHi = _hashHi;
+	index.m_pathSize = bx::strLen(_filePath);
+
+	static int32_t s_tempId = 0;
+
+	char tempPath[bx::kMaxFilePath];
+	bx::snprintf(tempPath, sizeof(tempPath), "%s.%d.tmp", _sources.m_indexPath, bx::atomicFetchAndAdd<int32_t>(&s_tempId, 1));
+
+	bx::Error err;
+	bx::FileWriter writer;
+	if (bx::open(&writer, tempPath, false, &err))
+	{
+		bx::write(&writer, &index, sizeof(TextureCookIndex), &err);
+		bx::write(&writer, _filePath, int32_t(index.m_pathSize), &err);
+		bx::close(&writer);
+	}
+
+	if (!err.isOk() || 0 != rename(tempPath, _sources.m_indexPath))
+	{
+		BX_TRACE("Failed to write texture cache index %s", _sources.m_indexPath)
+		bx::remove(tempPath);
+		return false;
+	}
+
+	return true;
+}
+
+/// Result of looking up cooked texture, see `findCooked`.
+///
+struct CookLookup
+{
+	enum Enum
+	{
+		AsIs, //!< Texture is loaded from its path, GPU ready or never cooked.
+		Hit,  //!< Cooked texture is up to date.
+		Miss, //!< Sources have to be cooked.
+	};
+};
+
+/// Find cooked texture by source stamps, sources are neither read nor hashed.
+static CookLookup::Enum findCooked(const char* _filePath, TextureUsage::Enum _usage, CookSources& _sources, bx::FilePath& _outFilePath)
+{
+	_outFilePath.set(_filePath);
+
+	// Already GPU ready.
+	const bx::StringView ext = _outFilePath.getExt();
+	if (0 == bx::strCmpI(ext, ".dds")
+	||  0 == bx::strCmpI(ext, ".ktx"))
+	{
+		return CookLookup::AsIs;
+	}
+
+	_sources.m_surface = parseSurfacePath(_filePath, _sources.m_paths[0], _sources.m_paths[1]);
+
+#if !TG_CONFIG_TEXTURE_COOK
+	// Packed surface textures are cooked uncompressed without encoder.
+	if (!_sources.m_surface)
+	{
+		return CookLookup::AsIs;
+	}
+#endif // !TG_CONFIG_TEXTURE_COOK
+
+	// Packed surfaces hold linear data whatever the material slot.
+	_sources.m_usage = _sources.m_surface ? TextureUsage::Linear : _usage;
+
+	if (!_sources.m_surface)
+	{
+		_sources.m_paths[0] = _filePath;
+	}
+
+	_sources.m_num = 0;
+	bx::memSet(_sources.m_stamps, 0, sizeof(_sources.m_stamps) );
+
+	for (uint32_t ii = 0; ii < BX_COUNTOF(_sources.m_paths); ++ii)
+	{
+		if (!_sources.m_paths[ii].empty()
+		&&  fileGetStamp(bx::FilePath(_sources.m_paths[ii].c_str() ), _sources.m_stamps[ii]) )
+		{
+			++_sources.m_num;
+		}
+	}
+
+	if (0 == _sources.m_num)
+	{
+		return CookLookup::AsIs;
+	}
+
+	// Keyed by path and usage, the same map can be cooked for several usages.
+	const uint32_t pathSize = bx::strLen(_filePath);
+	const uint32_t pathLo = sceneChecksum(_filePath, pathSize, _sources.m_usage);
+	const uint32_t pathHi = sceneChecksum(_filePath, pathSize, ~uint32_t(_sources.m_usage) );
+	bx::snprintf(_sources.m_indexPath, sizeof(_sources.m_indexPath), "%s/index/%08x%08x.%d", TG_CONFIG_TEXTURE_CACHE_DIR, pathHi, pathLo, _sources.m_usage);
+
+	const TextureCookIndex& index = _sources.m_index;
+	if (!readIndex(_filePath, _sources)
+	||  kTextureCookVersion != index.m_version
+	||  0 != bx::memCmp(index.m_sources, _sources.m_stamps, sizeof(_sources.m_stamps) ) )
+	{
+		return CookLookup::Miss;
+	}
+
+	bx::FilePath cooked;
+	getCookedPath(index.m_hashLo, index.m_hashHi, cooked);
+
+	bx::FileInfo info;
+	if (!bx::stat(info, cooked)
+	||  0 == info.size)
+	{
+		return CookLookup::Miss;
+	}
+
+	_outFilePath = cooked;
+	return CookLookup::Hit;
+}
+
+bool textureCookFind(const char* _filePath, TextureUsage::Enum _usage, bx::FilePath& _outFilePath)
+{
+	CookSources sources;
+	return CookLookup::Miss != findCooked(_filePath, _usage, sources, _outFilePath);
+}
+
+bool textureCook(const char* _filePath, TextureUsage::Enum _usage, bx::FilePath& _outFilePath)
+{
+	CookSources sources;
+	switch (findCooked(_filePath, _usage, sources, _outFilePath) )
+	{
+	case CookLookup::AsIs: return false;
+	case CookLookup::Hit:  return true;
+	case CookLookup::Miss: break;
+	}
+
+	MappedFile files[2];
+	uint32_t numFiles = 0;
+
+	for (uint32_t ii = 0; ii < BX_COUNTOF(files); ++ii)
+	{
+		if (!sources.m_paths[ii].empty() && files[ii].open(sources.m_paths[ii].c_str() ) )
+		{
+			++numFiles;
+		}
+	}
+
+	if (0 == numFiles)
+	{
+		return false;
+	}
+
+	// 64-bit content hash, cooked output only depends on sources, usage and cook version.
+	uint32_t hashLo = (sources.m_surface ? kTextureCookVersion ^ kTextureSurfaceSeed : kTextureCookVersion) + (uint32_t(sources.m_usage) << 16);
+	uint32_t hashHi = ~hashLo;
+
+	for (uint32_t ii = 0, num = sources.m_surface ? 2 : 1; ii < num; ++ii)
+	{
+		// Missing maps still change the hash, roughness only and metallic only textures differ.
+		const MappedFile& file = files[ii];
+		hashLo = sceneChecksum(file.isOpen() ? file.m_data : (const uint8_t*)"", file.m_size, hashLo + ii);
+		hashHi = sceneChecksum(file.isOpen() ? file.m_data : (const uint8_t*)"", file.m_size, hashHi + ii);
+	}
+
+	bx::FilePath cooked;
+	getCookedPath(hashLo, hashHi, cooked);
+
+	// Sources touched without changing still hash the same, cooked texture is reused.
+	bx::FileInfo info;
+	bool result = bx::stat(info, cooked) && 0 != info.size;
+
+	if (!result)
+	{
+		bx::makeAll(cooked.getPath());
+		result = sources.m_surface
+			? cookSurface(files, cooked)
+			: cookSource(files[0], sources.m_usage, cooked)
+			;
+	}
+
+	for (MappedFile& file : files)
+	{
+		if (file.isOpen() )
+		{
+			file.close();
+		}
+	}
+
+	if (result)
+	{
+		bx::makeAll(bx::FilePath(sources.m_indexPath).getPath() );
+		writeIndex(_filePath, sources, hashLo, hashHi);
+
+		// Cooked texture this one replaces is stale. Other paths with the same content miss
+		// once and cook it again.
+		const TextureCookIndex& index = sources.m_index;
+		if (kTextureIndexMagic == index.m_magic
+		&&  (index.m_hashLo != hashLo || index.m_hashHi != hashHi) )
+		{
+			bx::FilePath stale;
+			getCookedPath(index.m_hashLo, index.m_hashHi, stale);
+			bx::remove(stale);
+		}
+
+		_outFilePath = cooked;
+	}
+
+	return result;
+}
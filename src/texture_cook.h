@@ -0,0 +1,96 @@
+#pragma once
+
+#include <bx/filepath.h>
+
+#ifndef TG_CONFIG_TEXTURE_COOK
+#	define TG_CONFIG_TEXTURE_COOK 0 //!< Cook textures on cache miss, requires bimg_encode.
+#endif // TG_CONFIG_TEXTURE_COOK
+
+#ifndef TG_CONFIG_SURFACE_TEXTURE
+#	define TG_CONFIG_SURFACE_TEXTURE 0 //!< Pack roughness and metallic maps into one surface texture, requires fs_gbuffer_surface, fs_gbuffer_cubemap_surface and fs_gbuffer_vt_surface in runtime/shaders.
+#endif // TG_CONFIG_SURFACE_TEXTURE
+
+#ifndef TG_CONFIG_TEXTURE_CACHE_DIR
+#	define TG_CONFIG_TEXTURE_CACHE_DIR "cache/textures" //!< Directory of cooked textures.
+#endif // TG_CONFIG_TEXTURE_CACHE_DIR
+
+/// Kind of data stored in a texture, picks compression and mip filter of cooked textures.
+///
+struct TextureUsage
+{
+	enum Enum
+	{
+		Color,  //!< sRGB color, BC1 or BC3 with alpha. Mips are averaged in linear space.
+		Normal, //!< Tangent space normal, BC5 keeps x and y, shaders rebuild z. Mips are renormalized.
+		Linear, //!< Linear data like packed surface maps, BC1.
+
+		Count
+	};
+};
+
+/// Get GPU ready version of a source texture. Sources are cooked to a block compressed KTX
+/// with full mip chain, format depending on usage and renderer support, ASTC 4x4 if there
+/// is no BC support. DDS and KTX sources are used as is. Packed surface textures, see
+/// `textureSurfacePath`, are cooked from their maps, uncompressed if there is no encoder.
+///
+/// Cooked textures are named by content hash. An index next to them maps source path, size
+/// and last write time to the cooked texture, sources are only read and hashed on a miss.
+/// A cooked texture replaced by a newer cook of the same path is deleted.
+///
+/// Safe to call from worker threads. Cooking takes long, call `textureCookFind` on the
+/// main thread.
+///
+/// @param[in] _filePath Path to source texture.
+/// @param[in] _usage Kind of data in texture.
+/// @param[out] _outFilePath Path to cooked texture, _filePath if there is none.
+///
+/// @returns True if a cooked texture was found or created.
+///
+bool textureCook(const char* _filePath, TextureUsage::Enum _usage, bx::FilePath& _outFilePath);
+
+/// Find cooked texture without cooking it, see `textureCook`. Only reads the cache index.
+///
+/// @param[in] _filePath Path to source texture.
+/// @param[in] _usage Kind of data in texture.
+/// @param[out] _outFilePath Path to cooked texture, _filePath if there is none.
+///
+/// @returns False if texture still has to be cooked, true if _outFilePath is ready to load.
+///
+bool textureCookFind(const char* _filePath, TextureUsage::Enum _usage, bx::FilePath& _outFilePath);
+
+/// Get path of texture packing occlusion (r), roughness (g) and metallic (b) of a material,
+/// occlusion is white until there are occlusion maps. The path names no file, `textureCook`
+/// builds the texture from both maps so it loads like any other texture. Missing maps are
+/// white.
+///
+/// @param[in] _roughness Path to roughness map, read from red channel. Empty if none.
+/// @param[in] _metallic Path to metallic map, read from red channel. Empty if none.
+///
+/// @returns Interned path, "" if both maps are empty.
+///
+const char* textureSurfacePath(const char* _roughness, const char* _metallic);
+
+/// Check if path names a packed surface texture, see `textureSurfacePath`.
+///
+bool textureIsSurface(const char* _filePath);
+
+/// Get source files a texture is cooked from, the texture itself or maps of a packed surface.
+///
+/// @param[in] _filePath Path to texture.
+/// @param[out] _outSources Interned paths to source files.
+///
+/// @returns Number of source files.
+///
+uint32_t textureGetSources(const char* _filePath, const char* _outSources[2]);
+
+/// Halve RGBA8 image of even size with a box filter, like mips of cooked textures. Color is
+/// averaged in linear space, normals are renormalized, alpha and linear data are averaged
+/// as is.
+///
+/// @param[in] _src Texels of source image.
+/// @param[in] _width Width of source image, even.
+/// @param[in] _height Height of source image, even.
+/// @param[out] _dst Texels of image half the size.
+/// @param[in] _usage Kind of data in image.
+///
+void textureDownsample(const uint8_t* _src, uint32_t _width, uint32_t _height, uint8_t* _dst, TextureUsage::Enum _usage);
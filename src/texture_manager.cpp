@@ -1,44 +1,876 @@
 #include "texture_manager.h"
+#include "default_textures.h"
+#include "mapped_file.h"
+#include "texture_cook.h"
+#include "jobs.h"
 
-max::TextureHandle TextureManager::load(const char* _filePath)
+#include <bimg/decode.h>
+#include <bx/cpu.h>
+
+#include <queue>
+
+constexpr uint8_t kTextureSkipInitial = UINT8_MAX; //!< Skip picked on upload, once texture size is known.
+constexpr uint8_t kTextureMaxBackoff   = 10;        //!< Failed mip changes wait at most 2^n `stream` calls.
+
+/// Texture read and decoded by a worker.
+///
+struct TextureDecode
+{
+	TextureManager* m_manager;
+	const char* m_filepath;        //!< Interned.
+	uint32_t m_ref;                //!< Index of texture in `TextureManager::m_textures`.
+	uint8_t m_skip;                //!< Top mips left out of created texture.
+	bool m_reload;                 //!< Texture changed on disk, updated in place if possible.
+	TextureUsage::Enum m_usage;    //!< Kind of data in texture, see `textureCook`.
+	bimg::ImageContainer* m_image; //!< NULL if texture failed to decode.
+};
+
+static void releaseImage(void* _ptr, void* _userData)
+{
+	BX_UNUSED(_ptr);
+	bimg::imageFree((bimg::ImageContainer*)_userData);
+}
+
+static bool isStreamable(const bimg::ImageContainer* _image)
+{
+	// Mip tail of a single 2D image is contiguous and can be handed to the renderer as is.
+	return 1 == _image->m_depth
+		&& 1 == _image->m_numLayers
+		&& !_image->m_cubeMap
+		&& 1 < _image->m_numMips
+		&& _image->m_numMips == bimg::imageGetNumMips(_image->m_format, uint16_t(_image->m_width), uint16_t(_image->m_height))
+		;
+}
+
+/// Get bytes of mip chain without skipped top mips.
+static uint64_t getMipChainSize(const TextureRef& _tr, uint8_t _skip)
+{
+	return bimg::imageGetSize(NULL
+		, uint16_t(bx::max(_tr.m_width >> _skip, 1) )
+		, uint16_t(bx::max(_tr.m_height >> _skip, 1) )
+		, 1
+		, false
+		, 1 < _tr.m_numMips - _skip
+		, 1
+		, bimg::TextureFormat::Enum(_tr.m_format)
+		);
+}
+
+/// Get number of top mips to skip for top mip to be no larger than size in pixels.
+static uint8_t getSkip(const TextureRef& _tr, float _size)
+{
+	uint8_t skip = 0;
+	while (skip + 1 < _tr.m_numMips
+	&&     float(bx::max(_tr.m_width, _tr.m_height) >> skip) > _size)
+	{
+		++skip;
+	}
+
+	return skip;
+}
+
+static void traceFailed(const char* _filePath)
+{
+	if (textureIsSurface(_filePath) )
+	{
+		// Materials bind the white default texture, roughness and metallic come from their factors.
+		BX_TRACE("Failed to cook surface texture %s, using roughness and metallic factors.", _filePath)
+	}
+	else
+	{
+		BX_TRACE("Failed to load texture at, %s", _filePath)
+	}
+}
+
+static max::TextureHandle createTexture(bimg::ImageContainer* _image, const char* _filePath, uint8_t _skip)
+{
+	const max::TextureFormat::Enum format = max::TextureFormat::Enum(_image->m_format);
+
+	if (1 < _image->m_depth
+	||  !max::isTextureValid(0, _image->m_cubeMap, _image->m_numLayers, format))
+	{
+		bimg::imageFree(_image);
+		return MAX_INVALID_HANDLE;
+	}
+
+	max::TextureHandle handle = MAX_INVALID_HANDLE;
+
+	if (0 != _skip)
+	{
+		// Mips are stored largest first, tail starting at first kept mip is the whole texture.
+		bimg::ImageMip mip;
+		bimg::imageGetRawData(*_image, 0, _skip, _image->m_data, _image->m_size, mip);
+
+		const uint32_t size = uint32_t( (const uint8_t*)_image->m_data + _image->m_size - mip.m_data);
+		const max::Memory* mem = max::makeRef(mip.m_data, size, releaseImage, _image);
+
+		handle = max::createTexture2D(uint16_t(mip.m_width), uint16_t(mip.m_height), 1 < _image->m_numMips - _skip, 1, format, 0, mem);
+	}
+	else
+	{
+		const bool hasMips = 1 < _image->m_numMips;
+		const max::Memory* mem = max::makeRef(_image->m_data, _image->m_size, releaseImage, _image);
+
+		handle = _image->m_cubeMap
+			? max::createTextureCube(uint16_t(_image->m_width), hasMips, _image->m_numLayers, format, 0, mem)
+			: max::createTexture2D(uint16_t(_image->m_width), uint16_t(_image->m_height), hasMips, _image->m_numLayers, format, 0, mem)
+			;
+	}
+
+	if (isValid(handle))
+	{
+		max::setName(handle, _filePath);
+	}
+
+	return handle;
+}
+
+TextureManager::TextureManager()
+	: m_budget(uint64_t(TG_CONFIG_TEXTURE_BUDGET_MB) << 20)
+	, m_cacheBudget(uint64_t(TG_CONFIG_TEXTURE_CACHE_MB) << 20)
+	, m_numDecoding(0)
+	, m_numPending(0)
+	, m_residentSize(0)
+	, m_requestedSize(0)
+	, m_numStreams(0)
+	, m_lruFirst(UINT32_MAX)
+	, m_lruLast(UINT32_MAX)
+	, m_numReloads(0)
+{
+	bx::memSet(&m_cacheStats, 0, sizeof(m_cacheStats) );
+}
+
+TextureManager::~TextureManager()
+{
+	// Workers reference this manager.
+	wait();
+
+	for (TextureDecode* decode : m_decoded)
+	{
+		if (NULL != decode->m_image)
+		{
+			bimg::imageFree(decode->m_image);
+		}
+
+		bx::deleteObject(max::getAllocator(), decode);
+	}
+}
+
+/// Update texture with image of same size, format and mips.
+static bool updateTexture(const TextureRef& _tr, bimg::ImageContainer* _image)
+{
+	if (!isValid(_tr.m_texture.m_handle)
+	||  1 != _image->m_depth
+	||  1 != _image->m_numLayers
+	||  _image->m_cubeMap
+	||  _tr.m_width != _image->m_width
+	||  _tr.m_height != _image->m_height
+	||  _tr.m_numMips != _image->m_numMips
+	||  _tr.m_format != _image->m_format)
+	{
+		return false;
+	}
+
+	const max::TextureHandle handle = _tr.m_texture.m_handle;
+
+	// Resident mips only, image is released with the last one.
+	for (uint8_t mip = _tr.m_skip; mip < _image->m_numMips; ++mip)
+	{
+		bimg::ImageMip data;
+		bimg::imageGetRawData(*_image, 0, mip, _image->m_data, _image->m_size, data);
+
+		const max::Memory* mem = mip + 1 == _image->m_numMips
+			? max::makeRef(data.m_data, data.m_size, releaseImage, _image)
+			: max::makeRef(data.m_data, data.m_size)
+			;
+
+		max::updateTexture2D(handle, 0, uint8_t(mip - _tr.m_skip), 0, 0, uint16_t(data.m_width), uint16_t(data.m_height), mem);
+	}
+
+	return true;
+}
+
+max::TextureHandle TextureManager::load(const char* _filePath, TextureUsage::Enum _usage)
+{
+	if (bx::strCmp(_filePath, "") == bx::kExitSuccess)
+	{
+		return MAX_INVALID_HANDLE;
+	}
+
+	const uint32_t idx = m_textures.insert(_filePath, pathHash(_filePath) );
+	TextureRef& tr = m_textures[idx];
+	if (!acquire(idx) )
+	{
+		return tr.m_texture.m_handle;
+	}
+
+	tr.m_usage = uint8_t(_usage);
+
+	// Cooking takes long, a worker cooks and `update` swaps in the result like a reload.
+	bx::FilePath filePath;
+	if (!textureCookFind(_filePath, _usage, filePath) )
+	{
+		queue(idx, kTextureSkipInitial, true);
+	}
+
+	max::TextureInfo info;
+	max::TextureHandle handle = MAX_INVALID_HANDLE;
+
+	bx::FileInfo fileInfo;
+	if (bx::stat(fileInfo, filePath) )
+	{
+		handle = max::loadTexture(filePath.getCPtr(), 0, 0, &info);
+	}
+
+	if (isValid(handle))
+	{
+		// Reloads update the texture in place if these still match.
+		tr.m_texture.m_handle = handle;
+		tr.m_numMips = info.numMips;
+		tr.m_width = info.width;
+		tr.m_height = info.height;
+		tr.m_format = uint16_t(info.format);
+		tr.m_size = info.storageSize;
+		return tr.m_texture.m_handle;
+	}
+	else
+	{
+		// Failed unless still being cooked.
+		if (!tr.m_pending)
+		{
+			traceFailed(_filePath);
+			tr.m_failed = true;
+		}
+
+		return MAX_INVALID_HANDLE;
+	}
+}
+
+max::TextureHandle TextureManager::loadAsync(const char* _filePath, TextureUsage::Enum _usage)
 {
-	TextureRef& tr = m_textures[_filePath];
+	if (bx::strCmp(_filePath, "") == bx::kExitSuccess)
+	{
+		return MAX_INVALID_HANDLE;
+	}
 
-	if (isValid(tr.m_texture.m_handle))
+	const uint32_t idx = m_textures.insert(_filePath, pathHash(_filePath) );
+	TextureRef& tr = m_textures[idx];
+	if (!acquire(idx) )
 	{
-		++tr.m_refCount;
 		return tr.m_texture.m_handle;
 	}
+
+	tr.m_usage = uint8_t(_usage);
+	queue(idx, kTextureSkipInitial);
+
+	return MAX_INVALID_HANDLE;
+}
+
+bool TextureManager::acquire(uint32_t _idx)
+{
+	TextureRef& tr = m_textures[_idx];
+	++tr.m_refCount;
+
+	// Released, possibly with a mip change in flight.
+	if (tr.m_cached)
+	{
+		lruRemove(_idx);
+		tr.m_cached = false;
+
+		m_cacheStats.m_size -= tr.m_size;
+		--m_cacheStats.m_num;
+		++m_cacheStats.m_numHits;
+		return false;
+	}
+
+	// Loaded or arriving with `update`, failed ones are tried again.
+	if (tr.m_pending
+	||  (1 < tr.m_refCount && !tr.m_failed) )
+	{
+		return false;
+	}
+
+	++m_cacheStats.m_numMisses;
+	tr.m_failed = false;
+
+#if TG_CONFIG_TEXTURE_HOT_RELOAD
+	if (1 == tr.m_refCount)
+	{
+		const char* sources[2];
+		for (uint32_t ii = 0, num = textureGetSources(m_textures.getPath(_idx), sources); ii < num; ++ii)
+		{
+			m_watcher.add(sources[ii]);
+		}
+	}
+#endif // TG_CONFIG_TEXTURE_HOT_RELOAD
+
+	return true;
+}
+
+void TextureManager::queue(uint32_t _idx, uint8_t _skip, bool _reload)
+{
+	TextureDecode* job = BX_NEW(max::getAllocator(), TextureDecode);
+	job->m_manager = this;
+	job->m_filepath = m_textures.getPath(_idx);
+	job->m_ref = _idx;
+	job->m_skip = _skip;
+	job->m_reload = _reload;
+	job->m_usage = TextureUsage::Enum(m_textures[_idx].m_usage);
+	job->m_image = NULL;
+
+	m_textures[_idx].m_pending = true;
+	++m_numPending;
+	bx::atomicFetchAndAdd<int32_t>(&m_numDecoding, 1);
+
+	jobsPush(decode, job);
+}
+
+void TextureManager::lruPush(uint32_t _idx)
+{
+	TextureRef& tr = m_textures[_idx];
+	tr.m_lruPrev = UINT32_MAX;
+	tr.m_lruNext = m_lruFirst;
+
+	if (UINT32_MAX != m_lruFirst)
+	{
+		m_textures[m_lruFirst].m_lruPrev = _idx;
+	}
+	else
+	{
+		m_lruLast = _idx;
+	}
+
+	m_lruFirst = _idx;
+}
+
+void TextureManager::lruRemove(uint32_t _idx)
+{
+	TextureRef& tr = m_textures[_idx];
+
+	if (UINT32_MAX != tr.m_lruPrev)
+	{
+		m_textures[tr.m_lruPrev].m_lruNext = tr.m_lruNext;
+	}
+	else
+	{
+		m_lruFirst = tr.m_lruNext;
+	}
+
+	if (UINT32_MAX != tr.m_lruNext)
+	{
+		m_textures[tr.m_lruNext].m_lruPrev = tr.m_lruPrev;
+	}
 	else
 	{
-		max::TextureHandle handle = max::loadTexture(_filePath);
+		m_lruLast = tr.m_lruPrev;
+	}
+
+	tr.m_lruPrev = UINT32_MAX;
+	tr.m_lruNext = UINT32_MAX;
+}
+
+void TextureManager::unload(const char* _filePath)
+{
+	const uint32_t idx = m_textures.find(_filePath, pathHash(_filePath) );
+	if (PathTable<TextureRef>::kInvalid == idx)
+	{
+		return;
+	}
+
+	TextureRef& tr = m_textures[idx];
+	if (tr.m_refCount == 0)
+	{
+		return;
+	}
+
+	--tr.m_refCount;
+
+	if (tr.m_refCount == 0)
+	{
+		if (isValid(tr.m_texture.m_handle))
+		{
+			// Kept until evicted, see `trimCache`.
+			tr.m_cached = true;
+			lruPush(idx);
+
+			m_cacheStats.m_size += tr.m_size;
+			++m_cacheStats.m_num;
+
+			trimCache(m_cacheBudget);
+		}
+		else if (!tr.m_pending)
+		{
+			remove(idx);
+		}
+
+		// Pending decodes are dropped by `update` once they arrive.
+	}
+}
+
+uint32_t TextureManager::update(std::vector<TextureUpload>& _outUploaded)
+{
+#if TG_CONFIG_TEXTURE_HOT_RELOAD
+	std::vector<const char*> changed;
+	m_watcher.poll(changed);
+
+	for (const char* source : changed)
+	{
+		reload(source);
+	}
+#endif // TG_CONFIG_TEXTURE_HOT_RELOAD
+
+	std::vector<TextureDecode*> decoded;
+	{
+		bx::MutexScope lock(m_mutex);
+		decoded.swap(m_decoded);
+	}
+
+	uint32_t num = 0;
 
-		if (isValid(handle))
+	for (TextureDecode* decode : decoded)
+	{
+		--m_numPending;
+
+		// Pending textures are never removed, index is still theirs.
+		TextureRef& tr = m_textures[decode->m_ref];
+		BX_ASSERT(tr.m_pending, "Decoded texture is not pending.")
+
+		tr.m_pending = false;
+
+		if (0 == tr.m_refCount)
+		{
+			// Unloaded while decoding, cached textures keep their current mips.
+			if (NULL != decode->m_image)
+			{
+				bimg::imageFree(decode->m_image);
+			}
+
+			if (!tr.m_cached)
+			{
+				remove(decode->m_ref);
+			}
+		}
+		else if (decode->m_reload
+		&&       NULL != decode->m_image
+		&&       updateTexture(tr, decode->m_image) )
 		{
-			tr.m_refCount = 1;
-			tr.m_texture.m_handle = handle;
-			return tr.m_texture.m_handle;
+			// Same handle, materials keep using it.
+			++m_numReloads;
 		}
 		else
 		{
-			BX_TRACE("Failed to load texture at, %s", _filePath)
-			return MAX_INVALID_HANDLE;
+			bimg::ImageContainer* image = decode->m_image;
+			uint8_t skip = 0;
+			max::TextureInfo info;
+
+			if (NULL != image)
+			{
+				if (kTextureSkipInitial == decode->m_skip)
+				{
+					setStreamed(decode->m_ref, isStreamable(image) );
+					tr.m_numMips = image->m_numMips;
+					tr.m_width = uint16_t(image->m_width);
+					tr.m_height = uint16_t(image->m_height);
+					tr.m_format = uint16_t(image->m_format);
+					tr.m_requestedSkip = tr.m_streamed ? getSkip(tr, TG_CONFIG_TEXTURE_STREAM_MIN_SIZE) : 0;
+				}
+
+				const max::TextureFormat::Enum format = max::TextureFormat::Enum(image->m_format);
+
+				if (tr.m_streamed)
+				{
+					skip = kTextureSkipInitial == decode->m_skip ? tr.m_requestedSkip : decode->m_skip;
+					max::calcTextureSize(info
+						, uint16_t(bx::max(tr.m_width >> skip, 1) )
+						, uint16_t(bx::max(tr.m_height >> skip, 1) )
+						, 1
+						, false
+						, 1 < tr.m_numMips - skip
+						, 1
+						, format
+						);
+				}
+				else
+				{
+					max::calcTextureSize(info
+						, uint16_t(image->m_width)
+						, uint16_t(image->m_height)
+						, uint16_t(image->m_depth)
+						, image->m_cubeMap
+						, 1 < image->m_numMips
+						, image->m_numLayers
+						, format
+						);
+				}
+			}
+
+			max::TextureHandle handle = MAX_INVALID_HANDLE;
+			if (NULL != image)
+			{
+				handle = createTexture(image, decode->m_filepath, skip);
+			}
+
+			// Formats the decoder doesn't handle go through the blocking loader, packed surfaces
+			// only exist cooked.
+			if (!isValid(handle)
+			&&  !isValid(tr.m_texture.m_handle)
+			&&  !textureIsSurface(decode->m_filepath) )
+			{
+				setStreamed(decode->m_ref, false);
+				handle = max::loadTexture(decode->m_filepath, 0, 0, &info);
+			}
+
+			if (isValid(handle))
+			{
+				// Mip change, caller rebinds materials to the new texture.
+				if (isValid(tr.m_texture.m_handle))
+				{
+					BX_ASSERT(!isDefaultTexture(tr.m_texture.m_handle), "Default textures are shared, not owned by the manager.")
+					max::destroy(tr.m_texture.m_handle);
+				}
+
+				tr.m_texture.m_handle = handle;
+				tr.m_failed = false;
+				tr.m_streamBackoff = 0;
+				tr.m_skip = skip;
+				tr.m_size = info.storageSize;
+
+				_outUploaded.push_back({ decode->m_filepath, handle });
+				++num;
+
+				m_numReloads += decode->m_reload;
+			}
+			else if (!isValid(tr.m_texture.m_handle))
+			{
+				traceFailed(decode->m_filepath);
+				tr.m_failed = true;
+			}
+			else if (kTextureSkipInitial != decode->m_skip)
+			{
+				// Current mips stay, `stream` asks again after backing off.
+				BX_TRACE("Failed to change mips of texture at, %s", decode->m_filepath)
+				tr.m_streamBackoff = uint8_t(bx::min(tr.m_streamBackoff + 1, int32_t(kTextureMaxBackoff) ) );
+				tr.m_streamRetry = m_numStreams + (1u << tr.m_streamBackoff);
+			}
+		}
+
+		// Changed on disk again while decoding.
+		if (tr.m_reload
+		&&  0 != tr.m_refCount)
+		{
+			tr.m_reload = false;
+			queue(decode->m_ref, kTextureSkipInitial, true);
 		}
+
+		bx::deleteObject(max::getAllocator(), decode);
 	}
+
+	return num;
 }
 
-void TextureManager::unload(const char* _filePath)
+void TextureManager::wait()
+{
+	while (0 != bx::atomicFetchAndAdd<int32_t>(&m_numDecoding, 0))
+	{
+		m_decodeDone.wait();
+	}
+}
+
+uint32_t TextureManager::getNumPending() const
+{
+	return m_numPending;
+}
+
+const std::vector<uint32_t>& TextureManager::getStreamed() const
+{
+	return m_streamedTextures;
+}
+
+void TextureManager::request(const char* _filePath, float _screenSize)
+{
+	const uint32_t idx = m_textures.find(_filePath, pathHash(_filePath) );
+	if (PathTable<TextureRef>::kInvalid != idx)
+	{
+		request(idx, _screenSize);
+	}
+}
+
+void TextureManager::request(uint32_t _idx, float _screenSize)
+{
+	TextureRef& tr = m_textures[_idx];
+	tr.m_screenSize = bx::max(tr.m_screenSize, _screenSize);
+}
+
+void TextureManager::setStreamed(uint32_t _idx, bool _streamed)
+{
+	TextureRef& tr = m_textures[_idx];
+	if (tr.m_streamed == _streamed)
+	{
+		return;
+	}
+
+	tr.m_streamed = _streamed;
+
+	if (_streamed)
+	{
+		m_streamedTextures.push_back(_idx);
+	}
+	else
+	{
+		for (uint32_t ii = 0, num = uint32_t(m_streamedTextures.size() ); ii < num; ++ii)
+		{
+			if (_idx == m_streamedTextures[ii])
+			{
+				m_streamedTextures[ii] = m_streamedTextures.back();
+				m_streamedTextures.pop_back();
+				break;
+			}
+		}
+	}
+}
+
+void TextureManager::stream()
+{
+	/// Streamed texture that can drop another top mip, least needed on top.
+	struct Candidate
+	{
+		bool operator<(const Candidate& _other) const
+		{
+			return m_priority > _other.m_priority;
+		}
+
+		float m_priority; //!< Screen pixels per texel of top requested mip.
+		TextureRef* m_tr;
+	};
+
+	std::priority_queue<Candidate> candidates;
+
+	uint64_t residentSize = 0;
+	uint64_t requestedSize = 0;
+	uint64_t streamedSize = 0;
+
+	++m_numStreams;
+
+	for (uint32_t idx = 0, end = m_textures.getEnd(); idx < end; ++idx)
+	{
+		if (NULL == m_textures.getPath(idx) )
+		{
+			continue;
+		}
+
+		const TextureRef& tr = m_textures[idx];
+		residentSize += tr.m_size;
+
+		if (!tr.m_streamed || 0 == tr.m_refCount)
+		{
+			requestedSize += tr.m_size;
+		}
+	}
+
+	for (uint32_t idx : m_streamedTextures)
+	{
+		TextureRef& tr = m_textures[idx];
+		const float screenSize = tr.m_screenSize;
+		tr.m_screenSize = 0.0f;
+
+		if (0 == tr.m_refCount)
+		{
+			continue;
+		}
+
+		// Textures not on screen keep their low mips only.
+		const uint8_t minSkip = getSkip(tr, TG_CONFIG_TEXTURE_STREAM_MIN_SIZE);
+		tr.m_requestedSkip = 0.0f < screenSize
+			? bx::min(getSkip(tr, screenSize), minSkip)
+			: minSkip
+			;
+
+		const uint64_t size = getMipChainSize(tr, tr.m_requestedSkip);
+		requestedSize += size;
+		streamedSize += size;
+
+		if (tr.m_requestedSkip + 1 < tr.m_numMips)
+		{
+			const float texels = float(bx::max(tr.m_width, tr.m_height) >> tr.m_requestedSkip);
+			candidates.push({ screenSize / texels, &tr });
+		}
+	}
+
+	m_residentSize = residentSize;
+	m_requestedSize = requestedSize;
+
+	// Drop top mips of distant and unused textures first until within budget.
+	while (streamedSize > m_budget
+	&&     !candidates.empty() )
+	{
+		Candidate candidate = candidates.top();
+		candidates.pop();
+
+		TextureRef& tr = *candidate.m_tr;
+		streamedSize -= getMipChainSize(tr, tr.m_requestedSkip);
+		++tr.m_requestedSkip;
+		streamedSize += getMipChainSize(tr, tr.m_requestedSkip);
+
+		if (tr.m_requestedSkip + 1 < tr.m_numMips)
+		{
+			candidate.m_priority *= 2.0f;
+			candidates.push(candidate);
+		}
+	}
+
+	// Evictions go first so memory is freed before more is taken.
+	uint32_t numRequests = 0;
+	for (uint32_t pass = 0; pass < 2; ++pass)
+	{
+		for (uint32_t ii = 0, num = uint32_t(m_streamedTextures.size() ); ii < num && numRequests < TG_CONFIG_TEXTURE_STREAM_MAX_REQUESTS; ++ii)
+		{
+			const uint32_t idx = m_streamedTextures[ii];
+			const TextureRef& tr = m_textures[idx];
+			const bool evict = tr.m_requestedSkip > tr.m_skip;
+
+			if (tr.m_pending
+			||  0 == tr.m_refCount
+			||  tr.m_requestedSkip == tr.m_skip
+			||  evict != (0 == pass)
+			||  m_numStreams < tr.m_streamRetry)
+			{
+				continue;
+			}
+
+			queue(idx, tr.m_requestedSkip);
+			++numRequests;
+		}
+	}
+}
+
+void TextureManager::trimCache(uint64_t _size)
+{
+	while (m_cacheStats.m_size > _size
+	&&     UINT32_MAX != m_lruLast)
+	{
+		evict(m_lruLast);
+	}
+}
+
+void TextureManager::evict(uint32_t _idx)
 {
-	TextureRef& tr = m_textures[_filePath];
+	lruRemove(_idx);
+
+	TextureRef& tr = m_textures[_idx];
+	tr.m_cached = false;
+
+	m_cacheStats.m_size -= tr.m_size;
+	--m_cacheStats.m_num;
+	++m_cacheStats.m_numEvictions;
+
+	BX_ASSERT(!isDefaultTexture(tr.m_texture.m_handle), "Default textures are shared, not owned by the manager.")
+	max::destroy(tr.m_texture.m_handle);
+	tr.m_texture.m_handle = MAX_INVALID_HANDLE;
+
+	// Mip change in flight is dropped by `update`.
+	if (!tr.m_pending)
+	{
+		remove(_idx);
+	}
+}
+
+void TextureManager::remove(uint32_t _idx)
+{
+	BX_ASSERT(!m_textures[_idx].m_pending, "Texture is still decoding.")
+
+	setStreamed(_idx, false);
 
-	if (isValid(tr.m_texture.m_handle))
+#if TG_CONFIG_TEXTURE_HOT_RELOAD
+	const char* sources[2];
+	for (uint32_t ii = 0, num = textureGetSources(m_textures.getPath(_idx), sources); ii < num; ++ii)
 	{
-		--tr.m_refCount;
+		m_watcher.remove(sources[ii]);
+	}
+#endif // TG_CONFIG_TEXTURE_HOT_RELOAD
+
+	m_textures.remove(_idx);
+}
+
+void TextureManager::reload(const char* _source)
+{
+	for (uint32_t idx = 0, end = m_textures.getEnd(); idx < end; ++idx)
+	{
+		const char* filePath = m_textures.getPath(idx);
+		if (NULL == filePath)
+		{
+			continue;
+		}
+
+		const char* sources[2];
+		bool match = false;
+		for (uint32_t ii = 0, num = textureGetSources(filePath, sources); ii < num && !match; ++ii)
+		{
+			match = _source == sources[ii];
+		}
 
-		if (tr.m_refCount == 0)
+		if (!match)
 		{
-			max::destroy(tr.m_texture.m_handle);
-			tr.m_texture.m_handle = MAX_INVALID_HANDLE;
+			continue;
 		}
+
+		TextureRef& tr = m_textures[idx];
+		if (tr.m_cached)
+		{
+			// Not worth decoding until used again.
+			evict(idx);
+		}
+		else if (tr.m_pending)
+		{
+			tr.m_reload = 0 != tr.m_refCount;
+		}
+		else if (0 != tr.m_refCount)
+		{
+			queue(idx, kTextureSkipInitial, true);
+		}
+	}
+}
+
+const TextureCacheStats& TextureManager::getCacheStats() const
+{
+	return m_cacheStats;
+}
+
+uint32_t TextureManager::getNumReloads() const
+{
+	return m_numReloads;
+}
+
+uint64_t TextureManager::getResidentSize() const
+{
+	return m_residentSize;
+}
+
+uint64_t TextureManager::getRequestedSize() const
+{
+	return m_requestedSize;
+}
+
+void TextureManager::decode(void* _userData)
+{
+	TextureDecode* decode = (TextureDecode*)_userData;
+	TextureManager* manager = decode->m_manager;
+
+	// Cooked textures only need parsing, sources are cooked first on a cache miss.
+	bx::FilePath filePath;
+	textureCook(decode->m_filepath, decode->m_usage, filePath);
+
+	MappedFile file;
+	if (file.open(filePath))
+	{
+		decode->m_image = bimg::imageParse(max::getAllocator(), file.m_data, uint32_t(file.m_size));
+		file.close();
 	}
-}
\ No newline at end of file
+
+	{
+		bx::MutexScope lock(manager->m_mutex);
+		manager->m_decoded.push_back(decode);
+	}
+
+	bx::atomicFetchAndSub<int32_t>(&manager->m_numDecoding, 1);
+	manager->m_decodeDone.post();
+}
@@ -1,22 +1,260 @@
 #pragma once
 
+#include "file_watcher.h"
 #include "handles.h"
+#include "path_table.h"
+#include "texture_cook.h"
 
 #include <max/max.h>
+#include <bx/mutex.h>
+#include <bx/semaphore.h>
 
-#include <unordered_map>
-#include <string>
+#include <vector>
+
+#ifndef TG_CONFIG_TEXTURE_BUDGET_MB
+#	define TG_CONFIG_TEXTURE_BUDGET_MB 256 //!< Default memory budget of streamed textures.
+#endif // TG_CONFIG_TEXTURE_BUDGET_MB
+
+#ifndef TG_CONFIG_TEXTURE_STREAM_MIN_SIZE
+#	define TG_CONFIG_TEXTURE_STREAM_MIN_SIZE 64 //!< Largest top mip size kept for unused streamed textures.
+#endif // TG_CONFIG_TEXTURE_STREAM_MIN_SIZE
+
+#ifndef TG_CONFIG_TEXTURE_STREAM_MAX_REQUESTS
+#	define TG_CONFIG_TEXTURE_STREAM_MAX_REQUESTS 4 //!< Max mip changes started per `TextureManager::stream`.
+#endif // TG_CONFIG_TEXTURE_STREAM_MAX_REQUESTS
+
+#ifndef TG_CONFIG_TEXTURE_HOT_RELOAD
+#	define TG_CONFIG_TEXTURE_HOT_RELOAD BX_PLATFORM_LINUX //!< Reload textures changed on disk, Linux only, see `FileWatcher`.
+#endif // TG_CONFIG_TEXTURE_HOT_RELOAD
+
+#ifndef TG_CONFIG_TEXTURE_CACHE_MB
+#	define TG_CONFIG_TEXTURE_CACHE_MB 128 //!< Default size of released textures kept for reuse.
+#endif // TG_CONFIG_TEXTURE_CACHE_MB
+
+struct TextureDecode;
 
 struct TextureRef
 {
+	TextureRef()
+		: m_refCount(0)
+		, m_pending(false)
+		, m_streamed(false)
+		, m_numMips(0)
+		, m_skip(0)
+		, m_requestedSkip(0)
+		, m_width(0)
+		, m_height(0)
+		, m_format(0)
+		, m_screenSize(0.0f)
+		, m_size(0)
+		, m_cached(false)
+		, m_failed(false)
+		, m_reload(false)
+		, m_usage(TextureUsage::Color)
+		, m_streamBackoff(0)
+		, m_streamRetry(0)
+		, m_lruPrev(UINT32_MAX)
+		, m_lruNext(UINT32_MAX)
+	{}
+
 	TextureHandle m_texture;
 	uint32_t m_refCount;
+	bool m_pending;          //!< Being decoded by a worker, see `TextureManager::loadAsync`.
+	bool m_streamed;         //!< Top mips are streamed in and out, see `TextureManager::stream`.
+	uint8_t m_numMips;       //!< Number of mips of full texture.
+	uint8_t m_skip;          //!< Number of top mips not resident.
+	uint8_t m_requestedSkip; //!< Number of top mips not needed, as of last `stream`.
+	uint16_t m_width;        //!< Width of full texture.
+	uint16_t m_height;       //!< Height of full texture.
+	uint16_t m_format;       //!< bimg::TextureFormat::Enum.
+	float m_screenSize;      //!< Largest screen size in pixels requested since last `stream`.
+	uint64_t m_size;         //!< Bytes of resident mips.
+	bool m_cached;           //!< Released and kept in LRU until reloaded or evicted.
+	bool m_failed;           //!< Last load failed, the next load of the path tries again.
+	bool m_reload;           //!< Changed on disk while pending, decoded again once current decode arrives.
+	uint8_t m_usage;         //!< TextureUsage::Enum of first load, picks cooked format.
+	uint8_t m_streamBackoff; //!< Failed mip changes in a row, see `TextureManager::stream`.
+	uint32_t m_streamRetry;  //!< First `TextureManager::stream` call to try mip changes again.
+	uint32_t m_lruPrev;      //!< More recently released texture if cached, UINT32_MAX if first.
+	uint32_t m_lruNext;      //!< Less recently released texture if cached, UINT32_MAX if last.
+};
+
+/// Counters of released textures cache, see `TextureManager::getCacheStats`.
+///
+struct TextureCacheStats
+{
+	uint64_t m_size;         //!< Bytes of cached textures.
+	uint32_t m_num;          //!< Number of cached textures.
+	uint32_t m_numHits;      //!< Loads served from cache.
+	uint32_t m_numMisses;    //!< Loads that read texture from disk.
+	uint32_t m_numEvictions; //!< Cached textures destroyed to stay within budget.
 };
 
+/// Texture uploaded by `TextureManager::update`.
+///
+struct TextureUpload
+{
+	const char* m_filepath;       //!< Interned path passed to `TextureManager::loadAsync`.
+	max::TextureHandle m_texture; //!< Uploaded texture.
+};
+
+/// Reference counted textures by path. Every load of a non-empty path takes a reference
+/// released by `unload`, also if the texture failed to load. A failed texture is loaded again
+/// by the next load of its path or once its source changes on disk. Lookups hash the path
+/// once and don't allocate, see `PathTable`.
+///
+/// Textures are not destroyed once released but kept in an LRU of at most `m_cacheBudget`
+/// bytes, reloading one is a cache hit without any I/O. Least recently released textures
+/// are destroyed first.
+///
+/// 2D textures loaded with `loadAsync` stream their mips. They start out with top mip no
+/// larger than TG_CONFIG_TEXTURE_STREAM_MIN_SIZE and get higher mips as `request` asks for
+/// them, within a global memory budget. A mip change recreates the texture, new handles are
+/// reported by `update` like initial uploads.
+///
+/// Textures changed on disk, Linux only so far, are decoded again by workers and updated in
+/// place by `update`, keeping their handle. Only changes of size, format or mips recreate the
+/// texture.
+///
 struct TextureManager
 {
-	max::TextureHandle load(const char* _filePath);
+	TextureManager();
+	~TextureManager();
+
+	/// Load texture right away. Sources not cooked yet are loaded as is, or not at all if
+	/// there is no such file like for packed surfaces, and cooked by a worker. The cooked
+	/// texture replaces it with `update`.
+	///
+	/// @param[in] _filePath Path to texture.
+	/// @param[in] _usage Kind of data in texture, see `textureCook`.
+	///
+	max::TextureHandle load(const char* _filePath, TextureUsage::Enum _usage = TextureUsage::Color);
+
+	/// Load texture without blocking. File is read and decoded on a worker thread and
+	/// uploaded by `update` on the main thread.
+	///
+	/// @param[in] _filePath Path to texture, interned copy is reported by `update`.
+	/// @param[in] _usage Kind of data in texture, see `textureCook`.
+	///
+	/// @returns Texture if already loaded, otherwise invalid handle until uploaded. Materials
+	///   render with their placeholder textures meanwhile.
+	///
+	max::TextureHandle loadAsync(const char* _filePath, TextureUsage::Enum _usage = TextureUsage::Color);
+
 	void unload(const char* _filePath);
 
-	std::unordered_map<std::string, TextureRef> m_textures;
+	/// Upload textures decoded by workers and queue textures changed on disk for reload. Call
+	/// once per frame on the main thread.
+	///
+	/// @param[out] _outUploaded Textures uploaded by this call are appended, including
+	///   textures recreated with other mips or reloaded with another size. Replaced handles
+	///   are destroyed. Textures reloaded in place aren't reported.
+	///
+	/// @returns Number of textures uploaded.
+	///
+	uint32_t update(std::vector<TextureUpload>& _outUploaded);
+
+	/// Wait for all queued decodes to finish, they are uploaded by the next `update`.
+	///
+	void wait();
+
+	/// Get number of textures queued or being decoded.
+	///
+	uint32_t getNumPending() const;
+
+	/// Get streamed textures, only these take requests.
+	///
+	/// @returns Indices of streamed textures in `m_textures`, changed by `update` and `unload`.
+	///
+	const std::vector<uint32_t>& getStreamed() const;
+
+	/// Request mips of streamed texture for this frame.
+	///
+	/// @param[in] _filePath Path to texture.
+	/// @param[in] _screenSize Size in pixels the texture covers on screen.
+	///
+	void request(const char* _filePath, float _screenSize);
+
+	/// Request mips of streamed texture by index, see `getStreamed`.
+	///
+	void request(uint32_t _idx, float _screenSize);
+
+	/// Pick mips of streamed textures from requests since last call, dropping top mips of the
+	/// least needed textures until they fit the budget, and start loading changed ones. A
+	/// texture whose mip change failed waits twice as many calls after each failure before
+	/// it is tried again.
+	///
+	void stream();
+
+	/// Get bytes of mips currently resident, all textures.
+	///
+	uint64_t getResidentSize() const;
+
+	/// Get bytes of mips requested by last `stream`, all textures, before applying the budget.
+	///
+	uint64_t getRequestedSize() const;
+
+	/// Destroy least recently released textures until cache is no larger than size. Call with
+	/// 0 before shutdown.
+	///
+	void trimCache(uint64_t _size);
+
+	/// Get counters of released textures cache.
+	///
+	const TextureCacheStats& getCacheStats() const;
+
+	/// Get number of textures reloaded since creation, see TG_CONFIG_TEXTURE_HOT_RELOAD.
+	///
+	uint32_t getNumReloads() const;
+
+	uint64_t m_budget;      //!< Memory budget of streamed textures in bytes.
+	uint64_t m_cacheBudget; //!< Memory budget of released textures in bytes.
+
+	PathTable<TextureRef> m_textures;
+
+private:
+	static void decode(void* _userData);
+
+	void queue(uint32_t _idx, uint8_t _skip, bool _reload = false);
+
+	/// Reload textures cooked from changed source file.
+	///
+	void reload(const char* _source);
+
+	/// Destroy cached texture.
+	///
+	void evict(uint32_t _idx);
+
+	/// Remove texture, must not be pending.
+	///
+	void remove(uint32_t _idx);
+
+	/// Take reference to texture, reusing a cached one.
+	///
+	/// @returns True if texture needs to be loaded.
+	///
+	bool acquire(uint32_t _idx);
+
+	void lruPush(uint32_t _idx);
+	void lruRemove(uint32_t _idx);
+
+	/// Add texture to or remove it from `m_streamedTextures`.
+	void setStreamed(uint32_t _idx, bool _streamed);
+
+	bx::Mutex m_mutex;
+	bx::Semaphore m_decodeDone;
+	std::vector<TextureDecode*> m_decoded; //!< Decoded by workers, waiting for upload. Guarded by m_mutex.
+	int32_t m_numDecoding;                 //!< Decodes queued or running, atomic.
+	uint32_t m_numPending;                 //!< Decodes not yet uploaded.
+	uint64_t m_residentSize;
+	uint64_t m_requestedSize;
+	uint32_t m_numStreams;                     //!< Calls of `stream` so far.
+	std::vector<uint32_t> m_streamedTextures; //!< Indices of textures with `TextureRef::m_streamed` set.
+
+	uint32_t m_lruFirst; //!< Most recently released texture, UINT32_MAX if none.
+	uint32_t m_lruLast;  //!< Least recently released texture, evicted first.
+
+	FileWatcher m_watcher; //!< Sources of loaded textures.
+	uint32_t m_numReloads;
+	TextureCacheStats m_cacheStats;
 };
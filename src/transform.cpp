@@ -0,0 +1,505 @@
+#include "transform.h"
+#include "bvh.h"
+#include "components.h"
+#include "transform_kernel.h"
+
+#include <bx/timer.h>
+
+#include <algorithm>
+#include <vector>
+
+struct TransformSystem
+{
+	/// Transform component, one array each so kernel loads lanes of several slots at once.
+	struct Trs
+	{
+		enum Enum
+		{
+			PosX, PosY, PosZ,
+			RotX, RotY, RotZ, RotW,
+			ScaleX, ScaleY, ScaleZ,
+
+			Count
+		};
+	};
+
+	void create()
+	{
+		m_frame = 0;
+		m_capacity = TG_CONFIG_RENDER_LIST_RESERVE;
+		m_renderList.reserve(m_capacity);
+		bx::memSet(&m_list, 0, sizeof(m_list) );
+		bx::memSet(&m_stats, 0, sizeof(m_stats) );
+	}
+
+	void destroy()
+	{
+		m_bvh.clear();
+	}
+
+	void update()
+	{
+		const int64_t begin = bx::getHPCounter();
+
+		++m_frame;
+		m_dirty.clear();
+
+		gather();
+
+		const uint32_t numRenderables = uint32_t(m_renderList.size() );
+		m_listSlots.resize(numRenderables);
+
+		for (uint32_t ii = 0; ii < numRenderables; ++ii)
+		{
+			const max::EntityHandle entity = m_renderList[ii];
+			TransformComponent* tc = max::getComponent<TransformComponent>(entity);
+			RenderComponent* rc = max::getComponent<RenderComponent>(entity);
+
+			const uint32_t idx = acquire(entity, tc);
+			m_lastSeen[idx] = m_frame;
+			m_listSlots[ii] = idx;
+
+			// Cached copy of transform tells what changed, writers don't need to flag it.
+			if (m_changed[idx]
+			||  !isSame(idx, tc)
+			||  0 != bx::memCmp(&m_bounds[idx], &rc->m_bounds, sizeof(MeshBounds) ) )
+			{
+				store(idx, tc);
+				m_bounds[idx] = rc->m_bounds;
+				m_changed[idx] = false;
+				m_dirty.push_back(idx);
+			}
+		}
+
+		compute(m_dirty.data(), uint32_t(m_dirty.size() ) );
+
+#if !TG_CONFIG_BVH
+		// Spheres in render list order, culled per view.
+		for (uint32_t ii = 0; ii < 4; ++ii)
+		{
+			m_listSpheres[ii].resize(numRenderables);
+		}
+
+		for (uint32_t ii = 0; ii < numRenderables; ++ii)
+		{
+			const float* sphere = &m_spheres[m_listSlots[ii] * 4];
+			m_listSpheres[0][ii] = sphere[0];
+			m_listSpheres[1][ii] = sphere[1];
+			m_listSpheres[2][ii] = sphere[2];
+			m_listSpheres[3][ii] = sphere[3];
+		}
+
+		m_list.m_sphere[0] = m_listSpheres[0].data();
+		m_list.m_sphere[1] = m_listSpheres[1].data();
+		m_list.m_sphere[2] = m_listSpheres[2].data();
+		m_list.m_sphere[3] = m_listSpheres[3].data();
+#endif // !TG_CONFIG_BVH
+
+		m_list.m_entities = m_renderList.data();
+		m_list.m_num = numRenderables;
+
+		// Renderables without known bounds are never culled, queries return them as is.
+		m_unbounded.clear();
+		for (uint32_t ii = 0; ii < numRenderables; ++ii)
+		{
+			if (Bvh::kInvalid == m_proxies[m_listSlots[ii]])
+			{
+				m_unbounded.push_back(m_renderList[ii]);
+			}
+		}
+
+		// Slots not seen belong to destroyed entities or entities without a RenderComponent.
+		uint32_t num = 0;
+		for (uint32_t ii = 0, end = uint32_t(m_entities.size() ); ii < end; ++ii)
+		{
+			if (!isValid(m_entities[ii]) )
+			{
+				continue;
+			}
+
+			if (m_frame != m_lastSeen[ii])
+			{
+				if (Bvh::kInvalid != m_proxies[ii])
+				{
+					m_bvh.remove(m_proxies[ii]);
+					m_proxies[ii] = Bvh::kInvalid;
+				}
+
+				m_entities[ii] = MAX_INVALID_HANDLE;
+				m_free.push_back(ii);
+			}
+			else
+			{
+				++num;
+			}
+		}
+
+		m_stats.m_num = num;
+		m_stats.m_numUpdated = uint32_t(m_dirty.size() );
+		m_stats.m_bvhHeight = m_bvh.getHeight();
+		m_stats.m_bvhBytes = m_bvh.getMemorySize();
+		m_stats.m_updateMs = double(bx::getHPCounter() - begin) * 1000.0 / double(bx::getHPFrequency() );
+	}
+
+	/// Gather renderables into render list. System visits at most the count it is given, when
+	/// list fills up capacity is doubled and renderables are gathered again.
+	void gather()
+	{
+		max::System<TransformComponent, RenderComponent> renderables;
+
+		for (;;)
+		{
+			// Capacity is kept between frames, clear doesn't free.
+			m_renderList.clear();
+
+			renderables.each(m_capacity, [](max::EntityHandle _entity, void* _userData)
+			{
+				TransformSystem* system = (TransformSystem*)_userData;
+				system->m_renderList.push_back(_entity);
+			}, this);
+
+			if (m_renderList.size() < m_capacity)
+			{
+				break;
+			}
+
+			m_capacity *= 2;
+		}
+	}
+
+	const float* getWorld(max::EntityHandle _entity)
+	{
+		TransformComponent* tc = max::getComponent<TransformComponent>(_entity);
+		if (NULL == tc)
+		{
+			return NULL;
+		}
+
+		const uint32_t idx = acquire(_entity, tc);
+		if (m_changed[idx])
+		{
+			store(idx, tc);
+
+			const RenderComponent* rc = max::getComponent<RenderComponent>(_entity);
+			if (NULL != rc)
+			{
+				m_bounds[idx] = rc->m_bounds;
+			}
+
+			m_changed[idx] = false;
+			m_lastSeen[idx] = m_frame;
+			compute(&idx, 1);
+		}
+
+		return &m_matrices[idx * 16];
+	}
+
+	/// Get slot of entity, new slots are flagged changed.
+	uint32_t acquire(max::EntityHandle _entity, TransformComponent* _tc)
+	{
+		// Components copied from another entity carry its slot.
+		if (_tc->m_worldIdx < m_entities.size()
+		&&  m_entities[_tc->m_worldIdx].idx == _entity.idx)
+		{
+			return _tc->m_worldIdx;
+		}
+
+		uint32_t idx;
+		if (!m_free.empty() )
+		{
+			idx = m_free.back();
+			m_free.pop_back();
+
+			// Bounds of previous owner, entities without a RenderComponent have none.
+			m_bounds[idx] = MeshBounds();
+		}
+		else
+		{
+			idx = uint32_t(m_entities.size() );
+			m_entities.push_back(MAX_INVALID_HANDLE);
+			for (uint32_t ii = 0; ii < Trs::Count; ++ii)
+			{
+				m_trs[ii].push_back(0.0f);
+			}
+			m_matrices.resize(m_matrices.size() + 16);
+			m_bounds.push_back(MeshBounds() );
+#if !TG_CONFIG_BVH
+			m_spheres.resize(m_spheres.size() + 4);
+#endif // !TG_CONFIG_BVH
+			m_boxes.push_back(BoundingBox() );
+			m_proxies.push_back(Bvh::kInvalid);
+			m_lastSeen.push_back(0);
+			m_changed.push_back(true);
+		}
+
+		m_entities[idx] = _entity;
+		m_changed[idx] = true;
+		_tc->m_worldIdx = idx;
+
+		return idx;
+	}
+
+	/// Compare transform with cached copy bitwise, like `bx::memCmp` did for whole structs.
+	bool isSame(uint32_t _idx, const TransformComponent* _tc) const
+	{
+		const float* trs[Trs::Count];
+		gather(_tc, trs);
+
+		for (uint32_t ii = 0; ii < Trs::Count; ++ii)
+		{
+			if (0 != bx::memCmp(&m_trs[ii][_idx], trs[ii], sizeof(float) ) )
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	void store(uint32_t _idx, const TransformComponent* _tc)
+	{
+		const float* trs[Trs::Count];
+		gather(_tc, trs);
+
+		for (uint32_t ii = 0; ii < Trs::Count; ++ii)
+		{
+			m_trs[ii][_idx] = *trs[ii];
+		}
+	}
+
+	static void gather(const TransformComponent* _tc, const float* _outTrs[Trs::Count])
+	{
+		_outTrs[Trs::PosX] = &_tc->m_position.x;
+		_outTrs[Trs::PosY] = &_tc->m_position.y;
+		_outTrs[Trs::PosZ] = &_tc->m_position.z;
+		_outTrs[Trs::RotX] = &_tc->m_rotation.x;
+		_outTrs[Trs::RotY] = &_tc->m_rotation.y;
+		_outTrs[Trs::RotZ] = &_tc->m_rotation.z;
+		_outTrs[Trs::RotW] = &_tc->m_rotation.w;
+		_outTrs[Trs::ScaleX] = &_tc->m_scale.x;
+		_outTrs[Trs::ScaleY] = &_tc->m_scale.y;
+		_outTrs[Trs::ScaleZ] = &_tc->m_scale.z;
+	}
+
+	/// Compute world matrices of slots.
+	void compute(const uint32_t* _indices, uint32_t _num)
+	{
+		const TransformSoA trs =
+		{
+			{ m_trs[Trs::PosX].data(), m_trs[Trs::PosY].data(), m_trs[Trs::PosZ].data() },
+			{ m_trs[Trs::RotX].data(), m_trs[Trs::RotY].data(), m_trs[Trs::RotZ].data(), m_trs[Trs::RotW].data() },
+			{ m_trs[Trs::ScaleX].data(), m_trs[Trs::ScaleY].data(), m_trs[Trs::ScaleZ].data() },
+		};
+
+		transformBatch(trs, _indices, _num, m_matrices.data() );
+
+		for (uint32_t ii = 0; ii < _num; ++ii)
+		{
+			const uint32_t idx = _indices[ii];
+
+#if !TG_CONFIG_BVH
+			const float maxScale = bx::max(
+				  bx::abs(m_trs[Trs::ScaleX][idx])
+				, bx::abs(m_trs[Trs::ScaleY][idx])
+				, bx::abs(m_trs[Trs::ScaleZ][idx])
+				);
+
+			cullingTransformBounds(m_bounds[idx], &m_matrices[idx * 16], maxScale, &m_spheres[idx * 4]);
+#endif // !TG_CONFIG_BVH
+
+			// Tree only holds slots with known bounds, leaves are refit as transforms change.
+			uint32_t& proxy = m_proxies[idx];
+			if (FLT_MAX != m_bounds[idx].m_radius)
+			{
+				cullingTransformBox(m_bounds[idx], &m_matrices[idx * 16], m_boxes[idx]);
+
+				if (Bvh::kInvalid == proxy)
+				{
+					proxy = m_bvh.insert(m_boxes[idx], idx);
+				}
+				else
+				{
+					m_bvh.move(proxy, m_boxes[idx]);
+				}
+			}
+			else if (Bvh::kInvalid != proxy)
+			{
+				m_bvh.remove(proxy);
+				proxy = Bvh::kInvalid;
+			}
+		}
+	}
+
+	uint32_t queryFrustum(const Frustum& _frustum, std::vector<max::EntityHandle>& _outEntities)
+	{
+		const size_t first = _outEntities.size();
+		_outEntities.insert(_outEntities.end(), m_unbounded.begin(), m_unbounded.end() );
+
+#if TG_CONFIG_BVH
+		m_slots.clear();
+		m_bvh.queryFrustum(_frustum, m_slots);
+		toEntities(_outEntities);
+#else
+		for (uint32_t ii = 0; ii < m_list.m_num; ++ii)
+		{
+			const uint32_t idx = m_listSlots[ii];
+			if (Bvh::kInvalid != m_proxies[idx]
+			&&  cullingBox(_frustum, m_boxes[idx]) )
+			{
+				_outEntities.push_back(m_entities[idx]);
+			}
+		}
+#endif // TG_CONFIG_BVH
+
+		return uint32_t(_outEntities.size() - first);
+	}
+
+	uint32_t queryBox(const BoundingBox& _box, std::vector<max::EntityHandle>& _outEntities)
+	{
+		const size_t first = _outEntities.size();
+
+#if TG_CONFIG_BVH
+		m_slots.clear();
+		m_bvh.queryBox(_box, m_slots);
+		toEntities(_outEntities);
+#else
+		for (uint32_t ii = 0; ii < m_list.m_num; ++ii)
+		{
+			const uint32_t idx = m_listSlots[ii];
+			if (Bvh::kInvalid != m_proxies[idx]
+			&&  cullingOverlap(m_boxes[idx], _box) )
+			{
+				_outEntities.push_back(m_entities[idx]);
+			}
+		}
+#endif // TG_CONFIG_BVH
+
+		return uint32_t(_outEntities.size() - first);
+	}
+
+	uint32_t queryRay(const float _origin[3], const float _dir[3], float _maxDistance, std::vector<TransformRayHit>& _outHits)
+	{
+		const size_t first = _outHits.size();
+
+		m_hits.clear();
+
+#if TG_CONFIG_BVH
+		m_bvh.queryRay(_origin, _dir, _maxDistance, m_hits);
+#else
+		const float invDir[3] = { 1.0f / _dir[0], 1.0f / _dir[1], 1.0f / _dir[2] };
+		for (uint32_t ii = 0; ii < m_list.m_num; ++ii)
+		{
+			const uint32_t idx = m_listSlots[ii];
+			float distance;
+			if (Bvh::kInvalid != m_proxies[idx]
+			&&  cullingRay(_origin, invDir, _maxDistance, m_boxes[idx], distance) )
+			{
+				m_hits.push_back({ idx, distance });
+			}
+		}
+
+		std::sort(m_hits.begin(), m_hits.end(), [](const BvhHit& _a, const BvhHit& _b)
+		{
+			return _a.m_distance < _b.m_distance;
+		});
+#endif // TG_CONFIG_BVH
+
+		for (const BvhHit& hit : m_hits)
+		{
+			_outHits.push_back({ m_entities[hit.m_user], hit.m_distance });
+		}
+
+		return uint32_t(_outHits.size() - first);
+	}
+
+	/// Append owners of slots returned by tree.
+	void toEntities(std::vector<max::EntityHandle>& _outEntities) const
+	{
+		for (uint32_t idx : m_slots)
+		{
+			_outEntities.push_back(m_entities[idx]);
+		}
+	}
+
+	// Slots, index is TransformComponent::m_worldIdx.
+	std::vector<max::EntityHandle> m_entities; //!< Owner of slot, invalid if free.
+	std::vector<float> m_trs[Trs::Count];      //!< Transform matrix was computed from.
+	std::vector<float> m_matrices;             //!< 16 floats per slot.
+	std::vector<MeshBounds> m_bounds;          //!< Local bounds world bounds were computed from.
+#if !TG_CONFIG_BVH
+	std::vector<float> m_spheres;              //!< World bounding sphere, 4 floats per slot.
+#endif // !TG_CONFIG_BVH
+	std::vector<BoundingBox> m_boxes;          //!< World bounding box, undefined if bounds are unknown.
+	std::vector<uint32_t> m_proxies;           //!< Leaf of slot in m_bvh, invalid if bounds are unknown.
+	std::vector<uint32_t> m_lastSeen;          //!< Update that last saw entity.
+	std::vector<bool> m_changed;               //!< Matrix needs compute, slot is new.
+
+	std::vector<uint32_t> m_free;
+	std::vector<uint32_t> m_dirty; //!< Slots recomputed by update.
+
+	std::vector<max::EntityHandle> m_renderList; //!< Renderables gathered by update.
+	std::vector<uint32_t> m_listSlots;           //!< Slot of each renderable.
+#if !TG_CONFIG_BVH
+	std::vector<float> m_listSpheres[4];         //!< World bounding sphere of each renderable.
+#endif // !TG_CONFIG_BVH
+	uint32_t m_capacity;                         //!< Max renderables system is asked to visit.
+	RenderList m_list;
+
+	Bvh m_bvh;                                  //!< World boxes of slots with known bounds.
+	std::vector<max::EntityHandle> m_unbounded; //!< Renderables of last update with unknown bounds.
+	std::vector<uint32_t> m_slots;              //!< Scratch of queries.
+	std::vector<BvhHit> m_hits;                 //!< Scratch of `queryRay`.
+
+	uint32_t m_frame;
+	TransformStats m_stats;
+};
+
+static TransformSystem* s_ctx = NULL;
+
+void transformCreate()
+{
+	s_ctx = BX_NEW(max::getAllocator(), TransformSystem);
+	s_ctx->create();
+}
+
+void transformDestroy()
+{
+	s_ctx->destroy();
+	bx::deleteObject<TransformSystem>(max::getAllocator(), s_ctx);
+	s_ctx = NULL;
+}
+
+void transformUpdate()
+{
+	s_ctx->update();
+}
+
+const float* transformGetWorld(max::EntityHandle _entity)
+{
+	return s_ctx->getWorld(_entity);
+}
+
+const RenderList& transformGetRenderList()
+{
+	return s_ctx->m_list;
+}
+
+uint32_t transformQueryFrustum(const Frustum& _frustum, std::vector<max::EntityHandle>& _outEntities)
+{
+	return s_ctx->queryFrustum(_frustum, _outEntities);
+}
+
+uint32_t transformQueryBox(const BoundingBox& _box, std::vector<max::EntityHandle>& _outEntities)
+{
+	return s_ctx->queryBox(_box, _outEntities);
+}
+
+uint32_t transformQueryRay(const float _origin[3], const float _dir[3], float _maxDistance, std::vector<TransformRayHit>& _outHits)
+{
+	return s_ctx->queryRay(_origin, _dir, _maxDistance, _outHits);
+}
+
+const TransformStats& transformGetStats()
+{
+	return s_ctx->m_stats;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "culling.h"
+
+#include <max/max.h>
+
+#include <vector>
+
+#ifndef TG_CONFIG_RENDER_LIST_RESERVE
+#	define TG_CONFIG_RENDER_LIST_RESERVE (4 << 10) //!< Initial capacity of render list, grows as needed.
+#endif // TG_CONFIG_RENDER_LIST_RESERVE
+
+/// Counters of last `transformUpdate`.
+///
+struct TransformStats
+{
+	uint32_t m_num;        //!< Renderables with a cached world matrix.
+	uint32_t m_numUpdated; //!< World matrices recomputed, transform was new or changed.
+	uint32_t m_bvhHeight;  //!< Levels of spatial index over renderables with known bounds.
+	uint64_t m_bvhBytes;   //!< Memory held by spatial index.
+	double m_updateMs;     //!< CPU time spent in update.
+};
+
+/// Renderables gathered by `transformUpdate`.
+///
+struct RenderList
+{
+	const max::EntityHandle* m_entities;
+	const float* m_sphere[4]; //!< World bounding sphere center x, y, z and radius of each entity, see `cullingSpheres`. NULL with TG_CONFIG_BVH, see `transformQueryFrustum`.
+	uint32_t m_num;
+};
+
+/// Renderable hit by a ray, see `transformQueryRay`.
+///
+struct TransformRayHit
+{
+	max::EntityHandle m_entity;
+	float m_distance; //!< Distance world bounding box is entered at, in units of ray direction length.
+};
+
+/// Create transform system. World matrices of renderables are cached in contiguous arrays,
+/// slot of each entity is kept in its TransformComponent.
+///
+void transformCreate();
+
+void transformDestroy();
+
+/// Gather render list, recompute world matrices of renderables whose transform changed since
+/// last call and free slots of destroyed entities. Call once per frame after transforms are
+/// updated, before rendering.
+///
+void transformUpdate();
+
+/// Get world matrix of entity cached by last `transformUpdate`. Computed and cached now if
+/// entity is new since then, stale if its transform changed since then.
+///
+/// @returns 4x4 matrix, valid until next `transformUpdate`. NULL if entity has no
+///   TransformComponent.
+///
+const float* transformGetWorld(max::EntityHandle _entity);
+
+/// Get renderables gathered by last `transformUpdate`, every entity with a TransformComponent
+/// and a RenderComponent. Passes submit from this list instead of visiting entities each.
+///
+/// @returns Render list, valid until next `transformUpdate`.
+///
+const RenderList& transformGetRenderList();
+
+/// Get renderables whose world bounding box is inside or intersects frustum. Renderables
+/// with unknown bounds are always returned. Queries see world bounds as of last
+/// `transformUpdate`, a BVH over them is refit as transforms change, see TG_CONFIG_BVH.
+///
+/// @param[out] _outEntities Entities are appended.
+///
+/// @returns Number of entities appended.
+///
+uint32_t transformQueryFrustum(const Frustum& _frustum, std::vector<max::EntityHandle>& _outEntities);
+
+/// Get renderables whose world bounding box overlaps box. Renderables with unknown bounds
+/// are never returned.
+///
+/// @param[out] _outEntities Entities are appended.
+///
+/// @returns Number of entities appended.
+///
+uint32_t transformQueryBox(const BoundingBox& _box, std::vector<max::EntityHandle>& _outEntities);
+
+/// Get renderables whose world bounding box is hit by ray, nearest first. Renderables with
+/// unknown bounds are never returned.
+///
+/// @param[in] _origin Ray origin.
+/// @param[in] _dir Ray direction.
+/// @param[in] _maxDistance Max distance along ray, in units of direction length.
+/// @param[out] _outHits Hits are appended.
+///
+/// @returns Number of hits appended.
+///
+uint32_t transformQueryRay(const float _origin[3], const float _dir[3], float _maxDistance, std::vector<TransformRayHit>& _outHits);
+
+/// Get counters of last `transformUpdate`.
+///
+const TransformStats& transformGetStats();
@@ -0,0 +1,321 @@
+#include "transform_kernel.h"
+
+#include <bx/math.h>
+
+#if BX_CPU_X86
+#	include <immintrin.h>
+#	if BX_COMPILER_MSVC
+#		include <intrin.h>
+#	endif // BX_COMPILER_MSVC
+#endif // BX_CPU_X86
+
+#if BX_COMPILER_GCC || BX_COMPILER_CLANG
+#	define TG_TARGET_AVX2 __attribute__((target("avx2") ) )
+#else
+#	define TG_TARGET_AVX2
+#endif // BX_COMPILER_GCC || BX_COMPILER_CLANG
+
+typedef void (*TransformBatchFn)(const TransformSoA& _trs, const uint32_t* _indices, uint32_t _num, float* _outMatrices);
+
+static void transformBatchScalar(const TransformSoA& _trs, const uint32_t* _indices, uint32_t _num, float* _outMatrices)
+{
+	for (uint32_t ii = 0; ii < _num; ++ii)
+	{
+		const uint32_t idx = _indices[ii];
+
+		bx::mtxSRT(&_outMatrices[idx * 16],
+			_trs.m_scale[0][idx], _trs.m_scale[1][idx], _trs.m_scale[2][idx],
+			_trs.m_rot[0][idx], _trs.m_rot[1][idx], _trs.m_rot[2][idx], _trs.m_rot[3][idx],
+			_trs.m_pos[0][idx], _trs.m_pos[1][idx], _trs.m_pos[2][idx]);
+	}
+}
+
+#if BX_CPU_X86
+/// Store 4x4 block of matrix elements, lane i of each input is a row of transform i.
+static void storeRows(__m128 _a, __m128 _b, __m128 _c, __m128 _d, float* const _dst[4], uint32_t _row)
+{
+	_MM_TRANSPOSE4_PS(_a, _b, _c, _d);
+	_mm_storeu_ps(&_dst[0][_row * 4], _a);
+	_mm_storeu_ps(&_dst[1][_row * 4], _b);
+	_mm_storeu_ps(&_dst[2][_row * 4], _c);
+	_mm_storeu_ps(&_dst[3][_row * 4], _d);
+}
+
+static __m128 gather4(const float* _src, const uint32_t* _indices)
+{
+	return _mm_setr_ps(_src[_indices[0]], _src[_indices[1]], _src[_indices[2]], _src[_indices[3]]);
+}
+
+static void transformBatchSse2(const TransformSoA& _trs, const uint32_t* _indices, uint32_t _num, float* _outMatrices)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	uint32_t ii = 0;
+	for (; ii + 4 <= _num; ii += 4)
+	{
+		const uint32_t* idx = &_indices[ii];
+
+		const __m128 qx = gather4(_trs.m_rot[0], idx);
+		const __m128 qy = gather4(_trs.m_rot[1], idx);
+		const __m128 qz = gather4(_trs.m_rot[2], idx);
+		const __m128 qw = gather4(_trs.m_rot[3], idx);
+		const __m128 sx = gather4(_trs.m_scale[0], idx);
+		const __m128 sy = gather4(_trs.m_scale[1], idx);
+		const __m128 sz = gather4(_trs.m_scale[2], idx);
+
+		// Same terms as `bx::mtxFromQuaternion`.
+		const __m128 x2 = _mm_add_ps(qx, qx);
+		const __m128 y2 = _mm_add_ps(qy, qy);
+		const __m128 z2 = _mm_add_ps(qz, qz);
+		const __m128 x2x = _mm_mul_ps(x2, qx);
+		const __m128 x2y = _mm_mul_ps(x2, qy);
+		const __m128 x2z = _mm_mul_ps(x2, qz);
+		const __m128 x2w = _mm_mul_ps(x2, qw);
+		const __m128 y2y = _mm_mul_ps(y2, qy);
+		const __m128 y2z = _mm_mul_ps(y2, qz);
+		const __m128 y2w = _mm_mul_ps(y2, qw);
+		const __m128 z2z = _mm_mul_ps(z2, qz);
+		const __m128 z2w = _mm_mul_ps(z2, qw);
+
+		float* dst[4] =
+		{
+			&_outMatrices[idx[0] * 16],
+			&_outMatrices[idx[1] * 16],
+			&_outMatrices[idx[2] * 16],
+			&_outMatrices[idx[3] * 16],
+		};
+
+		storeRows(
+			  _mm_mul_ps(sx, _mm_sub_ps(one, _mm_add_ps(y2y, z2z) ) )
+			, _mm_mul_ps(sx, _mm_sub_ps(x2y, z2w) )
+			, _mm_mul_ps(sx, _mm_add_ps(x2z, y2w) )
+			, zero
+			, dst
+			, 0
+			);
+		storeRows(
+			  _mm_mul_ps(sy, _mm_add_ps(x2y, z2w) )
+			, _mm_mul_ps(sy, _mm_sub_ps(one, _mm_add_ps(x2x, z2z) ) )
+			, _mm_mul_ps(sy, _mm_sub_ps(y2z, x2w) )
+			, zero
+			, dst
+			, 1
+			);
+		storeRows(
+			  _mm_mul_ps(sz, _mm_sub_ps(x2z, y2w) )
+			, _mm_mul_ps(sz, _mm_add_ps(y2z, x2w) )
+			, _mm_mul_ps(sz, _mm_sub_ps(one, _mm_add_ps(x2x, y2y) ) )
+			, zero
+			, dst
+			, 2
+			);
+		storeRows(
+			  gather4(_trs.m_pos[0], idx)
+			, gather4(_trs.m_pos[1], idx)
+			, gather4(_trs.m_pos[2], idx)
+			, one
+			, dst
+			, 3
+			);
+	}
+
+	transformBatchScalar(_trs, &_indices[ii], _num - ii, _outMatrices);
+}
+
+/// Store 4x4 blocks of matrix elements of 8 transforms, lane i of each input is a row of transform i.
+TG_TARGET_AVX2 static void storeRows8(__m256 _a, __m256 _b, __m256 _c, __m256 _d, float* const _dst[8], uint32_t _row)
+{
+	storeRows(_mm256_castps256_ps128(_a), _mm256_castps256_ps128(_b), _mm256_castps256_ps128(_c), _mm256_castps256_ps128(_d), &_dst[0], _row);
+	storeRows(_mm256_extractf128_ps(_a, 1), _mm256_extractf128_ps(_b, 1), _mm256_extractf128_ps(_c, 1), _mm256_extractf128_ps(_d, 1), &_dst[4], _row);
+}
+
+TG_TARGET_AVX2 static void transformBatchAvx2(const TransformSoA& _trs, const uint32_t* _indices, uint32_t _num, float* _outMatrices)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 zero = _mm256_setzero_ps();
+
+	uint32_t ii = 0;
+	for (; ii + 8 <= _num; ii += 8)
+	{
+		const uint32_t* idx = &_indices[ii];
+		const __m256i vidx = _mm256_loadu_si256( (const __m256i*)idx);
+
+		const __m256 qx = _mm256_i32gather_ps(_trs.m_rot[0], vidx, 4);
+		const __m256 qy = _mm256_i32gather_ps(_trs.m_rot[1], vidx, 4);
+		const __m256 qz = _mm256_i32gather_ps(_trs.m_rot[2], vidx, 4);
+		const __m256 qw = _mm256_i32gather_ps(_trs.m_rot[3], vidx, 4);
+		const __m256 sx = _mm256_i32gather_ps(_trs.m_scale[0], vidx, 4);
+		const __m256 sy = _mm256_i32gather_ps(_trs.m_scale[1], vidx, 4);
+		const __m256 sz = _mm256_i32gather_ps(_trs.m_scale[2], vidx, 4);
+
+		const __m256 x2 = _mm256_add_ps(qx, qx);
+		const __m256 y2 = _mm256_add_ps(qy, qy);
+		const __m256 z2 = _mm256_add_ps(qz, qz);
+		const __m256 x2x = _mm256_mul_ps(x2, qx);
+		const __m256 x2y = _mm256_mul_ps(x2, qy);
+		const __m256 x2z = _mm256_mul_ps(x2, qz);
+		const __m256 x2w = _mm256_mul_ps(x2, qw);
+		const __m256 y2y = _mm256_mul_ps(y2, qy);
+		const __m256 y2z = _mm256_mul_ps(y2, qz);
+		const __m256 y2w = _mm256_mul_ps(y2, qw);
+		const __m256 z2z = _mm256_mul_ps(z2, qz);
+		const __m256 z2w = _mm256_mul_ps(z2, qw);
+
+		float* dst[8];
+		for (uint32_t jj = 0; jj < 8; ++jj)
+		{
+			dst[jj] = &_outMatrices[idx[jj] * 16];
+		}
+
+		storeRows8(
+			  _mm256_mul_ps(sx, _mm256_sub_ps(one, _mm256_add_ps(y2y, z2z) ) )
+			, _mm256_mul_ps(sx, _mm256_sub_ps(x2y, z2w) )
+			, _mm256_mul_ps(sx, _mm256_add_ps(x2z, y2w) )
+			, zero
+			, dst
+			, 0
+			);
+		storeRows8(
+			  _mm256_mul_ps(sy, _mm256_add_ps(x2y, z2w) )
+			, _mm256_mul_ps(sy, _mm256_sub_ps(one, _mm256_add_ps(x2x, z2z) ) )
+			, _mm256_mul_ps(sy, _mm256_sub_ps(y2z, x2w) )
+			, zero
+			, dst
+			, 1
+			);
+		storeRows8(
+			  _mm256_mul_ps(sz, _mm256_sub_ps(x2z, y2w) )
+			, _mm256_mul_ps(sz, _mm256_add_ps(y2z, x2w) )
+			, _mm256_mul_ps(sz, _mm256_sub_ps(one, _mm256_add_ps(x2x, y2y) ) )
+			, zero
+			, dst
+			, 2
+			);
+		storeRows8(
+			  _mm256_i32gather_ps(_trs.m_pos[0], vidx, 4)
+			, _mm256_i32gather_ps(_trs.m_pos[1], vidx, 4)
+			, _mm256_i32gather_ps(_trs.m_pos[2], vidx, 4)
+			, one
+			, dst
+			, 3
+			);
+	}
+
+	transformBatchSse2(_trs, &_indices[ii], _num - ii, _outMatrices);
+}
+
+static bool isAvx2Supported()
+{
+#	if BX_COMPILER_MSVC
+	int32_t info[4];
+	__cpuid(info, 0);
+	if (7 > info[0])
+	{
+		return false;
+	}
+
+	// OS must save AVX registers.
+	__cpuid(info, 1);
+	const bool osxsave = 0 != (info[2] & (1 << 27) );
+	if (!osxsave
+	||  6 != (_xgetbv(0) & 6) )
+	{
+		return false;
+	}
+
+	__cpuidex(info, 7, 0);
+	return 0 != (info[1] & (1 << 5) );
+#	else
+	return __builtin_cpu_supports("avx2");
+#	endif // BX_COMPILER_MSVC
+}
+#endif // BX_CPU_X86
+
+static const TransformBatchFn s_batchFn[TransformKernel::Count] =
+{
+	transformBatchScalar,
+#if BX_CPU_X86
+	transformBatchSse2,
+	transformBatchAvx2,
+#else
+	NULL,
+	NULL,
+#endif // BX_CPU_X86
+};
+
+static const char* s_kernelName[TransformKernel::Count] =
+{
+	"scalar",
+	"sse2",
+	"avx2",
+};
+
+static TransformKernel::Enum s_kernel = TransformKernel::Count; //!< Picked on first use.
+
+static TransformKernel::Enum pickKernel()
+{
+	for (int32_t kernel = TransformKernel::Count - 1; kernel > TransformKernel::Scalar; --kernel)
+	{
+		if (transformIsKernelSupported(TransformKernel::Enum(kernel) ) )
+		{
+			return TransformKernel::Enum(kernel);
+		}
+	}
+
+	return TransformKernel::Scalar;
+}
+
+void transformBatch(const TransformSoA& _trs, const uint32_t* _indices, uint32_t _num, float* _outMatrices)
+{
+	s_batchFn[transformGetKernel()](_trs, _indices, _num, _outMatrices);
+}
+
+bool transformIsKernelSupported(TransformKernel::Enum _kernel)
+{
+	switch (_kernel)
+	{
+	case TransformKernel::Scalar:
+		return true;
+
+#if BX_CPU_X86
+	case TransformKernel::Sse2:
+		return true; // Baseline of x86-64, SSE2 intrinsics are used by bx on x86 too.
+
+	case TransformKernel::Avx2:
+		{
+			static const bool avx2 = isAvx2Supported();
+			return avx2;
+		}
+#endif // BX_CPU_X86
+
+	default:
+		return false;
+	}
+}
+
+TransformKernel::Enum transformGetKernel()
+{
+	if (TransformKernel::Count == s_kernel)
+	{
+		s_kernel = pickKernel();
+	}
+
+	return s_kernel;
+}
+
+bool transformSetKernel(TransformKernel::Enum _kernel)
+{
+	if (!transformIsKernelSupported(_kernel) )
+	{
+		return false;
+	}
+
+	s_kernel = _kernel;
+	return true;
+}
+
+const char* transformGetKernelName(TransformKernel::Enum _kernel)
+{
+	return s_kernelName[_kernel];
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <bx/bx.h>
+
+/// Transforms stored as one float array per component.
+///
+struct TransformSoA
+{
+	const float* m_pos[3];   //!< Position x, y, z.
+	const float* m_rot[4];   //!< Rotation quaternion x, y, z, w.
+	const float* m_scale[3]; //!< Scale x, y, z.
+};
+
+/// Instruction set of transform kernel.
+///
+struct TransformKernel
+{
+	enum Enum
+	{
+		Scalar, //!< `bx::mtxSRT` per transform.
+		Sse2,   //!< 4 transforms at a time.
+		Avx2,   //!< 8 transforms at a time, gathers transforms.
+
+		Count
+	};
+};
+
+/// Compute world matrices of transforms, same as `bx::mtxSRT` up to rounding. Runs the best
+/// kernel supported by the CPU, picked on first use.
+///
+/// @param[in] _trs Transforms.
+/// @param[in] _indices Transforms to compute.
+/// @param[in] _num Number of indices.
+/// @param[out] _outMatrices Matrix of transform at index i is written to `_outMatrices + 16 * i`.
+///
+void transformBatch(const TransformSoA& _trs, const uint32_t* _indices, uint32_t _num, float* _outMatrices);
+
+/// Check if CPU supports kernel.
+///
+bool transformIsKernelSupported(TransformKernel::Enum _kernel);
+
+/// Get kernel used by `transformBatch`.
+///
+TransformKernel::Enum transformGetKernel();
+
+/// Use given kernel, for testing and benchmarks.
+///
+/// @returns False if CPU doesn't support kernel, current kernel is kept.
+///
+bool transformSetKernel(TransformKernel::Enum _kernel);
+
+/// Get name of kernel.
+///
+const char* transformGetKernelName(TransformKernel::Enum _kernel);
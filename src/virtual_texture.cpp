@@ -0,0 +1,331 @@
+#include "virtual_texture.h"
+
+#include <bx/string.h>
+
+#include <algorithm>
+
+static uint32_t makeEntry(uint16_t _x, uint16_t _y, uint8_t _mip)
+{
+	// RGBA8 in memory order.
+	return uint32_t(_x) | uint32_t(_y) << 8 | uint32_t(_mip) << 16 | UINT32_C(0xff) << 24;
+}
+
+static bool isMapped(uint32_t _entry)
+{
+	return 0 != (_entry >> 24);
+}
+
+static uint8_t getEntryMip(uint32_t _entry)
+{
+	return uint8_t(_entry >> 16);
+}
+
+VirtualTextureCache::VirtualTextureCache()
+	: m_numSlots(0)
+	, m_frame(0)
+{
+	bx::memSet(&m_desc, 0, sizeof(m_desc) );
+}
+
+void VirtualTextureCache::create(const VirtualTextureDesc& _desc, uint16_t _numSlots)
+{
+	BX_ASSERT(_numSlots <= 256, "Page table entries hold atlas slots in 8 bits.")
+
+	destroy();
+
+	m_desc = _desc;
+	m_numSlots = _numSlots;
+	m_frame = 0;
+
+	m_slots.resize(uint32_t(_numSlots) * _numSlots, { UINT32_MAX, 0 });
+
+	m_pageTable.resize(_desc.m_numMips);
+	m_dirtyBegin.resize(_desc.m_numMips, UINT32_MAX);
+	m_dirtyEnd.resize(_desc.m_numMips, 0);
+
+	for (uint8_t mip = 0; mip < _desc.m_numMips; ++mip)
+	{
+		const uint32_t num = _desc.getNumPages(mip);
+		m_pageTable[mip].resize(num * num, 0);
+	}
+}
+
+void VirtualTextureCache::destroy()
+{
+	m_slots.clear();
+	m_resident.clear();
+	m_inFlight.clear();
+	m_pageTable.clear();
+	m_dirtyBegin.clear();
+	m_dirtyEnd.clear();
+}
+
+uint32_t VirtualTextureCache::resolve(const uint8_t* _feedback, uint32_t _numPixels, uint32_t _maxRequests, std::vector<uint32_t>& _outPages)
+{
+	++m_frame;
+
+	m_requests.clear();
+	for (uint32_t ii = 0; ii < _numPixels; ++ii)
+	{
+		uint32_t page;
+		if (vtFeedbackDecode(&_feedback[ii * 4], page)
+		&&  vtPageMip(page) < m_desc.m_numMips
+		&&  vtPageX(page) < m_desc.getNumPages(vtPageMip(page) )
+		&&  vtPageY(page) < m_desc.getNumPages(vtPageMip(page) ) )
+		{
+			m_requests.push_back(page);
+		}
+	}
+
+	std::sort(m_requests.begin(), m_requests.end() );
+
+	struct Candidate
+	{
+		uint32_t m_page;
+		uint32_t m_count;
+	};
+
+	std::vector<Candidate> candidates;
+
+	// Last mip is the fallback of every texel.
+	const uint32_t root = vtPageId(m_desc.m_numMips - 1, 0, 0);
+	if (!isResident(root) )
+	{
+		candidates.push_back({ root, UINT32_MAX });
+	}
+
+	for (size_t ii = 0, num = m_requests.size(); ii < num;)
+	{
+		const uint32_t page = m_requests[ii];
+
+		size_t end = ii + 1;
+		while (end < num && m_requests[end] == page)
+		{
+			++end;
+		}
+
+		// Resident ancestors are used while finer pages load, keep them.
+		uint32_t missing = UINT32_MAX;
+		for (uint32_t mip = vtPageMip(page), xx = vtPageX(page), yy = vtPageY(page); mip < m_desc.m_numMips; ++mip, xx >>= 1, yy >>= 1)
+		{
+			const uint32_t ancestor = vtPageId(uint8_t(mip), xx, yy);
+			if (isResident(ancestor) )
+			{
+				touch(ancestor);
+			}
+			else
+			{
+				missing = ancestor;
+			}
+		}
+
+		if (UINT32_MAX != missing)
+		{
+			candidates.push_back({ missing, uint32_t(end - ii) });
+		}
+
+		ii = end;
+	}
+
+	// Pages missing for several requests add up.
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& _a, const Candidate& _b)
+	{
+		return _a.m_page < _b.m_page;
+	});
+
+	size_t numUnique = 0;
+	for (size_t ii = 0; ii < candidates.size(); ++ii)
+	{
+		if (0 != numUnique
+		&&  candidates[numUnique - 1].m_page == candidates[ii].m_page)
+		{
+			Candidate& candidate = candidates[numUnique - 1];
+			candidate.m_count = bx::max(candidate.m_count, candidate.m_count + candidates[ii].m_count);
+		}
+		else
+		{
+			candidates[numUnique++] = candidates[ii];
+		}
+	}
+	candidates.resize(numUnique);
+
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate& _a, const Candidate& _b)
+	{
+		const uint8_t mipA = vtPageMip(_a.m_page);
+		const uint8_t mipB = vtPageMip(_b.m_page);
+		return mipA != mipB ? mipA > mipB : _a.m_count > _b.m_count;
+	});
+
+	uint32_t num = 0;
+	for (size_t ii = 0; ii < candidates.size() && num < _maxRequests; ++ii)
+	{
+		const uint32_t page = candidates[ii].m_page;
+		if (m_inFlight.insert(page).second)
+		{
+			_outPages.push_back(page);
+			++num;
+		}
+	}
+
+	return num;
+}
+
+bool VirtualTextureCache::map(uint32_t _page, VirtualPageSlot& _outSlot)
+{
+	m_inFlight.erase(_page);
+
+	if (isResident(_page) )
+	{
+		return false;
+	}
+
+	const uint32_t root = vtPageId(m_desc.m_numMips - 1, 0, 0);
+
+	// Free slot or least recently used page not needed by last resolve.
+	uint32_t best = UINT32_MAX;
+	for (uint32_t ii = 0, num = uint32_t(m_slots.size() ); ii < num; ++ii)
+	{
+		const Slot& slot = m_slots[ii];
+		if (UINT32_MAX == slot.m_page)
+		{
+			best = ii;
+			break;
+		}
+
+		if (root != slot.m_page
+		&&  m_frame != slot.m_lastUsed
+		&&  (UINT32_MAX == best || slot.m_lastUsed < m_slots[best].m_lastUsed) )
+		{
+			best = ii;
+		}
+	}
+
+	if (UINT32_MAX == best)
+	{
+		return false;
+	}
+
+	Slot& slot = m_slots[best];
+	if (UINT32_MAX != slot.m_page)
+	{
+		const uint32_t evicted = slot.m_page;
+		m_resident.erase(evicted);
+
+		// Texels of evicted page fall back to its parent's mapping.
+		const uint8_t mip = vtPageMip(evicted);
+		const uint32_t fallback = mip + 1 < m_desc.m_numMips
+			? entry(mip + 1, vtPageX(evicted) >> 1, vtPageY(evicted) >> 1)
+			: 0
+			;
+		fill(evicted, fallback, true);
+	}
+
+	slot.m_page = _page;
+	slot.m_lastUsed = m_frame;
+	m_resident[_page] = best;
+
+	_outSlot.m_x = uint16_t(best % m_numSlots);
+	_outSlot.m_y = uint16_t(best / m_numSlots);
+
+	fill(_page, makeEntry(_outSlot.m_x, _outSlot.m_y, vtPageMip(_page) ), false);
+
+	return true;
+}
+
+void VirtualTextureCache::cancel(uint32_t _page)
+{
+	m_inFlight.erase(_page);
+}
+
+bool VirtualTextureCache::isResident(uint32_t _page) const
+{
+	return m_resident.end() != m_resident.find(_page);
+}
+
+bool VirtualTextureCache::isInFlight(uint32_t _page) const
+{
+	return m_inFlight.end() != m_inFlight.find(_page);
+}
+
+const uint32_t* VirtualTextureCache::getPageTable(uint8_t _mip) const
+{
+	return m_pageTable[_mip].data();
+}
+
+bool VirtualTextureCache::getDirtyRows(uint8_t _mip, uint32_t& _outBegin, uint32_t& _outEnd)
+{
+	if (UINT32_MAX == m_dirtyBegin[_mip])
+	{
+		return false;
+	}
+
+	_outBegin = m_dirtyBegin[_mip];
+	_outEnd = m_dirtyEnd[_mip];
+
+	m_dirtyBegin[_mip] = UINT32_MAX;
+	m_dirtyEnd[_mip] = 0;
+	return true;
+}
+
+uint32_t VirtualTextureCache::getNumResident() const
+{
+	return uint32_t(m_resident.size() );
+}
+
+const VirtualTextureDesc& VirtualTextureCache::getDesc() const
+{
+	return m_desc;
+}
+
+uint32_t& VirtualTextureCache::entry(uint8_t _mip, uint32_t _x, uint32_t _y)
+{
+	return m_pageTable[_mip][_y * m_desc.getNumPages(_mip) + _x];
+}
+
+void VirtualTextureCache::fill(uint32_t _page, uint32_t _entry, bool _unmap)
+{
+	const uint8_t mip = vtPageMip(_page);
+
+	// Page covers a square of entries in its own and every finer mip.
+	for (int32_t level = mip; level >= 0; --level)
+	{
+		const uint32_t shift = mip - level;
+		const uint32_t x0 = vtPageX(_page) << shift;
+		const uint32_t y0 = vtPageY(_page) << shift;
+		const uint32_t size = 1 << shift;
+		const uint32_t pitch = m_desc.getNumPages(uint8_t(level) );
+
+		std::vector<uint32_t>& table = m_pageTable[level];
+		for (uint32_t yy = y0; yy < y0 + size; ++yy)
+		{
+			uint32_t* row = &table[yy * pitch];
+			for (uint32_t xx = x0; xx < x0 + size; ++xx)
+			{
+				const uint32_t current = row[xx];
+
+				// Unmapping replaces entries of this page only, mapping those of coarser pages.
+				const bool replace = _unmap
+					? isMapped(current) && mip == getEntryMip(current)
+					: !isMapped(current) || mip < getEntryMip(current)
+					;
+
+				if (replace)
+				{
+					row[xx] = _entry;
+				}
+			}
+		}
+
+		m_dirtyBegin[level] = bx::min(m_dirtyBegin[level], y0);
+		m_dirtyEnd[level] = bx::max(m_dirtyEnd[level], y0 + size);
+	}
+}
+
+void VirtualTextureCache::touch(uint32_t _page)
+{
+	auto it = m_resident.find(_page);
+	if (it != m_resident.end() )
+	{
+		m_slots[it->second].m_lastUsed = m_frame;
+	}
+}
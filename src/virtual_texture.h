@@ -0,0 +1,193 @@
+#pragma once
+
+#include <bx/bx.h>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#ifndef TG_CONFIG_VIRTUAL_TEXTURE
+#	define TG_CONFIG_VIRTUAL_TEXTURE 0 //!< Virtual texture large floors on any renderer, requires fs_gbuffer_vt and fs_vt_feedback in runtime/shaders.
+#endif // TG_CONFIG_VIRTUAL_TEXTURE
+
+#ifndef TG_CONFIG_VT_PAGE_SIZE
+#	define TG_CONFIG_VT_PAGE_SIZE 128 //!< Texels per side of a virtual texture page, without border.
+#endif // TG_CONFIG_VT_PAGE_SIZE
+
+#ifndef TG_CONFIG_VT_PAGE_BORDER
+#	define TG_CONFIG_VT_PAGE_BORDER 4 //!< Texels of neighbouring pages stored around each page for filtering.
+#endif // TG_CONFIG_VT_PAGE_BORDER
+
+#ifndef TG_CONFIG_VT_ATLAS_PAGES
+#	define TG_CONFIG_VT_ATLAS_PAGES 16 //!< Pages per side of physical page cache atlas.
+#endif // TG_CONFIG_VT_ATLAS_PAGES
+
+#ifndef TG_CONFIG_VT_FEEDBACK_DIVISOR
+#	define TG_CONFIG_VT_FEEDBACK_DIVISOR 8 //!< Feedback pass resolution relative to viewport.
+#endif // TG_CONFIG_VT_FEEDBACK_DIVISOR
+
+#ifndef TG_CONFIG_VT_MAX_REQUESTS
+#	define TG_CONFIG_VT_MAX_REQUESTS 16 //!< Max page loads started per feedback readback.
+#endif // TG_CONFIG_VT_MAX_REQUESTS
+
+/// Size and page layout of a virtual texture.
+///
+struct VirtualTextureDesc
+{
+	/// Get pages per side of mip.
+	uint32_t getNumPages(uint8_t _mip) const
+	{
+		return (m_size / m_pageSize) >> _mip;
+	}
+
+	uint32_t m_size;     //!< Texels per side of top mip, power of two.
+	uint16_t m_pageSize; //!< Texels per side of page without border, power of two.
+	uint16_t m_border;   //!< Texels per side of page border.
+	uint8_t m_numMips;   //!< Mips down to a single page.
+};
+
+/// Get id of virtual texture page.
+///
+inline uint32_t vtPageId(uint8_t _mip, uint32_t _x, uint32_t _y)
+{
+	return uint32_t(_mip) << 24 | (_y & 0xfff) << 12 | (_x & 0xfff);
+}
+
+inline uint8_t vtPageMip(uint32_t _page)
+{
+	return uint8_t(_page >> 24);
+}
+
+inline uint32_t vtPageX(uint32_t _page)
+{
+	return _page & 0xfff;
+}
+
+inline uint32_t vtPageY(uint32_t _page)
+{
+	return (_page >> 12) & 0xfff;
+}
+
+/// Decode feedback pass pixel, RGBA8 as read back. Red and green hold low bits of page x and
+/// y, blue their high bits, alpha mip + 1 or 0 where nothing was drawn, see fs_vt_feedback.
+///
+/// @returns True if pixel requests a page.
+///
+inline bool vtFeedbackDecode(const uint8_t _rgba[4], uint32_t& _outPage)
+{
+	if (0 == _rgba[3])
+	{
+		return false;
+	}
+
+	const uint32_t xx = _rgba[0] | uint32_t(_rgba[2] & 0xf) << 8;
+	const uint32_t yy = _rgba[1] | uint32_t(_rgba[2] >> 4) << 8;
+	_outPage = vtPageId(uint8_t(_rgba[3] - 1), xx, yy);
+	return true;
+}
+
+/// Slot of page in physical page cache atlas.
+///
+struct VirtualPageSlot
+{
+	uint16_t m_x; //!< Column of slot in atlas, in pages.
+	uint16_t m_y; //!< Row of slot in atlas, in pages.
+};
+
+/// Page cache and page table of a virtual texture. CPU only, the caller loads pages and
+/// uploads atlas slots and page table rows.
+///
+/// Page table mip N has an RGBA8 entry per page of virtual texture mip N: atlas column (r),
+/// row (g) and mip (b) of the finest resident page covering it, alpha 255 if any.
+///
+/// The single page of the last mip is requested first and never evicted, every texel
+/// always has a resident page to fall back to once it is loaded.
+///
+struct VirtualTextureCache
+{
+	VirtualTextureCache();
+
+	/// @param[in] _desc Virtual texture.
+	/// @param[in] _numSlots Pages per side of atlas.
+	///
+	void create(const VirtualTextureDesc& _desc, uint16_t _numSlots);
+
+	void destroy();
+
+	/// Count page requests of feedback pass, touch used resident pages and pick missing pages
+	/// to load. Missing pages are loaded coarse to fine, a page is only requested once its
+	/// parent is resident. Most requested pages of coarsest mips come first.
+	///
+	/// @param[in] _feedback RGBA8 pixels read back from feedback pass, see `vtFeedbackDecode`.
+	/// @param[in] _numPixels Number of pixels.
+	/// @param[in] _maxRequests Max pages to pick.
+	/// @param[out] _outPages Pages to load are appended, they are in flight until `map` or
+	///   `cancel`.
+	///
+	/// @returns Number of pages picked.
+	///
+	uint32_t resolve(const uint8_t* _feedback, uint32_t _numPixels, uint32_t _maxRequests, std::vector<uint32_t>& _outPages);
+
+	/// Place loaded page into atlas, evicting the least recently used page if full. Pages
+	/// used by the last resolve and the last mip page are never evicted.
+	///
+	/// @param[out] _outSlot Slot to upload page to.
+	///
+	/// @returns False if no slot is free, page is dropped.
+	///
+	bool map(uint32_t _page, VirtualPageSlot& _outSlot);
+
+	/// Drop page in flight that failed to load.
+	///
+	void cancel(uint32_t _page);
+
+	bool isResident(uint32_t _page) const;
+
+	bool isInFlight(uint32_t _page) const;
+
+	/// Get page table entries of mip, row major.
+	///
+	const uint32_t* getPageTable(uint8_t _mip) const;
+
+	/// Get rows of page table mip changed since last call.
+	///
+	/// @returns False if none changed.
+	///
+	bool getDirtyRows(uint8_t _mip, uint32_t& _outBegin, uint32_t& _outEnd);
+
+	/// Get number of resident pages.
+	///
+	uint32_t getNumResident() const;
+
+	const VirtualTextureDesc& getDesc() const;
+
+private:
+	struct Slot
+	{
+		uint32_t m_page;     //!< Resident page, UINT32_MAX if free.
+		uint32_t m_lastUsed; //!< Resolve that last used page.
+	};
+
+	/// Get page table entry of page.
+	uint32_t& entry(uint8_t _mip, uint32_t _x, uint32_t _y);
+
+	/// Point page table entries of page and its descendants to entry, entries mapping coarser
+	/// pages when mapping, entries mapping the page when unmapping.
+	void fill(uint32_t _page, uint32_t _entry, bool _unmap);
+
+	void touch(uint32_t _page);
+
+	VirtualTextureDesc m_desc;
+	uint16_t m_numSlots;
+	uint32_t m_frame; //!< Number of resolves.
+
+	std::vector<Slot> m_slots;
+	std::unordered_map<uint32_t, uint32_t> m_resident; //!< Page to slot.
+	std::unordered_set<uint32_t> m_inFlight;
+
+	std::vector<std::vector<uint32_t> > m_pageTable;
+	std::vector<uint32_t> m_dirtyBegin; //!< Per mip, UINT32_MAX if clean.
+	std::vector<uint32_t> m_dirtyEnd;
+
+	std::vector<uint32_t> m_requests; //!< Scratch of `resolve`.
+};
@@ -0,0 +1,235 @@
+#include "virtual_texture_file.h"
+#include "scene_format.h"
+#include "texture_cook.h"
+
+#include <max/max.h>
+#include <bimg/decode.h>
+#include <bx/file.h>
+
+#include <vector>
+
+#include <stdio.h>
+
+#define TG_VT_MAGIC BX_MAKEFOURCC('T', 'G', 'V', 'T')
+
+constexpr uint32_t kVirtualTextureVersion = 1; //!< Bump when layout changes, invalidates cache.
+
+/// Header of tiled virtual texture file, followed by pages.
+///
+struct VirtualTextureHeader
+{
+	uint32_t m_magic;    //!< TG_VT_MAGIC.
+	uint32_t m_version;  //!< kVirtualTextureVersion.
+	uint32_t m_size;     //!< Texels per side of top mip.
+	uint16_t m_pageSize; //!< Texels per side of page without border.
+	uint16_t m_border;   //!< Texels per side of page border.
+	uint8_t m_numMips;
+	uint8_t m_reserved[3];
+};
+
+static uint32_t calcPageBytes(const VirtualTextureDesc& _desc)
+{
+	const uint32_t size = _desc.m_pageSize + 2 * _desc.m_border;
+	return size * size * 4;
+}
+
+/// Get index of page in file.
+static uint64_t getPageIndex(const VirtualTextureDesc& _desc, uint32_t _page)
+{
+	uint64_t index = 0;
+	for (uint8_t mip = 0; mip < vtPageMip(_page); ++mip)
+	{
+		const uint64_t num = _desc.getNumPages(mip);
+		index += num * num;
+	}
+
+	return index + vtPageY(_page) * _desc.getNumPages(vtPageMip(_page) ) + vtPageX(_page);
+}
+
+bool VirtualTextureFile::open(const bx::FilePath& _filePath)
+{
+	close();
+
+	if (!m_file.open(_filePath) )
+	{
+		return false;
+	}
+
+	VirtualTextureHeader header;
+	bool result = m_file.m_size >= sizeof(header);
+
+	if (result)
+	{
+		bx::memCopy(&header, m_file.m_data, sizeof(header) );
+
+		m_desc.m_size = header.m_size;
+		m_desc.m_pageSize = header.m_pageSize;
+		m_desc.m_border = header.m_border;
+		m_desc.m_numMips = header.m_numMips;
+
+		result = TG_VT_MAGIC == header.m_magic
+			&& kVirtualTextureVersion == header.m_version
+			&& 0 != header.m_pageSize
+			&& 0 != header.m_numMips
+			&& 1 == m_desc.getNumPages(header.m_numMips - 1)
+			&& m_file.m_size >= sizeof(header) + getPageIndex(m_desc, vtPageId(header.m_numMips, 0, 0) ) * calcPageBytes(m_desc)
+			;
+	}
+
+	if (!result)
+	{
+		BX_TRACE("Invalid virtual texture %s", _filePath.getCPtr())
+		m_file.close();
+	}
+
+	return result;
+}
+
+void VirtualTextureFile::close()
+{
+	if (m_file.isOpen() )
+	{
+		m_file.close();
+	}
+}
+
+const uint8_t* VirtualTextureFile::getPage(uint32_t _page) const
+{
+	return m_file.m_data + sizeof(VirtualTextureHeader) + getPageIndex(m_desc, _page) * calcPageBytes(m_desc);
+}
+
+uint32_t VirtualTextureFile::getPageBytes() const
+{
+	return calcPageBytes(m_desc);
+}
+
+/// Write pages of source repeated over virtual texture.
+static bool cookVirtual(const MappedFile& _source, uint16_t _repeat, const bx::FilePath& _dst)
+{
+	bimg::ImageContainer* rgba = bimg::imageParse(max::getAllocator(), _source.m_data, uint32_t(_source.m_size), bimg::TextureFormat::RGBA8);
+	if (NULL == rgba)
+	{
+		return false;
+	}
+
+	const uint32_t srcSize = rgba->m_width;
+	const uint32_t size = srcSize * _repeat;
+
+	if (srcSize != rgba->m_height
+	||  !bx::isPowerOf2(srcSize)
+	||  !bx::isPowerOf2<uint32_t>(_repeat)
+	||  size < TG_CONFIG_VT_PAGE_SIZE
+	||  size / TG_CONFIG_VT_PAGE_SIZE > 4096)
+	{
+		BX_TRACE("Virtual texture source must be square and power of two.")
+		bimg::imageFree(rgba);
+		return false;
+	}
+
+	// Source mips, repeated by every virtual texture mip.
+	std::vector<std::vector<uint8_t> > mips(1);
+	const uint8_t* pixels = (const uint8_t*)rgba->m_data;
+	mips[0].assign(pixels, pixels + srcSize * srcSize * 4);
+	bimg::imageFree(rgba);
+
+	for (uint32_t mipSize = srcSize; 1 < mipSize; mipSize /= 2)
+	{
+		std::vector<uint8_t> mip( (mipSize / 2) * (mipSize / 2) * 4);
+		bimg::imageRgba8Downsample2x2(mip.data(), mipSize, mipSize, 1, mipSize * 4, mipSize / 2 * 4, mips.back().data() );
+		mips.push_back(std::move(mip) );
+	}
+
+	VirtualTextureHeader header;
+	bx::memSet(&header, 0, sizeof(header) );
+	header.m_magic = TG_VT_MAGIC;
+	header.m_version = kVirtualTextureVersion;
+	header.m_size = size;
+	header.m_pageSize = TG_CONFIG_VT_PAGE_SIZE;
+	header.m_border = TG_CONFIG_VT_PAGE_BORDER;
+	header.m_numMips = uint8_t(bx::uint32_cnttz(size / TG_CONFIG_VT_PAGE_SIZE) + 1);
+
+	const int32_t border = TG_CONFIG_VT_PAGE_BORDER;
+	const int32_t pageSize = TG_CONFIG_VT_PAGE_SIZE;
+	std::vector<uint8_t> page( (pageSize + 2 * border) * (pageSize + 2 * border) * 4);
+
+	// Write next to the cache entry and move into place, like cooked textures.
+	char tempPath[bx::kMaxFilePath];
+	bx::snprintf(tempPath, sizeof(tempPath), "%s.tmp", _dst.getCPtr() );
+
+	bx::Error err;
+	bx::FileWriter writer;
+	if (bx::open(&writer, tempPath, false, &err) )
+	{
+		bx::write(&writer, &header, sizeof(header), &err);
+
+		for (uint8_t mip = 0; mip < header.m_numMips && err.isOk(); ++mip)
+		{
+			const uint32_t level = bx::min<uint32_t>(mip, uint32_t(mips.size() - 1) );
+			const uint32_t levelSize = bx::max<uint32_t>(srcSize >> mip, 1);
+			const uint32_t mask = levelSize - 1;
+			const uint8_t* src = mips[level].data();
+
+			const int32_t numPages = int32_t( (size >> mip) / pageSize);
+			for (int32_t py = 0; py < numPages; ++py)
+			{
+				for (int32_t px = 0; px < numPages; ++px)
+				{
+					// Source repeats, borders wrap around the virtual texture as well.
+					uint32_t* dst = (uint32_t*)page.data();
+					for (int32_t yy = py * pageSize - border; yy < (py + 1) * pageSize + border; ++yy)
+					{
+						const uint32_t* row = (const uint32_t*)src + (uint32_t(yy) & mask) * levelSize;
+						for (int32_t xx = px * pageSize - border; xx < (px + 1) * pageSize + border; ++xx)
+						{
+							*dst++ = row[uint32_t(xx) & mask];
+						}
+					}
+
+					bx::write(&writer, page.data(), int32_t(page.size() ), &err);
+				}
+			}
+		}
+
+		bx::close(&writer);
+	}
+
+	if (!err.isOk() || 0 != rename(tempPath, _dst.getCPtr() ) )
+	{
+		BX_TRACE("Failed to write virtual texture %s", _dst.getCPtr())
+		bx::remove(tempPath);
+		return false;
+	}
+
+	return true;
+}
+
+bool virtualTextureCook(const char* _filePath, uint16_t _repeat, bx::FilePath& _outFilePath)
+{
+	MappedFile source;
+	if (!source.open(_filePath) )
+	{
+		BX_TRACE("Failed to open virtual texture source %s", _filePath)
+		return false;
+	}
+
+	// Cooked output depends on source, repeat and page layout.
+	const uint32_t layout = kVirtualTextureVersion ^ uint32_t(_repeat) << 8 ^ TG_CONFIG_VT_PAGE_SIZE << 16 ^ TG_CONFIG_VT_PAGE_BORDER << 28;
+	const uint32_t hashLo = sceneChecksum(source.m_data, source.m_size, layout);
+	const uint32_t hashHi = sceneChecksum(source.m_data, source.m_size, ~layout);
+
+	char cookedPath[bx::kMaxFilePath];
+	bx::snprintf(cookedPath, sizeof(cookedPath), "%s/%08x%08x.vt", TG_CONFIG_TEXTURE_CACHE_DIR, hashHi, hashLo);
+	_outFilePath.set(cookedPath);
+
+	bx::FileInfo info;
+	bool result = bx::stat(info, _outFilePath) && 0 != info.size;
+
+	if (!result)
+	{
+		bx::makeAll(_outFilePath.getPath() );
+		result = cookVirtual(source, _repeat, _outFilePath);
+	}
+
+	source.close();
+	return result;
+}
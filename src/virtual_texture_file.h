@@ -0,0 +1,48 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "virtual_texture.h"
+
+/// Tiled virtual texture file, pages are stored one after another with their border, mip by
+/// mip and row by row. Pages are read straight from the mapped file.
+///
+struct VirtualTextureFile
+{
+	/// Map file, see `virtualTextureCook`.
+	///
+	/// @returns True if file is a valid virtual texture.
+	///
+	bool open(const bx::FilePath& _filePath);
+
+	void close();
+
+	bool isOpen() const
+	{
+		return m_file.isOpen();
+	}
+
+	/// Get RGBA8 texels of page including its border.
+	///
+	const uint8_t* getPage(uint32_t _page) const;
+
+	/// Get bytes per page.
+	///
+	uint32_t getPageBytes() const;
+
+	VirtualTextureDesc m_desc;
+
+private:
+	MappedFile m_file;
+};
+
+/// Get tiled virtual texture of source texture repeated over a grid, cooked on a cache miss.
+/// Virtual texture is the source repeated `_repeat` times per side, mips are repeated source
+/// mips. Pages are RGBA8 with TG_CONFIG_VT_PAGE_SIZE and TG_CONFIG_VT_PAGE_BORDER.
+///
+/// @param[in] _filePath Path to square power of two source texture.
+/// @param[in] _repeat Power of two repeat count per side, 1 for a unique texture.
+/// @param[out] _outFilePath Path to cooked virtual texture.
+///
+/// @returns True if a cooked virtual texture was found or created.
+///
+bool virtualTextureCook(const char* _filePath, uint16_t _repeat, bx::FilePath& _outFilePath);
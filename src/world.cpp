@@ -1,8 +1,15 @@
 #include "world.h"
 #include "components.h"
 
-#include <bx/readerwriter.h>
+#include "scene_format.h"
+#include "string_pool.h"
+#include "texture_cook.h"
+
 #include <bx/file.h>
+#include <bx/timer.h>
+
+#include <deque>
+#include <vector>
 
 void World::load(const char* _filepath)
 {
@@ -11,339 +18,1002 @@ void World::load(const char* _filepath)
 	deserialize();
 }
 
+bool World::loadAsync(const char* _filepath, float _budgetMs)
+{
+	if (_filepath != m_filepath)
+	{
+		bx::strCopy(m_filepath, 1024, _filepath);
+	}
+
+	m_loadBudgetMs = _budgetMs;
+
+	// Verifying reads the whole file before the first entity appears, left out by default.
+	return beginDeserialize(m_verify && m_verifyAsync);
+}
+
 void World::unload()
 {
-	if (m_entities.size() <= 0)
+	// Entities created so far are destroyed below like any other.
+	if (m_loader.isActive())
 	{
-		return;
+		m_loader.end();
+		m_loaderMeshes.clear();
 	}
 
+	// World no longer matches the scene on disk.
+	m_baseUid = 0;
+	m_deltaSize = 0;
+	m_dirty.clear();
+	m_removed.clear();
+
 	for (auto it = m_entities.begin(); it != m_entities.end(); ++it)
 	{
 		if (isValid(it->second.m_handle))
 		{
-			if (RenderComponent* rc = max::getComponent<RenderComponent>(it->second.m_handle))
+			destroyEntity(it->second.m_handle);
+			it->second.m_handle = MAX_INVALID_HANDLE;
+		}
+	}
+
+	m_entities.clear();
+	m_textureUsers.clear();
+
+	if (m_defaultTextures)
+	{
+		defaultTexturesRelease();
+		m_defaultTextures = false;
+	}
+}
+
+void World::destroyEntity(max::EntityHandle _entity)
+{
+	if (RenderComponent* rc = max::getComponent<RenderComponent>(_entity))
+	{
+		releaseMesh(rc->m_mesh);
+		rc->m_mesh = MAX_INVALID_HANDLE;
+	}
+	if (MaterialComponent* mc = max::getComponent<MaterialComponent>(_entity))
+	{
+		// Textures still being decoded hold a reference as well.
+		unloadMaterial(_entity, *mc);
+	}
+	max::destroy(_entity);
+}
+
+void World::loadMaterial(max::EntityHandle _entity, MaterialComponent& _material)
+{
+	loadTexture(_entity, _material.m_diffuse, TextureUsage::Color, m_asyncTextures);
+	loadTexture(_entity, _material.m_normal, TextureUsage::Normal, m_asyncTextures);
+#if TG_CONFIG_SURFACE_TEXTURE
+	// Roughness and metallic are packed into one.
+	_material.m_surface.m_filepath = textureSurfacePath(_material.m_roughness.m_filepath, _material.m_metallic.m_filepath);
+	loadTexture(_entity, _material.m_surface, TextureUsage::Linear, m_asyncTextures);
+#else
+	_material.m_surface = { MAX_INVALID_HANDLE, "" };
+	loadTexture(_entity, _material.m_roughness, TextureUsage::Linear, m_asyncTextures);
+	loadTexture(_entity, _material.m_metallic, TextureUsage::Linear, m_asyncTextures);
+#endif // TG_CONFIG_SURFACE_TEXTURE
+}
+
+void World::unloadMaterial(max::EntityHandle _entity, MaterialComponent& _material)
+{
+	unloadTexture(_entity, _material.m_diffuse);
+	unloadTexture(_entity, _material.m_normal);
+#if TG_CONFIG_SURFACE_TEXTURE
+	unloadTexture(_entity, _material.m_surface);
+#else
+	unloadTexture(_entity, _material.m_roughness);
+	unloadTexture(_entity, _material.m_metallic);
+#endif // TG_CONFIG_SURFACE_TEXTURE
+}
+
+void World::loadTexture(max::EntityHandle _entity, MaterialComponent::Texture& _texture, TextureUsage::Enum _usage, bool _async)
+{
+	_texture.m_texture = MAX_INVALID_HANDLE;
+
+	if (bx::strCmp(_texture.m_filepath, "") == bx::kExitSuccess)
+	{
+		return;
+	}
+
+	_texture.m_texture = _async
+		? m_textureManager.loadAsync(_texture.m_filepath, _usage)
+		: m_textureManager.load(_texture.m_filepath, _usage)
+		;
+
+	if (!isValid(_texture.m_texture))
+	{
+		if (!m_defaultTextures)
+		{
+			defaultTexturesAcquire();
+			m_defaultTextures = true;
+		}
+
+		_texture.m_texture = defaultTextureGet(TextureUsage::Normal == _usage ? DefaultTexture::Normal : DefaultTexture::White);
+	}
+
+	m_textureUsers[_texture.m_filepath].push_back(_entity);
+}
+
+void World::unloadTexture(max::EntityHandle _entity, MaterialComponent::Texture& _texture)
+{
+	m_textureManager.unload(_texture.m_filepath);
+	_texture.m_texture = MAX_INVALID_HANDLE;
+
+	auto it = m_textureUsers.find(_texture.m_filepath);
+	if (it == m_textureUsers.end())
+	{
+		return;
+	}
+
+	std::vector<max::EntityHandle>& users = it->second;
+	for (uint32_t ii = 0; ii < users.size(); ++ii)
+	{
+		if (users[ii].idx == _entity.idx)
+		{
+			users[ii] = users.back();
+			users.pop_back();
+			break;
+		}
+	}
+
+	if (users.empty())
+	{
+		m_textureUsers.erase(it);
+	}
+}
+
+void World::markDirty(const std::string& _name, uint32_t _flags)
+{
+	m_removed.erase(_name);
+	m_dirty[_name] |= _flags;
+}
+
+void World::markRemoved(const std::string& _name)
+{
+	m_dirty.erase(_name);
+	m_removed.insert(_name);
+}
+
+void World::acquireMesh(max::MeshHandle _mesh)
+{
+	++m_meshRefs[_mesh.idx];
+}
+
+void World::releaseMesh(max::MeshHandle _mesh)
+{
+	auto it = m_meshRefs.find(_mesh.idx);
+	if (it != m_meshRefs.end())
+	{
+		if (--it->second > 0)
+		{
+			return;
+		}
+
+		m_meshRefs.erase(it);
+	}
+
+	m_meshBounds.erase(_mesh.idx);
+	max::destroy(_mesh);
+}
+
+void World::update()
+{
+	m_textureUploads.clear();
+	if (0 != m_textureManager.update(m_textureUploads))
+	{
+		bindTextures(m_textureUploads);
+	}
+
+	if (!m_loader.isActive())
+	{
+		return;
+	}
+
+	const int64_t deadline = bx::getHPCounter() + int64_t(m_loadBudgetMs * 0.001 * bx::getHPFrequency());
+	createEntities(UINT32_MAX, deadline);
+
+	if (m_loader.isDone())
+	{
+		endDeserialize();
+	}
+}
+
+void World::bindTextures(const std::vector<TextureUpload>& _uploaded)
+{
+	// Paths are interned, equal paths share a pointer.
+	for (const TextureUpload& upload : _uploaded)
+	{
+		auto users = m_textureUsers.find(upload.m_filepath);
+		if (users == m_textureUsers.end())
+		{
+			continue;
+		}
+
+		for (max::EntityHandle entity : users->second)
+		{
+			MaterialComponent* mc = max::getComponent<MaterialComponent>(entity);
+			if (NULL == mc)
 			{
-				max::destroy(rc->m_mesh);
-				rc->m_mesh = MAX_INVALID_HANDLE;
+				continue;
 			}
-			if (MaterialComponent* mc = max::getComponent<MaterialComponent>(it->second.m_handle))
+
+			MaterialComponent::Texture* textures[] = { &mc->m_diffuse, &mc->m_normal, &mc->m_roughness, &mc->m_metallic, &mc->m_surface };
+			for (uint32_t ii = 0; ii < BX_COUNTOF(textures); ++ii)
 			{
-				if (isValid(mc->m_diffuse.m_texture))
+				if (textures[ii]->m_filepath == upload.m_filepath)
 				{
-					m_textureManager.unload(mc->m_diffuse.m_filepath);
-					mc->m_diffuse.m_texture = MAX_INVALID_HANDLE;
+					textures[ii]->m_texture = upload.m_texture;
 				}
+			}
+		}
+	}
+}
 
-				if (isValid(mc->m_normal.m_texture))
-				{
-					m_textureManager.unload(mc->m_normal.m_filepath);
-					mc->m_normal.m_texture = MAX_INVALID_HANDLE;
-				}
+const MeshBounds& World::getMeshBounds(max::MeshHandle _mesh)
+{
+	auto it = m_meshBounds.find(_mesh.idx);
+	if (it == m_meshBounds.end())
+	{
+		MeshBounds bounds;
+		if (!cullingComputeBounds(_mesh, bounds))
+		{
+			BX_TRACE("Mesh %d has no vertices, it is never culled.", _mesh.idx)
+		}
 
-				if (isValid(mc->m_roughness.m_texture))
-				{
-					m_textureManager.unload(mc->m_roughness.m_filepath);
-					mc->m_roughness.m_texture = MAX_INVALID_HANDLE;
-				}
+		it = m_meshBounds.insert({ _mesh.idx, bounds }).first;
+	}
 
-				if (isValid(mc->m_metallic.m_texture))
+	return it->second;
+}
+
+void World::streamTextures(uint32_t _cameraIdx, float _viewportHeight)
+{
+	struct Camera
+	{
+		uint32_t m_idx;
+		const CameraComponent* m_camera;
+	};
+
+	Camera camera = { _cameraIdx, NULL };
+
+	max::System<CameraComponent> cameras;
+	cameras.each(10, [](max::EntityHandle _entity, void* _userData)
+	{
+		Camera* camera = (Camera*)_userData;
+
+		const CameraComponent* cc = max::getComponent<CameraComponent>(_entity);
+		if (cc->m_idx == camera->m_idx)
+		{
+			camera->m_camera = cc;
+		}
+
+	}, &camera);
+
+	if (NULL != camera.m_camera)
+	{
+		// Pixels per world unit at distance 1, texture assumed to span the mesh.
+		const float pixelsPerUnit = _viewportHeight / bx::tan(bx::toRad(camera.m_camera->m_fov) * 0.5f);
+
+		// Streamed textures only, each asks the entities using it.
+		for (uint32_t idx : m_textureManager.getStreamed() )
+		{
+			auto it = m_textureUsers.find(m_textureManager.m_textures.getPath(idx) );
+			if (it == m_textureUsers.end() )
+			{
+				continue;
+			}
+
+			float screenSize = 0.0f;
+
+			for (max::EntityHandle entity : it->second)
+			{
+				const TransformComponent* tc = max::getComponent<TransformComponent>(entity);
+				const RenderComponent* rc = max::getComponent<RenderComponent>(entity);
+				if (NULL == tc || NULL == rc || !isValid(rc->m_mesh)
+				||  FLT_MAX == rc->m_bounds.m_radius)
 				{
-					m_textureManager.unload(mc->m_metallic.m_filepath);
-					mc->m_metallic.m_texture = MAX_INVALID_HANDLE;
+					continue;
 				}
+
+				// Sphere around mesh origin enclosing its bounding sphere.
+				const float* center = rc->m_bounds.m_center;
+				const float offset = bx::length(bx::Vec3(center[0], center[1], center[2]) );
+				const float scale = bx::max(bx::abs(tc->m_scale.x), bx::abs(tc->m_scale.y), bx::abs(tc->m_scale.z));
+				const float radius = (offset + rc->m_bounds.m_radius) * scale;
+				const float distance = bx::max(bx::length(bx::sub(tc->m_position, camera.m_camera->m_position)), radius, 0.001f);
+				screenSize = bx::max(screenSize, radius * pixelsPerUnit / distance);
 			}
-			max::destroy(it->second.m_handle);
-			it->second.m_handle = MAX_INVALID_HANDLE;
+
+			m_textureManager.request(idx, screenSize);
 		}
 	}
 
-	m_entities.clear();
+	m_textureManager.stream();
 }
 
-void World::update()
+/// Groups of a mesh merged into one vertex and one index blob.
+///
+struct MergedGeometry
 {
-	
-}
+	std::vector<uint8_t> m_vertices;
+	std::vector<uint32_t> m_indices;
+};
 
-// @todo Right now we serialize all meshes as unique. Use hashes to detect identical meshes and only serialize one.
-bool World::serialize()
+/// Tables shared by all entities written in one save.
+///
+struct SerializeContext
 {
-	bx::Error err;
-	bx::FileWriter writer;
+	SerializeContext(bool _dedup)
+	{
+		m_meshes.m_dedup = _dedup;
+	}
 
-	bx::FilePath filepath = m_filepath;
+	SceneStringTable m_strings;
+
+	// Entities sharing a mesh handle skip hashing, the rest are deduplicated by content.
+	SceneMeshTable m_meshes;
+	std::unordered_map<uint16_t, uint32_t> m_meshIndices;
 
-	bx::remove(filepath);
-	bx::makeAll(filepath.getPath());
+	// Referenced by mesh table until written, deque keeps elements in place.
+	std::deque<MergedGeometry> m_merged;
+};
 
-	if (bx::open(&writer, filepath, &err))
+static void mergeGroups(MergedGeometry& _out, const max::MeshQuery* _query, const max::VertexLayout& _layout)
+{
+	uint32_t numVertices = 0;
+	uint32_t numIndices = 0;
+	for (uint32_t ii = 0; ii < _query->m_num; ++ii)
 	{
-		// 
-		uint32_t numEntities = (uint32_t)m_entities.size();
-		if (numEntities <= 0)
+		numVertices += _query->m_data[ii].m_numVertices;
+		numIndices += _query->m_data[ii].m_numIndices;
+	}
+
+	_out.m_vertices.resize(_layout.getSize(numVertices));
+	_out.m_indices.resize(numIndices);
+
+	uint32_t firstVertex = 0;
+	uint32_t firstIndex = 0;
+	for (uint32_t ii = 0; ii < _query->m_num; ++ii)
+	{
+		const max::MeshQuery::Data& data = _query->m_data[ii];
+
+		bx::memCopy(&_out.m_vertices[_layout.getSize(firstVertex)], data.m_vertices, _layout.getSize(data.m_numVertices));
+
+		// Group indices are relative to their own vertices.
+		const uint32_t* indices = (const uint32_t*)data.m_indices;
+		for (uint32_t jj = 0; jj < data.m_numIndices; ++jj)
 		{
-			bx::close(&writer);
-			return false;
+			_out.m_indices[firstIndex + jj] = indices[jj] + firstVertex;
 		}
 
-		bx::write(&writer, &numEntities, sizeof(uint32_t), &err);
+		firstVertex += data.m_numVertices;
+		firstIndex += data.m_numIndices;
+	}
+}
+
+static void serializeEntity(SerializeContext& _ctx, SceneEntity& _entity, const std::string& _name, max::EntityHandle _handle, uint32_t _flags)
+{
+	bx::memSet(&_entity, 0, sizeof(SceneEntity));
+	_entity.m_name = _ctx.m_strings.add(_name.c_str());
+
+	// Transform Component
+	TransformComponent* tc = max::getComponent<TransformComponent>(_handle);
+	if (NULL != tc && 0 != (_flags & SceneEntity::Transform))
+	{
+		_entity.m_flags |= SceneEntity::Transform;
+		bx::memCopy(_entity.m_position, &tc->m_position.x, sizeof(float) * 3);
+		bx::memCopy(_entity.m_rotation, &tc->m_rotation.x, sizeof(float) * 4);
+		bx::memCopy(_entity.m_scale, &tc->m_scale.x, sizeof(float) * 3);
+	}
+
+	// Render Component
+	RenderComponent* rc = max::getComponent<RenderComponent>(_handle);
+	if (NULL != rc && 0 != (_flags & SceneEntity::Render))
+	{
+		_entity.m_flags |= SceneEntity::Render;
 
-		for (auto it = m_entities.begin(); it != m_entities.end(); ++it)
+		auto cached = _ctx.m_meshIndices.find(rc->m_mesh.idx);
+		if (_ctx.m_meshes.m_dedup
+		&&  cached != _ctx.m_meshIndices.end())
+		{
+			_entity.m_mesh = cached->second;
+		}
+		else
 		{
-			char name[1024];
-			bx::strCopy(name, 1024, it->first.c_str());
-			bx::write(&writer, &name, 1024, &err);
+			// Mesh
+			max::MeshQuery* query = max::queryMesh(rc->m_mesh);
+			max::VertexLayout layout = max::getLayout(rc->m_mesh);
 
-			// Transform Component
-			TransformComponent* tc = max::getComponent<TransformComponent>(it->second.m_handle);
-			bool hasTransformComponent = tc != NULL;
-			bx::write(&writer, &hasTransformComponent, sizeof(bool), &err);
-			if (hasTransformComponent)
+			SceneMesh mesh;
+			bx::memSet(&mesh, 0, sizeof(SceneMesh));
+			mesh.m_layoutHash = layout.m_hash;
+			mesh.m_stride = layout.m_stride;
+			bx::memCopy(mesh.m_offset, layout.m_offset, sizeof(uint16_t) * max::Attrib::Count);
+			bx::memCopy(mesh.m_attributes, layout.m_attributes, sizeof(uint16_t) * max::Attrib::Count);
+
+			SceneGeometry geometry;
+			bx::memSet(&geometry, 0, sizeof(SceneGeometry));
+
+			if (1 == query->m_num)
 			{
-				bx::write(&writer, &tc->m_position, sizeof(bx::Vec3), &err);
-				bx::write(&writer, &tc->m_rotation, sizeof(bx::Quaternion), &err);
-				bx::write(&writer, &tc->m_scale, sizeof(bx::Vec3), &err);
+				max::MeshQuery::Data& data = query->m_data[0];
+				geometry.m_vertices = data.m_vertices;
+				geometry.m_verticesSize = layout.getSize(data.m_numVertices);
+				geometry.m_indices = data.m_indices;
+				geometry.m_indicesSize = data.m_numIndices * sizeof(uint32_t);
 			}
-			
-			// Render Component
-			RenderComponent* rc = max::getComponent<RenderComponent>(it->second.m_handle);
-			bool hasRenderComponent = rc != NULL;
-			bx::write(&writer, &hasRenderComponent, sizeof(bool), &err);
-			if (hasRenderComponent)
+			else if (1 < query->m_num)
 			{
-				// Mesh
-				max::MeshQuery* query = max::queryMesh(rc->m_mesh);
+				_ctx.m_merged.emplace_back();
+				MergedGeometry& merged = _ctx.m_merged.back();
+				mergeGroups(merged, query, layout);
+
+				geometry.m_vertices = merged.m_vertices.data();
+				geometry.m_verticesSize = uint32_t(merged.m_vertices.size());
+				geometry.m_indices = merged.m_indices.data();
+				geometry.m_indicesSize = uint32_t(merged.m_indices.size() * sizeof(uint32_t));
+			}
 
-				uint32_t num = query->m_num;
-				bx::write(&writer, &num, sizeof(uint32_t), &err);
-				BX_ASSERT(num <= 1, "Serialization of meshes with multiple groups not supported.")
+			_entity.m_mesh = _ctx.m_meshes.add(mesh, geometry);
+			_ctx.m_meshIndices[rc->m_mesh.idx] = _entity.m_mesh;
+		}
+	}
 
-				max::VertexLayout layout = max::getLayout(rc->m_mesh);
-				bx::write(&writer, &layout.m_hash, sizeof(uint32_t), &err);
-				bx::write(&writer, &layout.m_stride, sizeof(uint16_t), &err);
-				bx::write(&writer, &layout.m_offset, sizeof(uint16_t) * max::Attrib::Count, &err);
-				bx::write(&writer, &layout.m_attributes, sizeof(uint16_t) * max::Attrib::Count, &err);
+	// Material Component
+	MaterialComponent* mc = max::getComponent<MaterialComponent>(_handle);
+	if (NULL != mc && 0 != (_flags & SceneEntity::Material))
+	{
+		_entity.m_flags |= SceneEntity::Material;
+
+		// Textures
+		_entity.m_material.m_diffuse = _ctx.m_strings.add(mc->m_diffuse.m_filepath);
+		_entity.m_material.m_normal = _ctx.m_strings.add(mc->m_normal.m_filepath);
+		_entity.m_material.m_roughness = _ctx.m_strings.add(mc->m_roughness.m_filepath);
+		_entity.m_material.m_metallic = _ctx.m_strings.add(mc->m_metallic.m_filepath);
+
+		// Factors
+		bx::memCopy(_entity.m_material.m_diffuseFactor, mc->m_diffuseFactor, sizeof(float) * 3);
+		bx::memCopy(_entity.m_material.m_normalFactor, mc->m_normalFactor, sizeof(float) * 3);
+		_entity.m_material.m_roughnessFactor = mc->m_roughnessFactor;
+		_entity.m_material.m_metallicFactor = mc->m_metallicFactor;
+	}
+}
 
-				max::MeshQuery::Data& data = query->m_data[0];
+bool World::serialize()
+{
+	bx::FilePath filepath = m_filepath;
 
-				uint32_t verticesSize = layout.getSize(data.m_numVertices);
-				bx::write(&writer, &verticesSize, sizeof(uint32_t), &err);
-				bx::write(&writer, data.m_vertices, verticesSize, &err);
+	if (m_loader.isActive())
+	{
+		BX_TRACE("Can't serialize %s while it is being loaded.", filepath.getCPtr())
+		return false;
+	}
 
-				uint32_t indicesSize = data.m_numIndices * sizeof(uint32_t);
-				bx::write(&writer, &indicesSize, sizeof(uint32_t), &err);
-				bx::write(&writer, data.m_indices, indicesSize, &err);
-			}
+	// Compact once replaying the log would cost a good part of loading the scene itself.
+	if (0 != m_baseUid
+	&&  m_deltaSize <= uint64_t(double(m_baseSize) * TG_CONFIG_SCENE_DELTA_RATIO))
+	{
+		return serializeDelta();
+	}
 
-			// Material Component
-			MaterialComponent* mc = max::getComponent<MaterialComponent>(it->second.m_handle);
-			bool hasMaterialComponent = mc != NULL;
-			bx::write(&writer, &hasMaterialComponent, sizeof(bool), &err);
-			if (hasMaterialComponent)
-			{
-				// Textures
-				bool hasColor = bx::strCmp(mc->m_diffuse.m_filepath, "") != bx::kExitSuccess;
-				bx::write(&writer, &hasColor, sizeof(bool), &err);
-				if (hasColor)
-				{
-					bx::write(&writer, mc->m_diffuse.m_filepath, 1024, &err);
-				}
+	return serializeFull();
+}
 
-				bool hasNormal = bx::strCmp(mc->m_normal.m_filepath, "") != bx::kExitSuccess;
-				bx::write(&writer, &hasNormal, sizeof(bool), &err);
-				if (hasNormal)
-				{
-					bx::write(&writer, mc->m_normal.m_filepath, 1024, &err);
-				}
+bool World::serializeFull()
+{
+	bx::FilePath filepath = m_filepath;
 
-				bool hasRoughness = bx::strCmp(mc->m_roughness.m_filepath, "") != bx::kExitSuccess;
-				bx::write(&writer, &hasRoughness, sizeof(bool), &err);
-				if (hasRoughness)
-				{
-					bx::write(&writer, mc->m_roughness.m_filepath, 1024, &err);
-				}
+	uint32_t numEntities = (uint32_t)m_entities.size();
+	if (numEntities <= 0)
+	{
+		return false;
+	}
 
-				bool hasMetallic = bx::strCmp(mc->m_metallic.m_filepath, "") != bx::kExitSuccess;
-				bx::write(&writer, &hasMetallic, sizeof(bool), &err);
-				if (hasMetallic)
-				{
-					bx::write(&writer, mc->m_metallic.m_filepath, 1024, &err);
-				}
+	std::vector<SceneEntity> entities(numEntities);
 
-				// Factors 
-				bx::write(&writer, &mc->m_diffuseFactor, sizeof(float) * 3, &err);
-				bx::write(&writer, &mc->m_normalFactor, sizeof(float) * 3, &err);
-				bx::write(&writer, &mc->m_roughnessFactor, sizeof(float), &err);
-				bx::write(&writer, &mc->m_metallicFactor, sizeof(float), &err);
-			}
+	SerializeContext ctx(m_dedupMeshes);
+
+	uint32_t index = 0;
+	for (auto it = m_entities.begin(); it != m_entities.end(); ++it, ++index)
+	{
+		serializeEntity(ctx, entities[index], it->first, it->second.m_handle, UINT32_MAX);
+	}
+
+	const uint64_t uid = sceneCreateUid();
+	if (!sceneWrite(filepath, entities.data(), numEntities, ctx.m_meshes, ctx.m_strings, uid, m_compression))
+	{
+		BX_TRACE("Failed to serialize file to path %s", filepath.getCPtr())
+		return false;
+	}
+
+	bx::FileInfo info;
+	bx::stat(info, filepath);
+
+	m_baseUid = uid;
+	m_baseSize = info.size;
+	m_deltaSize = 0;
+	m_dirty.clear();
+	m_removed.clear();
+
+	BX_TRACE("Scene serialized to %s", filepath.getCPtr());
+	return true;
+}
+
+bool World::serializeDelta()
+{
+	bx::FilePath filepath = m_filepath;
+
+	if (m_dirty.empty() && m_removed.empty())
+	{
+		return true;
+	}
+
+	std::vector<SceneEntity> entities;
+	entities.reserve(m_dirty.size());
+
+	SerializeContext ctx(m_dedupMeshes);
+
+	for (auto it = m_dirty.begin(); it != m_dirty.end(); ++it)
+	{
+		auto entity = m_entities.find(it->first);
+		if (entity != m_entities.end() && isValid(entity->second.m_handle))
+		{
+			entities.emplace_back();
+			serializeEntity(ctx, entities.back(), it->first, entity->second.m_handle, it->second);
 		}
+	}
+
+	std::vector<uint32_t> removed;
+	removed.reserve(m_removed.size());
+
+	for (const std::string& name : m_removed)
+	{
+		removed.push_back(ctx.m_strings.add(name.c_str()));
+	}
+
+	// Blocks appended so far are gone if the log was deleted or truncated, only a full save
+	// still captures them.
+	bx::FileInfo info;
+	if (0 != m_deltaSize
+	&&  (!bx::stat(info, sceneDeltaPath(filepath) ) || info.size != m_deltaSize) )
+	{
+		BX_TRACE("Delta log of %s changed on disk, saving whole scene.", filepath.getCPtr())
+		m_deltaSize = 0;
+		return serializeFull();
+	}
 
-		if (!err.isOk())
+	if (!sceneAppendDelta(sceneDeltaPath(filepath), m_baseUid, m_deltaSize
+		, entities.data(), (uint32_t)entities.size()
+		, removed.data(), (uint32_t)removed.size()
+		, ctx.m_meshes, ctx.m_strings, m_compression
+		))
+	{
+		BX_TRACE("Failed to append delta for %s", filepath.getCPtr())
+		return false;
+	}
+
+	m_dirty.clear();
+	m_removed.clear();
+
+	BX_TRACE("Scene delta appended to %s", filepath.getCPtr());
+	return true;
+}
+
+static void releaseDecoded(void* _ptr, void* _userData)
+{
+	BX_UNUSED(_userData);
+	bx::free(max::getAllocator(), _ptr);
+}
+
+static const max::Memory* takeDecoded(void*& _data, uint32_t _size)
+{
+	if (NULL == _data)
+	{
+		return NULL;
+	}
+
+	const max::Memory* mem = max::makeRef(_data, _size, releaseDecoded, NULL);
+	_data = NULL;
+
+	return mem;
+}
+
+bool World::deserialize()
+{
+	if (!beginDeserialize(m_verify))
+	{
+		return false;
+	}
+
+	while (!m_loader.isDone())
+	{
+		if (0 == createEntities(kSceneLoadChunkSize))
+		{
+			m_loader.wait();
+		}
+	}
+
+	return endDeserialize();
+}
+
+bool World::beginDeserialize(bool _verify)
+{
+	bx::FilePath filepath = m_filepath;
+
+	SceneFile* scene = SceneFile::open(filepath);
+	if (NULL == scene)
+	{
+		// Scenes written with the legacy stream layout are converted once to a file next to
+		// them, the legacy scene is left as is. Saving writes the current layout to filepath.
+		const bx::FilePath converted = sceneConvertedPath(filepath);
+
+		FileStamp source;
+		FileStamp stamp;
+		if (fileGetStamp(filepath, source)
+		&&  fileGetStamp(converted, stamp)
+		&&  stamp.m_mtime >= source.m_mtime)
+		{
+			scene = SceneFile::open(converted);
+		}
+
+		if (NULL == scene
+		&&  sceneConvertLegacy(filepath, converted) )
 		{
-			BX_TRACE("Failed to serialize file to path %s", filepath.getCPtr())
+			scene = SceneFile::open(converted);
+		}
+
+		if (NULL == scene)
+		{
+			BX_TRACE("Failed to open file at path %s", filepath.getCPtr())
 			return false;
 		}
+	}
 
-		bx::close(&writer);
-		BX_TRACE("Scene serialized to %s", filepath.getCPtr());
-		return true;
+	// Fast path trusts contents, header and bounds were checked by open.
+	if (_verify && !scene->verify())
+	{
+		BX_TRACE("Scene at path %s is corrupt", filepath.getCPtr())
+		scene->release();
+		return false;
 	}
-		
-	BX_TRACE("Failed to open file at path %s", filepath.getCPtr())
-	return false;
+
+	// Each unique mesh is created once on first use and shared by all referencing entities.
+	max::MeshHandle invalidMesh = MAX_INVALID_HANDLE;
+	m_loaderMeshes.assign(scene->getHeader()->m_numMeshes, invalidMesh);
+	m_loaderResult = true;
+
+	m_baseUid = scene->getHeader()->m_uid;
+	m_baseSize = scene->m_file.m_size;
+	m_deltaSize = 0;
+	m_dirty.clear();
+	m_removed.clear();
+
+	m_loader.begin(scene);
+
+	// Loader holds its own reference.
+	scene->release();
+
+	return true;
 }
 
-bool World::deserialize()
+bool World::endDeserialize()
 {
-	bx::Error err;
-	bx::FileReader reader;
+	bx::FilePath filepath = m_filepath;
+
+	m_loader.end();
+	m_loaderMeshes.clear();
+
+	replayDelta();
+
+	if (!m_loaderResult || m_entities.size() <= 0)
+	{
+		BX_TRACE("Failed to deserialize file at path %s", filepath.getCPtr())
+		return false;
+	}
+
+	BX_TRACE("Scene deserialized from %s", filepath.getCPtr());
+	return true;
+}
 
+static max::MeshHandle createDeltaMesh(const SceneDeltaBlock* _block, const SceneMesh& _mesh)
+{
+	const SceneSectionDesc& geometry = _block->m_sections[SceneSection::Geometry];
+
+	const bool valid = true
+		&& 0 != _mesh.m_verticesSize
+		&& 0 != _mesh.m_indicesSize
+		&& _mesh.m_verticesOffset <= geometry.m_size
+		&& _mesh.m_verticesStoredSize <= geometry.m_size - _mesh.m_verticesOffset
+		&& _mesh.m_indicesOffset <= geometry.m_size
+		&& _mesh.m_indicesStoredSize <= geometry.m_size - _mesh.m_indicesOffset
+		;
+
+	const uint8_t* data = SceneDeltaFile::getSection(_block, geometry);
+
+	void* decodedVertices;
+	void* decodedIndices;
+	if (!valid || !sceneDecodeMesh(_mesh, data, decodedVertices, decodedIndices))
+	{
+		return MAX_INVALID_HANDLE;
+	}
+
+	max::VertexLayout layout;
+	layout.m_hash = _mesh.m_layoutHash;
+	layout.m_stride = _mesh.m_stride;
+	bx::memCopy(layout.m_offset, _mesh.m_offset, sizeof(uint16_t) * max::Attrib::Count);
+	bx::memCopy(layout.m_attributes, _mesh.m_attributes, sizeof(uint16_t) * max::Attrib::Count);
+
+	// Log is unmapped after replay, uncompressed geometry is copied.
+	const max::Memory* vertices = takeDecoded(decodedVertices, _mesh.m_verticesSize);
+	if (NULL == vertices)
+	{
+		vertices = max::copy(data + _mesh.m_verticesOffset, _mesh.m_verticesSize);
+	}
+
+	const max::Memory* indices = takeDecoded(decodedIndices, _mesh.m_indicesSize);
+	if (NULL == indices)
+	{
+		indices = max::copy(data + _mesh.m_indicesOffset, _mesh.m_indicesSize);
+	}
+
+	return max::createMesh(vertices, indices, layout);
+}
+
+void World::replayDelta()
+{
 	bx::FilePath filepath = m_filepath;
 
-	if (bx::open(&reader, filepath, &err))
+	SceneDeltaFile delta;
+	if (!delta.open(sceneDeltaPath(filepath), m_baseUid))
 	{
-		// 
-		uint32_t numEntities = 0;
-		bx::read(&reader, &numEntities, sizeof(uint32_t), &err);
+		return;
+	}
 
-		for (uint32_t ii = 0; ii < numEntities; ++ii)
+	uint32_t numBlocks = 0;
+	while (const SceneDeltaBlock* block = delta.next())
+	{
+		// Removed entities.
+		const uint32_t* removed = (const uint32_t*)SceneDeltaFile::getSection(block, block->m_removed);
+		for (uint32_t ii = 0; ii < block->m_numRemoved; ++ii)
 		{
-			max::EntityHandle entity = max::createEntity();
+			auto it = m_entities.find(SceneDeltaFile::getString(block, removed[ii]));
+			if (it != m_entities.end())
+			{
+				if (isValid(it->second.m_handle))
+				{
+					destroyEntity(it->second.m_handle);
+				}
+				m_entities.erase(it);
+			}
+		}
+
+		// Added or changed entities, only components present in the record changed.
+		const SceneEntity* entities = (const SceneEntity*)SceneDeltaFile::getSection(block, block->m_sections[SceneSection::Entities]);
+		const SceneMesh* meshes = (const SceneMesh*)SceneDeltaFile::getSection(block, block->m_sections[SceneSection::Meshes]);
 
-			char name[1024];
-			bx::read(&reader, &name, 1024, &err);
-			BX_ASSERT(bx::strCmp(name, "") != bx::kExitSuccess, "Trying to create entity with invalid name.")
+		max::MeshHandle invalidMesh = MAX_INVALID_HANDLE;
+		std::vector<max::MeshHandle> meshHandles(block->m_numMeshes, invalidMesh);
+
+		for (uint32_t ii = 0; ii < block->m_numEntities; ++ii)
+		{
+			const SceneEntity& se = entities[ii];
+			const char* name = SceneDeltaFile::getString(block, se.m_name);
+
+			max::EntityHandle& entity = m_entities[name].m_handle;
+			if (!isValid(entity))
+			{
+				entity = max::createEntity();
+			}
 
 			// Transform Component
-			bool hasTransformComponent = false;
-			bx::read(&reader, &hasTransformComponent, sizeof(bool), &err);
-			if (hasTransformComponent)
+			if (0 != (se.m_flags & SceneEntity::Transform))
 			{
-				bx::Vec3 pos = { 0.0f, 0.0f, 0.0f };
-				bx::Quaternion rotation = { 0.0f, 0.0f, 0.0f, 1.0f };
-				bx::Vec3 scale = { 0.0f, 0.0f, 0.0f };
-
-				bx::read(&reader, &pos, sizeof(bx::Vec3), &err);
-				bx::read(&reader, &rotation, sizeof(bx::Quaternion), &err);
-				bx::read(&reader, &scale, sizeof(bx::Vec3), &err);
-
-				max::addComponent<TransformComponent>(entity, max::createComponent<TransformComponent>({
-					pos,
-					rotation,
-					scale
-				}));
+				TransformComponent transform = {
+					{ se.m_position[0], se.m_position[1], se.m_position[2] },
+					{ se.m_rotation[0], se.m_rotation[1], se.m_rotation[2], se.m_rotation[3] },
+					{ se.m_scale[0], se.m_scale[1], se.m_scale[2] }
+				};
+
+				if (TransformComponent* tc = max::getComponent<TransformComponent>(entity))
+				{
+					// Keep slot of cached world matrix, it is recomputed from these.
+					tc->m_position = transform.m_position;
+					tc->m_rotation = transform.m_rotation;
+					tc->m_scale = transform.m_scale;
+				}
+				else
+				{
+					max::addComponent<TransformComponent>(entity, max::createComponent<TransformComponent>(transform));
+				}
 			}
 
 			// Render Component
-			bool hasRenderComponent = false;
-			bx::read(&reader, &hasRenderComponent, sizeof(bool), &err);
-			if (hasRenderComponent)
+			if (0 != (se.m_flags & SceneEntity::Render))
 			{
-				uint32_t num = 0;
-				bx::read(&reader, &num, sizeof(uint32_t), &err);
-				BX_ASSERT(num <= 1, "Deserialization of meshes with multiple groups not supported.")
-
-				max::VertexLayout layout;
-				bx::read(&reader, &layout.m_hash, sizeof(uint32_t), &err);
-				bx::read(&reader, &layout.m_stride, sizeof(uint16_t), &err);
-				bx::read(&reader, &layout.m_offset, sizeof(uint16_t) * max::Attrib::Count, &err);
-				bx::read(&reader, &layout.m_attributes, sizeof(uint16_t) * max::Attrib::Count, &err);
-
-				// @todo Something is wrong with how data is used to create meshes, we getting leaks
-				uint32_t verticesSize = 0;
-				bx::read(&reader, &verticesSize, sizeof(uint32_t), &err);
-				const max::Memory* vertices = max::alloc(verticesSize);
-				bx::read(&reader, vertices->data, verticesSize, &err);
-
-				uint32_t indicesSize = 0;
-				bx::read(&reader, &indicesSize, sizeof(uint32_t), &err);
-				const max::Memory* indices = max::alloc(indicesSize);
-				bx::read(&reader, indices->data, indicesSize, &err);
-
-				max::MeshHandle mesh = max::createMesh(vertices, indices, layout);
-
-				max::addComponent<RenderComponent>(entity, max::createComponent<RenderComponent>({ mesh }));
+				max::MeshHandle mesh = MAX_INVALID_HANDLE;
+				if (se.m_mesh < block->m_numMeshes)
+				{
+					mesh = meshHandles[se.m_mesh];
+					if (!isValid(mesh))
+					{
+						mesh = createDeltaMesh(block, meshes[se.m_mesh]);
+						meshHandles[se.m_mesh] = mesh;
+					}
+				}
+
+				if (isValid(mesh))
+				{
+					acquireMesh(mesh);
+
+					if (RenderComponent* rc = max::getComponent<RenderComponent>(entity))
+					{
+						releaseMesh(rc->m_mesh);
+						rc->m_mesh = mesh;
+						rc->m_bounds = getMeshBounds(mesh);
+					}
+					else
+					{
+						max::addComponent<RenderComponent>(entity, max::createComponent<RenderComponent>({ mesh, false, getMeshBounds(mesh) }));
+					}
+				}
+				else
+				{
+					BX_TRACE("Entity %s in delta log references invalid mesh %d", name, se.m_mesh)
+					m_loaderResult = false;
+				}
 			}
 
 			// Material Component
-			bool hasMaterialCompoenent = false;
-			bx::read(&reader, &hasMaterialCompoenent, sizeof(bool), &err);
-			if (hasMaterialCompoenent)
+			if (0 != (se.m_flags & SceneEntity::Material))
 			{
 				MaterialComponent material;
+				material.m_diffuse = { MAX_INVALID_HANDLE, stringIntern(SceneDeltaFile::getString(block, se.m_material.m_diffuse)) };
+				material.m_normal = { MAX_INVALID_HANDLE, stringIntern(SceneDeltaFile::getString(block, se.m_material.m_normal)) };
+				material.m_roughness = { MAX_INVALID_HANDLE, stringIntern(SceneDeltaFile::getString(block, se.m_material.m_roughness)) };
+				material.m_metallic = { MAX_INVALID_HANDLE, stringIntern(SceneDeltaFile::getString(block, se.m_material.m_metallic)) };
 
-				// Textures.
-				bx::strCopy(material.m_diffuse.m_filepath, 1024, "");
-				material.m_diffuse.m_texture = MAX_INVALID_HANDLE;
+				// New textures first, unchanged ones stay loaded.
+				loadMaterial(entity, material);
 
-				bx::strCopy(material.m_normal.m_filepath, 1024, "");
-				material.m_normal.m_texture = MAX_INVALID_HANDLE;
+				bx::memCopy(material.m_diffuseFactor, se.m_material.m_diffuseFactor, sizeof(float) * 3);
+				bx::memCopy(material.m_normalFactor, se.m_material.m_normalFactor, sizeof(float) * 3);
+				material.m_roughnessFactor = se.m_material.m_roughnessFactor;
+				material.m_metallicFactor = se.m_material.m_metallicFactor;
 
-				bx::strCopy(material.m_roughness.m_filepath, 1024, "");
-				material.m_roughness.m_texture = MAX_INVALID_HANDLE;
-
-				bx::strCopy(material.m_metallic.m_filepath, 1024, "");
-				material.m_metallic.m_texture = MAX_INVALID_HANDLE;
-
-				bool hasDiffuse = false;
-				bx::read(&reader, &hasDiffuse, sizeof(bool), &err);
-				if (hasDiffuse)
+				if (MaterialComponent* mc = max::getComponent<MaterialComponent>(entity))
 				{
-					bx::read(&reader, material.m_diffuse.m_filepath, 1024, &err);
-					material.m_diffuse.m_texture = m_textureManager.load(material.m_diffuse.m_filepath);
+					unloadMaterial(entity, *mc);
+					*mc = material;
 				}
-
-				bool hasNormal = false;
-				bx::read(&reader, &hasNormal, sizeof(bool), &err);
-				if (hasNormal)
+				else
 				{
-					bx::read(&reader, material.m_normal.m_filepath, 1024, &err);
-					material.m_normal.m_texture = m_textureManager.load(material.m_normal.m_filepath);
+					max::addComponent<MaterialComponent>(entity, max::createComponent<MaterialComponent>(material));
 				}
+			}
+		}
 
-				bool hasRoughness = false;
-				bx::read(&reader, &hasRoughness, sizeof(bool), &err);
-				if (hasRoughness)
-				{
-					bx::read(&reader, material.m_roughness.m_filepath, 1024, &err);
-					material.m_roughness.m_texture = m_textureManager.load(material.m_roughness.m_filepath);
-				}
+		++numBlocks;
+	}
+
+	if (delta.isComplete())
+	{
+		m_deltaSize = delta.m_file.m_size;
+	}
+	else
+	{
+		// Blocks after a torn write are lost, next save rewrites the whole scene instead of appending past it.
+		BX_TRACE("Delta log of %s is truncated, replayed %d blocks", filepath.getCPtr(), numBlocks)
+		m_baseUid = 0;
+	}
+
+	delta.close();
+}
+
+bool World::getLoadProgress(uint32_t& _outLoaded, uint32_t& _outTotal) const
+{
+	_outLoaded = m_loader.m_numLoaded;
+	_outTotal = m_loader.m_numTotal;
+	return m_loader.isActive();
+}
+
+uint32_t World::createEntities(uint32_t _max, int64_t _deadline)
+{
+	uint32_t num = 0;
 
-				bool hasMetallic = false;
-				bx::read(&reader, &hasMetallic, sizeof(bool), &err);
-				if (hasMetallic)
+	const SceneLoadEntity* le = NULL;
+	while (num < _max && NULL != (le = m_loader.next()))
+	{
+		BX_ASSERT(bx::strCmp(le->m_name, "") != bx::kExitSuccess, "Trying to create entity with invalid name.")
+
+		max::EntityHandle entity = max::createEntity();
+
+		// Transform Component
+		if (0 != (le->m_flags & SceneEntity::Transform))
+		{
+			max::addComponent<TransformComponent>(entity, max::createComponent<TransformComponent>({
+				{ le->m_position[0], le->m_position[1], le->m_position[2] },
+				{ le->m_rotation[0], le->m_rotation[1], le->m_rotation[2], le->m_rotation[3] },
+				{ le->m_scale[0], le->m_scale[1], le->m_scale[2] }
+			}));
+		}
+
+		// Render Component
+		if (0 != (le->m_flags & SceneEntity::Render))
+		{
+			max::MeshHandle mesh = MAX_INVALID_HANDLE;
+
+			if (UINT32_MAX != le->m_mesh)
+			{
+				mesh = m_loaderMeshes[le->m_mesh];
+				if (!isValid(mesh))
 				{
-					bx::read(&reader, material.m_metallic.m_filepath, 1024, &err);
-					material.m_metallic.m_texture = m_textureManager.load(material.m_metallic.m_filepath);
+					SceneLoadMesh& lm = m_loader.getMesh(le->m_mesh);
+
+					// Memory is only released once consumed, both streams are checked before either is created.
+					const bool valid = lm.m_valid
+						&& (NULL != lm.m_vertices || m_loader.m_scene->isGeometry(lm.m_verticesOffset, lm.m_verticesSize) )
+						&& (NULL != lm.m_indices  || m_loader.m_scene->isGeometry(lm.m_indicesOffset, lm.m_indicesSize) )
+						;
+
+					if (valid)
+					{
+						// Decoded geometry is handed over to the renderer, the rest is referenced straight from the mapped file.
+						const max::Memory* vertices = takeDecoded(lm.m_vertices, lm.m_verticesSize);
+						if (NULL == vertices)
+						{
+							vertices = m_loader.m_scene->makeRef(lm.m_verticesOffset, lm.m_verticesSize);
+						}
+
+						const max::Memory* indices = takeDecoded(lm.m_indices, lm.m_indicesSize);
+						if (NULL == indices)
+						{
+							indices = m_loader.m_scene->makeRef(lm.m_indicesOffset, lm.m_indicesSize);
+						}
+
+						// Groups share one vertex and index buffer and are drawn with a single submit.
+						mesh = max::createMesh(vertices, indices, lm.m_layout);
+						m_loaderMeshes[le->m_mesh] = mesh;
+					}
 				}
+			}
 
-				// Factors. 
-				bx::read(&reader, &material.m_diffuseFactor, sizeof(float) * 3, &err);
-				bx::read(&reader, &material.m_normalFactor, sizeof(float) * 3, &err);
-				bx::read(&reader, &material.m_roughnessFactor, sizeof(float), &err);
-				bx::read(&reader, &material.m_metallicFactor, sizeof(float), &err);
+			if (isValid(mesh))
+			{
+				acquireMesh(mesh);
 
-				//
-				max::addComponent<MaterialComponent>(entity, max::createComponent<MaterialComponent>(material));
+				max::addComponent<RenderComponent>(entity, max::createComponent<RenderComponent>({ mesh, false, getMeshBounds(mesh) }));
+			}
+			else
+			{
+				BX_TRACE("Entity %s references invalid mesh %d", le->m_name, le->m_mesh)
+				m_loaderResult = false;
 			}
-
-			EntityHandle entityHandle;
-			entityHandle.m_handle = entity;
-			m_entities[name] = entityHandle;
 		}
 
-		if (!err.isOk() || m_entities.size() <= 0)
+		// Material Component
+		if (0 != (le->m_flags & SceneEntity::Material))
 		{
-			BX_TRACE("Failed to deserialize file at path %s", filepath.getCPtr())
-			return false;
+			MaterialComponent material = le->m_material;
+
+			// Textures.
+			loadMaterial(entity, material);
+
+			//
+			max::addComponent<MaterialComponent>(entity, max::createComponent<MaterialComponent>(material));
 		}
 
-		bx::close(&reader);
-		BX_TRACE("Scene deserialized from %s", filepath.getCPtr());
-		return true;
+		EntityHandle entityHandle;
+		entityHandle.m_handle = entity;
+		m_entities[le->m_name] = entityHandle;
+
+		++num;
+
+		if (bx::getHPCounter() >= _deadline)
+		{
+			break;
+		}
 	}
 
-	BX_TRACE("Failed to open file at path %s", filepath.getCPtr())
-	return false;
-}
\ No newline at end of file
+	return num;
+}
@@ -1,28 +1,182 @@
 #pragma once
 
+#include <string>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include "culling.h"
+#include "default_textures.h"
 #include "texture_manager.h"
 #include "maya_bridge.h"
+#include "scene_loader.h"
+
+#ifndef TG_CONFIG_LOAD_BUDGET_MS
+#	define TG_CONFIG_LOAD_BUDGET_MS 4.0f
+#endif // TG_CONFIG_LOAD_BUDGET_MS
+
+#ifndef TG_CONFIG_ASYNC_TEXTURES
+#	define TG_CONFIG_ASYNC_TEXTURES 1 //!< Decode material textures on worker threads, see `TextureManager::loadAsync`.
+#endif // TG_CONFIG_ASYNC_TEXTURES
+
+#ifndef TG_CONFIG_SCENE_DELTA_RATIO
+#	define TG_CONFIG_SCENE_DELTA_RATIO 0.25f //!< Delta log is compacted into the scene once it exceeds this fraction of the scene size.
+#endif // TG_CONFIG_SCENE_DELTA_RATIO
 
 struct World
 {
 	World()
 		: m_filepath("")
+		, m_loaderResult(true)
+		, m_loadBudgetMs(TG_CONFIG_LOAD_BUDGET_MS)
+		, m_asyncTextures(TG_CONFIG_ASYNC_TEXTURES)
+		, m_defaultTextures(false)
+		, m_baseUid(0)
+		, m_baseSize(0)
+		, m_deltaSize(0)
+		, m_verify(TG_CONFIG_SCENE_VERIFY)
+		, m_verifyAsync(TG_CONFIG_SCENE_VERIFY_ASYNC)
+		, m_compression(TG_CONFIG_SCENE_COMPRESSION)
+		, m_dedupMeshes(TG_CONFIG_SCENE_DEDUP)
 	{}
 
 	void load(const char* _filepath);
+
+	/// Start loading scene without blocking. Entities are created by `update` within a per
+	/// frame time budget and become renderable as they arrive.
+	///
+	/// @param[in] _filepath Path to scene.
+	/// @param[in] _budgetMs Max time in milliseconds spent creating entities per frame.
+	///
+	/// @returns True if loading started.
+	///
+	bool loadAsync(const char* _filepath, float _budgetMs = TG_CONFIG_LOAD_BUDGET_MS);
+
+	/// Unload scene, cancels loading in progress.
 	void unload();
 
+	/// Create entities of scene being loaded and bind textures uploaded since last frame.
 	void update();
 
+	/// Save changes since last save to the delta log, or the whole world once the log has
+	/// grown too large or there is no scene to apply it to.
 	bool serialize();
 	bool deserialize();
 
+	/// Save whole world and drop delta log.
+	bool serializeFull();
+
+	/// Append changes since last save to delta log.
+	bool serializeDelta();
+
+	/// Apply delta log of loaded scene.
+	void replayDelta();
+
+	/// Mark components of entity as changed since last save.
+	///
+	/// @param[in] _name Entity name.
+	/// @param[in] _flags Changed components, see `SceneEntity::Flags`.
+	///
+	void markDirty(const std::string& _name, uint32_t _flags);
+
+	/// Mark entity as removed since last save.
+	void markRemoved(const std::string& _name);
+
+	/// Release mesh and textures of entity and destroy it.
+	void destroyEntity(max::EntityHandle _entity);
+
+	/// Load textures of material, without blocking if `m_asyncTextures` is set, see
+	/// `loadTexture`. Sets path of surface texture, see TG_CONFIG_SURFACE_TEXTURE.
+	void loadMaterial(max::EntityHandle _entity, MaterialComponent& _material);
+
+	/// Release textures of material, see `unloadTexture`.
+	void unloadMaterial(max::EntityHandle _entity, MaterialComponent& _material);
+
+	/// Load texture of material of entity. Until the texture is uploaded, or if it failed to
+	/// load, the material is bound to a default texture. Uploads are bound by `bindTextures`.
+	///
+	/// @param[in] _entity Entity owning the material.
+	/// @param[in,out] _texture Texture of material, path set.
+	/// @param[in] _usage Kind of data in texture, picks cooked format and default texture.
+	/// @param[in] _async Load without blocking, see `TextureManager::loadAsync`.
+	///
+	void loadTexture(max::EntityHandle _entity, MaterialComponent::Texture& _texture, TextureUsage::Enum _usage, bool _async);
+
+	/// Release texture of material of entity and stop binding its uploads to the entity.
+	void unloadTexture(max::EntityHandle _entity, MaterialComponent::Texture& _texture);
+
+	/// Get progress of scene currently being loaded.
+	///
+	/// @param[out] _outLoaded Number of entities created.
+	/// @param[out] _outTotal Number of entities in scene.
+	///
+	/// @returns True if a scene is being loaded.
+	///
+	bool getLoadProgress(uint32_t& _outLoaded, uint32_t& _outTotal) const;
+
+	/// Open scene and start decoding it on worker threads.
+	///
+	/// @param[in] _verify Verify block checksums before decoding, see `SceneFile::verify`.
+	///
+	bool beginDeserialize(bool _verify);
+
+	/// Release loader, mapping stays alive while the renderer references geometry.
+	bool endDeserialize();
+
+	/// Create up to _max entities decoded by the scene loader, stops early once the high
+	/// performance counter passes _deadline.
+	///
+	/// @returns Number of entities created.
+	///
+	uint32_t createEntities(uint32_t _max, int64_t _deadline = INT64_MAX);
+
+	/// Bind uploaded textures to materials using them, replacing placeholders and textures
+	/// recreated with other mips. Only entities using an uploaded texture are visited.
+	void bindTextures(const std::vector<TextureUpload>& _uploaded);
+
+	/// Request texture mips from screen size of entities seen by camera and start streaming them,
+	/// see `TextureManager::stream`. Call once per frame after `update`.
+	///
+	/// @param[in] _cameraIdx Index of active camera, see `CameraComponent::m_idx`.
+	/// @param[in] _viewportHeight Height of viewport in pixels.
+	///
+	void streamTextures(uint32_t _cameraIdx, float _viewportHeight);
+
+	/// Get local bounds of mesh, computed once when first entity references it.
+	const MeshBounds& getMeshBounds(max::MeshHandle _mesh);
+
+	/// Add reference to mesh shared between entities.
+	void acquireMesh(max::MeshHandle _mesh);
+
+	/// Release reference to mesh, destroyed when no entity references it.
+	void releaseMesh(max::MeshHandle _mesh);
+
 	char m_filepath[1024];
 
 	std::unordered_map<std::string, EntityHandle> m_entities;
 	std::unordered_map<std::string, TextureHandle> m_textures;
+	std::unordered_map<const char*, std::vector<max::EntityHandle> > m_textureUsers; //!< Interned texture path to entities with a material using it, once per use.
+	std::unordered_map<uint16_t, uint32_t> m_meshRefs; //!< Mesh handle to number of referencing entities.
+	std::unordered_map<uint16_t, MeshBounds> m_meshBounds; //!< Mesh handle to bounds, see `getMeshBounds`.
 
 	TextureManager m_textureManager;
-};
\ No newline at end of file
+
+	SceneLoader m_loader;
+	std::vector<max::MeshHandle> m_loaderMeshes; //!< Meshes created so far from loader, indexed by mesh table index.
+	bool m_loaderResult;                         //!< False if any entity failed to load.
+	float m_loadBudgetMs;                        //!< Per frame budget of asynchronous load, see `loadAsync`.
+	bool m_asyncTextures;                        //!< Load material textures of scenes with `TextureManager::loadAsync`.
+	std::vector<TextureUpload> m_textureUploads; //!< Scratch for `update`.
+	bool m_defaultTextures;                      //!< Holds reference to default textures bound as placeholders.
+
+	uint64_t m_baseUid;     //!< Uid of scene on disk the world matches apart from tracked changes, 0 if none.
+	uint64_t m_baseSize;    //!< Size of that scene in bytes.
+	uint64_t m_deltaSize;   //!< Size of its delta log in bytes, 0 if none.
+	bool m_verify;          //!< Verify block checksums of scenes on load, see `SceneFile::verify`.
+	bool m_verifyAsync;     //!< Verify them on `loadAsync` as well, waits for all blocks to be read.
+	uint32_t m_compression; //!< Geometry compression of saved scenes, see `SceneCompression::Enum`.
+	bool m_dedupMeshes;     //!< Store meshes with identical contents once in saved scenes, see `SceneMeshTable`.
+
+	std::unordered_map<std::string, uint32_t> m_dirty; //!< Entity name to components changed since last save.
+	std::unordered_set<std::string> m_removed;         //!< Entities removed since last save.
+};